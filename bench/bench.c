@@ -0,0 +1,60 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_MIN_DURATION (100 * 1000 * 1000) /* ns */
+
+uint64_t bench_now (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+void bench_report (
+   const char * benchmark,
+   const char * metric,
+   double value,
+   const char * unit)
+{
+   printf ("%s,%s,%.3f,%s\n", benchmark, metric, value, unit);
+   fflush (stdout);
+}
+
+double bench_measure (void (*fn) (void * arg, unsigned int n), void * arg)
+{
+   unsigned int n = 16;
+   uint64_t elapsed;
+
+   for (;;)
+   {
+      uint64_t start = bench_now();
+
+      fn (arg, n);
+      elapsed = bench_now() - start;
+
+      if (elapsed >= BENCH_MIN_DURATION || n >= (1U << 30))
+         break;
+
+      n *= 2;
+   }
+
+   return (double)elapsed / n;
+}
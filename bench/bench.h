@@ -0,0 +1,89 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Benchmark support
+ *
+ * Benchmarks report results as comma-separated lines on stdout:
+ *
+ *    benchmark,metric,value,unit
+ *
+ * so that results can be collected and compared across releases.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Get monotonic time
+ *
+ * @return time in nanoseconds
+ */
+uint64_t bench_now (void);
+
+/**
+ * Report benchmark result
+ *
+ * @param benchmark     name of benchmark
+ * @param metric        name of metric
+ * @param value         measured value
+ * @param unit          unit of value
+ */
+void bench_report (
+   const char * benchmark,
+   const char * metric,
+   double value,
+   const char * unit);
+
+/**
+ * Measure time per iteration
+ *
+ * This function calls \a fn with an increasing number of iterations
+ * until a run lasts long enough to give a stable result.
+ *
+ * @param fn            function running \a n iterations
+ * @param arg           function argument
+ *
+ * @return time per iteration in nanoseconds
+ */
+double bench_measure (void (*fn) (void * arg, unsigned int n), void * arg);
+
+/** Seqlock contention benchmarks */
+void bench_seqlock (void);
+
+/** Object dictionary lookup benchmarks */
+void bench_od (void);
+
+/** PDO packing benchmarks */
+void bench_pdo (void);
+
+/** Frame dispatch benchmarks, on the virtual bus */
+void bench_rx (void);
+
+/** SDO transfer benchmarks, on the virtual bus */
+void bench_sdo (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCH_H */
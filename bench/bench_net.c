@@ -0,0 +1,220 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/*
+ * End-to-end benchmarks on the virtual bus. Frame dispatch is
+ * measured on a threadless network, receiving frames from a raw bus
+ * channel. SDO transfers are measured between two networks serviced
+ * by one reactor. The bus is not paced, so that the results reflect
+ * the cost of the stack.
+ */
+
+#include "bench.h"
+#include "co_api.h"
+#include "co_vbus.h"
+#include "osal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_BATCH       32
+#define BENCH_DOMAIN_SIZE 1024
+
+typedef struct bench_frame
+{
+   const char * metric;
+   uint32_t id;
+   uint8_t dlc;
+   uint8_t data[8];
+} bench_frame_t;
+
+typedef struct bench_rx
+{
+   co_net_t * net;
+   co_vbus_node_t * node;
+   const bench_frame_t * frame;
+} bench_rx_t;
+
+typedef struct bench_sdo
+{
+   co_client_t * client;
+   uint8_t data[BENCH_DOMAIN_SIZE];
+   size_t size;
+   int status;
+} bench_sdo_t;
+
+static uint32_t bench_2001;
+static uint8_t bench_2002[BENCH_DOMAIN_SIZE];
+
+static const co_entry_t OD1000[] = {
+   {0, OD_RO, DTYPE_UNSIGNED32, 32, 0x00000000, NULL},
+};
+
+static const co_entry_t OD2001[] = {
+   {0, OD_RW | OD_TPDO | OD_RPDO, DTYPE_UNSIGNED32, 32, 0, &bench_2001},
+};
+
+static const co_entry_t OD2002[] = {
+   {0, OD_RW, DTYPE_OCTET_STRING, 8 * BENCH_DOMAIN_SIZE, 0, bench_2002},
+};
+
+static const co_obj_t bench_net_od[] = {
+   {0x1000, OTYPE_VAR, 0, OD1000, NULL, NULL},
+   {0x2001, OTYPE_VAR, 0, OD2001, NULL, NULL},
+   {0x2002, OTYPE_VAR, 0, OD2002, NULL, NULL},
+   {0, OTYPE_NULL, 0, NULL, NULL, NULL},
+};
+
+/* Frames received by node 1, one kind per batch */
+static const bench_frame_t bench_frames[] = {
+   {"nmt", 0x000, 2, {0x01, 0x05}},
+   {"sync", 0x080, 0, {0}},
+   {"heartbeat", 0x705, 1, {0x05}},
+   {"pdo", 0x185, 8, {0}},
+   {"sdo_other", 0x605, 8, {0x40, 0x01, 0x20, 0x00}},
+   {"sdo_upload", 0x601, 8, {0x40, 0x01, 0x20, 0x00}},
+};
+
+static co_net_t * bench_net_init (const char * bus, uint8_t node, co_reactor_t * reactor)
+{
+   co_cfg_t cfg;
+
+   memset (&cfg, 0, sizeof (cfg));
+   cfg.node       = node;
+   cfg.od         = bench_net_od;
+   cfg.reactor    = reactor;
+   cfg.threadless = (reactor == NULL);
+
+   return co_init (bus, &cfg);
+}
+
+static void bench_rx_batch (void * arg, unsigned int n)
+{
+   bench_rx_t * bench = arg;
+   const bench_frame_t * frame = bench->frame;
+   unsigned int ix;
+
+   for (ix = 0; ix < n; ix++)
+   {
+      co_vbus_send (bench->node, frame->id, frame->data, frame->dlc);
+
+      /* Periodic processing is not included */
+      if ((ix % BENCH_BATCH) == BENCH_BATCH - 1 || ix == n - 1)
+         co_poll (bench->net, 0);
+   }
+}
+
+void bench_rx (void)
+{
+   static bench_rx_t bench;
+   size_t ix;
+
+   bench.net  = bench_net_init ("bench_rx", 1, NULL);
+   bench.node = co_vbus_open ("bench_rx", NULL, NULL);
+   if (bench.net == NULL || bench.node == NULL)
+   {
+      fprintf (stderr, "rx: failed to open virtual bus\n");
+      return;
+   }
+
+   /* Boot up to pre-operational */
+   co_poll (bench.net, os_tick_current());
+
+   for (ix = 0; ix < sizeof (bench_frames) / sizeof (bench_frames[0]); ix++)
+   {
+      bench.frame = &bench_frames[ix];
+      bench_report (
+         "rx_dispatch",
+         bench.frame->metric,
+         bench_measure (bench_rx_batch, &bench),
+         "ns");
+   }
+}
+
+static void bench_sdo_read (void * arg, unsigned int n)
+{
+   bench_sdo_t * bench = arg;
+   unsigned int ix;
+
+   for (ix = 0; ix < n; ix++)
+   {
+      uint16_t index = (bench->size > 4) ? 0x2002 : 0x2001;
+
+      if (co_sdo_read (bench->client, 2, index, 0, bench->data, bench->size) < 0)
+         bench->status = -1;
+   }
+}
+
+static void bench_sdo_write (void * arg, unsigned int n)
+{
+   bench_sdo_t * bench = arg;
+   unsigned int ix;
+
+   for (ix = 0; ix < n; ix++)
+   {
+      uint16_t index = (bench->size > 4) ? 0x2002 : 0x2001;
+
+      if (co_sdo_write (bench->client, 2, index, 0, bench->data, bench->size) < 0)
+         bench->status = -1;
+   }
+}
+
+static void bench_sdo_run (bench_sdo_t * bench, const char * name, size_t size)
+{
+   double read, write;
+
+   bench->size   = size;
+   bench->status = 0;
+
+   read  = bench_measure (bench_sdo_read, bench);
+   write = bench_measure (bench_sdo_write, bench);
+
+   if (bench->status != 0)
+   {
+      fprintf (stderr, "%s: transfer failed\n", name);
+      return;
+   }
+
+   bench_report (name, "read", read / 1000, "us");
+   bench_report (name, "write", write / 1000, "us");
+   bench_report (name, "read_rate", size * 1e9 / read, "B/s");
+   bench_report (name, "write_rate", size * 1e9 / write, "B/s");
+}
+
+void bench_sdo (void)
+{
+   static bench_sdo_t bench;
+   co_reactor_t * reactor;
+   co_net_t * client;
+
+   reactor = co_reactor_create (-1);
+   if (reactor == NULL)
+   {
+      fprintf (stderr, "sdo: failed to create reactor\n");
+      return;
+   }
+
+   client = bench_net_init ("bench_sdo", 1, reactor);
+   if (client == NULL || bench_net_init ("bench_sdo", 2, reactor) == NULL)
+   {
+      fprintf (stderr, "sdo: failed to open virtual bus\n");
+      return;
+   }
+
+   bench.client = co_client_init (client);
+
+   bench_sdo_run (&bench, "sdo_expedited", sizeof (bench_2001));
+   bench_sdo_run (&bench, "sdo_segmented", BENCH_DOMAIN_SIZE);
+}
@@ -0,0 +1,126 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/*
+ * Measures object lookup in dictionaries of realistic sizes. Sorted
+ * dictionaries are searched by bisection, unsorted dictionaries are
+ * walked from the start.
+ */
+
+#include "bench.h"
+#include "co_main.h"
+#include "co_od.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_LOOKUPS 1024
+
+typedef struct bench_od
+{
+   co_net_t * net;
+   uint16_t indexes[BENCH_LOOKUPS];
+   uintptr_t sink;
+} bench_od_t;
+
+static co_obj_t * bench_od_create (size_t size, bool sorted)
+{
+   static uint32_t value;
+   static const co_entry_t entry = {0, OD_RW, DTYPE_UNSIGNED32, 32, 0, &value};
+   co_obj_t * od = calloc (size + 1, sizeof (*od));
+   size_t ix;
+
+   for (ix = 0; ix < size; ix++)
+   {
+      /* Reversed order when unsorted, the average walk is the same */
+      co_obj_t * obj = &od[sorted ? ix : size - 1 - ix];
+
+      obj->index        = 0x2000 + ix;
+      obj->objtype      = OTYPE_VAR;
+      obj->max_subindex = 0;
+      obj->entries      = &entry;
+   }
+
+   return od;
+}
+
+static void bench_od_find (void * arg, unsigned int n)
+{
+   bench_od_t * bench = arg;
+   unsigned int ix;
+
+   for (ix = 0; ix < n; ix++)
+   {
+      const co_obj_t * obj;
+
+      obj = co_obj_find (bench->net, bench->indexes[ix % BENCH_LOOKUPS]);
+      bench->sink += (uintptr_t)obj;
+   }
+}
+
+static void bench_od_run (size_t size, bool sorted)
+{
+   static co_net_t net;
+   static bench_od_t bench;
+   uint32_t seed = 1;
+   char name[32];
+   co_obj_t * od;
+   size_t ix;
+
+   od     = bench_od_create (size, sorted);
+   net.od = od;
+   co_od_init (&net, 0);
+   bench.net = &net;
+
+   snprintf (name, sizeof (name), "od_find_%u", (unsigned int)size);
+
+   /* Existing objects, in random order */
+   for (ix = 0; ix < BENCH_LOOKUPS; ix++)
+   {
+      seed              = seed * 1103515245 + 12345;
+      bench.indexes[ix] = 0x2000 + (seed >> 16) % size;
+   }
+   bench_report (
+      name,
+      sorted ? "hit_sorted" : "hit_unsorted",
+      bench_measure (bench_od_find, &bench),
+      "ns");
+
+   /* Missing objects */
+   for (ix = 0; ix < BENCH_LOOKUPS; ix++)
+   {
+      bench.indexes[ix] = 0x1000 + ix;
+   }
+   bench_report (
+      name,
+      sorted ? "miss_sorted" : "miss_unsorted",
+      bench_measure (bench_od_find, &bench),
+      "ns");
+
+   free (od);
+}
+
+void bench_od (void)
+{
+   static const size_t sizes[] = {30, 300, 3000};
+   size_t ix;
+
+   for (ix = 0; ix < sizeof (sizes) / sizeof (sizes[0]); ix++)
+   {
+      bench_od_run (sizes[ix], true);
+      bench_od_run (sizes[ix], false);
+   }
+}
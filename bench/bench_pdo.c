@@ -0,0 +1,129 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/*
+ * Measures packing of objects into TPDO frames and unpacking of RPDO
+ * frames into objects, for typical mapping layouts.
+ */
+
+#include "bench.h"
+#include "co_main.h"
+#include "co_od.h"
+#include "co_pdo.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct bench_layout
+{
+   const char * name;
+   co_dtype_t datatype;
+   uint8_t bitlength;
+   uint8_t count;
+} bench_layout_t;
+
+typedef struct bench_pdo
+{
+   co_net_t * net;
+   co_pdo_t * pdo;
+} bench_pdo_t;
+
+static const bench_layout_t bench_layouts[] = {
+   {"pdo_8x8", DTYPE_UNSIGNED8, 8, 8},
+   {"pdo_4x16", DTYPE_UNSIGNED16, 16, 4},
+   {"pdo_2x32", DTYPE_UNSIGNED32, 32, 2},
+   {"pdo_1x64", DTYPE_UNSIGNED64, 64, 1},
+   {"pdo_64x1", DTYPE_BOOLEAN, 1, 64},
+};
+
+static void bench_pdo_pack (void * arg, unsigned int n)
+{
+   bench_pdo_t * bench = arg;
+   unsigned int ix;
+
+   for (ix = 0; ix < n; ix++)
+   {
+      co_pdo_pack (bench->net, bench->pdo);
+   }
+}
+
+static void bench_pdo_unpack (void * arg, unsigned int n)
+{
+   bench_pdo_t * bench = arg;
+   unsigned int ix;
+
+   for (ix = 0; ix < n; ix++)
+   {
+      bench->pdo->frame = ix;
+      co_pdo_unpack (bench->net, bench->pdo);
+   }
+}
+
+static void bench_pdo_run (const bench_layout_t * layout)
+{
+   static uint64_t values[CO_PDO_MAX_ENTRIES];
+   static co_entry_t entries[CO_PDO_MAX_ENTRIES];
+   static co_obj_t od[CO_PDO_MAX_ENTRIES + 1];
+   static uint32_t mappings[CO_PDO_MAX_ENTRIES];
+   static const co_obj_t * objs[CO_PDO_MAX_ENTRIES];
+   static const co_entry_t * mapped[CO_PDO_MAX_ENTRIES];
+   static co_net_t net;
+   static co_pdo_t pdo;
+   bench_pdo_t bench = {&net, &pdo};
+   unsigned int ix;
+
+   memset (od, 0, sizeof (od));
+   memset (&pdo, 0, sizeof (pdo));
+
+   /* One object per mapping entry, as in a typical device profile */
+   for (ix = 0; ix < layout->count; ix++)
+   {
+      entries[ix].subindex  = 0;
+      entries[ix].flags     = OD_RW | OD_TPDO | OD_RPDO;
+      entries[ix].datatype  = layout->datatype;
+      entries[ix].bitlength = layout->bitlength;
+      entries[ix].data      = &values[ix];
+
+      od[ix].index   = 0x6000 + ix;
+      od[ix].objtype = OTYPE_VAR;
+      od[ix].entries = &entries[ix];
+
+      mappings[ix] = (od[ix].index << 16) | layout->bitlength;
+      objs[ix]     = &od[ix];
+      mapped[ix]   = &entries[ix];
+   }
+
+   net.od = od;
+   co_od_init (&net, 0);
+
+   pdo.number_of_mappings = layout->count;
+   pdo.bitlength          = layout->count * layout->bitlength;
+   pdo.mappings           = mappings;
+   pdo.objs               = objs;
+   pdo.entries            = mapped;
+
+   bench_report (layout->name, "pack", bench_measure (bench_pdo_pack, &bench), "ns");
+   bench_report (layout->name, "unpack", bench_measure (bench_pdo_unpack, &bench), "ns");
+}
+
+void bench_pdo (void)
+{
+   size_t ix;
+
+   for (ix = 0; ix < sizeof (bench_layouts) / sizeof (bench_layouts[0]); ix++)
+   {
+      bench_pdo_run (&bench_layouts[ix]);
+   }
+}
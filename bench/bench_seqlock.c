@@ -0,0 +1,211 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/*
+ * Measures the cost of consistent reads of a multi-byte object that
+ * is continuously written by another thread. The seqlock, as used by
+ * the stack for objects with a sequence counter, is compared to a
+ * mutex protecting the same object.
+ */
+
+#include "bench.h"
+#include "co_api.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_DURATION    (250 * 1000 * 1000) /* ns */
+#define BENCH_MAX_READERS 4
+#define BENCH_OBJECT_SIZE 64
+
+typedef enum bench_mode
+{
+   BENCH_SEQLOCK,
+   BENCH_MUTEX,
+} bench_mode_t;
+
+typedef struct bench_object
+{
+   co_seqlock_t lock;
+   pthread_mutex_t mutex;
+   uint8_t data[BENCH_OBJECT_SIZE];
+   bench_mode_t mode;
+   bool stop;
+} bench_object_t;
+
+typedef struct bench_reader
+{
+   pthread_t thread;
+   bench_object_t * object;
+   uint64_t reads;
+   uint64_t retries;
+   uint64_t torn;
+} bench_reader_t;
+
+typedef struct bench_writer
+{
+   pthread_t thread;
+   bench_object_t * object;
+   uint64_t writes;
+} bench_writer_t;
+
+static bool bench_stopped (bench_object_t * object)
+{
+   return __atomic_load_n (&object->stop, __ATOMIC_RELAXED);
+}
+
+static void * bench_writer (void * arg)
+{
+   bench_writer_t * writer  = arg;
+   bench_object_t * object = writer->object;
+   uint8_t value           = 0;
+
+   while (!bench_stopped (object))
+   {
+      value++;
+
+      if (object->mode == BENCH_SEQLOCK)
+      {
+         co_seqlock_write_begin (&object->lock);
+         memset (object->data, value, sizeof (object->data));
+         co_seqlock_write_end (&object->lock);
+      }
+      else
+      {
+         pthread_mutex_lock (&object->mutex);
+         memset (object->data, value, sizeof (object->data));
+         pthread_mutex_unlock (&object->mutex);
+      }
+
+      writer->writes++;
+   }
+
+   return NULL;
+}
+
+static void * bench_reader (void * arg)
+{
+   bench_reader_t * reader = arg;
+   bench_object_t * object = reader->object;
+   uint8_t snapshot[BENCH_OBJECT_SIZE];
+
+   while (!bench_stopped (object))
+   {
+      if (object->mode == BENCH_SEQLOCK)
+      {
+         uint32_t sequence;
+
+         for (;;)
+         {
+            sequence = co_seqlock_read_begin (&object->lock);
+            memcpy (snapshot, object->data, sizeof (snapshot));
+            if (!co_seqlock_read_retry (&object->lock, sequence))
+               break;
+            reader->retries++;
+         }
+      }
+      else
+      {
+         pthread_mutex_lock (&object->mutex);
+         memcpy (snapshot, object->data, sizeof (snapshot));
+         pthread_mutex_unlock (&object->mutex);
+      }
+
+      /* All bytes are written with the same value */
+      if (memcmp (snapshot, snapshot + 1, sizeof (snapshot) - 1) != 0)
+         reader->torn++;
+
+      reader->reads++;
+   }
+
+   return NULL;
+}
+
+static void bench_run (bench_mode_t mode, int n_readers)
+{
+   static bench_object_t object;
+   bench_reader_t readers[BENCH_MAX_READERS];
+   bench_writer_t writer;
+   uint64_t reads   = 0;
+   uint64_t retries = 0;
+   uint64_t torn    = 0;
+   uint64_t start;
+   double elapsed;
+   char name[32];
+   int ix;
+
+   memset (&object, 0, sizeof (object));
+   pthread_mutex_init (&object.mutex, NULL);
+   object.mode = mode;
+
+   memset (&writer, 0, sizeof (writer));
+   memset (readers, 0, sizeof (readers));
+
+   start = bench_now();
+
+   writer.object = &object;
+   pthread_create (&writer.thread, NULL, bench_writer, &writer);
+
+   for (ix = 0; ix < n_readers; ix++)
+   {
+      readers[ix].object = &object;
+      pthread_create (&readers[ix].thread, NULL, bench_reader, &readers[ix]);
+   }
+
+   while (bench_now() - start < BENCH_DURATION)
+   {
+      struct timespec ts = {0, 10 * 1000 * 1000};
+      nanosleep (&ts, NULL);
+   }
+
+   __atomic_store_n (&object.stop, true, __ATOMIC_RELAXED);
+
+   pthread_join (writer.thread, NULL);
+   for (ix = 0; ix < n_readers; ix++)
+   {
+      pthread_join (readers[ix].thread, NULL);
+      reads += readers[ix].reads;
+      retries += readers[ix].retries;
+      torn += readers[ix].torn;
+   }
+
+   elapsed = (bench_now() - start) / 1e9;
+   pthread_mutex_destroy (&object.mutex);
+
+   snprintf (
+      name,
+      sizeof (name),
+      "%s_%dr",
+      (mode == BENCH_SEQLOCK) ? "seqlock" : "mutex",
+      n_readers);
+
+   bench_report (name, "reads", reads / elapsed, "1/s");
+   bench_report (name, "writes", writer.writes / elapsed, "1/s");
+   bench_report (name, "retries", reads ? (double)retries / reads : 0, "1/read");
+   bench_report (name, "torn", torn, "reads");
+}
+
+void bench_seqlock (void)
+{
+   int n_readers;
+
+   for (n_readers = 1; n_readers <= BENCH_MAX_READERS; n_readers *= 2)
+   {
+      bench_run (BENCH_SEQLOCK, n_readers);
+      bench_run (BENCH_MUTEX, n_readers);
+   }
+}
@@ -0,0 +1,59 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct bench
+{
+   const char * name;
+   void (*run) (void);
+} bench_t;
+
+static const bench_t benchmarks[] = {
+   {"seqlock", bench_seqlock},
+   {"od", bench_od},
+   {"pdo", bench_pdo},
+#ifdef CO_VIRTUAL_CAN
+   {"rx", bench_rx},
+   {"sdo", bench_sdo},
+#endif
+};
+
+int main (int argc, char * argv[])
+{
+   size_t ix;
+
+   if (argc > 2)
+   {
+      printf ("usage: %s [filter]\n", argv[0]);
+      return -1;
+   }
+
+   printf ("benchmark,metric,value,unit\n");
+
+   for (ix = 0; ix < sizeof (benchmarks) / sizeof (benchmarks[0]); ix++)
+   {
+      /* Run benchmarks whose name contains filter, if any */
+      if (argc == 2 && strstr (benchmarks[ix].name, argv[1]) == NULL)
+         continue;
+
+      benchmarks[ix].run();
+   }
+
+   return 0;
+}
@@ -0,0 +1,63 @@
+#********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2017 rt-labs AB, Sweden.
+#
+# This software is dual-licensed under GPLv3 and a commercial
+# license. See the file LICENSE.md distributed with this software for
+# full license information.
+#*******************************************************************/
+
+# Generate an object dictionary from an EDS or DCF file and add it to
+# a target.
+#
+# co_generate_od(<target> <eds>
+#   [NAME <name>]        # basename of generated files, default <target>_od
+#   [PREFIX <prefix>]    # symbol prefix, default <name>
+#   [NODE_ID <id>]       # node ID for $NODEID default values
+#   )
+#
+# The generated files are placed in the binary directory and built
+# as a static library named <name>, which is linked to the target.
+# The dictionary is regenerated when the EDS file changes.
+
+set(CO_EDS2C ${CMAKE_CURRENT_LIST_DIR}/../util/eds2c/eds2c.py)
+
+function(co_generate_od TARGET EDS)
+  cmake_parse_arguments(OD "" "NAME;PREFIX;NODE_ID" "" ${ARGN})
+
+  find_package(Python3 REQUIRED COMPONENTS Interpreter)
+
+  if (NOT OD_NAME)
+    set(OD_NAME ${TARGET}_od)
+  endif()
+  if (NOT OD_PREFIX)
+    set(OD_PREFIX ${OD_NAME})
+  endif()
+
+  get_filename_component(EDS ${EDS} ABSOLUTE)
+  set(OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${OD_NAME})
+
+  set(ARGS ${EDS} -o ${OUTPUT} -p ${OD_PREFIX})
+  if (OD_NODE_ID)
+    list(APPEND ARGS -n ${OD_NODE_ID})
+  endif()
+
+  add_custom_command(
+    OUTPUT ${OUTPUT}.c ${OUTPUT}.h
+    COMMAND Python3::Interpreter ${CO_EDS2C} ${ARGS}
+    DEPENDS ${EDS} ${CO_EDS2C}
+    COMMENT "Generating object dictionary ${OD_NAME} from ${EDS}"
+    VERBATIM
+    )
+
+  add_library(${OD_NAME} STATIC ${OUTPUT}.c ${OUTPUT}.h)
+  target_include_directories(${OD_NAME} PUBLIC ${CMAKE_CURRENT_BINARY_DIR})
+  target_link_libraries(${OD_NAME} PUBLIC canopen)
+  target_link_libraries(${TARGET} PRIVATE ${OD_NAME})
+endfunction()
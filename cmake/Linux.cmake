@@ -13,14 +13,25 @@
 # full license information.
 #*******************************************************************/
 
+if (CO_VIRTUAL_CAN)
+  set(CO_PORT src/ports/virtual)
+  target_sources(canopen PRIVATE src/ports/virtual/co_vbus.c)
+elseif (CO_REPLAY_CAN)
+  set(CO_PORT src/ports/replay)
+  target_sources(canopen PRIVATE src/ports/replay/co_replay_file.c)
+else()
+  set(CO_PORT src/ports/linux)
+endif()
+
 target_include_directories(canopen
   PRIVATE
-  src/ports/linux
+  ${CO_PORT}
   )
 
 target_sources(canopen
   PRIVATE
-  src/ports/linux/coal_can.c
+  ${CO_PORT}/coal_can.c
+  ${CO_PORT}/coal_loop.c
   )
 
 target_compile_options(canopen
@@ -40,18 +51,37 @@ target_link_libraries(canopen
 
 target_include_directories(slave
   PRIVATE
-  src/ports/linux
+  ${CO_PORT}
   )
 
 target_include_directories(slaveinfo
   PRIVATE
-  src/ports/linux
+  ${CO_PORT}
   )
 
 if (BUILD_TESTING)
   set(GOOGLE_TEST_INDIVIDUAL TRUE)
   target_include_directories(co_test
     PRIVATE
-    src/ports/linux
+    ${CO_PORT}
+    )
+endif()
+
+if (CMAKE_PROJECT_NAME STREQUAL CANOPEN)
+  add_executable(co_bench "")
+  set_target_properties (co_bench
+    PROPERTIES
+    C_STANDARD 99
+    )
+  target_compile_options(co_bench
+    PRIVATE
+    -Wall
+    -Wextra
+    -Werror
+    -Wno-unused-parameter
+    )
+  target_include_directories(co_bench
+    PRIVATE
+    ${CO_PORT}
     )
 endif()
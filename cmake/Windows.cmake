@@ -15,14 +15,25 @@
 
 find_package(Canlib)
 
+if (CO_VIRTUAL_CAN)
+  set(CO_PORT src/ports/virtual)
+  target_sources(canopen PRIVATE src/ports/virtual/co_vbus.c)
+elseif (CO_REPLAY_CAN)
+  set(CO_PORT src/ports/replay)
+  target_sources(canopen PRIVATE src/ports/replay/co_replay_file.c)
+else()
+  set(CO_PORT src/ports/windows)
+endif()
+
 target_include_directories(canopen
   PRIVATE
-  src/ports/windows
+  ${CO_PORT}
   )
 
 target_sources(canopen
   PRIVATE
-  src/ports/windows/coal_can.c
+  ${CO_PORT}/coal_can.c
+  ${CO_PORT}/coal_loop.c
   )
 
 target_compile_options(canopen
@@ -41,18 +52,18 @@ target_link_libraries(canopen
 
 target_include_directories(slave
   PRIVATE
-  src/ports/windows
+  ${CO_PORT}
   )
 
 target_include_directories(slaveinfo
   PRIVATE
-  src/ports/windows
+  ${CO_PORT}
   )
 
 if (BUILD_TESTING)
   set(GOOGLE_TEST_INDIVIDUAL TRUE)
   target_include_directories(co_test
     PRIVATE
-    src/ports/windows
+    ${CO_PORT}
     )
 endif()
@@ -13,14 +13,22 @@
 # full license information.
 #*******************************************************************/
 
+if (CO_VIRTUAL_CAN)
+  set(CO_PORT src/ports/virtual)
+  target_sources(canopen PRIVATE src/ports/virtual/co_vbus.c)
+else()
+  set(CO_PORT src/ports/rt-kernel)
+endif()
+
 target_include_directories(canopen
   PRIVATE
-  src/ports/rt-kernel
+  ${CO_PORT}
   )
 
 target_sources(canopen
   PRIVATE
-  src/ports/rt-kernel/coal_can.c
+  ${CO_PORT}/coal_can.c
+  ${CO_PORT}/coal_loop.c
   )
 
 target_compile_options(canopen
@@ -38,17 +46,17 @@ install (FILES
 
 target_include_directories(slave
   PRIVATE
-  src/ports/rt-kernel
+  ${CO_PORT}
   )
 
 target_include_directories(slaveinfo
   PRIVATE
-  src/ports/rt-kernel
+  ${CO_PORT}
   )
 
 if (BUILD_TESTING)
   target_include_directories(co_test
     PRIVATE
-    src/ports/rt-kernel
+    ${CO_PORT}
     )
 endif()
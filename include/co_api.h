@@ -38,12 +38,18 @@ typedef struct co_net co_net_t;
 /** Client handle */
 typedef struct co_client co_client_t;
 
+/** Reactor handle */
+typedef struct co_reactor co_reactor_t;
+
 #define CO_STATUS_OK          0
 #define CO_STATUS_ERROR       -1
 #define CO_STATUS_SDO_TOGGLE  -2
 #define CO_STATUS_SDO_TIMEOUT -3
 #define CO_STATUS_SDO_UNKNOWN -4
 
+/** Bitrate that is detected from bus traffic, see co_cfg_t */
+#define CO_BITRATE_AUTO -2
+
 /* Error register bits */
 #define CO_ERR_GENERIC       (1U << 0)
 #define CO_ERR_CURRENT       (1U << 1)
@@ -53,6 +59,14 @@ typedef struct co_client co_client_t;
 #define CO_ERR_DEVICE        (1U << 5)
 #define CO_ERR_MANUFACTURER  (1U << 7)
 
+/* NMT slave assignment bits (1F81h). See CiA 302-2 */
+#define CO_NMT_SLAVE           (1U << 0) /**< Node is NMT slave */
+#define CO_NMT_SLAVE_BOOT      (1U << 2) /**< NMT slave is started */
+#define CO_NMT_SLAVE_MANDATORY (1U << 3) /**< NMT slave is mandatory */
+
+/** Max size of concise DCF entry in NMT master boot-up */
+#define CO_MASTER_VALUE_SIZE 32
+
 /** Abort error codes. See CiA 301 7.2.4 */
 typedef enum co_sdo_abort
 {
@@ -160,6 +174,20 @@ typedef enum co_nmt_cmd
    CO_NMT_RESET_COMMUNICATION = 0x82,
 } co_nmt_cmd_t;
 
+/** NMT master boot-up state of NMT slave. See CiA 302-2 */
+typedef enum co_master_state
+{
+   CO_MASTER_NODE_UNUSED,         /**< Node is not an NMT slave (1F81h) */
+   CO_MASTER_NODE_WAITING,        /**< Waiting for an SDO session */
+   CO_MASTER_NODE_IDENTIFY,       /**< Checking identity (1F84h-1F88h) */
+   CO_MASTER_NODE_CONFIGURE,      /**< Downloading configuration (1F22h) */
+   CO_MASTER_NODE_CONFIGURED,     /**< Configured, not started */
+   CO_MASTER_NODE_OPERATIONAL,    /**< Configured and started */
+   CO_MASTER_NODE_MISSING,        /**< Node did not respond */
+   CO_MASTER_NODE_WRONG_IDENTITY, /**< Identity did not match */
+   CO_MASTER_NODE_CONFIG_ERROR,   /**< Configuration download failed */
+} co_master_state_t;
+
 /** Dictionary object types. See CiA 301 7.4.3 */
 typedef enum co_otype
 {
@@ -242,6 +270,60 @@ typedef uint32_t (*co_access_fn) (
    uint32_t * value               /**< value to set or get */
 );
 
+/** 64-bit access function for object. Same as co_access_fn but the
+    value is passed as 64 bits, so that 64-bit entries are not
+    truncated. */
+typedef uint32_t (*co_access64_fn) (
+   struct co_net *,               /**< network handle */
+   od_event_t event,              /**< access event */
+   const struct co_obj * obj,     /**< object descriptor */
+   const struct co_entry * entry, /**< entry descriptor */
+   uint8_t subindex,              /**< subindex */
+   uint64_t * value               /**< value to set or get */
+);
+
+/** Chunked access function for object. This function is called to
+    stream entries that do not fit in 64 bits, such as DOMAIN entries,
+    to or from the application without storage in the dictionary.
+
+    For OD_EVENT_READ, at most size bytes starting at offset are
+    copied to data and size is set to the number of bytes copied. If
+    data is NULL, size is set to the total size of the entry.
+
+    For OD_EVENT_WRITE, size bytes are written starting at offset. If
+    data is NULL, the transfer is complete and size is the total
+    number of bytes written. No completion call is made if the
+    transfer is aborted, e.g. when fewer bytes than announced by the
+    SDO client were written.
+
+    For OD_EVENT_RESTORE, entry and data are NULL. */
+typedef uint32_t (*co_stream_fn) (
+   struct co_net *,               /**< network handle */
+   od_event_t event,              /**< access event */
+   const struct co_obj * obj,     /**< object descriptor */
+   const struct co_entry * entry, /**< entry descriptor */
+   uint8_t subindex,              /**< subindex */
+   size_t offset,                 /**< offset of chunk */
+   void * data,                   /**< chunk to read or write */
+   size_t * size                  /**< size of chunk */
+);
+
+/** Sequence counter for consistent access to objects that are larger
+    than can be accessed atomically, or to several entries of an
+    object. The counter is odd while a write is in progress. */
+typedef struct co_seqlock
+{
+   uint32_t sequence; /**< sequence number */
+} co_seqlock_t;
+
+/** Extended access functions for object */
+typedef struct co_obj_ops
+{
+   co_access64_fn access;  /**< 64-bit access function if not NULL */
+   co_stream_fn stream;    /**< chunked access function if not NULL */
+   co_seqlock_t * seqlock; /**< sequence counter for object if not NULL */
+} co_obj_ops_t;
+
 /** Entry descriptor. Describes a subindex, or a series of subindexes
     as an array. */
 typedef struct co_entry
@@ -262,6 +344,7 @@ typedef struct co_obj
    uint8_t max_subindex;       /**< max subindex of object */
    const co_entry_t * entries; /**< list of entries in object */
    co_access_fn access;        /**< access function for object if not NULL */
+   const co_obj_ops_t * ops;   /**< extended access functions if not NULL */
 } co_obj_t;
 
 /** Default value for subindex */
@@ -289,15 +372,137 @@ typedef enum co_mode
    CO_MODE_WRITE, /**< Open for writing */
 } co_mode_t;
 
+/** Notification modes for OD_NOTIFY entries */
+typedef enum co_notify_mode
+{
+   CO_NOTIFY_IMMEDIATE, /**< Call cb_notify for every write */
+   CO_NOTIFY_FRAME,     /**< Call cb_notify_batch after each frame or job */
+   CO_NOTIFY_SYNC,      /**< Call cb_notify_batch on SYNC */
+   CO_NOTIFY_POLL,      /**< Call cb_notify_ready, fetch with co_notify_fetch */
+} co_notify_mode_t;
+
+/** LSS address of a node, i.e. its identity object. See CiA 305 */
+typedef struct co_lss_address
+{
+   uint32_t vendor;   /**< Vendor-ID */
+   uint32_t product;  /**< Product code */
+   uint32_t revision; /**< Revision number */
+   uint32_t serial;   /**< Serial number */
+} co_lss_address_t;
+
+/** Notification of written subindex */
+typedef struct co_notify
+{
+   uint16_t index;   /**< index of object */
+   uint8_t subindex; /**< subindex */
+} co_notify_t;
+
+/** Latest PDO received from a remote node, see co_image_read() */
+typedef struct co_image_entry
+{
+   uint64_t timestamp; /**< os_tick_current() when last received */
+   uint32_t count;     /**< Number of PDOs received, 0 if none yet */
+   uint8_t dlc;        /**< Length of data */
+   uint8_t data[8];    /**< PDO payload */
+} co_image_entry_t;
+
+/** EMCY issued by this node, see co_emcy_poll() */
+typedef struct co_emcy_record
+{
+   uint64_t timestamp; /**< os_tick_current() when issued */
+   uint32_t lost;      /**< Records lost before this one */
+   uint16_t code;      /**< Error code */
+   uint16_t info;      /**< Additional info */
+   uint8_t reg;        /**< Error register */
+   uint8_t msef[5];    /**< Manufacturer-specific error code */
+} co_emcy_record_t;
+
+/** EMCY subscription, see co_emcy_subscribe() */
+typedef struct co_emcy_stream co_emcy_stream_t;
+
+/** EMCYs consumed from one node, see co_emcy_status_get() */
+typedef struct co_emcy_status
+{
+   uint64_t timestamp;  /**< os_tick_current() when last received */
+   uint32_t count;      /**< Number of EMCYs received, 0 if none yet */
+   uint32_t suppressed; /**< EMCYs not passed to callback, see emcy_rate_ms */
+   uint16_t code;       /**< Error code of last EMCY */
+   uint8_t reg;         /**< Error register of last EMCY */
+   uint8_t msef[5];     /**< Manufacturer-specific error code of last EMCY */
+} co_emcy_status_t;
+
+/** Capture file format, see co_capture_start() */
+typedef enum co_capture_format
+{
+   CO_CAPTURE_PCAP,    /**< pcap, LINKTYPE_CAN_SOCKETCAN */
+   CO_CAPTURE_CANDUMP, /**< candump log, as written by candump -l */
+} co_capture_format_t;
+
+/** Extended CAN ID of captured NMT state transitions. Data holds the
+    previous and the new co_state_t. */
+#define CO_CAPTURE_EVENT_NMT 0x1FFFFF00
+
+/** Extended CAN ID of captured SDO aborts. Data holds the abort code
+    (uint32), index (uint16) and subindex (uint8), little-endian, and
+    1 if the abort was sent or 0 if it was received. */
+#define CO_CAPTURE_EVENT_SDO_ABORT 0x1FFFFF01
+
+/** Trace dump magic number, "COTR" in a little-endian file */
+#define CO_TRACE_MAGIC 0x52544F43
+
+/** Trace dump format version */
+#define CO_TRACE_VERSION 1
+
+/** Number of buckets in a latency histogram */
+#define CO_STATS_BUCKETS 16
+
+/** Latency histogram, see co_stats_t. Bucket 0 counts latencies
+    below 1 us, bucket n counts latencies from 2^(n-1) up to 2^n us
+    and the last bucket counts all longer latencies. */
+typedef struct co_histogram
+{
+   uint32_t bucket[CO_STATS_BUCKETS]; /**< Number of samples per bucket */
+   uint32_t max;                      /**< Longest latency [us] */
+} co_histogram_t;
+
+/** Runtime statistics, see co_stats_get() */
+typedef struct co_stats
+{
+   uint32_t rx[16];        /**< Frames received per function code */
+   uint32_t tx[16];        /**< Frames sent per function code */
+   uint32_t tx_failed;     /**< Frames that could not be sent */
+   uint32_t pdo_inhibited; /**< TPDOs held back by inhibit time */
+   uint32_t pdo_dropped;   /**< RPDOs discarded or overwritten */
+   uint32_t sdo_transfers; /**< Completed SDO transfers */
+   uint32_t sdo_aborts;    /**< SDO aborts sent or received */
+   uint32_t sdo_bytes;     /**< Data bytes transferred by SDO */
+   uint32_t hb_expired;    /**< Heartbeat consumer expiries */
+   uint32_t emcy_tx;       /**< EMCYs sent */
+   uint32_t emcy_rx;       /**< EMCYs received */
+   uint32_t emcy_dropped;  /**< EMCYs not sent due to full queue */
+   uint32_t mbox_overrun;  /**< Jobs lost due to full mailbox */
+   co_histogram_t rx_batch_latency; /**< Batch fetched to batch dispatched */
+   co_histogram_t sync_latency;     /**< SYNC to synchronous TPDO sent */
+   co_histogram_t sdo_latency;      /**< SDO request to response sent */
+} co_stats_t;
+
 /** CANopen stack configuration */
 typedef struct co_cfg
 {
    uint8_t node;        /**< Initial node ID */
-   int bitrate;         /**< Initial bitrate (bits per second) */
+   int bitrate;         /**< Initial bitrate (bits/s) or CO_BITRATE_AUTO */
    uint32_t restart_ms; /**< Bus-off recovery delay, zero to disable */
    const co_obj_t * od; /**< Application dictionary */
+   size_t od_size;      /**< Objects in dictionary, checked at init, or 0 */
    const co_default_t * defaults; /**< Dictionary default values */
    void * cb_arg;                 /**< Callback opaque argument */
+   bool process_image;            /**< Keep image of remote PDOs */
+   void * arena;      /**< Instance memory, or NULL to allocate */
+   size_t arena_size; /**< Size of instance memory */
+   co_reactor_t * reactor; /**< Shared reactor, or NULL */
+   bool threadless;        /**< Application calls co_poll() */
+   bool emcy_consumer;     /**< Consume EMCY from all nodes (81h - FFh) */
+   uint32_t emcy_rate_ms;  /**< Min time between EMCY callbacks per node */
 
    /** Reset callback */
    void (*cb_reset) (co_net_t * net);
@@ -319,6 +524,21 @@ typedef struct co_cfg
    /** Notify callback */
    void (*cb_notify) (co_net_t * net, uint16_t index, uint8_t subindex);
 
+   /** Notification mode */
+   co_notify_mode_t notify_mode;
+
+   /** Batched notify callback. Overrun is true if notifications were
+       lost because more than MAX_NOTIFY subindexes were written. */
+   void (*cb_notify_batch) (
+      co_net_t * net,
+      const co_notify_t * notify,
+      size_t count,
+      bool overrun);
+
+   /** Notifications pending callback, called when the first
+       notification is queued in poll mode */
+   void (*cb_notify_ready) (co_net_t * net);
+
    /** Heartbeat node state change callback */
    void (*cb_heartbeat_state) (
       co_net_t * net,
@@ -326,6 +546,21 @@ typedef struct co_cfg
       uint8_t old_state,
       uint8_t new_state);
 
+   /** Node boot-up callback, called when a node has sent its
+       boot-up message */
+   void (*cb_bootup) (co_net_t * net, uint8_t node);
+
+   /** NMT master boot-up progress callback, called when the
+       boot-up state of a node changes. \a done is the number of
+       nodes that have completed boot-up, successfully or not, out of
+       \a total. */
+   void (*cb_master_progress) (
+      co_net_t * net,
+      uint8_t node,
+      co_master_state_t state,
+      unsigned int done,
+      unsigned int total);
+
    /** Function to open dictionary store */
    void * (*open) (co_store_t store, co_mode_t mode);
 
@@ -339,10 +574,70 @@ typedef struct co_cfg
    int (*close) (void * arg);
 } co_cfg_t;
 
+/**
+ * Get instance memory size
+ *
+ * This function returns the size of the memory needed by a stack
+ * instance with the given configuration. The PDO, heartbeat consumer,
+ * EMCY consumer and error list tables are sized from the number of
+ * objects and subindexes in the application dictionary.
+ *
+ * @param cfg           stack configuration
+ *
+ * @return size in bytes, or 0 if the dictionary exceeds stack limits
+ */
+CO_EXPORT size_t co_arena_size (const co_cfg_t * cfg);
+
+/**
+ * Create reactor
+ *
+ * This function creates a reactor, a single thread that services
+ * any number of networks. The thread waits for received frames on
+ * all CAN channels, the periodic tick and submitted jobs in one
+ * event loop. Networks are added to the reactor by passing it in
+ * co_cfg_t::reactor to co_init().
+ *
+ * Reactors are only supported on ports with event loops, currently
+ * Linux.
+ *
+ * @param cpu           CPU to bind the reactor thread to, or -1
+ *
+ * @return reactor handle, or NULL on failure
+ */
+CO_EXPORT co_reactor_t * co_reactor_create (int cpu);
+
+/**
+ * Destroy reactor
+ *
+ * This function stops the reactor thread and releases the reactor.
+ * Networks that are still attached are no longer serviced. The
+ * thread also stops by itself when the last network attached to it
+ * has exited, after which no more networks can be added.
+ *
+ * Private reactors, created by co_init() when co_cfg_t::reactor is
+ * NULL, are released when their network exits and must not be
+ * destroyed. Must not be called from the reactor thread.
+ *
+ * @param reactor       reactor handle
+ */
+CO_EXPORT void co_reactor_destroy (co_reactor_t * reactor);
+
 /**
  * Initialise CANopen stack
  *
- * This function initialises the stack.
+ * This function initialises the stack. The network state and all
+ * tables are carved from co_cfg_t::arena, which must be at least
+ * co_arena_size() bytes and remain valid for the lifetime of the
+ * stack. If co_cfg_t::arena is NULL the memory is allocated from
+ * the heap instead.
+ *
+ * If co_cfg_t::threadless is set, the stack creates no threads or
+ * timers and the application drives it by calling co_poll(). If
+ * co_cfg_t::reactor is set, the network is serviced by the
+ * reactor. Otherwise the stack creates a private reactor for this
+ * network, so that one thread handles received frames, timers and
+ * jobs. On ports without event loops the stack instead creates a
+ * thread that is fed by a receive callback and an OS timer.
  *
  * @param canif         name of can channel interface
  * @param cfg           stack configuration
@@ -351,11 +646,58 @@ typedef struct co_cfg
  */
 CO_EXPORT co_net_t * co_init (const char * canif, const co_cfg_t * cfg);
 
+/**
+ * Poll stack
+ *
+ * This function services a network initialised with
+ * co_cfg_t::threadless set, in the context of the caller. It handles
+ * all received frames and runs the timers that are due. The
+ * application should call it when the descriptor returned by
+ * co_fd_get() becomes readable, or when the returned deadline has
+ * passed, whichever comes first.
+ *
+ * In threadless mode all stack functions must be called from the
+ * thread that calls co_poll(). Jobs are executed immediately. Functions
+ * that wait for a response from the network, such as co_sdo_read(),
+ * call co_poll() until the response has arrived. They must therefore
+ * not be called from callbacks run by co_poll(), where they fail with
+ * CO_STATUS_ERROR instead of polling recursively.
+ *
+ * The stack has a single time base, os_tick_current(). The time
+ * passed to co_poll() must be read from it, and is used for all
+ * frames and timers handled by this call. Like the tick counter, the
+ * returned deadline wraps and must be compared by its difference to
+ * the current time.
+ *
+ * @param net           network handle
+ * @param time          current time, from os_tick_current()
+ *
+ * @return time when co_poll() should be called next
+ */
+CO_EXPORT uint64_t co_poll (co_net_t * net, uint64_t time);
+
+/**
+ * Get pollable descriptor
+ *
+ * This function returns a descriptor that becomes readable when a
+ * threadless network has received frames, for use with poll(), select()
+ * or epoll. The descriptor is only available on ports with event
+ * loops. On other ports the application must call co_poll()
+ * periodically.
+ *
+ * @param net           network handle
+ *
+ * @return descriptor, or -1 if not available
+ */
+CO_EXPORT int co_fd_get (co_net_t * net);
+
 /**
  * Initialise client
  *
  * This function initialises a client. The client is used to submit
- * jobs to the stack.
+ * jobs to the stack. Client functions wait for the job to complete
+ * and fail with CO_STATUS_ERROR if called from a stack callback,
+ * except co_nmt() and co_sync() which are handled directly.
  *
  * @param net           network handle
  *
@@ -423,7 +765,16 @@ CO_EXPORT void * co_cb_arg_get (co_net_t * net);
 /**
  * Send NMT command.
  *
- * This function sends an NMT command to the given node.
+ * This function sends an NMT command to the given node. Nodes that
+ * are reset are expected to send a new boot-up message, see
+ * co_bootup_wait().
+ *
+ * This function may be called from the stack callbacks, e.g.
+ * cb_nmt, cb_heartbeat_state or cb_emcy. The command is then handled
+ * directly instead of being passed to the CANopen thread. Other
+ * client functions, except co_sync(), would have to wait for the
+ * CANopen thread and fail with CO_STATUS_ERROR when called from
+ * callbacks.
  *
  * @param client        client handle
  * @param cmd           NMT command
@@ -431,10 +782,185 @@ CO_EXPORT void * co_cb_arg_get (co_net_t * net);
  */
 CO_EXPORT void co_nmt (co_client_t * client, co_nmt_cmd_t cmd, uint8_t node);
 
+/**
+ * Wait for node boot-up.
+ *
+ * This function blocks until all expected nodes have sent their
+ * boot-up message, or until the timeout expires. A node is
+ * considered booted if it has sent a boot-up message since it was
+ * last reset by co_nmt().
+ *
+ * The node sets are 128-bit bitmaps where node n is bit (n % 32) of
+ * word (n / 32).
+ *
+ * @code
+ * uint32_t expected[4] = {0};
+ * uint32_t booted[4];
+ *
+ * expected[0] = BIT (1) | BIT (2) | BIT (3);
+ * co_nmt (client, CO_NMT_RESET_COMMUNICATION, 0);
+ * if (co_bootup_wait (client, expected, booted, 2000) < 0)
+ * {
+ *    printf ("Not all nodes booted\n");
+ * }
+ * @endcode
+ *
+ * @param client        client handle
+ * @param expected      expected nodes
+ * @param booted        expected nodes that have booted, or NULL
+ * @param timeout       timeout in milliseconds
+ *
+ * @return 0 if all expected nodes have booted, -1 on timeout
+ */
+CO_EXPORT int co_bootup_wait (
+   co_client_t * client,
+   const uint32_t * expected,
+   uint32_t * booted,
+   uint32_t timeout);
+
+/**
+ * Boot NMT slaves.
+ *
+ * This function performs the NMT master boot-up of all NMT slaves
+ * listed in object 1F81h of the local dictionary, in the manner of
+ * CiA 302-2. For each NMT slave, the identity is checked against the
+ * expected values in objects 1F84h to 1F88h, the concise DCF in
+ * object 1F22h is downloaded, and the node is started if it is
+ * marked as NMT boot slave in 1F81h.
+ *
+ * NMT slaves are handled concurrently, using up to MAX_SDO_CLIENTS
+ * parallel SDO transfers. Progress is reported through the
+ * cb_master_progress callback. The nodes are expected to be in
+ * pre-operational state, see co_nmt() and co_bootup_wait().
+ *
+ * Object 1F22h must have a chunked access function. Entries of the
+ * concise DCF may not be larger than CO_MASTER_VALUE_SIZE bytes. The
+ * boot-up state is only allocated if the dictionary has object 1F81h.
+ *
+ * @param client        client handle
+ *
+ * @return 0 if all mandatory NMT slaves were booted, -1 otherwise
+ */
+CO_EXPORT int co_master_boot (co_client_t * client);
+
+/**
+ * Get NMT master boot-up state of node.
+ *
+ * @param net           network handle
+ * @param node          node ID
+ *
+ * @return boot-up state of node
+ */
+CO_EXPORT co_master_state_t co_master_state_get (co_net_t * net, uint8_t node);
+
+/**
+ * Find non-configured LSS slave.
+ *
+ * This function uses the LSS Fastscan protocol to find the LSS
+ * address of one LSS slave that has no node ID. The LSS address is
+ * found bit by bit, in about 130 requests. The slave with the lowest
+ * LSS address is found first. On success, the slave is in LSS
+ * configuration state and can be configured with
+ * co_lss_node_id_set() and co_lss_bitrate_set().
+ *
+ * @param client        client handle
+ * @param address       LSS address of slave on success
+ *
+ * @return 0 if a slave was found, -1 otherwise
+ */
+CO_EXPORT int co_lss_fastscan (co_client_t * client, co_lss_address_t * address);
+
+/**
+ * Configure node ID of LSS slave.
+ *
+ * This function sets the pending node ID of the LSS slave in LSS
+ * configuration state. The node ID is activated when the slave is
+ * switched to LSS waiting state.
+ *
+ * @param client        client handle
+ * @param node          node ID
+ *
+ * @return 0 on success, -1 otherwise
+ */
+CO_EXPORT int co_lss_node_id_set (co_client_t * client, uint8_t node);
+
+/**
+ * Configure bitrate of LSS slave.
+ *
+ * This function sets the pending bitrate of the LSS slave in LSS
+ * configuration state.
+ *
+ * @param client        client handle
+ * @param bitrate       bitrate, one of the CiA 301 standard bitrates,
+ *                      or CO_BITRATE_AUTO
+ *
+ * @return 0 on success, -1 otherwise
+ */
+CO_EXPORT int co_lss_bitrate_set (co_client_t * client, int bitrate);
+
+/**
+ * Store configuration of LSS slave.
+ *
+ * This function makes the LSS slave in LSS configuration state store
+ * its pending node ID and bitrate.
+ *
+ * @param client        client handle
+ *
+ * @return 0 on success, -1 otherwise
+ */
+CO_EXPORT int co_lss_store (co_client_t * client);
+
+/**
+ * Switch state of all LSS slaves.
+ *
+ * This function switches all LSS slaves to LSS waiting state, or to
+ * LSS configuration state. Slaves that enter waiting state with a
+ * new node ID will start with the new node ID.
+ *
+ * @param client        client handle
+ * @param config        true for configuration state, false for
+ *                      waiting state
+ *
+ * @return 0 always
+ */
+CO_EXPORT int co_lss_switch_state (co_client_t * client, bool config);
+
+/**
+ * Assign node IDs to non-configured LSS slaves.
+ *
+ * This function finds all LSS slaves that have no node ID, using
+ * co_lss_fastscan(). Each slave is given the next node ID starting
+ * from \a node, optionally a new bitrate, and is told to store its
+ * configuration before being switched back to LSS waiting state.
+ *
+ * Assignment stops at the first slave that rejects its
+ * configuration. A slave that accepted its node ID but not the
+ * bitrate is included in the returned count and in \a address.
+ *
+ * @param client        client handle
+ * @param node          first node ID to assign
+ * @param bitrate       bitrate to assign, or 0 to keep bitrate
+ * @param address       LSS addresses of assigned slaves, or NULL
+ * @param max           max number of slaves to assign
+ * @param error         set to 0 on success, -1 if a slave could not
+ *                      be configured, or NULL
+ *
+ * @return number of slaves assigned a node ID
+ */
+CO_EXPORT size_t co_lss_assign (
+   co_client_t * client,
+   uint8_t node,
+   int bitrate,
+   co_lss_address_t * address,
+   size_t max,
+   int * error);
+
 /**
  * Send SYNC message.
  *
- * This function broadcasts a SYNC message. TODO: remove?
+ * This function broadcasts a SYNC message from the CANopen thread,
+ * followed by the synchronous TPDOs. It may be called from the stack
+ * callbacks, the SYNC is then sent directly.
  *
  * @param client        client handle
  */
@@ -580,6 +1106,319 @@ CO_EXPORT int co_error_clear (co_client_t * client, uint8_t mask);
  */
 CO_EXPORT int co_error_get (co_client_t * client, uint8_t * error);
 
+/**
+ * Subscribe to EMCYs
+ *
+ * This function subscribes to the EMCYs issued by this node, by the
+ * application or by the stack. EMCYs are recorded when issued, even
+ * if transmission is delayed by the inhibit time (1015h). Records are
+ * read with co_emcy_poll().
+ *
+ * Records are kept in a ring of CO_EMCY_STREAM_SIZE records. If the
+ * ring is full, new records are lost and counted in the next record
+ * read. There can be one subscription per network.
+ *
+ * @param client        client handle
+ *
+ * @return subscription, or NULL if already subscribed or on error
+ */
+CO_EXPORT co_emcy_stream_t * co_emcy_subscribe (co_client_t * client);
+
+/**
+ * Read EMCY record
+ *
+ * This function reads the oldest record of the subscription, waiting
+ * for one if the subscription is empty. It may be called from one
+ * thread at a time, and never blocks the CANopen thread.
+ *
+ * @param stream        subscription
+ * @param record        record read
+ * @param timeout       time to wait in ms, 0 to not wait
+ *
+ * @return 0 on success, -1 on timeout
+ */
+CO_EXPORT int co_emcy_poll (
+   co_emcy_stream_t * stream,
+   co_emcy_record_t * record,
+   uint32_t timeout);
+
+/**
+ * Unsubscribe from EMCYs
+ *
+ * This function ends and frees the subscription.
+ *
+ * @param client        client handle
+ * @param stream        subscription
+ *
+ * @return 0 on success, CO_STATUS error code otherwise
+ */
+CO_EXPORT int co_emcy_unsubscribe (co_client_t * client, co_emcy_stream_t * stream);
+
+/**
+ * Get consumed EMCY status of node
+ *
+ * This function gets the number of EMCYs received from a node and
+ * the last EMCY received. EMCYs are consumed from all nodes if
+ * co_cfg_t::emcy_consumer is set, otherwise from the COB IDs in the
+ * EMCY consumer object (1028h).
+ *
+ * The EMCY callback is called at most once per
+ * co_cfg_t::emcy_rate_ms for each node. EMCYs not passed to the
+ * callback are only counted, except error resets (code 0000h) which
+ * are always passed.
+ *
+ * @param client        client handle
+ * @param node          node ID
+ * @param status        EMCY status
+ *
+ * @return 0 on success, CO_STATUS_ERROR if EMCYs from node are not
+ *         consumed
+ */
+CO_EXPORT int co_emcy_status_get (
+   co_client_t * client,
+   uint8_t node,
+   co_emcy_status_t * status);
+
+/**
+ * Dump CAN trace
+ *
+ * This function writes the frames held in the CAN trace buffer,
+ * oldest first. The trace buffer keeps the last CO_TRACE_SIZE frames
+ * sent or received by all networks and is filled only if the stack
+ * is built with CO_CAN_LOG enabled. This function may be called from
+ * any thread, e.g. from a fault handler, while frames are traced.
+ * Frames overwritten during the dump are skipped. A frame is also
+ * dropped if its slot is still being written by a thread that traced
+ * CO_TRACE_SIZE frames earlier.
+ *
+ * The dump is little-endian. It starts with a 16 byte header:
+ *
+ * - magic (uint32), CO_TRACE_MAGIC
+ * - version (uint16), CO_TRACE_VERSION
+ * - size of record (uint16), 24
+ * - ticks per second (uint32)
+ * - reserved (uint32)
+ *
+ * The header is followed by one record per frame:
+ *
+ * - timestamp (uint64), os_tick_current() when traced
+ * - CAN ID (uint32), with CO_RTR_MASK and CO_EXT_MASK flags
+ * - flags (uint8), bit 0 set if the frame was sent
+ * - dlc (uint8)
+ * - reserved (uint16)
+ * - data (8 bytes)
+ *
+ * util/trace2txt/trace2txt.py decodes the dump offline.
+ *
+ * @param write         function writing a chunk of the dump. Should
+ *                      return a negative value on error
+ * @param arg           opaque argument to write function
+ *
+ * @return number of frames on success, -1 on error
+ */
+CO_EXPORT int co_trace_dump (
+   int (*write) (void * arg, const void * data, size_t size),
+   void * arg);
+
+/**
+ * Start capture
+ *
+ * This function starts capturing all frames received and sent by the
+ * stack, in the order they were processed, to a pcap or candump log
+ * file. Stack events are captured as frames with the extended CAN IDs
+ * CO_CAPTURE_EVENT_NMT and CO_CAPTURE_EVENT_SDO_ABORT.
+ *
+ * Frames are queued by the CANopen thread and written by a background
+ * thread, which calls the write function. The CANopen thread never
+ * waits for the writer. If the queue of CO_CAPTURE_SIZE frames is
+ * full, frames are dropped.
+ *
+ * Timestamps are the time since os_tick_current() started. The
+ * interface name in a candump log is "co".
+ *
+ * @param client        client handle
+ * @param format        file format
+ * @param write         function writing a chunk of the file. Should
+ *                      return a negative value on error
+ * @param arg           opaque argument to write function
+ *
+ * @return 0 on success, -1 if already capturing or on error
+ */
+CO_EXPORT int co_capture_start (
+   co_client_t * client,
+   co_capture_format_t format,
+   int (*write) (void * arg, const void * data, size_t size),
+   void * arg);
+
+/**
+ * Stop capture
+ *
+ * This function stops capturing. Queued frames are written before
+ * the function returns.
+ *
+ * @param client        client handle
+ * @param dropped       number of frames dropped, may be NULL
+ *
+ * @return 0 on success, -1 if not capturing or if writing failed
+ */
+CO_EXPORT int co_capture_stop (co_client_t * client, uint32_t * dropped);
+
+/**
+ * Get runtime statistics
+ *
+ * This function copies the runtime statistics of the network. The
+ * statistics are kept by the CANopen thread and are copied by that
+ * thread, so the copy is consistent.
+ *
+ * The frame counters are indexed by function code, i.e. bits 7-10
+ * of the COB-ID. Counters wrap around on overflow. Latencies are
+ * measured as follows:
+ *
+ * - rx_batch_latency: from when the CANopen thread wakes up to fetch
+ *   a batch of frames from the CAN channel until all frames of the
+ *   batch have been dispatched, one sample per batch. This is the
+ *   time to handle the batch, not the latency of each frame: the
+ *   time frames waited in the CAN driver is not included, as frames
+ *   are not timestamped on reception.
+ * - sync_latency: from SYNC reception or production until each
+ *   synchronous TPDO has been sent.
+ * - sdo_latency: from SDO server request reception until the
+ *   response has been sent. Aborted requests are not sampled.
+ *
+ * @param client        client handle
+ * @param stats         statistics on success
+ *
+ * @return 0 on success, CO_STATUS error code otherwise
+ */
+CO_EXPORT int co_stats_get (co_client_t * client, co_stats_t * stats);
+
+/**
+ * Reset runtime statistics
+ *
+ * This function clears all counters and histograms.
+ *
+ * @param client        client handle
+ *
+ * @return 0 on success, CO_STATUS error code otherwise
+ */
+CO_EXPORT int co_stats_reset (co_client_t * client);
+
+/**
+ * Fetch pending notifications
+ *
+ * This function fetches notifications of written OD_NOTIFY entries
+ * when the stack is configured with CO_NOTIFY_POLL. Each subindex
+ * is reported once, however many times it was written since it was
+ * last fetched. This function is thread-safe.
+ *
+ * @param net           network handle
+ * @param notify        array to receive notifications
+ * @param max           size of array
+ * @param overrun       set to true if notifications were lost
+ *
+ * @return number of notifications fetched
+ */
+CO_EXPORT size_t co_notify_fetch (
+   co_net_t * net,
+   co_notify_t * notify,
+   size_t max,
+   bool * overrun);
+
+/**
+ * Begin write of object protected by sequence counter
+ *
+ * This function marks the start of a write to an object that has a
+ * sequence counter. Readers in the stack, such as SDO upload, PDO
+ * transmission and store, will retry or fail rather than use a value
+ * that is being modified. The write should be short.
+ *
+ * Writers are kept apart: if another write is in progress, this
+ * function waits until it has ended. The stack writes objects from
+ * the CANopen thread, e.g. on RPDO reception and SDO download. A
+ * segmented SDO download is buffered and holds the object only
+ * while the value is copied on the last segment. Use
+ * co_seqlock_write_try_begin() to avoid waiting, and always in
+ * threadless mode, where a wait for the CANopen thread never ends.
+ * Segments are buffered in the arena, sized by the largest writable
+ * subindex of objects with a sequence counter.
+ *
+ * @param lock          sequence counter of object
+ */
+CO_EXPORT void co_seqlock_write_begin (co_seqlock_t * lock);
+
+/**
+ * Try to begin write of object protected by sequence counter
+ *
+ * This function is the same as co_seqlock_write_begin() but returns
+ * immediately if another write is in progress.
+ *
+ * @param lock          sequence counter of object
+ *
+ * @return true if write was begun, false otherwise
+ */
+CO_EXPORT bool co_seqlock_write_try_begin (co_seqlock_t * lock);
+
+/**
+ * End write of object protected by sequence counter
+ *
+ * @param lock          sequence counter of object
+ */
+CO_EXPORT void co_seqlock_write_end (co_seqlock_t * lock);
+
+/**
+ * Begin read of object protected by sequence counter
+ *
+ * This function returns the sequence number to be passed to
+ * co_seqlock_read_retry() when the object has been read. It does
+ * not block.
+ *
+ * @param lock          sequence counter of object
+ *
+ * @return sequence number
+ */
+CO_EXPORT uint32_t co_seqlock_read_begin (const co_seqlock_t * lock);
+
+/**
+ * Check read of object protected by sequence counter
+ *
+ * This function checks if the object was modified while it was
+ * read. If so, the value read may be inconsistent and the read
+ * should be retried.
+ *
+ * @param lock          sequence counter of object
+ * @param sequence      sequence number from co_seqlock_read_begin()
+ *
+ * @return true if read should be retried, false otherwise
+ */
+CO_EXPORT bool co_seqlock_read_retry (const co_seqlock_t * lock, uint32_t sequence);
+
+/**
+ * Read PDO from network process image
+ *
+ * This function copies the latest PDO received from a remote node
+ * from the network process image. The process image holds the four
+ * TPDOs of each node in the predefined connection set, COB-IDs
+ * 180h, 280h, 380h and 480h + node ID. PDOs are stored as they are
+ * received, regardless of the local PDO configuration.
+ *
+ * The process image is only kept if co_cfg_t::process_image is
+ * set. This function does not block and may be called from any
+ * thread. It fails if the entry was being updated for
+ * CO_SEQLOCK_RETRIES consecutive attempts.
+ *
+ * @param net           network handle
+ * @param node          node ID of remote node
+ * @param pdo           PDO number, 1 to 4
+ * @param entry         latest PDO on success
+ *
+ * @return 0 on success, -1 otherwise
+ */
+CO_EXPORT int co_image_read (
+   co_net_t * net,
+   uint8_t node,
+   uint8_t pdo,
+   co_image_entry_t * entry);
+
 #ifdef __cplusplus
 }
 #endif
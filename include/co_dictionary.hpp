@@ -0,0 +1,524 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Compile-time object dictionary for C++ applications
+ *
+ * This header lets a C++14 application define its object dictionary
+ * as types. The object table expected by the stack is built, sorted
+ * and checked at compile time and placed in read-only memory:
+ *
+ * @code
+ * using output = co::od::var<0x2000, uint64_t, OD_RW | OD_RPDO>;
+ * using input  = co::od::var<0x2001, uint16_t, OD_RO | OD_TPDO>;
+ *
+ * using od = co::od::dictionary<
+ *    co::od::constant<0x1000, uint32_t, 0x12345678>,
+ *    co::od::error_register,
+ *    co::od::identity<0x1337, 1, 1, 0>,
+ *    co::od::rpdo_comm<0>,
+ *    co::od::rpdo_mapping<0>,
+ *    input,
+ *    output>;
+ *
+ * cfg.od = od::objects ();
+ * input::set (0x55AA);
+ * @endcode
+ *
+ * Duplicated indexes, PDO mappable entries that are not of a basic
+ * datatype and PDO mappings larger than a PDO (see pdo_map) are
+ * rejected at compile time. The typed accessors of
+ * the application objects read and write the storage directly.
+ */
+
+#ifndef CO_DICTIONARY_HPP
+#define CO_DICTIONARY_HPP
+
+#include "co_api.h"
+#include "co_obj.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if __cplusplus < 201402L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+#error "co_dictionary.hpp requires C++14"
+#endif
+
+namespace co
+{
+namespace od
+{
+namespace detail
+{
+
+/** Maps a C++ type to its dictionary datatype and bitlength */
+template <typename T> struct dtype;
+
+// clang-format off
+template <> struct dtype<bool>     { static constexpr co_dtype_t value = DTYPE_BOOLEAN;    static constexpr size_t bitlength = 1; };
+template <> struct dtype<int8_t>   { static constexpr co_dtype_t value = DTYPE_INTEGER8;   static constexpr size_t bitlength = 8; };
+template <> struct dtype<int16_t>  { static constexpr co_dtype_t value = DTYPE_INTEGER16;  static constexpr size_t bitlength = 16; };
+template <> struct dtype<int32_t>  { static constexpr co_dtype_t value = DTYPE_INTEGER32;  static constexpr size_t bitlength = 32; };
+template <> struct dtype<int64_t>  { static constexpr co_dtype_t value = DTYPE_INTEGER64;  static constexpr size_t bitlength = 64; };
+template <> struct dtype<uint8_t>  { static constexpr co_dtype_t value = DTYPE_UNSIGNED8;  static constexpr size_t bitlength = 8; };
+template <> struct dtype<uint16_t> { static constexpr co_dtype_t value = DTYPE_UNSIGNED16; static constexpr size_t bitlength = 16; };
+template <> struct dtype<uint32_t> { static constexpr co_dtype_t value = DTYPE_UNSIGNED32; static constexpr size_t bitlength = 32; };
+template <> struct dtype<uint64_t> { static constexpr co_dtype_t value = DTYPE_UNSIGNED64; static constexpr size_t bitlength = 64; };
+template <> struct dtype<float>    { static constexpr co_dtype_t value = DTYPE_REAL32;     static constexpr size_t bitlength = 32; };
+template <> struct dtype<double>   { static constexpr co_dtype_t value = DTYPE_REAL64;     static constexpr size_t bitlength = 64; };
+// clang-format on
+
+/** Only basic datatypes can be mapped, not strings or domains */
+template <typename T> struct mappable : std::is_arithmetic<T>
+{
+};
+
+/**
+ * Checks an entry of type @a T with the given flags. The storage
+ * must match the bitlength, since the stack accesses it using the
+ * datatype, and PDO mappable entries must be of a basic datatype.
+ */
+template <typename T, uint8_t Flags> constexpr bool check_entry()
+{
+   static_assert (
+      dtype<T>::bitlength == 8 * sizeof (T) || (dtype<T>::bitlength == 1 && sizeof (T) == 1),
+      "storage size does not match bitlength of datatype");
+   static_assert (
+      !(Flags & (OD_TPDO | OD_RPDO)) || mappable<T>::value,
+      "PDO mappable entry must have a basic datatype");
+   static_assert (!(Flags & OD_ARRAY), "OD_ARRAY is set by the builder");
+   return true;
+}
+
+/** Fixed-size array that can be modified in constant expressions */
+template <typename T, size_t N> struct array
+{
+   T data[N];
+
+   constexpr T & operator[] (size_t i)
+   {
+      return data[i];
+   }
+
+   constexpr const T & operator[] (size_t i) const
+   {
+      return data[i];
+   }
+};
+
+/** Returns true if all @a n indexes are unique */
+template <size_t N> constexpr bool unique (const array<uint16_t, N> & indexes, size_t n)
+{
+   for (size_t i = 0; i < n; i++)
+   {
+      for (size_t j = i + 1; j < n; j++)
+      {
+         if (indexes[i] == indexes[j])
+            return false;
+      }
+   }
+   return true;
+}
+
+/** Returns true if none of the @a n indexes is 0, which ends the table */
+template <size_t N> constexpr bool nonzero (const array<uint16_t, N> & indexes, size_t n)
+{
+   for (size_t i = 0; i < n; i++)
+   {
+      if (indexes[i] == 0)
+         return false;
+   }
+   return true;
+}
+
+/** Sorts the first @a n objects by index (insertion sort) */
+template <size_t N> constexpr array<co_obj_t, N> sort (array<co_obj_t, N> objs, size_t n)
+{
+   for (size_t i = 1; i < n; i++)
+   {
+      co_obj_t obj = objs[i];
+      size_t j     = i;
+
+      while (j > 0 && objs[j - 1].index > obj.index)
+      {
+         objs[j] = objs[j - 1];
+         j--;
+      }
+      objs[j] = obj;
+   }
+   return objs;
+}
+
+/** Returns the total bitlength of the VAR objects @a Vars */
+template <typename... Vars> constexpr size_t mapping_bitlength()
+{
+   const size_t bitlength[] = {Vars::entries[0].bitlength...};
+   size_t total             = 0;
+
+   for (size_t i = 0; i < sizeof...(Vars); i++)
+      total += bitlength[i];
+   return total;
+}
+
+/** Returns true if all VAR objects @a Vars have @a Flags set */
+template <uint8_t Flags, typename... Vars> constexpr bool mapping_flags()
+{
+   const uint8_t flags[] = {Vars::entries[0].flags...};
+
+   for (size_t i = 0; i < sizeof...(Vars); i++)
+   {
+      if ((flags[i] & Flags) != Flags)
+         return false;
+   }
+   return true;
+}
+
+/** Relaxed atomic load, compiles to a plain load where possible */
+template <typename T> inline T load (const T * p)
+{
+#if defined(__GNUC__)
+   T v;
+   __atomic_load (p, &v, __ATOMIC_RELAXED);
+   return v;
+#else
+   return *static_cast<const volatile T *> (p);
+#endif
+}
+
+/** Relaxed atomic store, compiles to a plain store where possible */
+template <typename T> inline void store (T * p, T v)
+{
+#if defined(__GNUC__)
+   __atomic_store (p, &v, __ATOMIC_RELAXED);
+#else
+   *static_cast<volatile T *> (p) = v;
+#endif
+}
+
+} // namespace detail
+
+/**
+ * VAR object with storage of type @a T.
+ *
+ * @tparam Index        index of object
+ * @tparam T            type of value, e.g. uint16_t
+ * @tparam Flags        entry flags, e.g. OD_RO | OD_TPDO
+ */
+template <uint16_t Index, typename T, uint8_t Flags = OD_RW> struct var
+{
+   static_assert (detail::check_entry<T, Flags>(), "");
+
+   static constexpr uint16_t index = Index;
+
+   /** Storage of value */
+   static T value;
+
+   /** Entry descriptor */
+   static constexpr co_entry_t entries[] = {
+      {0, Flags, detail::dtype<T>::value, detail::dtype<T>::bitlength, 0, &value},
+   };
+
+   /** Object descriptor */
+   static constexpr co_obj_t descriptor()
+   {
+      return {Index, OTYPE_VAR, 0, entries, nullptr, nullptr};
+   }
+
+   /** Reads value */
+   static T get()
+   {
+      return detail::load (&value);
+   }
+
+   /** Writes value */
+   static void set (T v)
+   {
+      detail::store (&value, v);
+   }
+};
+
+template <uint16_t Index, typename T, uint8_t Flags> T var<Index, T, Flags>::value{};
+
+template <uint16_t Index, typename T, uint8_t Flags>
+constexpr co_entry_t var<Index, T, Flags>::entries[];
+
+/**
+ * ARRAY object with @a N members of type @a T. The members are
+ * subindex 1 to @a N.
+ *
+ * @tparam Index        index of object
+ * @tparam T            type of members, e.g. uint16_t
+ * @tparam N            number of members
+ * @tparam Flags        entry flags of members, e.g. OD_RW
+ */
+template <uint16_t Index, typename T, uint8_t N, uint8_t Flags = OD_RW> struct array
+{
+   static_assert (detail::check_entry<T, Flags>(), "");
+   static_assert (N > 0, "ARRAY must have at least one member");
+
+   static constexpr uint16_t index = Index;
+
+   /** Storage of members, subindex 1 is stored in value[0] */
+   static T value[N];
+
+   /** Entry descriptors */
+   static constexpr co_entry_t entries[] = {
+      {0, OD_RO, DTYPE_UNSIGNED8, 8, N, nullptr},
+      {1, Flags | OD_ARRAY, detail::dtype<T>::value, detail::dtype<T>::bitlength, 0, value},
+   };
+
+   /** Object descriptor */
+   static constexpr co_obj_t descriptor()
+   {
+      return {Index, OTYPE_ARRAY, N, entries, nullptr, nullptr};
+   }
+
+   /** Reads member at @a subindex (1 to N) */
+   static T get (uint8_t subindex)
+   {
+      return detail::load (&value[subindex - 1]);
+   }
+
+   /** Writes member at @a subindex (1 to N) */
+   static void set (uint8_t subindex, T v)
+   {
+      detail::store (&value[subindex - 1], v);
+   }
+};
+
+template <uint16_t Index, typename T, uint8_t N, uint8_t Flags>
+T array<Index, T, N, Flags>::value[N]{};
+
+template <uint16_t Index, typename T, uint8_t N, uint8_t Flags>
+constexpr co_entry_t array<Index, T, N, Flags>::entries[];
+
+/**
+ * Read-only VAR object with a constant value. The value is kept in
+ * the entry descriptor and has no storage.
+ *
+ * @tparam Index        index of object
+ * @tparam T            type of value, at most 32 bits
+ * @tparam Value        value
+ */
+template <uint16_t Index, typename T, T Value> struct constant
+{
+   static_assert (detail::check_entry<T, OD_RO>(), "");
+   static_assert (detail::dtype<T>::bitlength <= 32, "constant must fit in entry value");
+
+   static constexpr uint16_t index = Index;
+
+   /** Entry descriptor */
+   static constexpr co_entry_t entries[] = {
+      {0,
+       OD_RO,
+       detail::dtype<T>::value,
+       detail::dtype<T>::bitlength,
+       static_cast<uint32_t> (Value),
+       nullptr},
+   };
+
+   /** Object descriptor */
+   static constexpr co_obj_t descriptor()
+   {
+      return {Index, OTYPE_VAR, 0, entries, nullptr, nullptr};
+   }
+
+   /** Reads value */
+   static constexpr T get()
+   {
+      return Value;
+   }
+};
+
+template <uint16_t Index, typename T, T Value>
+constexpr co_entry_t constant<Index, T, Value>::entries[];
+
+/**
+ * Object defined by entry descriptors and an optional access
+ * function, e.g. the communication objects handled by the stack.
+ *
+ * @tparam Index        index of object
+ * @tparam OType        object type
+ * @tparam MaxSubindex  max subindex of object
+ * @tparam Entries      entry descriptors
+ * @tparam Access       access function, or nullptr
+ * @tparam Ops          extended access functions, or nullptr
+ */
+template <
+   uint16_t Index,
+   co_otype_t OType,
+   uint8_t MaxSubindex,
+   const co_entry_t * Entries,
+   co_access_fn Access     = nullptr,
+   const co_obj_ops_t * Ops = nullptr>
+struct object
+{
+   static constexpr uint16_t index = Index;
+
+   /** Object descriptor */
+   static constexpr co_obj_t descriptor()
+   {
+      return {Index, OType, MaxSubindex, Entries, Access, Ops};
+   }
+};
+
+/** Identity object (1018h) with constant values */
+template <uint32_t Vendor, uint32_t Product, uint32_t Revision, uint32_t Serial>
+struct identity
+{
+   static constexpr uint16_t index = 0x1018;
+
+   /** Entry descriptors */
+   static constexpr co_entry_t entries[] = {
+      {0, OD_RO, DTYPE_UNSIGNED8, 8, 4, nullptr},
+      {1, OD_RO, DTYPE_UNSIGNED32, 32, Vendor, nullptr},
+      {2, OD_RO, DTYPE_UNSIGNED32, 32, Product, nullptr},
+      {3, OD_RO, DTYPE_UNSIGNED32, 32, Revision, nullptr},
+      {4, OD_RO, DTYPE_UNSIGNED32, 32, Serial, nullptr},
+   };
+
+   /** Object descriptor */
+   static constexpr co_obj_t descriptor()
+   {
+      return {0x1018, OTYPE_RECORD, 4, entries, nullptr, nullptr};
+   }
+};
+
+template <uint32_t Vendor, uint32_t Product, uint32_t Revision, uint32_t Serial>
+constexpr co_entry_t identity<Vendor, Product, Revision, Serial>::entries[];
+
+/**
+ * PDO mapping of the VAR objects @a Vars, checked at compile time.
+ * The objects must be mappable in the direction of the PDO and fit
+ * in one PDO. The mapping entries can be used as default values of
+ * the mapping parameter object:
+ *
+ * @code
+ * using map = co::od::pdo_map<0x1A00, input, flag>;
+ *
+ * const co_default_t defaults[] = {
+ *    {0x1A00, 0, map::count},
+ *    {0x1A00, 1, map::entries[0]},
+ *    {0x1A00, 2, map::entries[1]},
+ *    {0},
+ * };
+ * @endcode
+ *
+ * @tparam Index        index of mapping parameter, 1600h - 17FFh for
+ *                      RPDOs or 1A00h - 1BFFh for TPDOs
+ * @tparam Vars         mapped VAR objects, in PDO order
+ */
+template <uint16_t Index, typename... Vars> struct pdo_map
+{
+   static_assert (
+      (Index >= 0x1600 && Index < 0x1800) || (Index >= 0x1A00 && Index < 0x1C00),
+      "not a PDO mapping parameter index");
+   static_assert (sizeof...(Vars) > 0, "PDO mapping must not be empty");
+   static_assert (sizeof...(Vars) <= MAX_PDO_ENTRIES, "PDO mapping has too many entries");
+   static_assert (
+      detail::mapping_flags<(Index >= 0x1A00) ? OD_TPDO : OD_RPDO, Vars...>(),
+      "mapped object is not mappable in this PDO direction");
+   static_assert (
+      detail::mapping_bitlength<Vars...>() <= 64,
+      "PDO mapping is larger than a PDO");
+
+   /** Number of mapped objects */
+   static constexpr uint8_t count = sizeof...(Vars);
+
+   /** Mapping entries, index << 16 | subindex << 8 | bitlength */
+   static constexpr uint32_t entries[] = {
+      (uint32_t)Vars::index << 16 | Vars::entries[0].bitlength...};
+};
+
+template <uint16_t Index, typename... Vars> constexpr uint8_t pdo_map<Index, Vars...>::count;
+
+template <uint16_t Index, typename... Vars>
+constexpr uint32_t pdo_map<Index, Vars...>::entries[];
+
+/* Communication objects handled by the stack */
+
+// clang-format off
+using error_register      = object<0x1001, OTYPE_VAR,   0,               OD1001, co_od1001_fn>;
+using error_field         = object<0x1003, OTYPE_ARRAY, MAX_ERRORS,      OD1003, co_od1003_fn>;
+using sync_cob_id         = object<0x1005, OTYPE_VAR,   0,               OD1005, co_od1005_fn>;
+using sync_period         = object<0x1006, OTYPE_VAR,   0,               OD1006, co_od1006_fn>;
+using sync_window         = object<0x1007, OTYPE_VAR,   0,               OD1007, co_od1007_fn>;
+using guard_time          = object<0x100C, OTYPE_VAR,   0,               OD100C, co_od100C_fn>;
+using life_time_factor    = object<0x100D, OTYPE_VAR,   0,               OD100D, co_od100D_fn>;
+using store_parameters    = object<0x1010, OTYPE_ARRAY, 4,               OD1010, co_od1010_fn>;
+using restore_parameters  = object<0x1011, OTYPE_ARRAY, 4,               OD1011, co_od1011_fn>;
+using emcy_cob_id         = object<0x1014, OTYPE_VAR,   0,               OD1014, co_od1014_fn>;
+using emcy_inhibit        = object<0x1015, OTYPE_VAR,   0,               OD1015, co_od1015_fn>;
+using consumer_heartbeat  = object<0x1016, OTYPE_ARRAY, MAX_HEARTBEATS,  OD1016, co_od1016_fn>;
+using producer_heartbeat  = object<0x1017, OTYPE_VAR,   0,               OD1017, co_od1017_fn>;
+using sync_overflow       = object<0x1019, OTYPE_VAR,   0,               OD1019, co_od1019_fn>;
+using verify_config       = object<0x1020, OTYPE_ARRAY, 2,               OD1020, co_od1020_fn>;
+using emcy_consumer       = object<0x1028, OTYPE_ARRAY, MAX_EMCY_COBIDS, OD1028, co_od1028_fn>;
+using error_behavior      = object<0x1029, OTYPE_ARRAY, 1,               OD1029, co_od1029_fn>;
+
+template <uint16_t N> using rpdo_comm    = object<0x1400 + N, OTYPE_RECORD, 5,               OD1400, co_od1400_fn>;
+template <uint16_t N> using rpdo_mapping = object<0x1600 + N, OTYPE_RECORD, MAX_PDO_ENTRIES, OD1600, co_od1600_fn>;
+template <uint16_t N> using tpdo_comm    = object<0x1800 + N, OTYPE_RECORD, 6,               OD1800, co_od1800_fn>;
+template <uint16_t N> using tpdo_mapping = object<0x1A00 + N, OTYPE_RECORD, MAX_PDO_ENTRIES, OD1A00, co_od1A00_fn>;
+// clang-format on
+
+/**
+ * Object dictionary built from the object types @a Objects, which
+ * may be given in any order. The resulting table is sorted by index
+ * and terminated as expected by the stack.
+ */
+template <typename... Objects> class dictionary
+{
+ public:
+   /** Number of objects in dictionary */
+   static constexpr size_t size = sizeof...(Objects);
+
+ private:
+   static_assert (size > 0, "dictionary must not be empty");
+
+   static constexpr detail::array<uint16_t, sizeof...(Objects)> indexes = {
+      {Objects::index...}};
+
+   static_assert (detail::nonzero (indexes, size), "index 0 is not allowed");
+   static_assert (detail::unique (indexes, size), "duplicate index in dictionary");
+
+   static constexpr detail::array<co_obj_t, sizeof...(Objects) + 1> table = detail::sort (
+      detail::array<co_obj_t, sizeof...(Objects) + 1>{
+         {Objects::descriptor()..., {0, OTYPE_NULL, 0, nullptr, nullptr, nullptr}}},
+      size);
+
+ public:
+   /** Returns the sorted object table, to be set in co_cfg_t
+       together with co_cfg_t::od_size = size */
+   static constexpr const co_obj_t * objects()
+   {
+      return table.data;
+   }
+};
+
+template <typename... Objects> constexpr size_t dictionary<Objects...>::size;
+
+template <typename... Objects>
+constexpr detail::array<uint16_t, sizeof...(Objects)> dictionary<Objects...>::indexes;
+
+template <typename... Objects>
+constexpr detail::array<co_obj_t, sizeof...(Objects) + 1> dictionary<Objects...>::table;
+
+} // namespace od
+} // namespace co
+
+#endif /* CO_DICTIONARY_HPP */
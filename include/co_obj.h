@@ -91,6 +91,9 @@ CO_EXPORT extern const co_entry_t OD1800[];
 /** Entry descriptor for RPDO mapping parameter object (1A00h - 1BFFh) */
 CO_EXPORT extern const co_entry_t OD1A00[];
 
+/** Entry descriptor for Runtime statistics object (5F00h) */
+CO_EXPORT extern const co_entry_t OD5F00[];
+
 /**
  * Access function for Error register object (1001h)
  *
@@ -511,6 +514,33 @@ CO_EXPORT uint32_t co_od1A00_fn (
    uint8_t subindex,
    uint32_t * value);
 
+/**
+ * Access function for Runtime statistics object (5F00h)
+ *
+ * The object is manufacturer-specific and optional. To include it,
+ * add {0x5F00, OTYPE_RECORD, 12, OD5F00, co_od5F00_fn} to the
+ * dictionary. Subindexes 1 - 12 hold, in order, the co_stats_t
+ * counters from frames received (all function codes) to mailbox
+ * overruns. The latency histograms, including the per-batch
+ * rx_batch_latency, are only available from co_stats_get().
+ *
+ * @param net           network handle
+ * @param event         read/write/restore
+ * @param obj           object descriptor
+ * @param entry         entry descriptor
+ * @param subindex      subindex
+ * @param value         value to read or write
+ *
+ * @return sdo abort code
+ */
+CO_EXPORT uint32_t co_od5F00_fn (
+   co_net_t * net,
+   od_event_t event,
+   const co_obj_t * obj,
+   const co_entry_t * entry,
+   uint8_t subindex,
+   uint32_t * value);
+
 #ifdef __cplusplus
 }
 #endif
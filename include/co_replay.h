@@ -0,0 +1,93 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Replay CAN port
+ *
+ * The replay port feeds a recorded candump log or pcap file
+ * (LINKTYPE_CAN_SOCKETCAN) to the stack instead of a CAN driver. The
+ * file name is passed to co_init() as the CAN interface name. Frames
+ * sent by the stack can be recorded as a candump log, for comparison
+ * with the original recording.
+ *
+ * Frames are read in batches, so timers and client jobs are still
+ * handled when replaying as fast as possible. Note that the stack
+ * clock is not affected by the replay, so timeouts such as heartbeat
+ * consumer timeouts are only reproduced with real-time pacing.
+ */
+
+#ifndef CO_REPLAY_H
+#define CO_REPLAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Max number of configured replay files */
+#define CO_REPLAY_FILES 4
+
+/** Replay pacing */
+typedef enum co_replay_pacing
+{
+   CO_REPLAY_FAST,     /**< As fast as the stack accepts frames */
+   CO_REPLAY_REALTIME, /**< With the recorded time between frames */
+} co_replay_pacing_t;
+
+/** Replay configuration */
+typedef struct co_replay_cfg
+{
+   co_replay_pacing_t pacing; /**< Replay pacing */
+
+   /** Function selecting recorded frames to replay, or NULL to
+       replay all frames. Should return false to skip the frame, e.g.
+       frames sent by the node under test. */
+   bool (*filter) (void * arg, uint32_t id);
+
+   /** Function writing a chunk of the candump log of frames sent by
+       the stack, or NULL. Frames are stamped with the recorded time
+       of the last frame replayed. */
+   int (*write) (void * arg, const void * data, size_t size);
+
+   /** Function called from the CANopen thread when the end of the
+       file has been reached, or NULL */
+   void (*done) (void * arg, uint64_t frames);
+
+   void * arg; /**< Opaque argument to functions */
+} co_replay_cfg_t;
+
+/**
+ * Configure replay
+ *
+ * This function sets the configuration used when the named file is
+ * opened by co_init(). Files that have not been configured are
+ * replayed as fast as possible, without recording.
+ *
+ * @param name          file name
+ * @param cfg           replay configuration
+ *
+ * @return 0 on success, -1 if too many files are configured
+ */
+int co_replay_configure (const char * name, const co_replay_cfg_t * cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_REPLAY_H */
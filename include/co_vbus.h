@@ -0,0 +1,241 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief In-process virtual CAN bus
+ *
+ * The virtual CAN port connects any number of stack instances in the
+ * same process to in-memory buses. A bus is identified by the name
+ * passed to co_init() and is created when it is first opened or
+ * configured. Frames are arbitrated by identifier and can optionally
+ * be paced to the configured bitrate, using worst case bit stuffing.
+ * Errors can be injected to exercise error handling.
+ *
+ * The transmit queues and the frame ring of a bus are lock-free.
+ * Opening channels and configuring buses is not thread-safe.
+ */
+
+#ifndef CO_VBUS_H
+#define CO_VBUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Max number of channels per bus */
+#define CO_VBUS_NODES 128
+
+/** Max number of buses */
+#define CO_VBUS_BUSES 4
+
+/** Virtual bus channel */
+typedef struct co_vbus_node co_vbus_node_t;
+
+/** Virtual bus configuration */
+typedef struct co_vbus_cfg
+{
+   int bitrate; /**< Bitrate for pacing (bits/s), 0 for no pacing */
+
+   /** Clock in nanoseconds, or NULL to use os_tick_current() */
+   uint64_t (*clock) (void * arg);
+   void * clock_arg; /**< Clock opaque argument */
+} co_vbus_cfg_t;
+
+/** Virtual bus statistics */
+typedef struct co_vbus_stats
+{
+   uint64_t frames;  /**< Number of frames transmitted */
+   uint64_t errors;  /**< Number of frames destroyed by errors */
+   uint64_t busy_ns; /**< Time the bus has been busy, if paced */
+} co_vbus_stats_t;
+
+/**
+ * Configure bus
+ *
+ * This function configures the named bus, creating it if needed.
+ *
+ * @param name          bus name
+ * @param cfg           bus configuration
+ *
+ * @return 0 on success, -1 on failure
+ */
+int co_vbus_configure (const char * name, const co_vbus_cfg_t * cfg);
+
+/**
+ * Destroy bus
+ *
+ * This function frees the named bus. Channels opened on the bus must
+ * no longer be used.
+ *
+ * @param name          bus name
+ */
+void co_vbus_destroy (const char * name);
+
+/**
+ * Inject errors
+ *
+ * This function destroys the next \a count transmissions of frames
+ * whose identifier matches \a id in the bits set in \a mask. The
+ * sender retransmits destroyed frames and its transmit error counter
+ * is increased as on a real bus, eventually making it error passive
+ * or bus off.
+ *
+ * @param name          bus name
+ * @param id            identifier to match
+ * @param mask          identifier bits to compare
+ * @param count         number of transmissions to destroy
+ *
+ * @return 0 on success, -1 if the bus does not exist
+ */
+int co_vbus_error_inject (
+   const char * name,
+   uint32_t id,
+   uint32_t mask,
+   unsigned int count);
+
+/**
+ * Get bus statistics
+ *
+ * @param name          bus name
+ * @param stats         bus statistics
+ *
+ * @return 0 on success, -1 if the bus does not exist
+ */
+int co_vbus_stats_get (const char * name, co_vbus_stats_t * stats);
+
+/**
+ * Get current bus time
+ *
+ * @param name          bus name
+ *
+ * @return time in nanoseconds, from the bus clock
+ */
+uint64_t co_vbus_now (const char * name);
+
+/**
+ * Open channel on bus
+ *
+ * The callback is called, from the context of the sender, when frames
+ * become available for the channel. On a paced bus, frames become
+ * available when transmission completes and the bus is next accessed,
+ * e.g. by co_vbus_pending().
+ *
+ * @param name          bus name
+ * @param callback      receive callback, or NULL
+ * @param arg           callback opaque argument
+ *
+ * @return channel, or NULL if the bus is full
+ */
+co_vbus_node_t * co_vbus_open (
+   const char * name,
+   void (*callback) (void * arg),
+   void * arg);
+
+/**
+ * Set receive callback of channel
+ *
+ * @param node          channel
+ * @param callback      receive callback, or NULL
+ * @param arg           callback opaque argument
+ */
+void co_vbus_callback_set (
+   co_vbus_node_t * node,
+   void (*callback) (void * arg),
+   void * arg);
+
+/**
+ * Queue frame for transmission
+ *
+ * @param node          channel
+ * @param id            identifier, with CO_RTR_MASK and CO_EXT_MASK flags
+ * @param data          frame data
+ * @param dlc           length of data
+ *
+ * @return 0 on success, -1 if the queue is full or the channel is
+ *         disabled, bus off or listen-only
+ */
+int co_vbus_send (co_vbus_node_t * node, uint32_t id, const void * data, size_t dlc);
+
+/**
+ * Receive frame
+ *
+ * Frames sent by the channel itself are not received.
+ *
+ * @param node          channel
+ * @param id            identifier
+ * @param data          frame data, 8 bytes
+ * @param dlc           length of data
+ *
+ * @return 0 on success, -1 if no frame is available
+ */
+int co_vbus_receive (co_vbus_node_t * node, uint32_t * id, void * data, size_t * dlc);
+
+/**
+ * Check for received frames
+ *
+ * @param node          channel
+ * @param next          time in ns until the next frame has been
+ *                      transmitted, if it is still being transmitted,
+ *                      else UINT64_MAX
+ *
+ * @return true if a frame is available
+ */
+bool co_vbus_pending (co_vbus_node_t * node, uint64_t * next);
+
+/**
+ * Get channel state
+ *
+ * The overrun flag is cleared when read.
+ *
+ * @param node          channel
+ * @param overrun       frames were lost because the channel was not read
+ * @param error_passive transmit error counter is 128 or more
+ * @param bus_off       transmit error counter is 256 or more
+ */
+void co_vbus_state_get (
+   co_vbus_node_t * node,
+   bool * overrun,
+   bool * error_passive,
+   bool * bus_off);
+
+/**
+ * Enable or disable channel
+ *
+ * Enabling a channel resets its error counter and recovers it from
+ * bus off.
+ *
+ * @param node          channel
+ * @param enable        true to enable
+ */
+void co_vbus_enable (co_vbus_node_t * node, bool enable);
+
+/**
+ * Set listen-only mode of channel
+ *
+ * @param node          channel
+ * @param enable        true for listen-only mode
+ */
+void co_vbus_listen_only (co_vbus_node_t * node, bool enable);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_VBUS_H */
@@ -0,0 +1,305 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_arena.h"
+#include "co_od.h"
+#include "co_util.h"
+
+#include <string.h>
+
+/* Alignment of tables holding 64-bit values */
+#define CO_ARENA_ALIGN_TABLE 8
+
+/** Tables allocated from arena */
+typedef struct co_arena_layout
+{
+   co_image_slot_t * image;
+   co_pdo_t * pdo_tx;
+   co_pdo_t * pdo_rx;
+   co_heartbeat_t * heartbeat;
+   const co_obj_t ** objs;
+   const co_entry_t ** entries;
+   uint32_t * mappings;
+   uint32_t * cobids;
+   uint32_t * errors;
+   co_emcy_node_t * emcy_nodes;
+   co_master_t * master;
+   uint8_t * hb_heap;
+   uint8_t * download;
+   uint8_t * od_last;
+} co_arena_layout_t;
+
+void co_arena_init (co_arena_t * arena, void * memory, size_t size)
+{
+   arena->next = (uintptr_t)memory;
+   arena->end  = (uintptr_t)memory + size;
+}
+
+void * co_arena_alloc (co_arena_t * arena, size_t size, size_t align)
+{
+   uintptr_t p = (arena->next + align - 1) & ~(uintptr_t)(align - 1);
+
+   if (p < arena->next || p > arena->end || size > arena->end - p)
+      return NULL;
+
+   arena->next = p + size;
+   return (void *)p;
+}
+
+/* Largest subindex that is downloaded in segments and then written
+   through a pointer while holding the object, see co_sdo_server.c */
+static uint32_t co_arena_download_size (const co_obj_t * obj)
+{
+   const co_entry_t * entry = obj->entries;
+   uint32_t max             = 0;
+
+   for (;;)
+   {
+      uint32_t size = CO_BYTELENGTH (entry->bitlength);
+
+      if (
+         (entry->flags & OD_WRITE) && size > sizeof (uint64_t) &&
+         !co_od_is_stream (obj, entry))
+      {
+         max = MAX (max, size);
+      }
+
+      if ((entry->flags & OD_ARRAY) || entry->subindex >= obj->max_subindex)
+         break;
+      entry++;
+   }
+
+   return max;
+}
+
+int co_arena_sizes (const co_obj_t * od, bool process_image, co_sizes_t * sizes)
+{
+   const co_obj_t * obj;
+
+   memset (sizes, 0, sizeof (*sizes));
+   sizes->process_image = process_image;
+
+   for (obj = od; obj->index != 0; obj++)
+   {
+      sizes->objects++;
+
+      if (co_od_seqlock (obj) != NULL)
+      {
+         uint32_t size = co_arena_download_size (obj);
+
+         if (size > sizes->download)
+            sizes->download = size;
+      }
+
+      if (obj->index >= 0x1400 && obj->index < 0x1600)
+      {
+         sizes->rx_pdos++;
+      }
+      else if (obj->index >= 0x1800 && obj->index < 0x1A00)
+      {
+         sizes->tx_pdos++;
+      }
+      else if (
+         (obj->index >= 0x1600 && obj->index < 0x1800) ||
+         (obj->index >= 0x1A00 && obj->index < 0x1C00))
+      {
+         if (obj->max_subindex > CO_PDO_MAX_ENTRIES)
+            return -1;
+
+         if (obj->max_subindex > sizes->pdo_entries)
+            sizes->pdo_entries = obj->max_subindex;
+      }
+      else if (obj->index == 0x1003)
+      {
+         sizes->errors = obj->max_subindex;
+      }
+      else if (obj->index == 0x1016)
+      {
+         /* Consumer slots are indexed by uint8_t, see co_heartbeat.c */
+         if (obj->max_subindex > 127)
+            return -1;
+
+         sizes->heartbeats = obj->max_subindex;
+      }
+      else if (obj->index == 0x1028)
+      {
+         sizes->emcy_cobids = obj->max_subindex;
+         sizes->emcy_nodes  = obj->max_subindex > 0;
+      }
+      else if (obj->index == 0x1F81)
+      {
+         sizes->master = true;
+      }
+   }
+
+   return 0;
+}
+
+/* Allocate tables in order of decreasing alignment, so that the
+   padding only depends on the alignment of the arena itself */
+static int co_arena_layout (
+   co_arena_t * arena,
+   const co_sizes_t * sizes,
+   co_arena_layout_t * layout)
+{
+   size_t pdos     = sizes->tx_pdos + sizes->rx_pdos;
+   size_t mappings = pdos * sizes->pdo_entries;
+
+   memset (layout, 0, sizeof (*layout));
+
+   if (sizes->process_image)
+   {
+      layout->image = co_arena_alloc (
+         arena,
+         CO_IMAGE_SIZE * sizeof (co_image_slot_t),
+         CO_IMAGE_ALIGN);
+      if (layout->image == NULL)
+         return -1;
+   }
+
+   if (sizes->emcy_nodes)
+   {
+      layout->emcy_nodes = co_arena_alloc (
+         arena,
+         128 * sizeof (co_emcy_node_t),
+         CO_ARENA_ALIGN_TABLE);
+      if (layout->emcy_nodes == NULL)
+         return -1;
+   }
+
+   if (sizes->master)
+   {
+      layout->master = co_arena_alloc (
+         arena,
+         sizeof (co_master_t),
+         CO_ARENA_ALIGN_TABLE);
+      if (layout->master == NULL)
+         return -1;
+   }
+
+   layout->pdo_tx = co_arena_alloc (
+      arena,
+      sizes->tx_pdos * sizeof (co_pdo_t),
+      CO_ARENA_ALIGN_TABLE);
+   layout->pdo_rx = co_arena_alloc (
+      arena,
+      sizes->rx_pdos * sizeof (co_pdo_t),
+      CO_ARENA_ALIGN_TABLE);
+   layout->heartbeat = co_arena_alloc (
+      arena,
+      sizes->heartbeats * sizeof (co_heartbeat_t),
+      CO_ARENA_ALIGN_TABLE);
+   layout->objs = co_arena_alloc (
+      arena,
+      mappings * sizeof (*layout->objs),
+      sizeof (void *));
+   layout->entries = co_arena_alloc (
+      arena,
+      mappings * sizeof (*layout->entries),
+      sizeof (void *));
+   layout->mappings = co_arena_alloc (
+      arena,
+      mappings * sizeof (*layout->mappings),
+      sizeof (uint32_t));
+   layout->cobids = co_arena_alloc (
+      arena,
+      sizes->emcy_cobids * sizeof (*layout->cobids),
+      sizeof (uint32_t));
+   layout->errors = co_arena_alloc (
+      arena,
+      sizes->errors * sizeof (*layout->errors),
+      sizeof (uint32_t));
+   layout->hb_heap = co_arena_alloc (
+      arena,
+      sizes->heartbeats * sizeof (*layout->hb_heap),
+      1);
+   layout->download = co_arena_alloc (arena, sizes->download, 1);
+   layout->od_last  = co_arena_alloc (arena, sizes->objects, 1);
+
+   if (
+      layout->pdo_tx == NULL || layout->pdo_rx == NULL ||
+      layout->heartbeat == NULL || layout->objs == NULL ||
+      layout->entries == NULL || layout->mappings == NULL ||
+      layout->cobids == NULL || layout->errors == NULL ||
+      layout->hb_heap == NULL || layout->download == NULL ||
+      layout->od_last == NULL)
+      return -1;
+
+   return 0;
+}
+
+size_t co_arena_tables_size (const co_sizes_t * sizes)
+{
+   co_arena_t arena;
+   co_arena_layout_t layout;
+
+   /* Dry run from an address with maximum alignment */
+   arena.next = CO_ARENA_ALIGN;
+   arena.end  = UINTPTR_MAX;
+   co_arena_layout (&arena, sizes, &layout);
+
+   return arena.next - CO_ARENA_ALIGN + CO_ARENA_ALIGN - 1;
+}
+
+int co_arena_tables (co_net_t * net, co_arena_t * arena)
+{
+   const co_sizes_t * sizes = &net->sizes;
+   co_arena_layout_t layout;
+   size_t offset = 0;
+   unsigned int ix;
+
+   if (co_arena_layout (arena, sizes, &layout) != 0)
+      return -1;
+
+   net->image       = layout.image;
+   net->pdo_tx      = layout.pdo_tx;
+   net->pdo_rx      = layout.pdo_rx;
+   net->heartbeat   = layout.heartbeat;
+   net->hb_heap     = layout.hb_heap;
+   net->download    = layout.download;
+   net->od_last     = layout.od_last;
+   net->emcy.cobids = layout.cobids;
+   net->emcy.nodes  = layout.emcy_nodes;
+   net->errors      = layout.errors;
+   net->master      = layout.master;
+
+   /* Each PDO has its own slice of the mapping tables */
+   for (ix = 0; ix < sizes->tx_pdos + sizes->rx_pdos; ix++)
+   {
+      co_pdo_t * pdo = (ix < sizes->tx_pdos) ? &net->pdo_tx[ix]
+                                             : &net->pdo_rx[ix - sizes->tx_pdos];
+
+      pdo->mappings = &layout.mappings[offset];
+      pdo->objs     = &layout.objs[offset];
+      pdo->entries  = &layout.entries[offset];
+      offset += sizes->pdo_entries;
+   }
+
+   return 0;
+}
+
+size_t co_arena_size (const co_cfg_t * cfg)
+{
+   co_sizes_t sizes;
+
+   if (co_arena_sizes (cfg->od, cfg->process_image, &sizes) != 0)
+      return 0;
+
+   sizes.emcy_nodes |= cfg->emcy_consumer;
+
+   /* Network state is allocated first, with maximum alignment */
+   return CO_ARENA_ALIGN - 1 + sizeof (co_net_t) +
+          co_arena_tables_size (&sizes);
+}
@@ -0,0 +1,119 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Per-instance memory arena
+ *
+ * The network state and all tables whose size depends on the
+ * configuration are carved from a single block of memory, which may
+ * be supplied by the application. The table sizes are derived from
+ * the object dictionary.
+ */
+
+#ifndef CO_ARENA_H
+#define CO_ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "co_api.h"
+#include "co_main.h"
+
+/** Alignment of the network state and the network process image */
+#define CO_ARENA_ALIGN CO_IMAGE_ALIGN
+
+/** Memory arena */
+typedef struct co_arena
+{
+   uintptr_t next; /**< Next free address */
+   uintptr_t end;  /**< End of arena */
+} co_arena_t;
+
+/**
+ * Initialise arena
+ *
+ * @param arena         arena
+ * @param memory        memory to allocate from
+ * @param size          size of memory
+ */
+void co_arena_init (co_arena_t * arena, void * memory, size_t size);
+
+/**
+ * Allocate from arena
+ *
+ * Memory allocated from the arena is never released, other than by
+ * releasing all of the arena.
+ *
+ * @param arena         arena
+ * @param size          size to allocate
+ * @param align         alignment, a power of 2
+ *
+ * @return pointer to memory, or NULL if the arena is exhausted
+ */
+void * co_arena_alloc (co_arena_t * arena, size_t size, size_t align);
+
+/**
+ * Get table sizes
+ *
+ * This function walks the object dictionary to find the number of
+ * objects, the number of PDOs, the largest PDO mapping and the number
+ * of subindexes of the heartbeat consumer, EMCY consumer and error
+ * list objects. NMT master boot-up state is kept if the NMT slave
+ * assignment object exists. EMCY consumer state is kept per node if
+ * the EMCY consumer object exists, the caller also sets
+ * co_sizes_t::emcy_nodes if all nodes are consumed. The SDO download
+ * buffer holds the largest writable subindex of objects with a
+ * sequence counter.
+ *
+ * @param od            object dictionary
+ * @param process_image true if network process image is kept
+ * @param sizes         table sizes
+ *
+ * @return 0 on success, -1 if the dictionary exceeds stack limits
+ */
+int co_arena_sizes (const co_obj_t * od, bool process_image, co_sizes_t * sizes);
+
+/**
+ * Get size of tables
+ *
+ * This function returns the arena size needed by co_arena_tables(),
+ * including worst case alignment of the arena.
+ *
+ * @param sizes         table sizes
+ *
+ * @return size in bytes
+ */
+size_t co_arena_tables_size (const co_sizes_t * sizes);
+
+/**
+ * Allocate tables
+ *
+ * This function allocates the tables described by net->sizes from
+ * the arena. The arena memory must be zeroed.
+ *
+ * @param net           network handle
+ * @param arena         arena
+ *
+ * @return 0 on success, -1 if the arena is exhausted
+ */
+int co_arena_tables (co_net_t * net, co_arena_t * arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_ARENA_H */
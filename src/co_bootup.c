@@ -0,0 +1,129 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifdef UNIT_TEST
+#define os_tick_from_us mock_os_tick_from_us
+#endif
+
+#include "co_bootup.h"
+#include "co_bitmap.h"
+#include "co_util.h"
+
+#include <string.h>
+
+static bool co_bootup_complete (co_net_t * net, co_job_t * job)
+{
+   const uint32_t * expected = job->bootup.expected;
+   unsigned int ix;
+
+   for (ix = 0; ix < NELEMENTS (net->booted); ix++)
+   {
+      if ((expected[ix] & net->booted[ix]) != expected[ix])
+         return false;
+   }
+
+   return true;
+}
+
+static void co_bootup_done (co_net_t * net, int result)
+{
+   co_job_t * job = net->job_bootup;
+   unsigned int ix;
+
+   net->job_bootup = NULL;
+
+   /* Report the expected nodes that have booted */
+   if (job->bootup.booted != NULL)
+   {
+      for (ix = 0; ix < NELEMENTS (net->booted); ix++)
+      {
+         job->bootup.booted[ix] = job->bootup.expected[ix] & net->booted[ix];
+      }
+   }
+
+   job->result = result;
+   if (job->callback)
+      job->callback (job);
+}
+
+int co_bootup_rx (co_net_t * net, uint32_t id, uint8_t * msg, size_t dlc)
+{
+   uint8_t node = CO_NODE_GET (id);
+
+   /* Boot-up is a single byte 0, but not a node guarding request */
+   if (id & CO_RTR_MASK)
+      return 0;
+
+   if (dlc != 1 || msg[0] != 0 || node == 0 || node > 127)
+      return 0;
+
+   LOG_DEBUG (CO_NMT_LOG, "node %d booted\n", node);
+   co_bitmap_set (net->booted, node);
+
+   if (net->cb_bootup)
+   {
+      net->cb_bootup (net, node);
+   }
+
+   if (net->job_bootup != NULL && co_bootup_complete (net, net->job_bootup))
+   {
+      co_bootup_done (net, 0);
+   }
+
+   return 0;
+}
+
+void co_bootup_reset (co_net_t * net, uint8_t node)
+{
+   if (node == 0)
+      memset (net->booted, 0, sizeof (net->booted));
+   else if (node <= 127)
+      co_bitmap_clear (net->booted, node);
+}
+
+void co_bootup_job (co_net_t * net, co_job_t * job)
+{
+   if (net->job_bootup != NULL)
+   {
+      /* Only one waiter is supported */
+      job->result = -1;
+      if (job->callback)
+         job->callback (job);
+      return;
+   }
+
+   net->job_bootup = job;
+
+   if (co_bootup_complete (net, job))
+   {
+      co_bootup_done (net, 0);
+   }
+}
+
+int co_bootup_timer (co_net_t * net, os_tick_t now)
+{
+   co_job_t * job = net->job_bootup;
+
+   if (job == NULL)
+      return 0;
+
+   if (co_is_expired (now, job->timestamp, 1000 * job->bootup.timeout))
+   {
+      LOG_WARNING (CO_NMT_LOG, "boot-up wait timed out\n");
+      co_bootup_done (net, -1);
+   }
+
+   return 0;
+}
@@ -0,0 +1,82 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifndef CO_BOOTUP_H
+#define CO_BOOTUP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "co_api.h"
+#include "co_main.h"
+
+/**
+ * Receive boot-up message
+ *
+ * This function should be called when an NMT error control message
+ * is received. If the message is a boot-up message the node is
+ * marked as booted, the boot-up callback is called and a pending
+ * boot-up wait job is completed if all expected nodes have booted.
+ *
+ * @param net           network handle
+ * @param id            CAN ID
+ * @param msg           CAN message
+ * @param dlc           size of CAN message
+ *
+ * @return 0 always
+ */
+int co_bootup_rx (co_net_t * net, uint32_t id, uint8_t * msg, size_t dlc);
+
+/**
+ * Forget boot-up of node
+ *
+ * This function should be called when an NMT reset command is
+ * sent. The node will be expected to send a new boot-up message.
+ *
+ * @param net           network handle
+ * @param node          node ID, or 0 for all nodes
+ */
+void co_bootup_reset (co_net_t * net, uint8_t node);
+
+/**
+ * Start boot-up wait job
+ *
+ * This function starts a job that completes when all expected nodes
+ * have sent a boot-up message, or when the job times out.
+ *
+ * @param net           network handle
+ * @param job           boot-up wait job
+ */
+void co_bootup_job (co_net_t * net, co_job_t * job);
+
+/**
+ * Boot-up timer
+ *
+ * This function completes a pending boot-up wait job if it has timed
+ * out and should be called periodically.
+ *
+ * @param net           network handle
+ * @param now           current timestamp
+ *
+ * @return 0 always
+ */
+int co_bootup_timer (co_net_t * net, os_tick_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_BOOTUP_H */
@@ -0,0 +1,366 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifdef UNIT_TEST
+#define os_tick_current mock_os_tick_current
+#define os_tick_from_us mock_os_tick_from_us
+#endif
+
+#include "co_capture.h"
+#include "co_util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+CC_STATIC_ASSERT ((CO_CAPTURE_SIZE & (CO_CAPTURE_SIZE - 1)) == 0);
+
+/* Writer thread events */
+#define CO_CAPTURE_EXIT BIT (0)
+
+/* Writer thread period, in ms */
+#define CO_CAPTURE_PERIOD 10
+
+/* Number of records formatted per write */
+#define CO_CAPTURE_CHUNK 16
+
+/* pcap link type for SocketCAN frames */
+#define CO_CAPTURE_LINKTYPE_CAN_SOCKETCAN 227
+
+/* SocketCAN CAN ID flags */
+#define CO_CAPTURE_CAN_EFF_FLAG 0x80000000
+#define CO_CAPTURE_CAN_RTR_FLAG 0x40000000
+
+static int co_capture_write_header (co_capture_t * capture)
+{
+   uint8_t header[CO_CAPTURE_PCAP_HEADER_SIZE];
+   uint8_t * p = header;
+
+   /* candump log has no header */
+   if (capture->format != CO_CAPTURE_PCAP)
+      return 0;
+
+   p = co_put_uint32 (p, 0xA1B2C3D4); /* Magic, microsecond resolution */
+   p = co_put_uint16 (p, 2);          /* Major version */
+   p = co_put_uint16 (p, 4);          /* Minor version */
+   p = co_put_uint32 (p, 0);          /* Reserved */
+   p = co_put_uint32 (p, 0);          /* Reserved */
+   p = co_put_uint32 (p, 16);         /* Snapshot length */
+   p = co_put_uint32 (p, CO_CAPTURE_LINKTYPE_CAN_SOCKETCAN);
+
+   return capture->write (capture->arg, header, sizeof (header));
+}
+
+static size_t co_capture_format_pcap (
+   uint8_t * buffer,
+   const co_capture_record_t * record,
+   uint64_t us)
+{
+   uint8_t * p = buffer;
+   uint32_t id = record->id & CO_ID_MASK;
+
+   if (record->id & CO_EXT_MASK)
+      id |= CO_CAPTURE_CAN_EFF_FLAG;
+   if (record->id & CO_RTR_MASK)
+      id |= CO_CAPTURE_CAN_RTR_FLAG;
+
+   /* Record header */
+   p = co_put_uint32 (p, (uint32_t)(us / 1000000));
+   p = co_put_uint32 (p, (uint32_t)(us % 1000000));
+   p = co_put_uint32 (p, 16);
+   p = co_put_uint32 (p, 16);
+
+   /* struct can_frame, CAN ID in network byte order */
+   *p++ = (uint8_t)(id >> 24);
+   *p++ = (uint8_t)(id >> 16);
+   *p++ = (uint8_t)(id >> 8);
+   *p++ = (uint8_t)id;
+   *p++ = record->dlc;
+   *p++ = 0;
+   *p++ = 0;
+   *p++ = 0;
+   memcpy (p, record->data, sizeof (record->data));
+   p += sizeof (record->data);
+
+   return p - buffer;
+}
+
+static size_t co_capture_format_candump (
+   uint8_t * buffer,
+   const co_capture_record_t * record,
+   uint64_t us)
+{
+   char * s = (char *)buffer;
+   char * p = s;
+   unsigned int ix;
+
+   p += sprintf (
+      p,
+      "(%010lu.%06lu) co ",
+      (unsigned long)(us / 1000000),
+      (unsigned long)(us % 1000000));
+
+   if (record->id & CO_EXT_MASK)
+      p += sprintf (p, "%08lX#", (unsigned long)(record->id & CO_ID_MASK));
+   else
+      p += sprintf (p, "%03lX#", (unsigned long)(record->id & CO_ID_MASK));
+
+   if (record->id & CO_RTR_MASK)
+   {
+      p += sprintf (p, "R");
+   }
+   else
+   {
+      for (ix = 0; ix < record->dlc; ix++)
+      {
+         p += sprintf (p, "%02X", record->data[ix]);
+      }
+   }
+
+   *p++ = '\n';
+   return p - s;
+}
+
+co_capture_t * co_capture_create (
+   co_capture_format_t format,
+   int (*write) (void * arg, const void * data, size_t size),
+   void * arg)
+{
+   co_capture_t * capture;
+
+   capture = calloc (1, sizeof (*capture));
+   if (capture == NULL)
+      return NULL;
+
+   capture->format  = format;
+   capture->write   = write;
+   capture->arg     = arg;
+   capture->tick_ms = os_tick_from_us (1000);
+
+   if (co_capture_write_header (capture) < 0)
+   {
+      free (capture);
+      return NULL;
+   }
+
+   return capture;
+}
+
+static void co_capture_main (void * arg)
+{
+   co_capture_t * capture = arg;
+   uint32_t value;
+   bool running = true;
+
+   while (running)
+   {
+      value = 0;
+      if (!os_event_wait (capture->event, CO_CAPTURE_EXIT, &value, CO_CAPTURE_PERIOD))
+         running = !(value & CO_CAPTURE_EXIT);
+
+      co_capture_flush (capture);
+   }
+
+   os_sem_signal (capture->done);
+}
+
+int co_capture_run (co_capture_t * capture)
+{
+   capture->event = os_event_create();
+   if (capture->event == NULL)
+      goto error1;
+
+   capture->done = os_sem_create (0);
+   if (capture->done == NULL)
+      goto error2;
+
+   if (
+      os_thread_create (
+         "co_capture",
+         CO_CAPTURE_PRIO,
+         CO_THREAD_STACK_SIZE,
+         co_capture_main,
+         capture) == NULL)
+      goto error3;
+
+   return 0;
+
+error3:
+   os_sem_destroy (capture->done);
+   capture->done = NULL;
+error2:
+   os_event_destroy (capture->event);
+   capture->event = NULL;
+error1:
+   return -1;
+}
+
+int co_capture_destroy (co_capture_t * capture)
+{
+   int result;
+
+   if (capture->done != NULL)
+   {
+      /* Writer thread does a final flush before exiting */
+      os_event_set (capture->event, CO_CAPTURE_EXIT);
+      os_sem_wait (capture->done, OS_WAIT_FOREVER);
+      os_sem_destroy (capture->done);
+      os_event_destroy (capture->event);
+   }
+   else
+   {
+      co_capture_flush (capture);
+   }
+
+   result = capture->failed ? -1 : 0;
+   free (capture);
+   return result;
+}
+
+void co_capture_put (
+   co_capture_t * capture,
+   uint32_t id,
+   const void * data,
+   size_t dlc)
+{
+   uint32_t head = capture->head;
+   co_capture_record_t * record;
+
+   if (head - co_atomic_get_uint32 (&capture->tail) >= CO_CAPTURE_SIZE)
+   {
+      capture->dropped++;
+      return;
+   }
+
+   if (dlc > sizeof (record->data))
+      dlc = sizeof (record->data);
+
+   record            = &capture->ring[head % CO_CAPTURE_SIZE];
+   record->timestamp = os_tick_current();
+   record->id        = id;
+   record->dlc       = (uint8_t)dlc;
+   memset (record->data, 0, sizeof (record->data));
+   if (data != NULL && !(id & CO_RTR_MASK))
+      memcpy (record->data, data, dlc);
+
+   /* Publish record to writer thread */
+   CO_MEMORY_BARRIER();
+   co_atomic_set_uint32 (&capture->head, head + 1);
+}
+
+int co_capture_flush (co_capture_t * capture)
+{
+   uint8_t buffer[CO_CAPTURE_CHUNK * CO_CAPTURE_CANDUMP_LINE_SIZE];
+   const co_capture_record_t * record;
+   uint32_t head;
+   uint32_t tail = capture->tail;
+   uint64_t us;
+   size_t size;
+   int count = 0;
+
+   CC_STATIC_ASSERT (CO_CAPTURE_PCAP_RECORD_SIZE <= CO_CAPTURE_CANDUMP_LINE_SIZE);
+
+   head = co_atomic_get_uint32 (&capture->head);
+   CO_MEMORY_BARRIER();
+
+   while (tail != head)
+   {
+      size = 0;
+      while (tail != head && size + CO_CAPTURE_CANDUMP_LINE_SIZE <= sizeof (buffer))
+      {
+         record = &capture->ring[tail % CO_CAPTURE_SIZE];
+         us     = (uint64_t)record->timestamp * 1000 / capture->tick_ms;
+
+         if (capture->format == CO_CAPTURE_PCAP)
+            size += co_capture_format_pcap (&buffer[size], record, us);
+         else
+            size += co_capture_format_candump (&buffer[size], record, us);
+
+         tail++;
+         count++;
+      }
+
+      /* Release records to producer before the write, which may block */
+      CO_MEMORY_BARRIER();
+      co_atomic_set_uint32 (&capture->tail, tail);
+
+      if (!capture->failed && capture->write (capture->arg, buffer, size) < 0)
+         capture->failed = true;
+   }
+
+   return capture->failed ? -1 : count;
+}
+
+void co_capture_nmt (co_net_t * net, co_state_t previous)
+{
+   uint8_t data[2];
+
+   if (net->capture == NULL)
+      return;
+
+   data[0] = (uint8_t)previous;
+   data[1] = (uint8_t)net->state;
+   co_capture_put (net->capture, CO_EXT_MASK | CO_CAPTURE_EVENT_NMT, data, sizeof (data));
+}
+
+void co_capture_sdo_abort (
+   co_net_t * net,
+   uint16_t index,
+   uint8_t subindex,
+   uint32_t code,
+   bool sent)
+{
+   uint8_t data[8];
+   uint8_t * p = data;
+
+   if (net->capture == NULL)
+      return;
+
+   p = co_put_uint32 (p, code);
+   p = co_put_uint16 (p, index);
+   p = co_put_uint8 (p, subindex);
+   p = co_put_uint8 (p, sent ? 1 : 0);
+   co_capture_put (
+      net->capture,
+      CO_EXT_MASK | CO_CAPTURE_EVENT_SDO_ABORT,
+      data,
+      sizeof (data));
+}
+
+void co_capture_job (co_net_t * net, co_job_t * job)
+{
+   job->result = 0;
+
+   switch (job->type)
+   {
+   case CO_JOB_CAPTURE_START:
+      if (net->capture == NULL)
+         net->capture = job->capture;
+      else
+         job->result = -1;
+      break;
+   case CO_JOB_CAPTURE_STOP:
+      job->capture = net->capture;
+      net->capture = NULL;
+      if (job->capture == NULL)
+         job->result = -1;
+      break;
+   default:
+      CC_ASSERT (0);
+   }
+
+   if (job->callback)
+      job->callback (job);
+}
@@ -0,0 +1,194 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Frame capture to pcap or candump log
+ */
+
+#ifndef CO_CAPTURE_H
+#define CO_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "co_api.h"
+#include "co_main.h"
+
+/** Size of pcap file header */
+#define CO_CAPTURE_PCAP_HEADER_SIZE 24
+
+/** Size of pcap record, including record header */
+#define CO_CAPTURE_PCAP_RECORD_SIZE (16 + 16)
+
+/** Maximum size of candump log line */
+#define CO_CAPTURE_CANDUMP_LINE_SIZE 64
+
+/** Captured frame */
+typedef struct co_capture_record
+{
+   os_tick_t timestamp; /**< Time when captured */
+   uint32_t id;         /**< CAN ID, with CO_RTR_MASK and CO_EXT_MASK */
+   uint8_t dlc;         /**< Size of CAN message */
+   uint8_t data[8];     /**< CAN message */
+} co_capture_record_t;
+
+/**
+ * Capture state
+ *
+ * The ring is written only by the CANopen thread and read only by the
+ * writer thread. The head and tail positions are free-running.
+ */
+typedef struct co_capture
+{
+   co_capture_format_t format;
+   int (*write) (void * arg, const void * data, size_t size);
+   void * arg;
+   uint32_t head;      /**< Next position to write, owned by producer */
+   uint32_t tail;      /**< Next position to read, owned by consumer */
+   uint32_t dropped;   /**< Frames dropped because ring was full */
+   os_tick_t tick_ms;  /**< Ticks per ms */
+   bool failed;        /**< Write function returned error */
+   os_event_t * event; /**< Writer thread wakeup and exit */
+   os_sem_t * done;    /**< Signalled when writer thread exits */
+   co_capture_record_t ring[CO_CAPTURE_SIZE];
+} co_capture_t;
+
+/**
+ * Create capture
+ *
+ * This function allocates the capture state and writes the file
+ * header. No writer thread is started, see co_capture_run().
+ *
+ * @param format        file format
+ * @param write         write function
+ * @param arg           opaque argument to write function
+ *
+ * @return capture handle, or NULL on error
+ */
+co_capture_t * co_capture_create (
+   co_capture_format_t format,
+   int (*write) (void * arg, const void * data, size_t size),
+   void * arg);
+
+/**
+ * Start writer thread
+ *
+ * @param capture       capture handle
+ *
+ * @return 0 on success, -1 on failure
+ */
+int co_capture_run (co_capture_t * capture);
+
+/**
+ * Destroy capture
+ *
+ * This function stops the writer thread if running, writes queued
+ * frames and frees the capture state. The capture must no longer be
+ * reachable from the CANopen thread.
+ *
+ * @param capture       capture handle
+ *
+ * @return 0 on success, -1 if writing failed
+ */
+int co_capture_destroy (co_capture_t * capture);
+
+/**
+ * Queue captured frame
+ *
+ * This function is called from the CANopen thread. It never blocks.
+ * If the ring is full the frame is dropped.
+ *
+ * @param capture       capture handle
+ * @param id            CAN ID, with CO_RTR_MASK and CO_EXT_MASK
+ * @param data          CAN message
+ * @param dlc           size of CAN message
+ */
+void co_capture_put (
+   co_capture_t * capture,
+   uint32_t id,
+   const void * data,
+   size_t dlc);
+
+/**
+ * Write queued frames
+ *
+ * This function is called from the writer thread.
+ *
+ * @param capture       capture handle
+ *
+ * @return number of frames written, or -1 if writing failed
+ */
+int co_capture_flush (co_capture_t * capture);
+
+/**
+ * Capture frame, if capturing
+ *
+ * @param net           network handle
+ * @param id            CAN ID, with CO_RTR_MASK and CO_EXT_MASK
+ * @param data          CAN message
+ * @param dlc           size of CAN message
+ */
+static inline void co_capture_frame (
+   co_net_t * net,
+   uint32_t id,
+   const void * data,
+   size_t dlc)
+{
+   if (net->capture != NULL)
+      co_capture_put (net->capture, id, data, dlc);
+}
+
+/**
+ * Capture NMT state transition, if capturing
+ *
+ * @param net           network handle
+ * @param previous      previous state
+ */
+void co_capture_nmt (co_net_t * net, co_state_t previous);
+
+/**
+ * Capture SDO abort, if capturing
+ *
+ * @param net           network handle
+ * @param index         index of aborted transfer
+ * @param subindex      subindex of aborted transfer
+ * @param code          abort code
+ * @param sent          true if abort was sent, false if received
+ */
+void co_capture_sdo_abort (
+   co_net_t * net,
+   uint16_t index,
+   uint8_t subindex,
+   uint32_t code,
+   bool sent);
+
+/**
+ * Capture job
+ *
+ * This function is called from the CANopen thread to attach or
+ * detach the capture.
+ *
+ * @param net           network handle
+ * @param job           job to run
+ */
+void co_capture_job (co_net_t * net, co_job_t * job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_CAPTURE_H */
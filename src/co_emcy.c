@@ -22,12 +22,17 @@
 #endif
 
 #include "co_emcy.h"
+#include "co_bitmap.h"
 #include "co_nmt.h"
 #include "co_sdo.h"
+#include "co_stats.h"
 #include "co_util.h"
 
 #include <string.h>
 
+CC_STATIC_ASSERT ((CO_EMCY_STREAM_SIZE & (CO_EMCY_STREAM_SIZE - 1)) == 0);
+CC_STATIC_ASSERT (CO_EMCY_QUEUE_SIZE > 0 && CO_EMCY_QUEUE_SIZE <= UINT8_MAX);
+
 static uint32_t co_emcy_error_get (co_net_t * net, uint8_t subindex, uint32_t * value)
 {
    uint8_t ix;
@@ -38,10 +43,10 @@ static uint32_t co_emcy_error_get (co_net_t * net, uint8_t subindex, uint32_t *
       return 0;
    }
 
-   /* Get error from list */
-   ix = subindex - 1;
-   if (ix < net->number_of_errors)
+   /* Get error from ring, subindex 1 is the latest error */
+   if (subindex <= net->number_of_errors)
    {
+      ix     = (net->errors_head + net->sizes.errors - subindex) % net->sizes.errors;
       *value = net->errors[ix];
       return 0;
    }
@@ -165,6 +170,76 @@ uint32_t co_od1015_fn (
    }
 }
 
+/* Default EMCY COB-IDs, 81h - FFh */
+static bool co_emcy_is_default (uint32_t cobid)
+{
+   return cobid > 0x80 && cobid < 0x100;
+}
+
+/* Get node of consumed COB-ID. Default COB-IDs give the node, other
+   COB-IDs are consumed for the node given by the subindex. */
+static uint8_t co_emcy_consumer_node (int ix, uint32_t cobid)
+{
+   return co_emcy_is_default (cobid) ? CO_NODE_GET (cobid) : (uint8_t)(ix + 1);
+}
+
+static void co_emcy_consumer_update (co_net_t * net)
+{
+   int ix;
+
+   /* Index consumed COB IDs by node, so that received EMCYs are
+      matched without searching 1028h unless other COB-IDs are
+      consumed */
+   memset (net->emcy.consumed, 0, sizeof (net->emcy.consumed));
+   net->emcy.remapped = 0;
+   for (ix = 0; ix < net->sizes.emcy_cobids; ix++)
+   {
+      uint32_t cobid = net->emcy.cobids[ix];
+
+      if (cobid & CO_COBID_INVALID)
+         continue;
+
+      if (!co_emcy_is_default (cobid))
+         net->emcy.remapped++;
+
+      co_bitmap_set (net->emcy.consumed, co_emcy_consumer_node (ix, cobid));
+   }
+}
+
+/* Find node of received EMCY, or 0 if not consumed */
+static uint8_t co_emcy_consumer_find (co_net_t * net, uint32_t id)
+{
+   int ix;
+
+   if (id & CO_RTR_MASK)
+      return 0;
+
+   if (co_emcy_is_default (id))
+   {
+      uint8_t node = CO_NODE_GET (id);
+
+      if (net->emcy.consume_all)
+         return node;
+
+      if (net->emcy.remapped == 0)
+         return co_bitmap_get (net->emcy.consumed, node) ? node : 0;
+   }
+   else if (net->emcy.remapped == 0)
+   {
+      return 0;
+   }
+
+   for (ix = 0; ix < net->sizes.emcy_cobids; ix++)
+   {
+      uint32_t cobid = net->emcy.cobids[ix];
+
+      if ((cobid & CO_COBID_INVALID) == 0 && (cobid & CO_EXTID_MASK) == id)
+         return co_emcy_consumer_node (ix, cobid);
+   }
+
+   return 0;
+}
+
 uint32_t co_od1028_fn (
    co_net_t * net,
    od_event_t event,
@@ -175,6 +250,13 @@ uint32_t co_od1028_fn (
 {
    uint32_t cobid;
 
+   /* Number of entries depends on dictionary */
+   if (subindex == 0 && event == OD_EVENT_READ)
+   {
+      *value = obj->max_subindex;
+      return 0;
+   }
+
    if (subindex == 0 && event != OD_EVENT_RESTORE)
       return CO_SDO_ABORT_BAD_SUBINDEX;
 
@@ -188,10 +270,12 @@ uint32_t co_od1028_fn (
       if (((cobid | *value) & CO_COBID_INVALID) == 0)
          return CO_SDO_ABORT_VALUE;
       net->emcy.cobids[subindex - 1] = *value;
+      co_emcy_consumer_update (net);
       return 0;
    case OD_EVENT_RESTORE:
-      for (int ix = 0; ix < MAX_EMCY_COBIDS; ix++)
+      for (int ix = 0; ix < net->sizes.emcy_cobids; ix++)
          net->emcy.cobids[ix] = CO_COBID_INVALID;
+      co_emcy_consumer_update (net);
       return 0;
    default:
       return CO_SDO_ABORT_GENERAL;
@@ -228,28 +312,98 @@ uint32_t co_od1029_fn (
    }
 }
 
+static void co_emcy_stream_write (
+   co_emcy_stream_t * stream,
+   uint16_t code,
+   uint16_t info,
+   uint8_t reg,
+   const uint8_t msef[5])
+{
+   uint32_t head = stream->head;
+   co_emcy_record_t * record;
+
+   if (head - co_atomic_get_uint32 (&stream->tail) >= CO_EMCY_STREAM_SIZE)
+   {
+      stream->lost++;
+      return;
+   }
+
+   record            = &stream->ring[head % CO_EMCY_STREAM_SIZE];
+   record->timestamp = os_tick_current();
+   record->lost      = stream->lost;
+   record->code      = code;
+   record->info      = info;
+   record->reg       = reg;
+   if (msef != NULL)
+      memcpy (record->msef, msef, sizeof (record->msef));
+   else
+      memset (record->msef, 0, sizeof (record->msef));
+   stream->lost = 0;
+
+   /* Publish record to subscriber */
+   CO_MEMORY_BARRIER();
+   co_atomic_set_uint32 (&stream->head, head + 1);
+   os_event_set (stream->event, 1);
+}
+
+bool co_emcy_stream_read (co_emcy_stream_t * stream, co_emcy_record_t * record)
+{
+   uint32_t tail = stream->tail;
+
+   if (tail == co_atomic_get_uint32 (&stream->head))
+      return false;
+
+   CO_MEMORY_BARRIER();
+   *record = stream->ring[tail % CO_EMCY_STREAM_SIZE];
+
+   /* Release record to producer */
+   CO_MEMORY_BARRIER();
+   co_atomic_set_uint32 (&stream->tail, tail + 1);
+   return true;
+}
+
+void co_emcy_timer (co_net_t * net, os_tick_t now)
+{
+   co_emcy_t * emcy = &net->emcy;
+
+   while (emcy->queued > 0 && co_is_expired (now, emcy->timestamp, 100 * emcy->inhibit))
+   {
+      const uint8_t * msg = emcy->queue[emcy->queue_head];
+
+      LOG_ERROR (CO_EMCY_LOG, "emcy %x\n", co_fetch_uint16 (msg));
+
+      /* Keep EMCY queued if it could not be sent, e.g. when bus off */
+      if (co_send (net, emcy->cobid, msg, 8) != 0)
+         break;
+
+      emcy->timestamp  = now;
+      emcy->queue_head = (emcy->queue_head + 1) % CO_EMCY_QUEUE_SIZE;
+      emcy->queued--;
+      net->stats.emcy_tx++;
+   }
+}
+
 int co_emcy_tx (co_net_t * net, uint16_t code, uint16_t info, uint8_t msef[5])
 {
    uint8_t msg[8] = {0};
    uint8_t * p    = msg;
    uint8_t reg;
-   os_tick_t now;
    bool error_behavior = false;
 
-   if (net->number_of_errors < MAX_ERRORS)
-      net->number_of_errors++;
-
-   /* Move down previous errors. The oldest error is discarded. Note
-      that memmove supports overlapping copy. */
-   memmove (
-      &net->errors[1],
-      &net->errors[0],
-      (net->number_of_errors - 1) * sizeof (net->errors[0]));
-
-   net->errors[0] = info << 16 | code;
+   /* Error list is optional. The oldest error is overwritten. */
+   if (net->sizes.errors > 0)
+   {
+      net->errors[net->errors_head] = info << 16 | code;
+      net->errors_head              = (net->errors_head + 1) % net->sizes.errors;
+      if (net->number_of_errors < net->sizes.errors)
+         net->number_of_errors++;
+   }
 
    reg = co_emcy_error_register_get (net);
 
+   if (net->emcy.stream != NULL)
+      co_emcy_stream_write (net->emcy.stream, code, info, reg, msef);
+
    p = co_put_uint16 (p, code);
    p = co_put_uint8 (p, reg);
 
@@ -263,15 +417,21 @@ int co_emcy_tx (co_net_t * net, uint16_t code, uint16_t info, uint8_t msef[5])
       (void)p;
    }
 
-   /* Send EMCY if inhibit time has expired */
-   now = os_tick_current();
-   if (co_is_expired (now, net->emcy.timestamp, 100 * net->emcy.inhibit))
+   /* Queue EMCY, then send queued EMCYs if inhibit time has expired */
+   if (net->emcy.queued < CO_EMCY_QUEUE_SIZE)
+   {
+      unsigned int ix = (net->emcy.queue_head + net->emcy.queued) % CO_EMCY_QUEUE_SIZE;
+
+      memcpy (net->emcy.queue[ix], msg, sizeof (msg));
+      net->emcy.queued++;
+   }
+   else
    {
-      LOG_ERROR (CO_EMCY_LOG, "emcy %x\n", code);
-      os_channel_send (net->channel, net->emcy.cobid, msg, sizeof (msg));
-      net->emcy.timestamp = now;
+      net->stats.emcy_dropped++;
    }
 
+   co_emcy_timer (net, os_tick_current());
+
    /* Call user callback, except for bus-off recovery, where it was
     * called at the actual bus-off event. */
    if (net->cb_emcy && code != 0x8140)
@@ -291,33 +451,56 @@ int co_emcy_tx (co_net_t * net, uint16_t code, uint16_t info, uint8_t msef[5])
 
 int co_emcy_rx (co_net_t * net, uint32_t id, uint8_t * msg, size_t dlc)
 {
-   uint16_t code;
-   uint8_t reg;
-   uint8_t msef[5];
-   int ix;
+   uint8_t node;
+   co_emcy_node_t * consumer;
+   co_emcy_status_t * status;
+   os_tick_t now;
 
-   for (ix = 0; ix < MAX_EMCY_COBIDS; ix++)
+   /* Check for consumed COB ID */
+   node = co_emcy_consumer_find (net, id);
+   if (node == 0)
+      return 0;
+
+   if (dlc != 8)
    {
-      uint32_t cobid = net->emcy.cobids[ix];
+      /* Ignore bad message */
+      return -1;
+   }
 
-      /* Check for matching COB ID */
-      if (cobid != id)
-         continue;
+   /* Consume this EMCY */
+   now      = os_tick_current();
+   consumer = &net->emcy.nodes[node];
+   status   = &consumer->status;
+
+   net->stats.emcy_rx++;
+   status->timestamp = now;
+   status->count++;
+   status->code    = co_fetch_uint16 (&msg[0]);
+   status->reg     = co_fetch_uint8 (&msg[2]);
+   status->msef[0] = co_fetch_uint8 (&msg[3]);
+   status->msef[1] = co_fetch_uint8 (&msg[4]);
+   status->msef[2] = co_fetch_uint8 (&msg[5]);
+   status->msef[3] = co_fetch_uint8 (&msg[6]);
+   status->msef[4] = co_fetch_uint8 (&msg[7]);
+
+   if (net->cb_emcy == NULL)
+      return 0;
 
-      /* Consume this EMCY */
-      code    = co_fetch_uint16 (&msg[0]);
-      reg     = co_fetch_uint8 (&msg[2]);
-      msef[0] = co_fetch_uint8 (&msg[3]);
-      msef[1] = co_fetch_uint8 (&msg[4]);
-      msef[2] = co_fetch_uint8 (&msg[5]);
-      msef[3] = co_fetch_uint8 (&msg[6]);
-      msef[4] = co_fetch_uint8 (&msg[7]);
+   /* Rate limit user callback. Error resets are always passed so that
+      the application does not miss the end of an error. */
+   if (
+      net->emcy.rate == 0 || status->count == 1 || status->code == 0 ||
+      co_is_expired (now, consumer->notified, net->emcy.rate))
+   {
+      uint8_t msef[5];
 
-      /* Call user callback */
-      if (net->cb_emcy)
-      {
-         net->cb_emcy (net, CO_NODE_GET (id), code, reg, msef);
-      }
+      memcpy (msef, status->msef, sizeof (msef));
+      consumer->notified = now;
+      net->cb_emcy (net, node, status->code, status->reg, msef);
+   }
+   else
+   {
+      status->suppressed++;
    }
 
    return 0;
@@ -421,6 +604,8 @@ uint8_t co_emcy_error_register_get (co_net_t * net)
 
 void co_emcy_job (co_net_t * net, co_job_t * job)
 {
+   job->result = 0;
+
    switch (job->type)
    {
    case CO_JOB_EMCY_TX:
@@ -435,11 +620,30 @@ void co_emcy_job (co_net_t * net, co_job_t * job)
    case CO_JOB_ERROR_GET:
       job->emcy.value = co_emcy_error_register_get (net);
       break;
+   case CO_JOB_EMCY_SUBSCRIBE:
+      if (net->emcy.stream != NULL)
+         job->result = CO_STATUS_ERROR;
+      else
+         net->emcy.stream = job->emcy.stream;
+      break;
+   case CO_JOB_EMCY_UNSUBSCRIBE:
+      if (net->emcy.stream != job->emcy.stream)
+         job->result = CO_STATUS_ERROR;
+      else
+         net->emcy.stream = NULL;
+      break;
+   case CO_JOB_EMCY_STATUS_GET:
+      if (
+         job->emcy.node < 1 || job->emcy.node > 127 ||
+         (!net->emcy.consume_all && !co_bitmap_get (net->emcy.consumed, job->emcy.node)))
+         job->result = CO_STATUS_ERROR;
+      else
+         *job->emcy.status = net->emcy.nodes[job->emcy.node].status;
+      break;
    default:
       CC_ASSERT (0);
    }
 
-   job->result = 0;
    if (job->callback)
       job->callback (job);
 }
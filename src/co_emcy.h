@@ -27,11 +27,28 @@ extern "C" {
 
 #include "co_main.h"
 
+/**
+ * EMCY subscription
+ *
+ * The ring is written only by the CANopen thread and read only by the
+ * subscriber. The head and tail positions are free-running.
+ */
+typedef struct co_emcy_stream
+{
+   uint32_t head;        /**< Next position to write, owned by producer */
+   uint32_t tail;        /**< Next position to read, owned by consumer */
+   uint32_t lost;        /**< Records lost since last record written */
+   os_event_t * event;   /**< Set when a record is written */
+   co_emcy_record_t ring[CO_EMCY_STREAM_SIZE];
+} co_emcy_stream_t;
+
 /**
  * Transmit emergency object (EMCY)
  *
  * This function transmits an emergency object. An optional
- * manufacturer-speficic error code can be included.
+ * manufacturer-speficic error code can be included. If the inhibit
+ * time (1015h) is active, the EMCY is queued and transmitted by
+ * co_emcy_timer(). If the queue is full, the EMCY is not transmitted.
  *
  * Calling this function adds an error to the error history object
  * (1003h). It also signals an error to the NMT state-machine which
@@ -50,19 +67,45 @@ extern "C" {
  */
 int co_emcy_tx (co_net_t * net, uint16_t code, uint16_t info, uint8_t msef[5]);
 
+/**
+ * Transmit queued EMCYs
+ *
+ * This function should be called periodically. It transmits queued
+ * EMCYs as the inhibit time expires.
+ *
+ * @param net           network handle
+ * @param now           current timestamp
+ */
+void co_emcy_timer (co_net_t * net, os_tick_t now);
+
+/**
+ * Read EMCY record from subscription
+ *
+ * @param stream        subscription
+ * @param record        record read
+ *
+ * @return true if a record was read, false if subscription is empty
+ */
+bool co_emcy_stream_read (co_emcy_stream_t * stream, co_emcy_record_t * record);
+
 /**
  * Receive emergency object (EMCY)
  *
  * This function should be called when an emergency object is
- * received. The application will be notified via the EMCY callback
- * function, if the EMCY object is being consumed.
+ * received. If the EMCY object is being consumed, the status of the
+ * sending node is updated and the application is notified via the
+ * EMCY callback function, at most once per rate limit period.
+ *
+ * EMCYs are consumed on the COB IDs in 1028h. Default COB IDs 81h -
+ * FFh give the sending node, other COB IDs are consumed for the node
+ * given by the subindex.
  *
  * @param net           network handle
  * @param id            CAN ID
  * @param msg           CAN message
  * @param dlc           size of CAN message
  *
- * @return 0 always
+ * @return 0 on success, -1 if a consumed EMCY has a bad length
  */
 int co_emcy_rx (co_net_t * net, uint32_t node, uint8_t * msg, size_t dlc);
 
@@ -23,6 +23,8 @@
 #include "co_heartbeat.h"
 #include "co_sdo.h"
 #include "co_emcy.h"
+#include "co_stats.h"
+#include "co_probe.h"
 #include "co_util.h"
 #include "co_bitmap.h"
 
@@ -52,6 +54,133 @@ uint32_t co_od1017_fn (
    }
 }
 
+/* Heartbeat consumers are found by node ID through the consumed
+   node bitmap and slot table. Consumers that are being monitored are
+   kept in a min-heap ordered by deadline, so that the timer only
+   needs to look at consumers that have expired. The number of
+   consumers is at most 127, see co_arena_sizes(). */
+
+static bool co_heartbeat_before (os_tick_t a, os_tick_t b)
+{
+   /* True if a is before b, allowing for tick wrap-around */
+   return (os_tick_t)(a - b) > ((os_tick_t)-1 >> 1);
+}
+
+static void co_heartbeat_heap_set (co_net_t * net, uint8_t ix, uint8_t slot)
+{
+   net->hb_heap[ix]              = slot;
+   net->heartbeat[slot].heap_ix = ix;
+}
+
+static bool co_heartbeat_heap_less (co_net_t * net, uint8_t a, uint8_t b)
+{
+   return co_heartbeat_before (
+      net->heartbeat[net->hb_heap[a]].deadline,
+      net->heartbeat[net->hb_heap[b]].deadline);
+}
+
+static void co_heartbeat_heap_swap (co_net_t * net, uint8_t a, uint8_t b)
+{
+   uint8_t slot = net->hb_heap[a];
+
+   co_heartbeat_heap_set (net, a, net->hb_heap[b]);
+   co_heartbeat_heap_set (net, b, slot);
+}
+
+static void co_heartbeat_sift_up (co_net_t * net, uint8_t ix)
+{
+   while (ix > 0)
+   {
+      uint8_t parent = (ix - 1) / 2;
+
+      if (!co_heartbeat_heap_less (net, ix, parent))
+         break;
+
+      co_heartbeat_heap_swap (net, ix, parent);
+      ix = parent;
+   }
+}
+
+static void co_heartbeat_sift_down (co_net_t * net, uint8_t ix)
+{
+   for (;;)
+   {
+      unsigned int left  = 2 * ix + 1;
+      unsigned int right = left + 1;
+      uint8_t smallest   = ix;
+
+      if (left < net->hb_heap_size && co_heartbeat_heap_less (net, left, smallest))
+         smallest = left;
+
+      if (right < net->hb_heap_size && co_heartbeat_heap_less (net, right, smallest))
+         smallest = right;
+
+      if (smallest == ix)
+         break;
+
+      co_heartbeat_heap_swap (net, ix, smallest);
+      ix = smallest;
+   }
+}
+
+static void co_heartbeat_unschedule (co_net_t * net, co_heartbeat_t * heartbeat)
+{
+   uint8_t ix = heartbeat->heap_ix;
+   uint8_t moved;
+
+   if (!heartbeat->scheduled)
+      return;
+
+   heartbeat->scheduled = false;
+   net->hb_heap_size--;
+   if (ix == net->hb_heap_size)
+      return;
+
+   /* Move last element to the vacated position and restore order */
+   moved = net->hb_heap[net->hb_heap_size];
+   co_heartbeat_heap_set (net, ix, moved);
+   co_heartbeat_sift_up (net, ix);
+   co_heartbeat_sift_down (net, net->heartbeat[moved].heap_ix);
+}
+
+static void co_heartbeat_schedule (co_net_t * net, co_heartbeat_t * heartbeat)
+{
+   uint8_t slot = heartbeat - net->heartbeat;
+
+   heartbeat->deadline = heartbeat->timestamp + os_tick_from_us (1000 * heartbeat->time);
+
+   if (heartbeat->scheduled)
+   {
+      /* Deadline has moved forward */
+      co_heartbeat_sift_down (net, heartbeat->heap_ix);
+      return;
+   }
+
+   heartbeat->scheduled = true;
+   co_heartbeat_heap_set (net, net->hb_heap_size++, slot);
+   co_heartbeat_sift_up (net, heartbeat->heap_ix);
+}
+
+static void co_heartbeat_consume (co_net_t * net, uint8_t slot, uint8_t node)
+{
+   co_heartbeat_t * heartbeat = &net->heartbeat[slot];
+
+   /* Remove previous node */
+   co_heartbeat_unschedule (net, heartbeat);
+   if (heartbeat->node != 0 && heartbeat->node <= 127)
+      co_bitmap_clear (net->hb_consumed, heartbeat->node);
+
+   heartbeat->node  = node;
+   heartbeat->state = 0;
+
+   /* Monitoring starts when first heartbeat is received */
+   if (node != 0 && node <= 127)
+   {
+      co_bitmap_set (net->hb_consumed, node);
+      net->hb_slot[node] = slot;
+   }
+}
+
 uint32_t co_od1016_fn (
    co_net_t * net,
    od_event_t event,
@@ -62,9 +191,16 @@ uint32_t co_od1016_fn (
 {
    co_heartbeat_t * heartbeat = &net->heartbeat[subindex - 1];
 
+   /* Number of entries depends on dictionary */
+   if (event == OD_EVENT_READ && subindex == 0)
+   {
+      *value = obj->max_subindex;
+      return 0;
+   }
+
    if (event != OD_EVENT_RESTORE)
    {
-      if (subindex == 0 || subindex > MAX_HEARTBEATS)
+      if (subindex == 0 || subindex > net->sizes.heartbeats)
          return CO_SDO_ABORT_BAD_SUBINDEX;
    }
 
@@ -78,9 +214,16 @@ uint32_t co_od1016_fn (
       uint16_t time = *value & 0xFFFF;
       int ix;
 
-      if (node != 0)
+      if (node != 0 && node <= 127)
       {
-         for (ix = 0; ix < MAX_HEARTBEATS; ix++)
+         /* Node may only be consumed by one slot */
+         if (co_bitmap_get (net->hb_consumed, node) &&
+             net->hb_slot[node] != subindex - 1)
+            return CO_SDO_ABORT_PARAM_INCOMPATIBLE;
+      }
+      else if (node != 0)
+      {
+         for (ix = 0; ix < net->sizes.heartbeats; ix++)
          {
             if (ix == subindex - 1)
                continue; /* Ignore this slot */
@@ -90,12 +233,14 @@ uint32_t co_od1016_fn (
          }
       }
 
-      heartbeat->node = node;
+      co_heartbeat_consume (net, subindex - 1, node);
       heartbeat->time = time;
    }
    else if (event == OD_EVENT_RESTORE)
    {
-      memset (&net->heartbeat, 0, sizeof (net->heartbeat));
+      memset (net->heartbeat, 0, net->sizes.heartbeats * sizeof (net->heartbeat[0]));
+      memset (&net->hb_consumed, 0, sizeof (net->hb_consumed));
+      net->hb_heap_size = 0;
    }
 
    return 0;
@@ -103,51 +248,50 @@ uint32_t co_od1016_fn (
 
 int co_heartbeat_rx (co_net_t * net, uint8_t node, void * msg, size_t dlc)
 {
-   int ix;
+   co_heartbeat_t * heartbeat;
+   uint8_t state;
 
    co_bitmap_set (net->nodes, node);
 
-   for (ix = 0; ix < MAX_HEARTBEATS; ix++)
-   {
-      if (net->heartbeat[ix].node == node)
-      {
-         co_heartbeat_t * heartbeat = &net->heartbeat[ix];
-         uint8_t state;
+   if (node > 127 || !co_bitmap_get (net->hb_consumed, node))
+      return 0;
 
-         heartbeat->timestamp = os_tick_current();
-         state = co_fetch_uint8 (msg);
-         LOG_DEBUG (
-            CO_HEARTBEAT_LOG,
-            "node %d got heartbeat state %02x\n",
-            heartbeat->node,
-            heartbeat->state);
+   heartbeat = &net->heartbeat[net->hb_slot[node]];
 
-         /* Check for node state change */
-         if (state != heartbeat->state)
-         {
-            LOG_DEBUG (
-               CO_HEARTBEAT_LOG,
-               "node %d heartbeat state change\n",
-               heartbeat->node);
-
-            /* Call user callback */
-            if (net->cb_heartbeat_state)
-            {
-               net->cb_heartbeat_state (net, node, heartbeat->state, state);
-            }
-
-            /* Update node state */
-            heartbeat->state = state;
-         }
+   heartbeat->timestamp = os_tick_current();
+   state                = co_fetch_uint8 (msg);
+   LOG_DEBUG (
+      CO_HEARTBEAT_LOG,
+      "node %d got heartbeat state %02x\n",
+      heartbeat->node,
+      heartbeat->state);
+
+   /* Check for node state change */
+   if (state != heartbeat->state)
+   {
+      LOG_DEBUG (CO_HEARTBEAT_LOG, "node %d heartbeat state change\n", heartbeat->node);
+
+      /* Call user callback */
+      if (net->cb_heartbeat_state)
+      {
+         net->cb_heartbeat_state (net, node, heartbeat->state, state);
       }
+
+      /* Update node state */
+      heartbeat->state = state;
    }
 
+   /* Schedule expiry, unless heartbeat has already expired */
+   if (heartbeat->state != 0 && heartbeat->time != 0)
+      co_heartbeat_schedule (net, heartbeat);
+   else
+      co_heartbeat_unschedule (net, heartbeat);
+
    return 0;
 }
 
 int co_heartbeat_timer (co_net_t * net, os_tick_t now)
 {
-   unsigned int ix;
    bool heartbeat_error = false;
 
    /* TODO: send on activation */
@@ -181,45 +325,36 @@ int co_heartbeat_timer (co_net_t * net, os_tick_t now)
          }
 
          co_put_uint8 (msg, state);
-         os_channel_send (net->channel, 0x700 + net->node, msg, sizeof (msg));
+         co_send (net, 0x700 + net->node, msg, sizeof (msg));
       }
    }
 
-   /* Heartbeat consumer */
-   for (ix = 0; ix < MAX_HEARTBEATS; ix++)
+   /* Heartbeat consumer. Only expired consumers are visited. */
+   while (net->hb_heap_size > 0)
    {
-      co_heartbeat_t * heartbeat = &net->heartbeat[ix];
+      co_heartbeat_t * heartbeat = &net->heartbeat[net->hb_heap[0]];
 
-      /* Check active slot */
-      if (heartbeat->node == 0 || heartbeat->node > 127)
-         continue;
+      if (co_heartbeat_before (now, heartbeat->deadline))
+         break;
 
-      /* Check that heartbeat has not already expired */
-      if (heartbeat->state == 0)
-         continue;
+      /* Expired */
+      co_heartbeat_unschedule (net, heartbeat);
+      co_bitmap_clear (net->nodes, heartbeat->node);
+      net->stats.hb_expired++;
+      CO_PROBE2 (hb_expired, net->node, heartbeat->node);
+      LOG_ERROR (CO_HEARTBEAT_LOG, "node %d heartbeat expired\n", heartbeat->node);
 
-      /* Check heartbeat has not expired */
-      if (co_is_expired (now, heartbeat->timestamp, 1000 * heartbeat->time))
+      /* Call user callback */
+      if (net->cb_heartbeat_state)
       {
-         /* Expired */
-         co_bitmap_clear (net->nodes, heartbeat->node);
-         LOG_ERROR (
-            CO_HEARTBEAT_LOG,
-            "node %d heartbeat expired\n",
-            heartbeat->node);
-
-         /* Call user callback */
-         if (net->cb_heartbeat_state)
-         {
-            net->cb_heartbeat_state (net, heartbeat->node, heartbeat->state, 0);
-         }
+         net->cb_heartbeat_state (net, heartbeat->node, heartbeat->state, 0);
+      }
 
-         heartbeat->state = 0;
-         heartbeat_error = true;
+      heartbeat->state = 0;
+      heartbeat_error  = true;
 
-         co_emcy_error_register_set (net, CO_ERR_COMMUNICATION);
-         co_emcy_tx (net, 0x8130, 0, NULL);
-      }
+      co_emcy_error_register_set (net, CO_ERR_COMMUNICATION);
+      co_emcy_tx (net, 0x8130, 0, NULL);
    }
 
    /* Update heartbeat state */
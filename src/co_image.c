@@ -0,0 +1,89 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifdef UNIT_TEST
+#define os_tick_current mock_os_tick_current
+#endif
+
+#include "co_image.h"
+#include "co_util.h"
+
+#include <string.h>
+
+CC_STATIC_ASSERT (CO_IMAGE_ALIGN % sizeof (co_image_slot_t) == 0);
+
+static co_image_slot_t * co_image_slot (co_net_t * net, uint8_t node, uint8_t pdo)
+{
+   if (net->image == NULL)
+      return NULL;
+
+   if (node < 1 || node > 127 || pdo < 1 || pdo > CO_IMAGE_PDOS)
+      return NULL;
+
+   /* PDOs of one node are adjacent */
+   return &net->image[(node - 1) * CO_IMAGE_PDOS + pdo - 1];
+}
+
+void co_image_rx (co_net_t * net, uint32_t id, const uint8_t * msg, size_t dlc)
+{
+   uint16_t function = id & CO_FUNCTION_MASK;
+   co_image_slot_t * slot;
+
+   if (id & (CO_RTR_MASK | CO_EXT_MASK))
+      return;
+
+   /* TPDOs are 180h, 280h, 380h and 480h + node ID */
+   if ((function & 0x80) == 0)
+      return;
+
+   slot = co_image_slot (net, CO_NODE_GET (id), function >> 8);
+   if (slot == NULL)
+      return;
+
+   if (dlc > sizeof (slot->entry.data))
+      dlc = sizeof (slot->entry.data);
+
+   co_seqlock_write_begin (&slot->lock);
+   slot->entry.timestamp = os_tick_current();
+   slot->entry.count++;
+   slot->entry.dlc = dlc;
+   memcpy (slot->entry.data, msg, dlc);
+   co_seqlock_write_end (&slot->lock);
+}
+
+int co_image_read (
+   co_net_t * net,
+   uint8_t node,
+   uint8_t pdo,
+   co_image_entry_t * entry)
+{
+   unsigned int retries = CO_SEQLOCK_RETRIES;
+   co_image_slot_t * slot;
+   uint32_t sequence;
+
+   slot = co_image_slot (net, node, pdo);
+   if (slot == NULL)
+      return -1;
+
+   do
+   {
+      sequence = co_seqlock_read_begin (&slot->lock);
+      memcpy (entry, &slot->entry, sizeof (*entry));
+      if (!co_seqlock_read_retry (&slot->lock, sequence))
+         return 0;
+   } while (--retries > 0);
+
+   return -1;
+}
@@ -0,0 +1,49 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Network process image of remote PDOs
+ */
+
+#ifndef CO_IMAGE_H
+#define CO_IMAGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "co_api.h"
+#include "co_main.h"
+
+/**
+ * Receive PDO into network process image
+ *
+ * This function should be called when a PDO is received. If the
+ * COB-ID is the TPDO of a remote node in the predefined connection
+ * set, the PDO is stored in the network process image.
+ *
+ * @param net           network handle
+ * @param id            CAN ID
+ * @param msg           CAN message
+ * @param dlc           size of CAN message
+ */
+void co_image_rx (co_net_t * net, uint32_t id, const uint8_t * msg, size_t dlc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_IMAGE_H */
@@ -13,13 +13,47 @@
  * full license information.
  ********************************************************************/
 
+#ifdef UNIT_TEST
+#define os_tick_current mock_os_tick_current
+#define os_tick_from_us mock_os_tick_from_us
+#endif
+
 #include "co_log.h"
 #include "co_main.h"
+#include "co_util.h"
 
 #include <stdio.h>
 #include <inttypes.h>
+#include <string.h>
+
+CC_STATIC_ASSERT ((CO_TRACE_SIZE & (CO_TRACE_SIZE - 1)) == 0);
+
+/* Flag in traced CAN ID of frames sent. Not used by CAN IDs. */
+#define CO_TRACE_TX_MASK BIT (31)
+
+/* Number of records buffered per write during dump */
+#define CO_TRACE_CHUNK 8
+
+/* Slot sequence while the slot is being written */
+#define CO_TRACE_BUSY UINT32_MAX
+
+/** Traced frame */
+typedef struct co_trace_slot
+{
+   uint32_t sequence;   /**< Position + 1, 0 if empty or CO_TRACE_BUSY */
+   uint32_t id;         /**< CAN ID and CO_TRACE_TX_MASK */
+   os_tick_t timestamp; /**< Time when traced */
+   uint8_t dlc;         /**< Size of CAN message */
+   uint8_t data[8];     /**< CAN message */
+} co_trace_slot_t;
 
-void co_msg_log (char * prefix, uint32_t id, const uint8_t * data, size_t dlc)
+static co_trace_slot_t co_trace_ring[CO_TRACE_SIZE];
+static uint32_t co_trace_head;
+
+#if CO_CAN_LOG == LOG_STATE_ON
+
+#if LOG_LEVEL == LOG_LEVEL_DEBUG
+static void co_trace_print (uint8_t flags, uint32_t id, const uint8_t * data, size_t dlc)
 {
    unsigned int ix;
    char s[80];
@@ -38,5 +72,146 @@ void co_msg_log (char * prefix, uint32_t id, const uint8_t * data, size_t dlc)
       }
    }
 
-   LOG_DEBUG (CO_CAN_LOG, "%s %04" PRIx32 ":%s\n", prefix, id & CO_ID_MASK, s);
+   LOG_DEBUG (
+      CO_CAN_LOG,
+      "%s %04" PRIx32 ":%s\n",
+      (flags & CO_TRACE_TX) ? "Tx" : "Rx",
+      id & CO_ID_MASK,
+      s);
+}
+#endif
+
+/* Claim slot for writing. Writers a multiple of CO_TRACE_SIZE
+   positions apart share a slot. The frame is dropped if another
+   writer holds the slot or has already stored a newer frame in it,
+   rather than letting the writes interleave. */
+static bool co_trace_claim (co_trace_slot_t * slot, uint32_t sequence)
+{
+   uint32_t previous = co_atomic_get_uint32 (&slot->sequence);
+
+   /* The frames at positions UINT32_MAX - 1 and UINT32_MAX are lost
+      when the position wraps, their sequences are reserved */
+   if (sequence == 0 || sequence == CO_TRACE_BUSY)
+      return false;
+
+   if (previous == CO_TRACE_BUSY)
+      return false;
+
+   if (previous != 0 && (int32_t)(previous - sequence) > 0)
+      return false;
+
+   return co_atomic_cas_uint32 (&slot->sequence, previous, CO_TRACE_BUSY);
+}
+
+void co_trace (uint8_t flags, uint32_t id, const void * data, size_t dlc)
+{
+   uint32_t position = co_atomic_add_uint32 (&co_trace_head, 1);
+   co_trace_slot_t * slot = &co_trace_ring[position % CO_TRACE_SIZE];
+
+   if (dlc > sizeof (slot->data))
+      dlc = sizeof (slot->data);
+
+   /* Slot is invalid while it is written, see co_trace_dump() */
+   if (co_trace_claim (slot, position + 1))
+   {
+      CO_MEMORY_BARRIER();
+
+      slot->id        = (flags & CO_TRACE_TX) ? id | CO_TRACE_TX_MASK : id;
+      slot->timestamp = os_tick_current();
+      slot->dlc       = (uint8_t)dlc;
+      memset (slot->data, 0, sizeof (slot->data));
+      if (data != NULL && !(id & CO_RTR_MASK))
+         memcpy (slot->data, data, dlc);
+
+      CO_MEMORY_BARRIER();
+      co_atomic_set_uint32 (&slot->sequence, position + 1);
+   }
+
+#if LOG_LEVEL == LOG_LEVEL_DEBUG
+   co_trace_print (flags, id, data, dlc);
+#endif
+}
+
+#endif /* CO_CAN_LOG == LOG_STATE_ON */
+
+void co_trace_clear (void)
+{
+   memset (co_trace_ring, 0, sizeof (co_trace_ring));
+   co_atomic_set_uint32 (&co_trace_head, 0);
+}
+
+/* Copy slot at position. Returns false if it has been overwritten. */
+static bool co_trace_copy (uint32_t position, co_trace_slot_t * copy)
+{
+   const co_trace_slot_t * slot = &co_trace_ring[position % CO_TRACE_SIZE];
+   uint32_t sequence;
+
+   sequence = co_atomic_get_uint32 (&slot->sequence);
+   CO_MEMORY_BARRIER();
+
+   /* Empty and busy slots never match, see co_trace_claim() */
+   if (sequence != position + 1 || sequence == 0 || sequence == CO_TRACE_BUSY)
+      return false;
+
+   *copy = *slot;
+
+   CO_MEMORY_BARRIER();
+   return co_atomic_get_uint32 (&slot->sequence) == sequence;
+}
+
+int co_trace_dump (
+   int (*write) (void * arg, const void * data, size_t size),
+   void * arg)
+{
+   uint8_t buffer[CO_TRACE_CHUNK * CO_TRACE_RECORD_SIZE];
+   uint8_t * p = buffer;
+   uint32_t head;
+   uint32_t position;
+   co_trace_slot_t slot;
+   int count = 0;
+
+   CC_STATIC_ASSERT (sizeof (buffer) >= CO_TRACE_HEADER_SIZE);
+
+   /* Header */
+   p = co_put_uint32 (p, CO_TRACE_MAGIC);
+   p = co_put_uint16 (p, CO_TRACE_VERSION);
+   p = co_put_uint16 (p, CO_TRACE_RECORD_SIZE);
+   p = co_put_uint32 (p, (uint32_t)os_tick_from_us (1000000));
+   p = co_put_uint32 (p, 0);
+   if (write (arg, buffer, CO_TRACE_HEADER_SIZE) < 0)
+      return -1;
+
+   /* Records, oldest first. Positions before the first frame was
+      traced never match a slot sequence and are skipped. */
+   head = co_atomic_get_uint32 (&co_trace_head);
+   p    = buffer;
+   for (position = head - CO_TRACE_SIZE; position != head; position++)
+   {
+      if (!co_trace_copy (position, &slot))
+         continue;
+
+      p = co_put_uint64 (p, slot.timestamp);
+      p = co_put_uint32 (p, slot.id & ~CO_TRACE_TX_MASK);
+      p = co_put_uint8 (p, (slot.id & CO_TRACE_TX_MASK) ? CO_TRACE_TX : 0);
+      p = co_put_uint8 (p, slot.dlc);
+      p = co_put_uint16 (p, 0);
+      memcpy (p, slot.data, sizeof (slot.data));
+      p += sizeof (slot.data);
+      count++;
+
+      if (p == buffer + sizeof (buffer))
+      {
+         if (write (arg, buffer, sizeof (buffer)) < 0)
+            return -1;
+         p = buffer;
+      }
+   }
+
+   if (p != buffer)
+   {
+      if (write (arg, buffer, p - buffer) < 0)
+         return -1;
+   }
+
+   return count;
 }
@@ -15,7 +15,7 @@
 
 /**
  * @file
- * @brief CAN message logging utilities
+ * @brief CAN message trace
  */
 
 #ifndef CO_LOG_H
@@ -25,20 +25,52 @@
 extern "C" {
 #endif
 
+#include "options.h"
+#include "osal_log.h"
+
 #include <stdint.h>
 #include <stdlib.h>
 
+/** Trace flag of frames sent */
+#define CO_TRACE_TX 0x01
+
+/** Trace record in dump, see co_trace_dump() */
+#define CO_TRACE_RECORD_SIZE 24
+
+/** Trace dump header, see co_trace_dump() */
+#define CO_TRACE_HEADER_SIZE 16
+
+#if CO_CAN_LOG == LOG_STATE_ON
+
 /**
- * Log CAN message
+ * Trace CAN message
  *
- * This function logs CAN messages.
+ * This function stores a CAN message in the trace buffer. It is
+ * called by the CAN driver for every frame sent or received and may
+ * be called from any thread. The cost is one atomic increment and a
+ * copy of the frame. Frames are also printed if the CAN log is
+ * enabled at debug level.
  *
- * @param prefix        Prefix of message
+ * @param flags         CO_TRACE_TX if sent, 0 if received
  * @param id            CAN ID
  * @param data          CAN message
  * @param dlc           size of CAN message
  */
-void co_msg_log (char * prefix, uint32_t id, const uint8_t * data, size_t dlc);
+void co_trace (uint8_t flags, uint32_t id, const void * data, size_t dlc);
+
+#else
+
+#define co_trace(flags, id, data, dlc)
+
+#endif
+
+/**
+ * Clear CAN trace
+ *
+ * This function discards all traced frames. It should not be called
+ * while frames are traced.
+ */
+void co_trace_clear (void);
 
 #ifdef __cplusplus
 }
@@ -18,55 +18,18 @@
 #define os_channel_bus_off     mock_os_channel_bus_off
 #define os_channel_bus_on      mock_os_channel_bus_on
 #define os_channel_set_bitrate mock_os_channel_set_bitrate
+#define os_channel_set_listen_only mock_os_channel_set_listen_only
+#define os_channel_get_state   mock_os_channel_get_state
+#define os_tick_current        mock_os_tick_current
+#define os_tick_from_us        mock_os_tick_from_us
 #endif
 
 #include "co_lss.h"
 #include "co_nmt.h"
 #include "co_od.h"
+#include "co_stats.h"
 #include "co_util.h"
 
-typedef enum lss_cs
-{
-   CS_SWITCH_GLOBAL                  = 0x04,
-   CS_CONFIGURE_NODE_ID              = 0x11,
-   CS_CONFIGURE_BIT_TIMING           = 0x13,
-   CS_ACTIVATE_BIT_TIMING            = 0x15,
-   CS_STORE_CONFIGURATION            = 0x17,
-   CS_SWITCH_SELECTIVE_VENDOR_ID     = 0x40,
-   CS_SWITCH_SELECTIVE_PRODUCT_NO    = 0x41,
-   CS_SWITCH_SELECTIVE_REVISION_NO   = 0x42,
-   CS_SWITCH_SELECTIVE_SERIAL_NO     = 0x43,
-   CS_SWITCH_SELECTIVE_SUCCESS       = 0x44,
-   CS_IDENTIFY_REMOTE_VENDOR_ID      = 0x46,
-   CS_IDENTIFY_REMOTE_PRODUCT_NO     = 0x47,
-   CS_IDENTIFY_REMOTE_REVISION_LOW   = 0x48,
-   CS_IDENTIFY_REMOTE_REVISION_HIGH  = 0x49,
-   CS_IDENTIFY_REMOTE_SERIAL_LOW     = 0x4A,
-   CS_IDENTIFY_REMOTE_SERIAL_HIGH    = 0x4B,
-   CS_IDENTIFY_NON_CONFIGURED_REMOTE = 0x4C,
-   CS_IDENTIFY_SLAVE                 = 0x4F,
-   CS_IDENTIFY_NON_CONFIGURED_SLAVE  = 0x50,
-   CS_INQUIRE_IDENTITY_VENDOR_ID     = 0x5A,
-   CS_INQUIRE_IDENTITY_PRODUCT_NO    = 0x5B,
-   CS_INQUIRE_IDENTITY_REVISION_NO   = 0x5C,
-   CS_INQUIRE_IDENTITY_SERIAL_NO     = 0x5D,
-   CS_INQUIRE_IDENTITY_NODE_ID       = 0x5E,
-} lss_cs_t;
-
-typedef enum lss_bitrate
-{
-   LSS_BITRATE_1M       = 0,
-   LSS_BITRATE_800K     = 1,
-   LSS_BITRATE_500K     = 2,
-   LSS_BITRATE_250K     = 3,
-   LSS_BITRATE_125K     = 4,
-   LSS_BITRATE_RESERVED = 5,
-   LSS_BITRATE_50K      = 6,
-   LSS_BITRATE_20K      = 7,
-   LSS_BITRATE_10K      = 8,
-   LSS_BITRATE_AUTO     = 9, /* TODO */
-} lss_bitrate_t;
-
 typedef enum lss_match_type
 {
    MATCH_VENDOR_ID     = 0,
@@ -86,7 +49,7 @@ typedef enum lss_store_error
 
 #define LSS_MATCH_ALL (BIT (MATCH_SERIAL_HIGH + 1) - 1)
 
-static int co_lss_bitrates[] = {
+const int co_lss_bitrates[] = {
    1000 * 1000,
    800 * 1000,
    500 * 1000,
@@ -96,6 +59,7 @@ static int co_lss_bitrates[] = {
    50 * 1000,
    20 * 1000,
    10 * 1000,
+   CO_BITRATE_AUTO,
    0};
 
 const char * co_lss_state_literals[] = {
@@ -200,7 +164,7 @@ static void co_lss_configure_node_id (co_net_t * net, uint8_t * _msg)
    }
 
    msg[0] = CS_CONFIGURE_NODE_ID;
-   os_channel_send (net->channel, 0x7E4, msg, sizeof (msg));
+   co_send (net, 0x7E4, msg, sizeof (msg));
 }
 
 static void co_lss_configure_bit_timing (co_net_t * net, uint8_t * _msg)
@@ -214,7 +178,7 @@ static void co_lss_configure_bit_timing (co_net_t * net, uint8_t * _msg)
       return;
 
    if (
-      table == 0 && ix <= LSS_BITRATE_10K && /* TODO: auto */
+      table == 0 && ix <= LSS_BITRATE_AUTO &&
       ix != LSS_BITRATE_RESERVED)
    {
       LOG_DEBUG (CO_LSS_LOG, "lss pending bitrate ix %d\n", ix);
@@ -227,7 +191,7 @@ static void co_lss_configure_bit_timing (co_net_t * net, uint8_t * _msg)
    }
 
    msg[0] = CS_CONFIGURE_BIT_TIMING;
-   os_channel_send (net->channel, 0x7E4, msg, sizeof (msg));
+   co_send (net, 0x7E4, msg, sizeof (msg));
 }
 
 static void co_lss_activate_bit_timing (co_net_t * net, uint8_t * _msg)
@@ -241,9 +205,21 @@ static void co_lss_activate_bit_timing (co_net_t * net, uint8_t * _msg)
    os_usleep (1000 * delay);
 
    net->bitrate = net->lss.bitrate;
-   os_channel_bus_off (net->channel);
-   os_channel_set_bitrate (net->channel, net->bitrate);
-   os_channel_bus_on (net->channel);
+   if (net->bitrate == CO_BITRATE_AUTO)
+   {
+      /* Stay on the bus at the current bitrate if detection fails */
+      if (co_lss_autobaud_start (net) < 0)
+         os_channel_bus_on (net->channel);
+   }
+   else
+   {
+      os_channel_bus_off (net->channel);
+      if (os_channel_set_bitrate (net->channel, net->bitrate) < 0)
+      {
+         LOG_WARNING (CO_LSS_LOG, "failed to switch bitrate\n");
+      }
+      os_channel_bus_on (net->channel);
+   }
 
    os_usleep (1000 * delay);
 }
@@ -283,13 +259,13 @@ static void co_lss_store_configuration (co_net_t * net, uint8_t * _msg)
       goto error1;
 
    msg[1] = SUCCESS;
-   os_channel_send (net->channel, 0x7E4, msg, sizeof (msg));
+   co_send (net, 0x7E4, msg, sizeof (msg));
    return;
 
 error2:
    net->close (arg);
 error1:
-   os_channel_send (net->channel, 0x7E4, msg, sizeof (msg));
+   co_send (net, 0x7E4, msg, sizeof (msg));
 }
 
 static void co_lss_switch_selective (co_net_t * net, uint8_t * msg)
@@ -329,7 +305,7 @@ static void co_lss_switch_selective (co_net_t * net, uint8_t * msg)
          "lss state = %s\n",
          co_lss_state_literals[LSS_STATE_CONFIG]);
       co_put_uint8 (msg, CS_SWITCH_SELECTIVE_SUCCESS);
-      os_channel_send (net->channel, 0x7E4, msg, sizeof (msg));
+      co_send (net, 0x7E4, msg, sizeof (msg));
    }
 }
 
@@ -360,7 +336,7 @@ static void co_lss_inquire_identity (co_net_t * net, uint8_t * _msg)
    /* Send response */
    p = co_put_uint8 (msg, cmd);
    co_put_uint32 (p, value & UINT32_MAX);
-   os_channel_send (net->channel, 0x7E4, msg, sizeof (msg));
+   co_send (net, 0x7E4, msg, sizeof (msg));
 }
 
 static void co_lss_identify_non_configured_remote (co_net_t * net)
@@ -378,7 +354,56 @@ static void co_lss_identify_non_configured_remote (co_net_t * net)
 
    /* Send response */
    co_put_uint8 (msg, CS_IDENTIFY_NON_CONFIGURED_SLAVE);
-   os_channel_send (net->channel, 0x7E4, msg, sizeof (msg));
+   co_send (net, 0x7E4, msg, sizeof (msg));
+}
+
+static void co_lss_identify_fastscan (co_net_t * net, uint8_t * _msg)
+{
+   uint32_t id         = co_fetch_uint32 (&_msg[1]);
+   uint8_t bit_checked = _msg[5];
+   uint8_t sub         = _msg[6];
+   uint8_t next        = _msg[7];
+   uint8_t msg[8]      = {0};
+
+   /* Only non-configured slaves in waiting state take part */
+   if (net->lss.state != LSS_STATE_WAITING || net->state != STATE_INIT)
+      return;
+
+   if (bit_checked == LSS_FASTSCAN_CONFIRM)
+   {
+      /* Restart Fastscan */
+      net->lss.fastscan_pos = 0;
+   }
+   else
+   {
+      uint32_t mask;
+
+      if (bit_checked > 31 || sub > 3 || next > 3)
+         return;
+
+      if (net->lss.fastscan_pos != sub)
+         return;
+
+      /* Compare bits checked so far */
+      mask = UINT32_MAX << bit_checked;
+      if ((id ^ co_lss_identity_get (net, sub + 1)) & mask)
+         return;
+
+      net->lss.fastscan_pos = next;
+
+      if (bit_checked == 0 && next < sub)
+      {
+         /* Complete LSS address matched */
+         LOG_DEBUG (
+            CO_LSS_LOG,
+            "lss state = %s\n",
+            co_lss_state_literals[LSS_STATE_CONFIG]);
+         net->lss.state = LSS_STATE_CONFIG;
+      }
+   }
+
+   co_put_uint8 (msg, CS_IDENTIFY_SLAVE);
+   co_send (net, 0x7E4, msg, sizeof (msg));
 }
 
 static void co_lss_identify_remote (co_net_t * net, uint8_t * msg)
@@ -418,7 +443,7 @@ static void co_lss_identify_remote (co_net_t * net, uint8_t * msg)
       /* Indicate success */
       LOG_DEBUG (CO_LSS_LOG, "lss identified\n");
       co_put_uint8 (msg, CS_IDENTIFY_SLAVE);
-      os_channel_send (net->channel, 0x7E4, msg, sizeof (msg));
+      co_send (net, 0x7E4, msg, sizeof (msg));
    }
 }
 
@@ -426,6 +451,9 @@ int co_lss_rx (co_net_t * net, uint32_t id, uint8_t * msg, size_t dlc)
 {
    uint8_t cmd = msg[0];
 
+   if (id == 0x7E4)
+      return co_lss_master_rx (net, msg, dlc);
+
    if (id != 0x7E5)
       return -1;
 
@@ -465,6 +493,9 @@ int co_lss_rx (co_net_t * net, uint32_t id, uint8_t * msg, size_t dlc)
    case CS_IDENTIFY_NON_CONFIGURED_REMOTE:
       co_lss_identify_non_configured_remote (net);
       break;
+   case CS_FASTSCAN:
+      co_lss_identify_fastscan (net, msg);
+      break;
    case CS_IDENTIFY_REMOTE_VENDOR_ID:
    case CS_IDENTIFY_REMOTE_PRODUCT_NO:
    case CS_IDENTIFY_REMOTE_REVISION_LOW:
@@ -548,9 +579,124 @@ error1:
    return net->bitrate;
 }
 
+static int co_lss_autobaud_try (co_net_t * net)
+{
+   int bitrate = co_lss_bitrates[net->lss.autobaud_ix];
+
+   LOG_DEBUG (CO_LSS_LOG, "lss autobaud trying %d\n", bitrate);
+   os_channel_bus_off (net->channel);
+   if (os_channel_set_bitrate (net->channel, bitrate) < 0)
+   {
+      LOG_ERROR (
+         CO_LSS_LOG,
+         "lss autobaud failed to set bitrate %d\n",
+         bitrate);
+      return -1;
+   }
+   os_channel_bus_on (net->channel);
+   net->lss.autobaud_timestamp = os_tick_current();
+   return 0;
+}
+
+/* Leave bitrate detection and complete reset communication if
+   waiting for the bitrate */
+static void co_lss_autobaud_stop (co_net_t * net)
+{
+   net->lss.autobaud = false;
+
+   os_channel_bus_off (net->channel);
+   if (os_channel_set_listen_only (net->channel, false) < 0)
+   {
+      /* Node must not become active while it can not transmit */
+      LOG_ERROR (CO_LSS_LOG, "lss autobaud failed to leave listen-only\n");
+      return;
+   }
+   os_channel_bus_on (net->channel);
+
+   if (net->state == STATE_INIT && net->lss.node != 0xFF)
+   {
+      net->node = net->lss.node;
+      co_nmt_event (net, EVENT_INITDONE);
+   }
+}
+
+int co_lss_autobaud_start (co_net_t * net)
+{
+   os_channel_bus_off (net->channel);
+
+   /* Detection must not disturb the bus with error frames */
+   if (os_channel_set_listen_only (net->channel, true) < 0)
+   {
+      LOG_ERROR (CO_LSS_LOG, "lss autobaud requires listen-only mode\n");
+      net->lss.autobaud = false;
+      return -1;
+   }
+
+   net->lss.autobaud    = true;
+   net->lss.autobaud_ix = LSS_BITRATE_1M;
+   if (co_lss_autobaud_try (net) < 0)
+   {
+      net->lss.autobaud = false;
+      if (os_channel_set_listen_only (net->channel, false) < 0)
+      {
+         LOG_ERROR (CO_LSS_LOG, "lss autobaud failed to leave listen-only\n");
+      }
+      return -1;
+   }
+
+   return 0;
+}
+
+bool co_lss_autobaud_rx (co_net_t * net)
+{
+   os_channel_state_t state = {0};
+
+   if (!net->lss.autobaud)
+      return false;
+
+   /* Frames received with errors are not proof of correct bitrate */
+   os_channel_get_state (net->channel, &state);
+   if (state.error_passive || state.bus_off)
+      return true;
+
+   net->bitrate = co_lss_bitrates[net->lss.autobaud_ix];
+   LOG_INFO (CO_LSS_LOG, "lss autobaud detected %d\n", net->bitrate);
+
+   co_lss_autobaud_stop (net);
+   return false;
+}
+
+void co_lss_autobaud_timer (co_net_t * net, os_tick_t now)
+{
+   uint8_t ix = net->lss.autobaud_ix;
+
+   if (!net->lss.autobaud)
+      return;
+
+   if (!co_is_expired (now, net->lss.autobaud_timestamp, 1000 * LSS_AUTOBAUD_TIMEOUT))
+      return;
+
+   /* Try next standard bitrate, skipping reserved and auto entries */
+   do
+   {
+      ix++;
+      if (co_lss_bitrates[ix] == 0)
+         ix = 0;
+   } while (co_lss_bitrates[ix] < 0);
+
+   net->lss.autobaud_ix = ix;
+   if (co_lss_autobaud_try (net) < 0)
+   {
+      /* Continue at the current bitrate of the channel */
+      co_lss_autobaud_stop (net);
+   }
+}
+
 void co_lss_init (co_net_t * net)
 {
-   net->lss.state    = LSS_STATE_WAITING;
-   net->lss.identity = co_obj_find (net, 0x1018);
-   net->lss.match    = 0;
+   net->lss.state        = LSS_STATE_WAITING;
+   net->lss.identity     = co_obj_find (net, 0x1018);
+   net->lss.match        = 0;
+   net->lss.fastscan_pos = 0;
+   net->lss.autobaud     = false;
 }
@@ -28,6 +28,99 @@ extern "C" {
 #include "co_api.h"
 #include "co_main.h"
 
+/** LSS command specifiers. See CiA 305 */
+typedef enum lss_cs
+{
+   CS_SWITCH_GLOBAL                  = 0x04,
+   CS_CONFIGURE_NODE_ID              = 0x11,
+   CS_CONFIGURE_BIT_TIMING           = 0x13,
+   CS_ACTIVATE_BIT_TIMING            = 0x15,
+   CS_STORE_CONFIGURATION            = 0x17,
+   CS_SWITCH_SELECTIVE_VENDOR_ID     = 0x40,
+   CS_SWITCH_SELECTIVE_PRODUCT_NO    = 0x41,
+   CS_SWITCH_SELECTIVE_REVISION_NO   = 0x42,
+   CS_SWITCH_SELECTIVE_SERIAL_NO     = 0x43,
+   CS_SWITCH_SELECTIVE_SUCCESS       = 0x44,
+   CS_IDENTIFY_REMOTE_VENDOR_ID      = 0x46,
+   CS_IDENTIFY_REMOTE_PRODUCT_NO     = 0x47,
+   CS_IDENTIFY_REMOTE_REVISION_LOW   = 0x48,
+   CS_IDENTIFY_REMOTE_REVISION_HIGH  = 0x49,
+   CS_IDENTIFY_REMOTE_SERIAL_LOW     = 0x4A,
+   CS_IDENTIFY_REMOTE_SERIAL_HIGH    = 0x4B,
+   CS_IDENTIFY_NON_CONFIGURED_REMOTE = 0x4C,
+   CS_IDENTIFY_SLAVE                 = 0x4F,
+   CS_IDENTIFY_NON_CONFIGURED_SLAVE  = 0x50,
+   CS_FASTSCAN                       = 0x51,
+   CS_INQUIRE_IDENTITY_VENDOR_ID     = 0x5A,
+   CS_INQUIRE_IDENTITY_PRODUCT_NO    = 0x5B,
+   CS_INQUIRE_IDENTITY_REVISION_NO   = 0x5C,
+   CS_INQUIRE_IDENTITY_SERIAL_NO     = 0x5D,
+   CS_INQUIRE_IDENTITY_NODE_ID       = 0x5E,
+} lss_cs_t;
+
+/** LSS bit timing table indices. See CiA 305 */
+typedef enum lss_bitrate
+{
+   LSS_BITRATE_1M       = 0,
+   LSS_BITRATE_800K     = 1,
+   LSS_BITRATE_500K     = 2,
+   LSS_BITRATE_250K     = 3,
+   LSS_BITRATE_125K     = 4,
+   LSS_BITRATE_RESERVED = 5,
+   LSS_BITRATE_50K      = 6,
+   LSS_BITRATE_20K      = 7,
+   LSS_BITRATE_10K      = 8,
+   LSS_BITRATE_AUTO     = 9,
+} lss_bitrate_t;
+
+/** Fastscan BitChecked value that resets the Fastscan of all slaves */
+#define LSS_FASTSCAN_CONFIRM 0x80
+
+/** Bitrates indexed by bit timing table index, 0 terminated */
+extern const int co_lss_bitrates[];
+
+/**
+ * Start bitrate detection
+ *
+ * This function puts the CAN channel in listen-only mode and starts
+ * cycling through the standard bitrates until a frame is received
+ * without errors. The node remains in NMT INIT_COMM state until the
+ * bitrate has been detected. Detection is aborted if a bitrate can
+ * not be set, the channel then stays at its current bitrate.
+ *
+ * @param net           network handle
+ *
+ * @return 0 on success, -1 if listen-only mode is not supported or
+ *         the first bitrate could not be set
+ */
+int co_lss_autobaud_start (co_net_t * net);
+
+/**
+ * Handle received frame during bitrate detection
+ *
+ * This function should be called for each received frame. If
+ * bitrate detection is ongoing, the frame is taken as proof that the
+ * current bitrate is correct, unless the CAN controller reports
+ * errors. The detected bitrate is then activated.
+ *
+ * @param net           network handle
+ *
+ * @return true if the frame should be discarded, false otherwise
+ */
+bool co_lss_autobaud_rx (co_net_t * net);
+
+/**
+ * Bitrate detection timer
+ *
+ * This function should be called periodically. It tries the next
+ * bitrate when no frame has been received within
+ * LSS_AUTOBAUD_TIMEOUT.
+ *
+ * @param net           network handle
+ * @param now           timestamp
+ */
+void co_lss_autobaud_timer (co_net_t * net, os_tick_t now);
+
 /**
  * Get LSS persistent node ID
  *
@@ -65,6 +158,44 @@ int co_lss_get_persistent_bitrate (co_net_t * net);
  */
 int co_lss_rx (co_net_t * net, uint32_t id, uint8_t * msg, size_t dlc);
 
+/**
+ * Receive LSS slave response
+ *
+ * This function handles responses to the LSS master and should be
+ * called when an LSS slave message is received.
+ *
+ * @param net           network handle
+ * @param msg           CAN message
+ * @param dlc           size of CAN message
+ *
+ * @return 0 on success, -1 otherwise
+ */
+int co_lss_master_rx (co_net_t * net, uint8_t * msg, size_t dlc);
+
+/**
+ * Start LSS master job
+ *
+ * This function starts an LSS request or a Fastscan. The job
+ * completes when the response has been received, or on timeout.
+ *
+ * @param net           network handle
+ * @param job           LSS master job
+ */
+void co_lss_master_job (co_net_t * net, co_job_t * job);
+
+/**
+ * LSS master timer
+ *
+ * This function advances Fastscan and handles LSS response timeouts
+ * and should be called periodically.
+ *
+ * @param net           network handle
+ * @param now           current timestamp
+ *
+ * @return 0 always
+ */
+int co_lss_master_timer (co_net_t * net, os_tick_t now);
+
 /**
  * Initialise LSS state
  *
@@ -0,0 +1,247 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifdef UNIT_TEST
+#define os_channel_send mock_os_channel_send
+#define os_tick_current mock_os_tick_current
+#define os_tick_from_us mock_os_tick_from_us
+#endif
+
+#include "co_lss.h"
+#include "co_stats.h"
+#include "co_util.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+/* Fastscan phases */
+#define FASTSCAN_RESET  0 /* Waiting for any non-configured slave */
+#define FASTSCAN_SCAN   1 /* Checking one bit of LSS address */
+#define FASTSCAN_VERIFY 2 /* Verifying one LSS address value */
+
+static void co_lss_master_send (co_net_t * net, const uint8_t * msg)
+{
+   co_lss_master_t * master = &net->lss_master;
+
+   master->ack       = false;
+   master->timestamp = os_tick_current();
+   co_send (net, 0x7E5, msg, 8);
+}
+
+static void co_lss_master_done (co_net_t * net, int result)
+{
+   co_lss_master_t * master = &net->lss_master;
+   co_job_t * job           = master->job;
+
+   master->job = NULL;
+
+   job->result = result;
+   if (job->callback)
+      job->callback (job);
+}
+
+static void co_lss_fastscan_send (
+   co_net_t * net,
+   uint32_t id,
+   uint8_t bit_checked,
+   uint8_t sub,
+   uint8_t next)
+{
+   uint8_t msg[8] = {0};
+   uint8_t * p;
+
+   p = co_put_uint8 (msg, CS_FASTSCAN);
+   p = co_put_uint32 (p, id);
+   p = co_put_uint8 (p, bit_checked);
+   p = co_put_uint8 (p, sub);
+   co_put_uint8 (p, next);
+
+   co_lss_master_send (net, msg);
+}
+
+static void co_lss_fastscan_scan (co_net_t * net)
+{
+   co_lss_master_t * master = &net->lss_master;
+
+   /* Ask for slaves where the checked bit is 0 */
+   master->phase = FASTSCAN_SCAN;
+   co_lss_fastscan_send (net, master->id[master->sub], master->bit, master->sub, master->sub);
+}
+
+static void co_lss_fastscan_verify (co_net_t * net)
+{
+   co_lss_master_t * master = &net->lss_master;
+
+   /* Matching slaves move on to next value. After the last value,
+      the single matching slave enters configuration state. */
+   master->phase = FASTSCAN_VERIFY;
+   co_lss_fastscan_send (
+      net,
+      master->id[master->sub],
+      0,
+      master->sub,
+      (master->sub + 1) % NELEMENTS (master->id));
+}
+
+static void co_lss_fastscan_step (co_net_t * net)
+{
+   co_lss_master_t * master = &net->lss_master;
+   co_lss_address_t * address;
+
+   switch (master->phase)
+   {
+   case FASTSCAN_RESET:
+      if (!master->ack)
+      {
+         LOG_DEBUG (CO_LSS_LOG, "lss no non-configured slaves\n");
+         co_lss_master_done (net, -1);
+         return;
+      }
+
+      master->sub = 0;
+      master->bit = 31;
+      co_lss_fastscan_scan (net);
+      break;
+
+   case FASTSCAN_SCAN:
+      /* No response means that the bit is 1 in remaining slaves */
+      if (!master->ack)
+         master->id[master->sub] |= BIT (master->bit);
+
+      if (master->bit == 0)
+      {
+         co_lss_fastscan_verify (net);
+      }
+      else
+      {
+         master->bit--;
+         co_lss_fastscan_scan (net);
+      }
+      break;
+
+   case FASTSCAN_VERIFY:
+      if (!master->ack)
+      {
+         LOG_WARNING (CO_LSS_LOG, "lss fastscan lost slave\n");
+         co_lss_master_done (net, -1);
+         return;
+      }
+
+      master->sub++;
+      if (master->sub < NELEMENTS (master->id))
+      {
+         master->bit = 31;
+         co_lss_fastscan_scan (net);
+         return;
+      }
+
+      /* Slave found */
+      address           = master->job->lss.address;
+      address->vendor   = master->id[0];
+      address->product  = master->id[1];
+      address->revision = master->id[2];
+      address->serial   = master->id[3];
+
+      LOG_INFO (
+         CO_LSS_LOG,
+         "lss found %08" PRIx32 ":%08" PRIx32 ":%08" PRIx32 ":%08" PRIx32 "\n",
+         master->id[0],
+         master->id[1],
+         master->id[2],
+         master->id[3]);
+      co_lss_master_done (net, 0);
+      break;
+
+   default:
+      CC_ASSERT (0);
+      break;
+   }
+}
+
+int co_lss_master_rx (co_net_t * net, uint8_t * msg, size_t dlc)
+{
+   co_lss_master_t * master = &net->lss_master;
+   co_job_t * job           = master->job;
+
+   if (job == NULL || dlc != 8)
+      return -1;
+
+   if (job->type == CO_JOB_LSS_FASTSCAN)
+   {
+      /* Responses are collected until timeout, as several slaves
+         may respond to the same request */
+      if (msg[0] == CS_IDENTIFY_SLAVE)
+         master->ack = true;
+   }
+   else if (job->lss.response && msg[0] == job->lss.msg[0])
+   {
+      memcpy (job->lss.msg, msg, sizeof (job->lss.msg));
+      co_lss_master_done (net, 0);
+   }
+
+   return 0;
+}
+
+void co_lss_master_job (co_net_t * net, co_job_t * job)
+{
+   co_lss_master_t * master = &net->lss_master;
+
+   if (master->job != NULL)
+   {
+      /* Only one LSS master job at a time */
+      job->result = -1;
+      if (job->callback)
+         job->callback (job);
+      return;
+   }
+
+   master->job = job;
+
+   if (job->type == CO_JOB_LSS_FASTSCAN)
+   {
+      memset (master->id, 0, sizeof (master->id));
+      master->phase = FASTSCAN_RESET;
+      co_lss_fastscan_send (net, 0, LSS_FASTSCAN_CONFIRM, 0, 0);
+      return;
+   }
+
+   co_lss_master_send (net, job->lss.msg);
+   if (!job->lss.response)
+      co_lss_master_done (net, 0);
+}
+
+int co_lss_master_timer (co_net_t * net, os_tick_t now)
+{
+   co_lss_master_t * master = &net->lss_master;
+   co_job_t * job           = master->job;
+
+   if (job == NULL)
+      return 0;
+
+   if (!co_is_expired (now, master->timestamp, 1000 * LSS_TIMEOUT))
+      return 0;
+
+   if (job->type == CO_JOB_LSS_FASTSCAN)
+   {
+      co_lss_fastscan_step (net);
+   }
+   else
+   {
+      LOG_WARNING (CO_LSS_LOG, "lss timeout (cs %02x)\n", job->lss.msg[0]);
+      co_lss_master_done (net, -1);
+   }
+
+   return 0;
+}
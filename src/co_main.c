@@ -17,18 +17,31 @@
 #define os_usleep              mock_os_usleep
 #define os_thread_create       mock_os_thread_create
 #define os_channel_open        mock_os_channel_open
+#define os_channel_close       mock_os_channel_close
 #define os_channel_send        mock_os_channel_send
 #define os_channel_receive     mock_os_channel_receive
 #define os_channel_set_bitrate mock_os_channel_set_bitrate
 #define os_channel_set_filter  mock_os_channel_set_filter
 #define os_channel_bus_on      mock_os_channel_bus_on
 #define os_channel_bus_off     mock_os_channel_bus_off
+#define os_tick_current        mock_os_tick_current
+#define os_tick_from_us        mock_os_tick_from_us
+#define os_sem_wait            mock_os_sem_wait
+#define os_loop_create         mock_os_loop_create
+#define os_loop_destroy        mock_os_loop_destroy
+#define os_loop_add            mock_os_loop_add
+#define os_loop_remove         mock_os_loop_remove
+#define os_loop_wait           mock_os_loop_wait
+#define os_loop_wake           mock_os_loop_wake
+#define os_loop_fd             mock_os_loop_fd
+#define os_loop_bind           mock_os_loop_bind
 #endif
 
 #include "co_main.h"
 #include "co_api.h"
 
 #include "co_nmt.h"
+#include "co_od.h"
 #include "co_sdo.h"
 #include "co_pdo.h"
 #include "co_sync.h"
@@ -37,27 +50,86 @@
 #include "co_node_guard.h"
 #include "co_lss.h"
 #include "co_bitmap.h"
+#include "co_notify.h"
+#include "co_bootup.h"
+#include "co_image.h"
+#include "co_arena.h"
+#include "co_master.h"
+#include "co_stats.h"
+#include "co_capture.h"
+#include "co_probe.h"
+#include "co_util.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define IS_PDO(f) ((f) >= CO_FUNCTION_PDO1_TX && (f) <= CO_FUNCTION_PDO4_RX)
 
-void co_handle_rx (co_net_t * net)
+#if defined(_MSC_VER)
+#define CO_THREAD_LOCAL __declspec (thread)
+#else
+#define CO_THREAD_LOCAL __thread
+#endif
+
+/* Network or reactor serviced by the current thread, or network
+   being polled by co_poll(). NULL if not called from the stack. */
+static CO_THREAD_LOCAL const void * co_thread_context;
+
+/* Interval of periodic handler (us) */
+#define CO_PERIOD 1000
+
+/* Maximum number of ready channels handled per reactor wakeup */
+#define CO_REACTOR_READY 16
+
+/* Number of consecutive failed waits before the reactor gives up */
+#define CO_REACTOR_RETRIES 10
+
+/** Reactor servicing several networks from one thread */
+struct co_reactor
+{
+   os_loop_t * loop;    /**< Event loop */
+   os_mutex_t * mutex;  /**< Protects list of networks and flags */
+   os_sem_t * stopped;  /**< Signalled when thread has stopped */
+   co_net_t * nets;     /**< Networks serviced by reactor */
+   int cpu;             /**< CPU to bind thread to, or -1 */
+   bool stopping;       /**< Thread is stopping, no more networks */
+   bool release;        /**< Released by thread when it stops */
+};
+
+void co_handle_rx (co_net_t * net, os_tick_t now)
 {
    int status;
    uint32_t id;
    uint8_t data[8];
    size_t dlc;
+   unsigned int frames = 0;
+
+   net->rx_timestamp = now;
+   CO_PROBE1 (rx_entry, net->node);
 
    do
    {
       status = os_channel_receive (net->channel, &id, data, &dlc);
+
+      /* Discard frames while bitrate is being detected */
+      if (status == 0 && co_lss_autobaud_rx (net))
+         continue;
+
       if (status == 0)
       {
          uint16_t function = id & CO_FUNCTION_MASK;
          uint8_t node      = CO_NODE_GET (id);
 
+         frames++;
+         co_stats_rx (net, id);
+         co_capture_frame (net, id, data, dlc);
+         CO_PROBE3 (rx_frame, net->node, id, dlc);
+
+         /* EMCYs may be consumed on other COB IDs (1028h) */
+         if (net->emcy.remapped > 0 && function != CO_FUNCTION_EMCY)
+            co_emcy_rx (net, id, data, dlc);
+
          /* Process messages */
          if (function == CO_FUNCTION_NMT)
          {
@@ -65,6 +137,7 @@ void co_handle_rx (co_net_t * net)
          }
          else if (IS_PDO (function))
          {
+            co_image_rx (net, id, data, dlc);
             co_pdo_rx (net, id, data, dlc);
          }
          else if (function == CO_FUNCTION_SYNC && node == 0)
@@ -85,6 +158,7 @@ void co_handle_rx (co_net_t * net)
          }
          else if (function == CO_FUNCTION_NMT_ERR)
          {
+            co_bootup_rx (net, id, data, dlc);
             co_heartbeat_rx (net, node, data, dlc);
             co_node_guard_rx (net, id, data, dlc);
          }
@@ -92,20 +166,96 @@ void co_handle_rx (co_net_t * net)
          {
             co_lss_rx (net, id, data, dlc);
          }
+
+         co_notify_flush (net, CO_NOTIFY_FRAME);
       }
    } while (status == 0);
+
+   /* One sample per batch, so that the clock is read once */
+   if (frames > 0)
+   {
+      co_stats_latency (
+         net,
+         &net->stats.rx_batch_latency,
+         net->rx_timestamp,
+         os_tick_current());
+   }
+
+   CO_PROBE2 (rx_exit, net->node, frames);
 }
 
-void co_handle_periodic (co_net_t * net)
+void co_handle_periodic (co_net_t * net, os_tick_t now)
 {
-   os_tick_t now = os_tick_current();
-
    co_sdo_server_timer (net, now);
    co_sdo_client_timer (net, now);
    co_pdo_timer (net, now);
    co_sync_timer (net, now);
    co_heartbeat_timer (net, now);
+   co_emcy_timer (net, now);
    co_node_guard_timer (net, now);
+   co_bootup_timer (net, now);
+   co_lss_master_timer (net, now);
+   co_lss_autobaud_timer (net, now);
+}
+
+static void co_handle_job (co_net_t * net, co_job_t * job)
+{
+   switch (job->type)
+   {
+   case CO_JOB_PERIODIC:
+      co_handle_periodic (net, os_tick_current());
+      co_emcy_handle_can_state (net);
+      break;
+   case CO_JOB_RX:
+      co_handle_rx (net, os_tick_current());
+      break;
+   case CO_JOB_PDO_EVENT:
+   case CO_JOB_PDO_OBJ_EVENT:
+      co_pdo_job (net, job);
+      break;
+   case CO_JOB_SDO_READ:
+   case CO_JOB_SDO_WRITE:
+      co_sdo_issue (net, job);
+      break;
+   case CO_JOB_EMCY_TX:
+   case CO_JOB_ERROR_SET:
+   case CO_JOB_ERROR_CLEAR:
+   case CO_JOB_ERROR_GET:
+   case CO_JOB_EMCY_SUBSCRIBE:
+   case CO_JOB_EMCY_UNSUBSCRIBE:
+   case CO_JOB_EMCY_STATUS_GET:
+      co_emcy_job (net, job);
+      break;
+   case CO_JOB_NMT:
+      co_nmt_job (net, job);
+      break;
+   case CO_JOB_SYNC:
+      co_sync_job (net, job);
+      break;
+   case CO_JOB_BOOTUP_WAIT:
+      co_bootup_job (net, job);
+      break;
+   case CO_JOB_MASTER_BOOT:
+      co_master_job (net, job);
+      break;
+   case CO_JOB_LSS_REQUEST:
+   case CO_JOB_LSS_FASTSCAN:
+      co_lss_master_job (net, job);
+      break;
+   case CO_JOB_STATS_GET:
+   case CO_JOB_STATS_RESET:
+      co_stats_job (net, job);
+      break;
+   case CO_JOB_CAPTURE_START:
+   case CO_JOB_CAPTURE_STOP:
+      co_capture_job (net, job);
+      break;
+   default:
+      CC_ASSERT (0);
+      break;
+   }
+
+   co_notify_flush (net, CO_NOTIFY_FRAME);
 }
 
 void co_main (void * arg)
@@ -114,42 +264,269 @@ void co_main (void * arg)
    co_job_t * job;
    bool running = true;
 
+   co_thread_context = net;
+
    /* Main loop */
    while (running)
    {
       os_mbox_fetch (net->mbox, (void **)&job, OS_WAIT_FOREVER);
+      CO_PROBE2 (mbox_fetch, net->node, job->type);
 
-      switch (job->type)
-      {
-      case CO_JOB_PERIODIC:
-         co_handle_periodic (net);
-         co_emcy_handle_can_state (net);
-         break;
-      case CO_JOB_RX:
-         co_handle_rx (net);
-         break;
-      case CO_JOB_PDO_EVENT:
-      case CO_JOB_PDO_OBJ_EVENT:
-         co_pdo_job (net, job);
-         break;
-      case CO_JOB_SDO_READ:
-      case CO_JOB_SDO_WRITE:
-         co_sdo_issue (net, job);
-         break;
-      case CO_JOB_EMCY_TX:
-      case CO_JOB_ERROR_SET:
-      case CO_JOB_ERROR_CLEAR:
-      case CO_JOB_ERROR_GET:
-         co_emcy_job (net, job);
-         break;
-      case CO_JOB_EXIT:
+      if (job->type == CO_JOB_EXIT)
          running = false;
+      else
+         co_handle_job (net, job);
+   }
+}
+
+static void co_reactor_release (co_reactor_t * reactor)
+{
+   os_sem_destroy (reactor->stopped);
+   os_mutex_destroy (reactor->mutex);
+   os_loop_destroy (reactor->loop);
+   free (reactor);
+}
+
+/* Stop servicing network, called from the reactor thread with the
+   reactor mutex held */
+static void co_reactor_detach (co_reactor_t * reactor, co_net_t * net)
+{
+   co_net_t ** p;
+
+   os_loop_remove (reactor->loop, net->channel);
+
+   for (p = &reactor->nets; *p != NULL; p = &(*p)->reactor_next)
+   {
+      if (*p == net)
+      {
+         *p = net->reactor_next;
          break;
-      default:
-         CC_ASSERT (0);
+      }
+   }
+
+   net->reactor_next = NULL;
+
+   /* Thread stops once the last network has detached */
+   if (reactor->nets == NULL)
+      reactor->stopping = true;
+}
+
+/* Handle submitted jobs, returns false if the network exits */
+static bool co_reactor_jobs (co_net_t * net)
+{
+   co_job_t * job;
+
+   while (!os_mbox_fetch (net->mbox, (void **)&job, 0))
+   {
+      CO_PROBE2 (mbox_fetch, net->node, job->type);
+
+      if (job->type == CO_JOB_EXIT)
+         return false;
+
+      co_handle_job (net, job);
+   }
+
+   return true;
+}
+
+static void co_reactor_main (void * arg)
+{
+   co_reactor_t * reactor = arg;
+   void * ready[CO_REACTOR_READY];
+   unsigned int failures = 0;
+   uint32_t events;
+   os_tick_t now;
+   co_net_t * net;
+   co_net_t * next;
+   bool running = true;
+   bool release;
+   int n;
+   int ix;
+
+   co_thread_context = reactor;
+
+   if (reactor->cpu >= 0)
+      os_loop_bind (reactor->cpu);
+
+   while (running)
+   {
+      n = os_loop_wait (
+         reactor->loop,
+         OS_WAIT_FOREVER,
+         ready,
+         NELEMENTS (ready),
+         &events);
+      if (n < 0)
+      {
+         /* Retry transient failures, e.g. interrupted waits */
+         if (++failures < CO_REACTOR_RETRIES)
+         {
+            LOG_WARNING (CO_CAN_LOG, "reactor wait failed, retrying\n");
+            os_usleep (CO_PERIOD);
+            continue;
+         }
+
+         LOG_ERROR (CO_CAN_LOG, "reactor wait failed, networks not serviced\n");
          break;
       }
+
+      failures = 0;
+
+      /* Received frames are handled inline, batches of all ready
+         networks are timed from the wakeup */
+      now = os_tick_current();
+      for (ix = 0; ix < n; ix++)
+      {
+         co_handle_rx (ready[ix], now);
+      }
+
+      if (events == 0)
+         continue;
+
+      os_mutex_lock (reactor->mutex);
+      for (net = reactor->nets; net != NULL; net = next)
+      {
+         next = net->reactor_next;
+
+         if ((events & OS_LOOP_WAKE) && !co_reactor_jobs (net))
+         {
+            /* Exit job stops servicing this network only */
+            co_reactor_detach (reactor, net);
+            continue;
+         }
+
+         if (events & OS_LOOP_TICK)
+         {
+            co_handle_job (net, (co_job_t *)&net->job_periodic);
+         }
+      }
+      running = !reactor->stopping;
+      os_mutex_unlock (reactor->mutex);
+   }
+
+   os_mutex_lock (reactor->mutex);
+   reactor->stopping = true;
+   release           = reactor->release;
+   os_mutex_unlock (reactor->mutex);
+
+   /* Private reactors have no owner left to release them */
+   if (release)
+      co_reactor_release (reactor);
+   else
+      os_sem_signal (reactor->stopped);
+}
+
+uint64_t co_poll (co_net_t * net, uint64_t time)
+{
+   os_tick_t period     = os_tick_from_us (CO_PERIOD);
+   os_tick_t now        = (os_tick_t)time;
+   const void * context = co_thread_context;
+   uint32_t events;
+
+   /* Client calls from callbacks must not poll recursively */
+   co_thread_context = net;
+
+   /* Received frames are read until the channel is empty, only
+      consume the readiness of the descriptor */
+   if (net->loop != NULL)
+      os_loop_wait (net->loop, 0, NULL, 0, &events);
+
+   co_handle_rx (net, now);
+
+   if (co_is_expired (now, net->poll_timestamp, CO_PERIOD))
+   {
+      co_handle_periodic (net, now);
+      co_emcy_handle_can_state (net);
+      co_notify_flush (net, CO_NOTIFY_FRAME);
+
+      /* Skip missed periods rather than catching up */
+      net->poll_timestamp += period;
+      if (co_is_expired (now, net->poll_timestamp, CO_PERIOD))
+         net->poll_timestamp = now;
+   }
+
+   co_thread_context = context;
+   return net->poll_timestamp + period;
+}
+
+int co_fd_get (co_net_t * net)
+{
+   if (net->loop == NULL)
+      return -1;
+
+   return os_loop_fd (net->loop);
+}
+
+static int co_reactor_attach (co_reactor_t * reactor, co_net_t * net)
+{
+   int result = -1;
+
+   os_mutex_lock (reactor->mutex);
+   if (!reactor->stopping && os_loop_add (reactor->loop, net->channel, net) == 0)
+   {
+      net->reactor_next = reactor->nets;
+      reactor->nets     = net;
+      result            = 0;
    }
+   os_mutex_unlock (reactor->mutex);
+
+   return result;
+}
+
+co_reactor_t * co_reactor_create (int cpu)
+{
+   co_reactor_t * reactor;
+
+   reactor = calloc (1, sizeof (*reactor));
+   if (reactor == NULL)
+      goto error1;
+
+   reactor->cpu  = cpu;
+   reactor->loop = os_loop_create (CO_PERIOD);
+   if (reactor->loop == NULL)
+      goto error2;
+
+   reactor->mutex = os_mutex_create();
+   if (reactor->mutex == NULL)
+      goto error3;
+
+   reactor->stopped = os_sem_create (0);
+   if (reactor->stopped == NULL)
+      goto error4;
+
+   if (
+      os_thread_create (
+         "co_reactor",
+         CO_THREAD_PRIO,
+         CO_THREAD_STACK_SIZE,
+         co_reactor_main,
+         reactor) == NULL)
+      goto error5;
+
+   return reactor;
+
+error5:
+   os_sem_destroy (reactor->stopped);
+error4:
+   os_mutex_destroy (reactor->mutex);
+error3:
+   os_loop_destroy (reactor->loop);
+error2:
+   free (reactor);
+error1:
+   return NULL;
+}
+
+void co_reactor_destroy (co_reactor_t * reactor)
+{
+   os_mutex_lock (reactor->mutex);
+   reactor->stopping = true;
+   os_mutex_unlock (reactor->mutex);
+
+   os_loop_wake (reactor->loop);
+   os_sem_wait (reactor->stopped, OS_WAIT_FOREVER);
+
+   co_reactor_release (reactor);
 }
 
 static void co_timer (os_timer_t * timer, void * arg)
@@ -158,6 +535,7 @@ static void co_timer (os_timer_t * timer, void * arg)
    int tmo;
 
    tmo = os_mbox_post (net->mbox, &net->job_periodic, 0);
+   CO_PROBE3 (mbox_post, net->node, CO_JOB_PERIODIC, tmo);
    if (tmo)
    {
       net->mbox_overrun++;
@@ -169,39 +547,307 @@ static void co_can_callback (co_net_t * net)
    int tmo;
 
    tmo = os_mbox_post (net->mbox, &net->job_rx, 0);
+   CO_PROBE3 (mbox_post, net->node, CO_JOB_RX, tmo);
    if (tmo)
    {
       net->mbox_overrun++;
    }
 }
 
+/* Check if called from the thread servicing the network, e.g. from
+   a callback. Jobs must then be handled directly, since waiting for
+   them would deadlock the thread. */
+static bool co_is_stack_thread (co_net_t * net)
+{
+   return co_thread_context != NULL &&
+          (co_thread_context == net || co_thread_context == net->reactor);
+}
+
+static void co_job_post (co_net_t * net, co_job_t * job)
+{
+   /* Waiting for the job from the stack thread would deadlock, fail
+      the job instead */
+   if (co_is_stack_thread (net))
+   {
+      job->result = CO_STATUS_ERROR;
+      job->callback (job);
+      return;
+   }
+
+   /* Threadless networks are only called from the polling thread */
+   if (net->threadless)
+   {
+      co_handle_job (net, job);
+      return;
+   }
+
+   os_mbox_post (net->mbox, job, OS_WAIT_FOREVER);
+   CO_PROBE3 (mbox_post, net->node, job->type, 0);
+   if (net->loop != NULL)
+      os_loop_wake (net->loop);
+}
+
+static void co_job_wait (co_client_t * client)
+{
+   co_net_t * net = client->net;
+
+   if (!net->threadless)
+   {
+      os_sem_wait (client->sem, OS_WAIT_FOREVER);
+      return;
+   }
+
+   /* Drive the stack until the job completes */
+   while (os_sem_wait (client->sem, 1))
+   {
+      co_poll (net, os_tick_current());
+   }
+}
+
 static void co_job_callback (co_job_t * job)
 {
    co_client_t * client = job->client;
    os_sem_signal (client->sem);
 }
 
-/* TODO: issue nmt job? */
 void co_nmt (co_client_t * client, co_nmt_cmd_t cmd, uint8_t node)
 {
    co_net_t * net = client->net;
-   uint8_t data[] = {cmd, node};
+   co_job_t * job = &client->job;
 
-   if (node == net->node || node == 0)
+   /* Called from a callback, handle command without waiting */
+   if (co_is_stack_thread (net))
    {
-      co_nmt_rx (net, 0, data, sizeof (data));
+      co_job_t direct = {0};
+
+      direct.nmt.cmd  = cmd;
+      direct.nmt.node = node;
+      direct.type     = CO_JOB_NMT;
+      co_handle_job (net, &direct);
+      return;
    }
 
-   os_channel_send (net->channel, CO_FUNCTION_NMT, data, sizeof (data));
+   job->client   = client;
+   job->nmt.cmd  = cmd;
+   job->nmt.node = node;
+   job->callback = co_job_callback;
+   job->type     = CO_JOB_NMT;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+}
+
+int co_bootup_wait (
+   co_client_t * client,
+   const uint32_t * expected,
+   uint32_t * booted,
+   uint32_t timeout)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+
+   job->client          = client;
+   job->bootup.expected = expected;
+   job->bootup.booted   = booted;
+   job->bootup.timeout  = timeout;
+   job->callback        = co_job_callback;
+   job->timestamp       = os_tick_current();
+   job->type            = CO_JOB_BOOTUP_WAIT;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   return job->result;
+}
+
+int co_master_boot (co_client_t * client)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+
+   job->client   = client;
+   job->callback = co_job_callback;
+   job->type     = CO_JOB_MASTER_BOOT;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   return job->result;
+}
+
+co_master_state_t co_master_state_get (co_net_t * net, uint8_t node)
+{
+   if (node > 127 || net->master == NULL)
+      return CO_MASTER_NODE_UNUSED;
+
+   return net->master->state[node];
+}
+
+static int co_lss_request (
+   co_client_t * client,
+   const uint8_t * msg,
+   bool response,
+   uint8_t * result)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+
+   job->client       = client;
+   job->callback     = co_job_callback;
+   job->lss.response = response;
+   job->type         = CO_JOB_LSS_REQUEST;
+   memcpy (job->lss.msg, msg, sizeof (job->lss.msg));
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   if (result != NULL)
+      memcpy (result, job->lss.msg, sizeof (job->lss.msg));
+
+   return job->result;
+}
+
+int co_lss_fastscan (co_client_t * client, co_lss_address_t * address)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+
+   job->client      = client;
+   job->callback    = co_job_callback;
+   job->lss.address = address;
+   job->type        = CO_JOB_LSS_FASTSCAN;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   return job->result;
+}
+
+int co_lss_node_id_set (co_client_t * client, uint8_t node)
+{
+   uint8_t msg[8] = {CS_CONFIGURE_NODE_ID, node};
+
+   /* Response has error code 0 on success */
+   if (co_lss_request (client, msg, true, msg) < 0 || msg[1] != 0)
+      return -1;
+
+   return 0;
+}
+
+int co_lss_bitrate_set (co_client_t * client, int bitrate)
+{
+   uint8_t msg[8] = {CS_CONFIGURE_BIT_TIMING, 0};
+   uint8_t ix;
+
+   for (ix = 0; co_lss_bitrates[ix] != 0; ix++)
+   {
+      if (co_lss_bitrates[ix] == bitrate)
+         break;
+   }
+
+   if (co_lss_bitrates[ix] == 0 || ix == LSS_BITRATE_RESERVED)
+      return -1;
+
+   msg[2] = ix;
+   if (co_lss_request (client, msg, true, msg) < 0 || msg[1] != 0)
+      return -1;
+
+   return 0;
+}
+
+int co_lss_store (co_client_t * client)
+{
+   uint8_t msg[8] = {CS_STORE_CONFIGURATION};
+
+   if (co_lss_request (client, msg, true, msg) < 0 || msg[1] != 0)
+      return -1;
+
+   return 0;
+}
+
+int co_lss_switch_state (co_client_t * client, bool config)
+{
+   uint8_t msg[8] = {CS_SWITCH_GLOBAL};
+
+   msg[1] = config ? LSS_STATE_CONFIG : LSS_STATE_WAITING;
+   return co_lss_request (client, msg, false, NULL);
+}
+
+size_t co_lss_assign (
+   co_client_t * client,
+   uint8_t node,
+   int bitrate,
+   co_lss_address_t * address,
+   size_t max,
+   int * error)
+{
+   co_lss_address_t found;
+   size_t n;
+   int result = 0;
+
+   for (n = 0; n < max && node + n <= 127; n++)
+   {
+      if (co_lss_fastscan (client, &found) < 0)
+         break;
+
+      if (co_lss_node_id_set (client, node + n) < 0)
+      {
+         LOG_ERROR (CO_LSS_LOG, "lss node %d not assigned\n", (int)(node + n));
+         co_lss_switch_state (client, false);
+         result = -1;
+         break;
+      }
+
+      if (address != NULL)
+         address[n] = found;
+
+      /* Node ID is assigned even if the bitrate is not */
+      if (bitrate != 0 && co_lss_bitrate_set (client, bitrate) < 0)
+      {
+         LOG_ERROR (CO_LSS_LOG, "lss node %d bitrate not set\n", (int)(node + n));
+         result = -1;
+      }
+
+      /* Storage is optional in LSS slaves */
+      if (co_lss_store (client) < 0)
+         LOG_WARNING (CO_LSS_LOG, "lss node %d did not store\n", (int)(node + n));
+
+      co_lss_switch_state (client, false);
+
+      if (result < 0)
+      {
+         n++;
+         break;
+      }
+   }
+
+   if (error != NULL)
+      *error = result;
+
+   return n;
 }
 
-/* TODO: issue sync job? */
 void co_sync (co_client_t * client)
 {
    co_net_t * net = client->net;
+   co_job_t * job = &client->job;
 
-   co_pdo_sync (net, NULL, 0);
-   os_channel_send (net->channel, CO_FUNCTION_SYNC, NULL, 0);
+   /* Called from a callback, send SYNC without waiting */
+   if (co_is_stack_thread (net))
+   {
+      co_job_t direct = {0};
+
+      direct.type = CO_JOB_SYNC;
+      co_handle_job (net, &direct);
+      return;
+   }
+
+   job->client   = client;
+   job->callback = co_job_callback;
+   job->type     = CO_JOB_SYNC;
+
+   co_job_post (net, job);
+   co_job_wait (client);
 }
 
 uint8_t co_node_next (co_client_t * client, uint8_t node)
@@ -234,8 +880,8 @@ int co_pdo_event (co_client_t * client)
    job->type     = CO_JOB_PDO_EVENT;
    job->callback = co_job_callback;
 
-   os_mbox_post (net->mbox, job, OS_WAIT_FOREVER);
-   os_sem_wait (client->sem, OS_WAIT_FOREVER);
+   co_job_post (net, job);
+   co_job_wait (client);
 
    return 0;
 }
@@ -252,8 +898,8 @@ int co_pdo_obj_event (co_client_t * client, uint16_t index, uint8_t subindex)
    job->pdo.subindex = subindex;
    job->callback     = co_job_callback;
 
-   os_mbox_post (net->mbox, job, OS_WAIT_FOREVER);
-   os_sem_wait (client->sem, OS_WAIT_FOREVER);
+   co_job_post (net, job);
+   co_job_wait (client);
 
    return 0;
 }
@@ -282,8 +928,8 @@ int co_sdo_read (
    job->timestamp    = os_tick_current();
    job->type         = CO_JOB_SDO_READ;
 
-   os_mbox_post (net->mbox, job, OS_WAIT_FOREVER);
-   os_sem_wait (client->sem, OS_WAIT_FOREVER);
+   co_job_post (net, job);
+   co_job_wait (client);
 
    return job->result;
 }
@@ -312,8 +958,8 @@ int co_sdo_write (
    job->timestamp    = os_tick_current();
    job->type         = CO_JOB_SDO_WRITE;
 
-   os_mbox_post (net->mbox, job, OS_WAIT_FOREVER);
-   os_sem_wait (client->sem, OS_WAIT_FOREVER);
+   co_job_post (net, job);
+   co_job_wait (client);
 
    return job->result;
 }
@@ -334,8 +980,8 @@ int co_emcy_issue (
    job->emcy.msef = msef;
    job->type      = CO_JOB_EMCY_TX;
 
-   os_mbox_post (net->mbox, job, OS_WAIT_FOREVER);
-   os_sem_wait (client->sem, OS_WAIT_FOREVER);
+   co_job_post (net, job);
+   co_job_wait (client);
 
    return job->result;
 }
@@ -350,8 +996,8 @@ int co_error_set (co_client_t * client, uint8_t mask)
    job->emcy.value = mask;
    job->type       = CO_JOB_ERROR_SET;
 
-   os_mbox_post (net->mbox, job, OS_WAIT_FOREVER);
-   os_sem_wait (client->sem, OS_WAIT_FOREVER);
+   co_job_post (net, job);
+   co_job_wait (client);
 
    return job->result;
 }
@@ -366,8 +1012,8 @@ int co_error_clear (co_client_t * client, uint8_t mask)
    job->emcy.value = mask;
    job->type       = CO_JOB_ERROR_CLEAR;
 
-   os_mbox_post (net->mbox, job, OS_WAIT_FOREVER);
-   os_sem_wait (client->sem, OS_WAIT_FOREVER);
+   co_job_post (net, job);
+   co_job_wait (client);
 
    return job->result;
 }
@@ -381,14 +1027,196 @@ int co_error_get (co_client_t * client, uint8_t * error)
    job->callback = co_job_callback;
    job->type     = CO_JOB_ERROR_GET;
 
-   os_mbox_post (net->mbox, job, OS_WAIT_FOREVER);
-   os_sem_wait (client->sem, OS_WAIT_FOREVER);
+   co_job_post (net, job);
+   co_job_wait (client);
 
    *error = job->emcy.value;
 
    return job->result;
 }
 
+co_emcy_stream_t * co_emcy_subscribe (co_client_t * client)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+   co_emcy_stream_t * stream;
+
+   stream = calloc (1, sizeof (*stream));
+   if (stream == NULL)
+      return NULL;
+
+   stream->event = os_event_create();
+   if (stream->event == NULL)
+   {
+      free (stream);
+      return NULL;
+   }
+
+   job->client      = client;
+   job->callback    = co_job_callback;
+   job->type        = CO_JOB_EMCY_SUBSCRIBE;
+   job->emcy.stream = stream;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   if (job->result != 0)
+   {
+      os_event_destroy (stream->event);
+      free (stream);
+      return NULL;
+   }
+
+   return stream;
+}
+
+int co_emcy_poll (
+   co_emcy_stream_t * stream,
+   co_emcy_record_t * record,
+   uint32_t timeout)
+{
+   uint32_t value;
+
+   for (;;)
+   {
+      /* Clear before checking, so that a record written after the
+         check sets the event again */
+      os_event_clr (stream->event, 1);
+      if (co_emcy_stream_read (stream, record))
+         return 0;
+
+      if (timeout == 0 || os_event_wait (stream->event, 1, &value, timeout))
+         return -1;
+   }
+}
+
+int co_emcy_unsubscribe (co_client_t * client, co_emcy_stream_t * stream)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+
+   job->client      = client;
+   job->callback    = co_job_callback;
+   job->type        = CO_JOB_EMCY_UNSUBSCRIBE;
+   job->emcy.stream = stream;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   if (job->result != 0)
+      return job->result;
+
+   os_event_destroy (stream->event);
+   free (stream);
+   return 0;
+}
+
+int co_emcy_status_get (co_client_t * client, uint8_t node, co_emcy_status_t * status)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+
+   job->client      = client;
+   job->callback    = co_job_callback;
+   job->type        = CO_JOB_EMCY_STATUS_GET;
+   job->emcy.node   = node;
+   job->emcy.status = status;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   return job->result;
+}
+
+int co_stats_get (co_client_t * client, co_stats_t * stats)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+
+   job->client   = client;
+   job->callback = co_job_callback;
+   job->stats    = stats;
+   job->type     = CO_JOB_STATS_GET;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   return job->result;
+}
+
+int co_stats_reset (co_client_t * client)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+
+   job->client   = client;
+   job->callback = co_job_callback;
+   job->type     = CO_JOB_STATS_RESET;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   return job->result;
+}
+
+int co_capture_start (
+   co_client_t * client,
+   co_capture_format_t format,
+   int (*write) (void * arg, const void * data, size_t size),
+   void * arg)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+   co_capture_t * capture;
+
+   capture = co_capture_create (format, write, arg);
+   if (capture == NULL)
+      return -1;
+
+   if (co_capture_run (capture) < 0)
+   {
+      co_capture_destroy (capture);
+      return -1;
+   }
+
+   job->client   = client;
+   job->callback = co_job_callback;
+   job->capture  = capture;
+   job->type     = CO_JOB_CAPTURE_START;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   if (job->result != 0)
+      co_capture_destroy (capture);
+
+   return job->result;
+}
+
+int co_capture_stop (co_client_t * client, uint32_t * dropped)
+{
+   co_net_t * net = client->net;
+   co_job_t * job = &client->job;
+   co_capture_t * capture;
+
+   job->client   = client;
+   job->callback = co_job_callback;
+   job->type     = CO_JOB_CAPTURE_STOP;
+
+   co_job_post (net, job);
+   co_job_wait (client);
+
+   if (job->result != 0)
+      return -1;
+
+   /* Capture is detached, no more frames are queued */
+   capture = job->capture;
+   if (dropped != NULL)
+      *dropped = capture->dropped;
+
+   return co_capture_destroy (capture);
+}
+
 co_client_t * co_client_init (co_net_t * net)
 {
    co_client_t * client;
@@ -406,11 +1234,56 @@ co_client_t * co_client_init (co_net_t * net)
 co_net_t * co_init (const char * canif, const co_cfg_t * cfg)
 {
    co_net_t * net;
+   co_reactor_t * reactor;
+   co_reactor_t * owned = NULL;
    os_timer_t * tmr;
+   co_arena_t arena;
+   co_sizes_t sizes;
+   void * memory = cfg->arena;
+   size_t size   = cfg->arena_size;
 
-   net = calloc (1, sizeof (*net));
-   if (net == NULL)
+   if (co_arena_sizes (cfg->od, cfg->process_image, &sizes) != 0)
+   {
+      LOG_ERROR (CO_ALLOC_LOG, "dictionary exceeds stack limits\n");
       goto error1;
+   }
+
+   sizes.emcy_nodes |= cfg->emcy_consumer;
+
+   if (memory == NULL)
+   {
+      size   = co_arena_size (cfg);
+      memory = malloc (size);
+      if (memory == NULL)
+         goto error1;
+   }
+
+   memset (memory, 0, size);
+   co_arena_init (&arena, memory, size);
+
+   net = co_arena_alloc (&arena, sizeof (*net), CO_ARENA_ALIGN);
+   if (net != NULL)
+      net->sizes = sizes;
+
+   if (net == NULL || co_arena_tables (net, &arena) != 0)
+   {
+      LOG_ERROR (CO_ALLOC_LOG, "arena of %u bytes too small\n", (unsigned)size);
+      goto error2;
+   }
+
+   LOG_INFO (
+      CO_ALLOC_LOG,
+      "%u TPDOs, %u RPDOs, %u mappings, %u heartbeats, %u EMCY, %u errors, "
+      "image %s: %u of %u bytes\n",
+      (unsigned)sizes.tx_pdos,
+      (unsigned)sizes.rx_pdos,
+      (unsigned)sizes.pdo_entries,
+      (unsigned)sizes.heartbeats,
+      (unsigned)sizes.emcy_cobids,
+      (unsigned)sizes.errors,
+      sizes.process_image ? "yes" : "no",
+      (unsigned)(arena.next - (uintptr_t)memory),
+      (unsigned)size);
 
    net->bitrate  = cfg->bitrate;
    net->node     = cfg->node;
@@ -423,10 +1296,17 @@ co_net_t * co_init (const char * canif, const co_cfg_t * cfg)
    net->cb_sync   = cfg->cb_sync;
    net->cb_emcy   = cfg->cb_emcy;
    net->cb_notify = cfg->cb_notify;
+   net->cb_notify_batch    = cfg->cb_notify_batch;
+   net->cb_notify_ready    = cfg->cb_notify_ready;
    net->cb_heartbeat_state = cfg->cb_heartbeat_state;
+   net->cb_bootup          = cfg->cb_bootup;
+   net->cb_master_progress = cfg->cb_master_progress;
 
    net->restart_ms = cfg->restart_ms;
 
+   net->emcy.consume_all = cfg->emcy_consumer;
+   net->emcy.rate        = 1000 * cfg->emcy_rate_ms;
+
    net->open  = cfg->open;
    net->read  = cfg->read;
    net->write = cfg->write;
@@ -435,35 +1315,108 @@ co_net_t * co_init (const char * canif, const co_cfg_t * cfg)
    net->job_periodic = CO_JOB_PERIODIC;
    net->job_rx       = CO_JOB_RX;
 
-   if (co_pdo_init (net) != 0)
+   co_od_init (net, cfg->od_size);
+   co_stats_init (net);
+
+   if (co_notify_init (net, cfg->notify_mode) != 0)
       goto error2;
 
+   if (co_pdo_init (net) != 0)
+      goto error3;
+
+   if (cfg->threadless)
+   {
+      /* Event loop without tick, only used for its descriptor */
+      net->threadless     = true;
+      net->poll_timestamp = os_tick_current() - os_tick_from_us (CO_PERIOD);
+      net->loop           = os_loop_create (0);
+
+      net->channel = os_channel_open (canif, NULL, net);
+      if (
+         net->channel == NULL ||
+         (net->loop != NULL && os_loop_add (net->loop, net->channel, net) != 0))
+      {
+         if (net->channel != NULL)
+            os_channel_close (net->channel);
+         if (net->loop != NULL)
+            os_loop_destroy (net->loop);
+         goto error3;
+      }
+
+      co_nmt_init (net);
+      return net;
+   }
+
    net->mbox = os_mbox_create (10);
    if (net->mbox == NULL)
-      goto error2;
+      goto error3;
+
+   /* Use a private reactor if the port supports event loops. The
+      protocol thread then receives frames itself, without a separate
+      receive thread and mailbox round trip. */
+   reactor = cfg->reactor;
+   if (reactor == NULL)
+   {
+      reactor = co_reactor_create (-1);
+      owned   = reactor;
+   }
+
+   if (reactor != NULL)
+   {
+      /* Channel is polled by the reactor, no timer or threads needed */
+      net->reactor = reactor;
+      net->loop    = reactor->loop;
+
+      net->channel = os_channel_open (canif, NULL, net);
+      if (net->channel == NULL)
+         goto error4;
+
+      co_nmt_init (net);
+
+      if (co_reactor_attach (net->reactor, net) != 0)
+      {
+         os_channel_close (net->channel);
+         goto error4;
+      }
 
-   tmr = os_timer_create (1000, co_timer, net, false);
+      /* Private reactor is released when the network exits */
+      if (owned != NULL)
+         owned->release = true;
+
+      return net;
+   }
+
+   /* Fall back to timer and receive callback posting to mailbox */
+   tmr = os_timer_create (CO_PERIOD, co_timer, net, false);
    if (tmr == NULL)
-      goto error3;
+      goto error4;
 
    net->channel = os_channel_open (canif, co_can_callback, net);
    if (net->channel == NULL)
-      goto error4;
+      goto error5;
 
    if (os_thread_create ("co_thread", CO_THREAD_PRIO, CO_THREAD_STACK_SIZE, co_main, net) == NULL)
-      goto error4;
+   {
+      os_channel_close (net->channel);
+      goto error5;
+   }
 
    os_timer_start (tmr);
    co_nmt_init (net);
 
    return net;
 
-error4:
+error5:
    os_timer_destroy (tmr);
-error3:
+error4:
+   if (owned != NULL)
+      co_reactor_destroy (owned);
    os_mbox_destroy (net->mbox);
+error3:
+   co_notify_exit (net);
 error2:
-   free (net);
+   if (cfg->arena == NULL)
+      free (memory);
 error1:
    return NULL;
 }
@@ -28,6 +28,7 @@ extern "C" {
 #include "co_api.h"
 #include "osal.h"
 #include "coal_can.h"
+#include "coal_loop.h"
 #include "options.h"
 #include "osal_log.h"
 
@@ -85,11 +86,31 @@ typedef struct co_pdo
       bool rpdo_monitoring : 1;
       bool rpdo_timeout : 1;
    };
-   uint32_t mappings[MAX_PDO_ENTRIES];
-   const co_obj_t * objs[MAX_PDO_ENTRIES];
-   const co_entry_t * entries[MAX_PDO_ENTRIES];
+   uint32_t * mappings;          /**< Mapping entries, see co_sizes_t */
+   const co_obj_t ** objs;       /**< Mapped objects */
+   const co_entry_t ** entries;  /**< Mapped entries */
 } co_pdo_t;
 
+/** Max number of objects that can be mapped to a PDO, one bit each */
+#define CO_PDO_MAX_ENTRIES 64
+
+/** Sizes of per-instance tables. Derived from the dictionary and
+    allocated from the arena, see co_arena.h */
+typedef struct co_sizes
+{
+   uint16_t tx_pdos;    /**< Number of TPDOs (1800h - 19FFh) */
+   uint16_t rx_pdos;    /**< Number of RPDOs (1400h - 15FFh) */
+   uint8_t pdo_entries; /**< Max number of mapped objects per PDO */
+   uint8_t heartbeats;  /**< Number of heartbeat consumers (1016h) */
+   uint8_t emcy_cobids; /**< Number of consumed EMCY COB-IDs (1028h) */
+   uint8_t errors;      /**< Size of error list (1003h) */
+   uint32_t download;   /**< Size of SDO download buffer */
+   uint32_t objects;    /**< Number of objects in dictionary */
+   bool process_image;  /**< Network process image is kept */
+   bool emcy_nodes;     /**< EMCY consumer state is kept per node */
+   bool master;         /**< NMT master boot-up state is kept (1F81h) */
+} co_sizes_t;
+
 typedef enum co_job_type
 {
    CO_JOB_NONE,
@@ -105,6 +126,19 @@ typedef enum co_job_type
    CO_JOB_ERROR_SET,
    CO_JOB_ERROR_CLEAR,
    CO_JOB_ERROR_GET,
+   CO_JOB_EMCY_SUBSCRIBE,
+   CO_JOB_EMCY_UNSUBSCRIBE,
+   CO_JOB_EMCY_STATUS_GET,
+   CO_JOB_NMT,
+   CO_JOB_SYNC,
+   CO_JOB_BOOTUP_WAIT,
+   CO_JOB_MASTER_BOOT,
+   CO_JOB_LSS_REQUEST,
+   CO_JOB_LSS_FASTSCAN,
+   CO_JOB_STATS_GET,
+   CO_JOB_STATS_RESET,
+   CO_JOB_CAPTURE_START,
+   CO_JOB_CAPTURE_STOP,
    CO_JOB_EXIT,
 } co_job_type_t;
 
@@ -118,10 +152,16 @@ typedef struct co_sdo_job
    uint64_t value;
    size_t remain;
    size_t total;
+   size_t offset;
+   co_seqlock_t * seqlock;
+   uint32_t sequence;
    struct
    {
       bool toggle : 1;
       bool cached : 1;
+      bool stream : 1;
+      bool sized : 1;
+      bool buffered : 1;
    };
 } co_sdo_job_t;
 
@@ -132,6 +172,9 @@ typedef struct co_emcy_job
    uint16_t info;
    uint8_t * msef;
    uint8_t value;
+   uint8_t node;
+   struct co_emcy_stream * stream;
+   co_emcy_status_t * status;
 } co_emcy_job_t;
 
 /** Parameters for PDO job */
@@ -141,6 +184,29 @@ typedef struct co_pdo_job
    uint8_t subindex;
 } co_pdo_job_t;
 
+/** Parameters for NMT job */
+typedef struct co_nmt_job
+{
+   co_nmt_cmd_t cmd;
+   uint8_t node;
+} co_nmt_job_t;
+
+/** Parameters for LSS master job */
+typedef struct co_lss_job
+{
+   uint8_t msg[8];               /**< Request, and response on success */
+   bool response;                /**< Request has a response */
+   co_lss_address_t * address;   /**< Fastscan result */
+} co_lss_job_t;
+
+/** Parameters for boot-up wait job */
+typedef struct co_bootup_job
+{
+   const uint32_t * expected;
+   uint32_t * booted;
+   uint32_t timeout;
+} co_bootup_job_t;
+
 /** Generic job */
 typedef struct co_job
 {
@@ -150,11 +216,17 @@ typedef struct co_job
       co_sdo_job_t sdo;
       co_emcy_job_t emcy;
       co_pdo_job_t pdo;
+      co_nmt_job_t nmt;
+      co_bootup_job_t bootup;
+      co_lss_job_t lss;
+      co_stats_t * stats;
+      struct co_capture * capture;
    };
    os_tick_t timestamp;
    struct co_client * client;
    void (*callback) (struct co_job * job);
    int result;
+   struct co_job * next; /**< Next job in queue */
 } co_job_t;
 
 /** Client state */
@@ -172,6 +244,9 @@ typedef struct co_heartbeat
    uint8_t state;
    uint16_t time;
    os_tick_t timestamp;
+   os_tick_t deadline;  /**< Time of expiry if scheduled */
+   uint8_t heap_ix;     /**< Position in deadline heap if scheduled */
+   bool scheduled;      /**< Expiry is scheduled */
 } co_heartbeat_t;
 
 /** Node guarding state */
@@ -199,8 +274,42 @@ typedef struct lss
    uint8_t node;
    const co_obj_t * identity;
    uint8_t match;
+   uint8_t fastscan_pos;
+   bool autobaud;
+   uint8_t autobaud_ix;
+   os_tick_t autobaud_timestamp;
 } lss_t;
 
+/** LSS master state */
+typedef struct co_lss_master
+{
+   co_job_t * job;       /**< Current LSS master job */
+   os_tick_t timestamp;  /**< Time of last request */
+   uint32_t id[4];       /**< LSS address found by Fastscan */
+   uint8_t phase;        /**< Fastscan phase */
+   uint8_t sub;          /**< Fastscan LSS address index */
+   uint8_t bit;          /**< Fastscan bit being checked */
+   bool ack;             /**< Slave responded to last request */
+} co_lss_master_t;
+
+/** Number of PDOs per node in network process image */
+#define CO_IMAGE_PDOS 4
+
+/** Number of entries in network process image */
+#define CO_IMAGE_SIZE (127 * CO_IMAGE_PDOS)
+
+/** Alignment of network process image. Entries do not straddle cache
+    lines if this is a multiple of the entry size. */
+#define CO_IMAGE_ALIGN 64
+
+/** Network process image entry, protected by sequence counter */
+typedef struct co_image_slot
+{
+   co_seqlock_t lock;      /**< Sequence counter */
+   uint32_t reserved;      /**< Padding to keep entry 8-byte aligned */
+   co_image_entry_t entry; /**< Latest PDO */
+} co_image_slot_t;
+
 /** SYNC producer state */
 typedef struct co_sync
 {
@@ -211,6 +320,13 @@ typedef struct co_sync
    os_tick_t timestamp;
 } co_sync_t;
 
+/** EMCY consumer state of one node */
+typedef struct co_emcy_node
+{
+   co_emcy_status_t status;          /**< EMCYs received from node */
+   os_tick_t notified;               /**< Timestamp of last callback */
+} co_emcy_node_t;
+
 /** EMCY state */
 typedef struct co_emcy
 {
@@ -223,20 +339,71 @@ typedef struct co_emcy
    bool node_guard_error;            /**< Node guard error */
    bool heartbeat_error;             /**< Heartbeat error */
    bool rpdo_timeout;                /**< RPDO timeout */
-   uint32_t cobids[MAX_EMCY_COBIDS]; /**< EMCY consumer object */
+   uint32_t * cobids;                /**< EMCY consumer object */
+   uint32_t consumed[4];             /**< Nodes in 1028h. 128-bit bitmap */
+   uint8_t remapped;                 /**< Consumed COB IDs not 81h - FFh */
+   bool consume_all;                 /**< Consume EMCY from all nodes */
+   uint32_t rate;                    /**< Min time between callbacks [us] */
+   co_emcy_node_t * nodes;           /**< Consumer state of each node */
+   uint8_t queue[CO_EMCY_QUEUE_SIZE][8]; /**< EMCYs waiting for inhibit */
+   uint8_t queue_head;               /**< Oldest queued EMCY */
+   uint8_t queued;                   /**< Number of queued EMCYs */
+   struct co_emcy_stream * stream;   /**< Subscription, or NULL */
 } co_emcy_t;
 
+/** NMT master boot-up session, configuring one NMT slave */
+typedef struct co_master_session
+{
+   co_job_t job;        /**< SDO job. Must be first */
+   co_net_t * net;      /**< Network handle */
+   uint8_t node;        /**< Node being booted, or 0 if idle */
+   uint8_t step;        /**< Identity check step */
+   uint32_t count;      /**< Remaining concise DCF entries */
+   size_t offset;       /**< Offset of next concise DCF entry */
+   uint8_t value[CO_MASTER_VALUE_SIZE]; /**< SDO transfer buffer */
+} co_master_session_t;
+
+/** NMT master boot-up state */
+typedef struct co_master
+{
+   co_job_t * job;        /**< Pending boot job */
+   uint32_t waiting[4];   /**< Nodes waiting for a session. 128-bit bitmap */
+   uint8_t state[128];    /**< Boot-up state of each node */
+   unsigned int done;     /**< Number of nodes completed */
+   unsigned int total;    /**< Number of NMT slaves */
+   bool error;            /**< A mandatory NMT slave failed */
+   co_master_session_t session[MAX_SDO_CLIENTS]; /**< Sessions */
+} co_master_t;
+
+/** Queue of pending notifications */
+typedef struct co_notify_queue
+{
+   co_notify_mode_t mode;           /**< Notification mode */
+   os_mutex_t * mutex;              /**< Protects queue in poll mode */
+   size_t count;                    /**< Number of queued notifications */
+   bool overrun;                    /**< Notifications were lost */
+   co_notify_t entries[MAX_NOTIFY]; /**< Queued notifications */
+} co_notify_queue_t;
+
 /** CANopen network state */
 struct co_net
 {
    os_channel_t * channel;      /**< CAN channel */
    int bitrate;                 /**< CAN bitrate (bits per second) */
    os_mbox_t * mbox;            /**< Mailbox for job submission */
+   os_loop_t * loop;            /**< Event loop, or NULL */
+   co_reactor_t * reactor;      /**< Reactor servicing network, or NULL */
+   co_net_t * reactor_next;     /**< Next network in reactor */
+   bool threadless;             /**< Serviced by co_poll() */
+   os_tick_t poll_timestamp;    /**< Start of period for co_poll() */
    co_job_type_t job_periodic;  /**< Static message for periodic job */
    co_job_type_t job_rx;        /**< Static message for rx job */
    co_job_t job_sdo_server;     /**< Current SDO server job */
-   co_job_t * job_client;       /**< Pointer to current client job */
+   co_job_t * job_client[MAX_SDO_CLIENTS]; /**< Ongoing client jobs */
+   co_job_t * job_client_pending; /**< Client jobs waiting for a session */
+   co_job_t * job_bootup;       /**< Pointer to current boot-up wait job */
    uint32_t nodes[4];           /**< Discovered nodes. 128-bit bitmap */
+   uint32_t booted[4];          /**< Booted nodes. 128-bit bitmap */
    uint8_t node;                /**< Node ID for this node */
    co_emcy_t emcy;              /**< EMCY state */
    co_sync_t sync;              /**< SYNC state */
@@ -246,21 +413,39 @@ struct co_net
    os_tick_t sync_timestamp;     /**< Timestamp of last SYNC */
    uint32_t sync_window;        /**< Synchronous window length */
    uint32_t restart_ms;         /**< Delay before attempting to recover from bus-off */
-   co_pdo_t pdo_tx[MAX_TX_PDO]; /**< TPDOs */
-   co_pdo_t pdo_rx[MAX_RX_PDO]; /**< RPDOs */
+   co_sizes_t sizes;            /**< Sizes of tables below */
+   co_pdo_t * pdo_tx;           /**< TPDOs */
+   co_pdo_t * pdo_rx;           /**< RPDOs */
+   uint8_t * download;          /**< SDO download buffer */
    co_node_guard_t node_guard;  /**< Node guarding state */
-   co_heartbeat_t heartbeat[MAX_HEARTBEATS]; /**< Heartbeat consumer state */
+   co_heartbeat_t * heartbeat;               /**< Heartbeat consumer state */
+   uint32_t hb_consumed[4];                  /**< Consumed nodes. 128-bit bitmap */
+   uint8_t hb_slot[128];                     /**< Consumer slot of each node */
+   uint8_t * hb_heap;                        /**< Consumer slots by deadline */
+   uint8_t hb_heap_size;                     /**< Number of scheduled slots */
    uint8_t number_of_errors;                 /**< Number of active errors */
-   uint32_t errors[MAX_ERRORS];              /**< List of active errors */
+   uint8_t errors_head;                      /**< Next position in errors */
+   uint32_t * errors;                        /**< Ring of active errors */
    uint8_t error_behavior;                   /**< Error behavior object */
    uint32_t config_date;                     /**< Configuration date */
    uint32_t config_time;                     /**< Configuration time */
    uint8_t config_dirty;                     /**< Configuration has changed */
    lss_t lss;                                /**< LSS state */
+   co_lss_master_t lss_master;               /**< LSS master state */
    const co_obj_t * od;                      /**< Object dictionary */
+   size_t od_size;                           /**< Number of objects */
+   bool od_sorted;                           /**< Dictionary is sorted */
+   uint8_t * od_last;                        /**< Last entry of each object */
    const co_default_t * defaults;            /**< Dictionary default values */
    void * cb_arg;                            /**< Callback opaque argument */
-   uint32_t mbox_overrun; /**< Mailbox overruns (for debugging) */
+   co_notify_queue_t notify;                 /**< Pending notifications */
+   co_master_t * master;                     /**< NMT master boot-up, or NULL */
+   co_image_slot_t * image;                  /**< Network process image */
+   uint32_t mbox_overrun;                    /**< Mailbox overruns */
+   co_stats_t stats;                         /**< Runtime statistics */
+   os_tick_t stats_tick_ms;                  /**< Ticks per millisecond */
+   os_tick_t rx_timestamp;                   /**< Start of current rx batch */
+   struct co_capture * capture;              /**< Frame capture, or NULL */
 
    /** Reset callback */
    void (*cb_reset) (co_net_t * net);
@@ -282,6 +467,16 @@ struct co_net
    /** Notify callback */
    void (*cb_notify) (co_net_t * net, uint16_t index, uint8_t subindex);
 
+   /** Batched notify callback */
+   void (*cb_notify_batch) (
+      co_net_t * net,
+      const co_notify_t * notify,
+      size_t count,
+      bool overrun);
+
+   /** Notifications pending callback */
+   void (*cb_notify_ready) (co_net_t * net);
+
    /** Heartbeat node state change callback */
    void (*cb_heartbeat_state) (
       co_net_t * net,
@@ -289,6 +484,17 @@ struct co_net
       uint8_t old_state,
       uint8_t new_state);
 
+   /** Node boot-up callback */
+   void (*cb_bootup) (co_net_t * net, uint8_t node);
+
+   /** NMT master boot-up progress callback */
+   void (*cb_master_progress) (
+      co_net_t * net,
+      uint8_t node,
+      co_master_state_t state,
+      unsigned int done,
+      unsigned int total);
+
    /** Function to open dictionary store */
    void * (*open) (co_store_t store, co_mode_t mode);
 
@@ -0,0 +1,404 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifdef UNIT_TEST
+#define os_channel_send mock_os_channel_send
+#endif
+
+#include "co_master.h"
+#include "co_sdo.h"
+#include "co_od.h"
+#include "co_bitmap.h"
+#include "co_stats.h"
+#include "co_util.h"
+
+#include <string.h>
+
+/* Size of concise DCF entry header: index, subindex and size */
+#define CO_DCF_HEADER_SIZE 7
+
+/* Number of identity checks. Device type (1000h) is always read to
+   detect that the node is present. */
+#define CO_IDENTITY_STEPS 5
+
+static void co_master_next (co_net_t * net, co_master_session_t * session);
+
+static bool co_master_param (
+   co_net_t * net,
+   uint16_t index,
+   uint8_t subindex,
+   uint32_t * value)
+{
+   const co_obj_t * obj;
+   const co_entry_t * entry;
+   uint64_t v;
+
+   obj = co_obj_find (net, index);
+   if (obj == NULL)
+      return false;
+
+   entry = co_entry_find (net, obj, subindex);
+   if (entry == NULL)
+      return false;
+
+   if (co_od_get_value (net, obj, entry, subindex, &v) != 0)
+      return false;
+
+   *value = (uint32_t)v;
+   return true;
+}
+
+static void co_master_set_state (
+   co_net_t * net,
+   uint8_t node,
+   co_master_state_t state)
+{
+   co_master_t * master = net->master;
+
+   master->state[node] = state;
+
+   if (net->cb_master_progress)
+   {
+      net->cb_master_progress (net, node, state, master->done, master->total);
+   }
+}
+
+static void co_master_complete (
+   co_net_t * net,
+   co_master_session_t * session,
+   co_master_state_t state)
+{
+   co_master_t * master = net->master;
+   uint8_t node         = session->node;
+   uint32_t assignment  = 0;
+
+   LOG_INFO (CO_NMT_LOG, "node %d boot-up complete (%d)\n", node, state);
+
+   if (state != CO_MASTER_NODE_CONFIGURED && state != CO_MASTER_NODE_OPERATIONAL)
+   {
+      co_master_param (net, 0x1F81, node, &assignment);
+      if (assignment & CO_NMT_SLAVE_MANDATORY)
+         master->error = true;
+   }
+
+   master->done++;
+   co_master_set_state (net, node, state);
+
+   session->node = 0;
+   co_master_next (net, session);
+}
+
+static void co_master_sdo (
+   co_master_session_t * session,
+   co_job_type_t type,
+   uint16_t index,
+   uint8_t subindex,
+   size_t size)
+{
+   co_job_t * job = &session->job;
+
+   job->type         = type;
+   job->sdo.node     = session->node;
+   job->sdo.index    = index;
+   job->sdo.subindex = subindex;
+   job->sdo.data     = session->value;
+   job->sdo.remain   = size;
+   job->sdo.cached   = false;
+
+   co_sdo_issue (session->net, job);
+}
+
+static void co_master_start (co_net_t * net, co_master_session_t * session)
+{
+   uint8_t node        = session->node;
+   uint32_t assignment = 0;
+
+   co_master_param (net, 0x1F81, node, &assignment);
+
+   if (assignment & CO_NMT_SLAVE_BOOT)
+   {
+      uint8_t msg[] = {CO_NMT_OPERATIONAL, node};
+
+      co_send (net, CO_FUNCTION_NMT, msg, sizeof (msg));
+      co_master_complete (net, session, CO_MASTER_NODE_OPERATIONAL);
+   }
+   else
+   {
+      co_master_complete (net, session, CO_MASTER_NODE_CONFIGURED);
+   }
+}
+
+static void co_master_configure (co_net_t * net, co_master_session_t * session)
+{
+   const co_obj_t * obj = co_obj_find (net, 0x1F22);
+   const co_entry_t * entry;
+   uint8_t header[CO_DCF_HEADER_SIZE];
+   size_t size;
+   uint32_t length;
+
+   if (session->count == 0)
+   {
+      co_master_start (net, session);
+      return;
+   }
+
+   entry = co_entry_find (net, obj, session->node);
+
+   /* Read next concise DCF entry */
+   size = sizeof (header);
+   if (
+      co_od_get_chunk (net, obj, entry, session->node, session->offset, header, &size) != 0 ||
+      size != sizeof (header))
+      goto error;
+
+   length = co_fetch_uint32 (&header[3]);
+   if (length > sizeof (session->value))
+      goto error;
+
+   size = length;
+   if (
+      co_od_get_chunk (
+         net,
+         obj,
+         entry,
+         session->node,
+         session->offset + sizeof (header),
+         session->value,
+         &size) != 0 ||
+      size != length)
+      goto error;
+
+   session->offset += sizeof (header) + length;
+   session->count--;
+
+   co_master_sdo (
+      session,
+      CO_JOB_SDO_WRITE,
+      co_fetch_uint16 (&header[0]),
+      header[2],
+      length);
+   return;
+
+error:
+   LOG_ERROR (CO_NMT_LOG, "node %d bad concise DCF\n", session->node);
+   co_master_complete (net, session, CO_MASTER_NODE_CONFIG_ERROR);
+}
+
+static void co_master_configure_begin (co_net_t * net, co_master_session_t * session)
+{
+   const co_obj_t * obj = co_obj_find (net, 0x1F22);
+   const co_entry_t * entry;
+   uint8_t count[4];
+   size_t size = sizeof (count);
+
+   co_master_set_state (net, session->node, CO_MASTER_NODE_CONFIGURE);
+
+   session->count  = 0;
+   session->offset = sizeof (count);
+
+   /* Configuration is optional */
+   entry = (obj != NULL) ? co_entry_find (net, obj, session->node) : NULL;
+   if (entry != NULL && co_od_is_stream (obj, entry))
+   {
+      if (co_od_get_chunk (net, obj, entry, session->node, 0, NULL, &size) == 0 && size > 0)
+      {
+         size = sizeof (count);
+         if (
+            co_od_get_chunk (net, obj, entry, session->node, 0, count, &size) != 0 ||
+            size != sizeof (count))
+         {
+            co_master_complete (net, session, CO_MASTER_NODE_CONFIG_ERROR);
+            return;
+         }
+
+         session->count = co_fetch_uint32 (count);
+      }
+   }
+
+   co_master_configure (net, session);
+}
+
+static void co_master_identify (co_net_t * net, co_master_session_t * session)
+{
+   uint32_t expected = 0;
+
+   /* Skip identity checks with no expected value */
+   while (session->step < CO_IDENTITY_STEPS)
+   {
+      co_master_param (net, 0x1F84 + session->step, session->node, &expected);
+      if (session->step == 0 || expected != 0)
+         break;
+      session->step++;
+   }
+
+   if (session->step == CO_IDENTITY_STEPS)
+   {
+      co_master_configure_begin (net, session);
+      return;
+   }
+
+   if (session->step == 0)
+      co_master_sdo (session, CO_JOB_SDO_READ, 0x1000, 0, sizeof (uint32_t));
+   else
+      co_master_sdo (session, CO_JOB_SDO_READ, 0x1018, session->step, sizeof (uint32_t));
+}
+
+static void co_master_sdo_done (co_job_t * job)
+{
+   co_master_session_t * session = (co_master_session_t *)job;
+   co_net_t * net                = session->net;
+   uint32_t expected             = 0;
+
+   switch (net->master->state[session->node])
+   {
+   case CO_MASTER_NODE_IDENTIFY:
+      if (job->result != sizeof (uint32_t))
+      {
+         co_master_complete (
+            net,
+            session,
+            (session->step == 0) ? CO_MASTER_NODE_MISSING
+                                 : CO_MASTER_NODE_WRONG_IDENTITY);
+         return;
+      }
+
+      co_master_param (net, 0x1F84 + session->step, session->node, &expected);
+      if (expected != 0 && expected != co_fetch_uint32 (session->value))
+      {
+         LOG_ERROR (CO_NMT_LOG, "node %d wrong identity\n", session->node);
+         co_master_complete (net, session, CO_MASTER_NODE_WRONG_IDENTITY);
+         return;
+      }
+
+      session->step++;
+      co_master_identify (net, session);
+      break;
+
+   case CO_MASTER_NODE_CONFIGURE:
+      if (job->result < 0)
+      {
+         co_master_complete (net, session, CO_MASTER_NODE_CONFIG_ERROR);
+         return;
+      }
+
+      co_master_configure (net, session);
+      break;
+
+   default:
+      CC_ASSERT (0);
+      break;
+   }
+}
+
+static void co_master_finish (co_net_t * net)
+{
+   co_master_t * master = net->master;
+   co_job_t * job       = master->job;
+
+   master->job = NULL;
+
+   job->result = master->error ? -1 : 0;
+   if (job->callback)
+      job->callback (job);
+}
+
+static void co_master_next (co_net_t * net, co_master_session_t * session)
+{
+   co_master_t * master = net->master;
+   uint8_t node;
+
+   node = co_bitmap_next (master->waiting, 1);
+   if (node == 0)
+   {
+      /* Boot-up is finished when the last node has completed */
+      if (master->job != NULL && master->done == master->total)
+         co_master_finish (net);
+      return;
+   }
+
+   co_bitmap_clear (master->waiting, node);
+
+   session->node = node;
+   session->step = 0;
+   co_master_set_state (net, node, CO_MASTER_NODE_IDENTIFY);
+   co_master_identify (net, session);
+}
+
+void co_master_job (co_net_t * net, co_job_t * job)
+{
+   co_master_t * master = net->master;
+   unsigned int ix;
+   uint8_t node;
+
+   /* Not an NMT master, or boot-up already in progress */
+   if (master == NULL || master->job != NULL)
+   {
+      job->result = -1;
+      if (job->callback)
+         job->callback (job);
+      return;
+   }
+
+   master->job   = job;
+   master->done  = 0;
+   master->total = 0;
+   master->error = false;
+   memset (master->waiting, 0, sizeof (master->waiting));
+   memset (master->state, CO_MASTER_NODE_UNUSED, sizeof (master->state));
+
+   /* Find NMT slaves */
+   for (node = 1; node <= 127; node++)
+   {
+      uint32_t assignment = 0;
+
+      if (node == net->node)
+         continue;
+
+      co_master_param (net, 0x1F81, node, &assignment);
+      if (assignment & CO_NMT_SLAVE)
+      {
+         co_bitmap_set (master->waiting, node);
+         master->total++;
+      }
+   }
+
+   for (node = 1; node <= 127; node++)
+   {
+      if (co_bitmap_get (master->waiting, node))
+         co_master_set_state (net, node, CO_MASTER_NODE_WAITING);
+   }
+
+   if (master->total == 0)
+   {
+      co_master_finish (net);
+      return;
+   }
+
+   /* Boot NMT slaves in parallel, one session per node */
+   for (ix = 0; ix < NELEMENTS (master->session); ix++)
+   {
+      co_master_session_t * session = &master->session[ix];
+
+      session->net          = net;
+      session->node         = 0;
+      session->job.callback = co_master_sdo_done;
+      session->job.client   = NULL;
+   }
+
+   for (ix = 0; ix < NELEMENTS (master->session) && master->job != NULL; ix++)
+   {
+      co_master_next (net, &master->session[ix]);
+   }
+}
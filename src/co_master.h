@@ -0,0 +1,42 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifndef CO_MASTER_H
+#define CO_MASTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "co_api.h"
+#include "co_main.h"
+
+/**
+ * Start NMT master boot-up job
+ *
+ * This function starts booting the NMT slaves listed in object
+ * 1F81h. The job completes when all NMT slaves have been booted or
+ * have failed.
+ *
+ * @param net           network handle
+ * @param job           master boot job
+ */
+void co_master_job (co_net_t * net, co_job_t * job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_MASTER_H */
@@ -26,6 +26,10 @@
 #include "co_od.h"
 #include "co_pdo.h"
 #include "co_lss.h"
+#include "co_bootup.h"
+#include "co_stats.h"
+#include "co_capture.h"
+#include "co_probe.h"
 
 typedef struct co_fsm
 {
@@ -60,8 +64,22 @@ static co_fsm_event_t co_nmt_reset_comm (co_net_t * net, co_fsm_event_t event)
    /* Reset communication */
    co_od_reset (net, CO_STORE_COMM, 0x1000, 0x1FFF);
    os_channel_bus_off (net->channel);
-   os_channel_set_bitrate (net->channel, net->bitrate);
    os_channel_set_filter (net->channel, NULL, 0);
+
+   if (net->bitrate == CO_BITRATE_AUTO)
+   {
+      /* Remain in INIT_COMM state until bitrate is detected */
+      if (co_lss_autobaud_start (net) == 0)
+         return EVENT_NONE;
+
+      /* Rather than staying silent, continue at the current bitrate */
+      LOG_ERROR (CO_NMT_LOG, "bitrate detection failed\n");
+   }
+   else if (os_channel_set_bitrate (net->channel, net->bitrate) < 0)
+   {
+      /* Keep running at the current bitrate if it can not be changed */
+      LOG_WARNING (CO_NMT_LOG, "failed to set bitrate %d\n", net->bitrate);
+   }
    os_channel_bus_on (net->channel);
 
    if (net->lss.node != 0xFF)
@@ -78,11 +96,7 @@ static co_fsm_event_t co_nmt_reset_comm (co_net_t * net, co_fsm_event_t event)
 static co_fsm_event_t co_nmt_bootup (co_net_t * net, co_fsm_event_t event)
 {
    uint8_t msg[] = {0};
-   os_channel_send (
-      net->channel,
-      CO_FUNCTION_NMT_ERR + net->node,
-      msg,
-      sizeof (msg));
+   co_send (net, CO_FUNCTION_NMT_ERR + net->node, msg, sizeof (msg));
    return EVENT_NONE;
 }
 
@@ -151,6 +165,9 @@ void co_nmt_event (co_net_t * net, co_fsm_event_t event)
       /* Call user callback if state has changed */
       if (previous != net->state)
       {
+         co_capture_nmt (net, previous);
+         CO_PROBE3 (nmt_state, net->node, previous, net->state);
+
          if (net->cb_nmt)
          {
             net->cb_nmt (net, net->state);
@@ -239,3 +256,26 @@ int co_nmt_rx (co_net_t * net, uint32_t id, uint8_t * msg, size_t dlc)
 
    return 0;
 }
+
+void co_nmt_job (co_net_t * net, co_job_t * job)
+{
+   uint8_t data[] = {job->nmt.cmd, job->nmt.node};
+
+   /* Resetting nodes are expected to send a new boot-up message */
+   if (job->nmt.cmd == CO_NMT_RESET_NODE ||
+       job->nmt.cmd == CO_NMT_RESET_COMMUNICATION)
+   {
+      co_bootup_reset (net, job->nmt.node);
+   }
+
+   if (job->nmt.node == net->node || job->nmt.node == 0)
+   {
+      co_nmt_rx (net, 0, data, sizeof (data));
+   }
+
+   co_send (net, CO_FUNCTION_NMT, data, sizeof (data));
+
+   job->result = 0;
+   if (job->callback)
+      job->callback (job);
+}
@@ -73,6 +73,18 @@ void co_nmt_event (co_net_t * net, co_fsm_event_t event);
  */
 int co_nmt_rx (co_net_t * net, uint32_t id, uint8_t * msg, size_t dlc);
 
+/**
+ * Send NMT command
+ *
+ * This function sends the NMT command of a client job. The command
+ * is also applied to this node if it is a recipient. The job is
+ * completed immediately.
+ *
+ * @param net           network handle
+ * @param job           NMT job
+ */
+void co_nmt_job (co_net_t * net, co_job_t * job);
+
 /**
  * Initialise NMT state-machine
  *
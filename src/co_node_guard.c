@@ -23,6 +23,7 @@
 #include "co_node_guard.h"
 #include "co_sdo.h"
 #include "co_emcy.h"
+#include "co_stats.h"
 #include "co_util.h"
 
 uint32_t co_od100C_fn (
@@ -107,7 +108,7 @@ int co_node_guard_rx (co_net_t * net, uint32_t id, void * msg, size_t dlc)
       }
 
       co_put_uint8 (_msg, net->node_guard.toggle | state);
-      os_channel_send (net->channel, 0x700 + net->node, _msg, sizeof (_msg));
+      co_send (net, 0x700 + net->node, _msg, sizeof (_msg));
       net->node_guard.toggle = ~net->node_guard.toggle & 0x80;
    }
 
@@ -0,0 +1,135 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_notify.h"
+
+#include <string.h>
+
+int co_notify_init (co_net_t * net, co_notify_mode_t mode)
+{
+   co_notify_queue_t * queue = &net->notify;
+
+   queue->mode    = mode;
+   queue->count   = 0;
+   queue->overrun = false;
+
+   /* Queue is shared with application in poll mode */
+   if (mode == CO_NOTIFY_POLL)
+   {
+      queue->mutex = os_mutex_create();
+      if (queue->mutex == NULL)
+         return -1;
+   }
+
+   return 0;
+}
+
+void co_notify_exit (co_net_t * net)
+{
+   co_notify_queue_t * queue = &net->notify;
+
+   if (queue->mutex != NULL)
+   {
+      os_mutex_destroy (queue->mutex);
+      queue->mutex = NULL;
+   }
+}
+
+void co_notify_post (co_net_t * net, uint16_t index, uint8_t subindex)
+{
+   co_notify_queue_t * queue = &net->notify;
+   bool ready                = false;
+   size_t ix;
+
+   if (queue->mutex != NULL)
+      os_mutex_lock (queue->mutex);
+
+   /* Subindex is reported once per batch */
+   for (ix = 0; ix < queue->count; ix++)
+   {
+      if (queue->entries[ix].index == index && queue->entries[ix].subindex == subindex)
+         goto done;
+   }
+
+   if (queue->count == MAX_NOTIFY)
+   {
+      if (queue->mode != CO_NOTIFY_FRAME)
+      {
+         queue->overrun = true;
+         goto done;
+      }
+
+      /* Deliver full batch early rather than lose notifications */
+      co_notify_flush (net, CO_NOTIFY_FRAME);
+   }
+
+   ready = (queue->count == 0 && !queue->overrun);
+
+   queue->entries[queue->count].index    = index;
+   queue->entries[queue->count].subindex = subindex;
+   queue->count++;
+
+done:
+   if (queue->mutex != NULL)
+      os_mutex_unlock (queue->mutex);
+
+   if (ready && queue->mode == CO_NOTIFY_POLL && net->cb_notify_ready)
+      net->cb_notify_ready (net);
+}
+
+void co_notify_flush (co_net_t * net, co_notify_mode_t mode)
+{
+   co_notify_queue_t * queue = &net->notify;
+
+   if (queue->mode != mode || (queue->count == 0 && !queue->overrun))
+      return;
+
+   if (net->cb_notify_batch)
+      net->cb_notify_batch (net, queue->entries, queue->count, queue->overrun);
+
+   queue->count   = 0;
+   queue->overrun = false;
+}
+
+size_t co_notify_fetch (
+   co_net_t * net,
+   co_notify_t * notify,
+   size_t max,
+   bool * overrun)
+{
+   co_notify_queue_t * queue = &net->notify;
+   size_t count;
+
+   if (queue->mutex != NULL)
+      os_mutex_lock (queue->mutex);
+
+   count = MIN (queue->count, max);
+   memcpy (notify, queue->entries, count * sizeof (*notify));
+
+   /* Keep remaining notifications in order */
+   queue->count -= count;
+   memmove (
+      queue->entries,
+      &queue->entries[count],
+      queue->count * sizeof (*notify));
+
+   *overrun       = queue->overrun;
+   queue->overrun = false;
+
+   if (queue->mutex != NULL)
+      os_mutex_unlock (queue->mutex);
+
+   return count;
+}
@@ -0,0 +1,77 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Batching of notifications for OD_NOTIFY entries
+ */
+
+#ifndef CO_NOTIFY_H
+#define CO_NOTIFY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "co_api.h"
+#include "co_main.h"
+
+/**
+ * Initialise notification queue
+ *
+ * @param net           network handle
+ * @param mode          notification mode
+ *
+ * @return 0 on success, -1 on failure
+ */
+int co_notify_init (co_net_t * net, co_notify_mode_t mode);
+
+/**
+ * Release notification queue
+ *
+ * @param net           network handle
+ */
+void co_notify_exit (co_net_t * net);
+
+/**
+ * Queue notification
+ *
+ * This function queues a notification of a written subindex, unless
+ * it is already queued. If the queue is full, the notification is
+ * lost and the overrun flag is set, except in frame mode where the
+ * queue is delivered first.
+ *
+ * @param net           network handle
+ * @param index         index of written object
+ * @param subindex      written subindex
+ */
+void co_notify_post (co_net_t * net, uint16_t index, uint8_t subindex);
+
+/**
+ * Deliver queued notifications
+ *
+ * This function delivers queued notifications to the batched notify
+ * callback, if the notification mode matches \a mode.
+ *
+ * @param net           network handle
+ * @param mode          notification mode of delivery point
+ */
+void co_notify_flush (co_net_t * net, co_notify_mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_NOTIFY_H */
@@ -137,3 +137,9 @@ const co_entry_t OD1A00[] = {
    {0x00, OD_RW, DTYPE_UNSIGNED8, 8, MAX_PDO_ENTRIES, NULL},
    {0x01, OD_RW | OD_ARRAY, DTYPE_UNSIGNED32, 32, 0, NULL},
 };
+
+/* Entry descriptor for Runtime statistics object (5F00h) */
+const co_entry_t OD5F00[] = {
+   {0x00, OD_RO, DTYPE_UNSIGNED8, 8, 12, NULL},
+   {0x01, OD_RO | OD_ARRAY, DTYPE_UNSIGNED32, 32, 0, NULL},
+};
@@ -17,6 +17,7 @@
 #endif
 
 #include "co_od.h"
+#include "co_notify.h"
 #include "co_sdo.h"
 #include "co_util.h"
 
@@ -26,6 +27,8 @@
 #define OD_RESTORE 0x64616F6C /* Signature for restore ("load") */
 #define OD_STORE   0x65766173 /* Signature for store ("save") */
 
+#define CO_SEQLOCK_BACKOFF 10 /* Time between write attempts [us] */
+
 static int co_subindex_equals (
    co_net_t * net,
    const co_obj_t * obj,
@@ -36,6 +39,78 @@ static int co_subindex_equals (
    return entry->subindex == subindex;
 }
 
+bool co_seqlock_write_try_begin (co_seqlock_t * lock)
+{
+   uint32_t sequence = co_atomic_get_uint32 (&lock->sequence);
+
+   /* Take the odd value only if no other write is in progress, so
+      that concurrent writers can not lose an increment */
+   if ((sequence & 1) || !co_atomic_cas_uint32 (&lock->sequence, sequence, sequence + 1))
+      return false;
+
+   CO_MEMORY_BARRIER();
+   return true;
+}
+
+void co_seqlock_write_begin (co_seqlock_t * lock)
+{
+   while (!co_seqlock_write_try_begin (lock))
+   {
+      os_usleep (CO_SEQLOCK_BACKOFF);
+   }
+}
+
+void co_seqlock_write_end (co_seqlock_t * lock)
+{
+   uint32_t sequence = co_atomic_get_uint32 (&lock->sequence);
+
+   CO_MEMORY_BARRIER();
+   co_atomic_set_uint32 (&lock->sequence, sequence + 1);
+}
+
+uint32_t co_seqlock_read_begin (const co_seqlock_t * lock)
+{
+   uint32_t sequence = co_atomic_get_uint32 (&lock->sequence);
+
+   CO_MEMORY_BARRIER();
+   return sequence;
+}
+
+bool co_seqlock_read_retry (const co_seqlock_t * lock, uint32_t sequence)
+{
+   CO_MEMORY_BARRIER();
+
+   /* Retry if a write was in progress or has been made since read
+      began */
+   return (sequence & 1) || co_atomic_get_uint32 (&lock->sequence) != sequence;
+}
+
+/* Begin write from the CANopen thread */
+static co_seqlock_t * co_od_write_begin (co_net_t * net, const co_obj_t * obj)
+{
+   co_seqlock_t * lock = co_od_seqlock (obj);
+
+   if (lock != NULL)
+      co_seqlock_write_begin (lock);
+
+   return lock;
+}
+
+static void co_od_write_end (co_seqlock_t * lock)
+{
+   if (lock != NULL)
+      co_seqlock_write_end (lock);
+}
+
+static bool co_od_is_storable (const co_obj_t * obj, const co_entry_t * entry)
+{
+   if (!(entry->flags & OD_WRITE) || (entry->flags & OD_TRANSIENT))
+      return false;
+
+   /* Streamed entries have no storage in the dictionary */
+   return !co_od_is_stream (obj, entry);
+}
+
 void co_od_notify (
    co_net_t * net,
    const co_obj_t * obj,
@@ -44,7 +119,9 @@ void co_od_notify (
 {
    if (entry->flags & OD_NOTIFY)
    {
-      if (net->cb_notify)
+      if (net->notify.mode != CO_NOTIFY_IMMEDIATE)
+         co_notify_post (net, obj->index, subindex);
+      else if (net->cb_notify)
          net->cb_notify (net, obj->index, subindex);
    }
 }
@@ -77,14 +154,124 @@ const co_entry_t * co_entry_find (
       }
    }
 
+   /* Binary search in entries sorted by co_od_init() */
+   if (net->od_last != NULL)
+   {
+      uintptr_t pos = ((uintptr_t)obj - (uintptr_t)net->od) / sizeof (*obj);
+
+      if (
+         (uintptr_t)obj >= (uintptr_t)net->od && pos < net->od_size &&
+         pos < net->sizes.objects && net->od_last[pos] > 0)
+      {
+         const co_entry_t * entries = obj->entries;
+         size_t low                 = 1;
+         size_t high                = net->od_last[pos] + 1;
+
+         while (low < high)
+         {
+            size_t mid = low + (high - low) / 2;
+
+            if (entries[mid].subindex == subindex)
+               return &entries[mid];
+
+            if (entries[mid].subindex < subindex)
+               low = mid + 1;
+            else
+               high = mid;
+         }
+
+         return NULL;
+      }
+   }
+
    /* Otherwise search descriptor for matching subindex */
    return co_obj_traverse (net, obj, co_subindex_equals, subindex, obj->max_subindex);
 }
 
+/* Position of the last entry of a RECORD or ARRAY object, where a
+   linear search of the entries stops. Returns 0 if the entries are
+   not sorted by subindex, or if there is only one to search. */
+static uint8_t co_od_last (const co_obj_t * obj)
+{
+   const co_entry_t * entry = obj->entries;
+   unsigned int pos         = 0;
+
+   if (obj->objtype == OTYPE_VAR || obj->max_subindex == 0)
+      return 0;
+
+   if (entry[1].flags & OD_ARRAY)
+      return 0;
+
+   while (entry[pos].subindex < obj->max_subindex)
+   {
+      pos++;
+      if (entry[pos].subindex <= entry[pos - 1].subindex)
+      {
+         LOG_WARNING (CO_OD_LOG, "OD %x subindexes not sorted\n", obj->index);
+         return 0;
+      }
+   }
+
+   return (uint8_t)pos;
+}
+
+void co_od_init (co_net_t * net, size_t od_size)
+{
+   const co_obj_t * obj;
+
+   net->od_size   = 0;
+   net->od_sorted = true;
+
+   for (obj = net->od; obj->index != 0; obj++)
+   {
+      if (obj != net->od && obj->index <= obj[-1].index)
+         net->od_sorted = false;
+
+      if (net->od_last != NULL && net->od_size < net->sizes.objects)
+         net->od_last[net->od_size] = co_od_last (obj);
+
+      net->od_size++;
+   }
+
+   if (od_size > 0 && od_size != net->od_size)
+   {
+      LOG_WARNING (
+         CO_OD_LOG,
+         "OD size %u does not match %u objects\n",
+         (unsigned)od_size,
+         (unsigned)net->od_size);
+   }
+
+   if (!net->od_sorted)
+      LOG_INFO (CO_OD_LOG, "OD not sorted, using linear search\n");
+}
+
 const co_obj_t * co_obj_find (co_net_t * net, uint16_t index)
 {
    const co_obj_t * obj = net->od;
 
+   if (net->od_sorted)
+   {
+      size_t low  = 0;
+      size_t high = net->od_size;
+
+      /* Binary search in sorted table */
+      while (low < high)
+      {
+         size_t mid = low + (high - low) / 2;
+
+         if (obj[mid].index == index)
+            return &obj[mid];
+
+         if (obj[mid].index < index)
+            low = mid + 1;
+         else
+            high = mid;
+      }
+
+      return NULL;
+   }
+
    /* Walk table until it ends or index is found */
    while (obj->index != 0 && obj->index != index)
    {
@@ -106,7 +293,7 @@ uint32_t co_od_get_ptr (
    uint8_t subindex,
    uint8_t ** ptr)
 {
-   if (obj->access)
+   if (obj->access || (obj->ops && obj->ops->access) || co_od_is_stream (obj, entry))
    {
       /* Access function has no storage */
       return CO_SDO_ABORT_GENERAL;
@@ -137,7 +324,15 @@ uint32_t co_od_get_value (
    uint32_t abort;
    uint8_t * data;
 
-   if (obj->access)
+   if (obj->ops && obj->ops->access)
+   {
+      /* Call 64-bit object access function. Subindex 0 is handled
+         as for the 32-bit access function. */
+      abort = obj->ops->access (net, OD_EVENT_READ, obj, entry, subindex, value);
+      if (!(subindex == 0 && abort == CO_SDO_ABORT_BAD_SUBINDEX))
+         return abort;
+   }
+   else if (obj->access)
    {
       uint32_t v;
 
@@ -211,10 +406,21 @@ uint32_t co_od_set_value (
    uint8_t subindex,
    uint64_t value)
 {
+   co_seqlock_t * lock;
+   uint32_t abort = 0;
    uint8_t * data;
 
    LOG_DEBUG (CO_OD_LOG, "set %x:%x = %" PRIx64 "\n", obj->index, subindex, value);
 
+   if (obj->ops && obj->ops->access)
+   {
+      uint32_t result;
+
+      result = obj->ops->access (net, OD_EVENT_WRITE, obj, entry, subindex, &value);
+      co_od_notify (net, obj, entry, subindex);
+      return result;
+   }
+
    if (obj->access)
    {
       uint32_t result;
@@ -233,6 +439,8 @@ uint32_t co_od_set_value (
    }
 
    /* Set value in dictionary */
+   lock = co_od_write_begin (net, obj);
+
    switch (entry->datatype)
    {
    case DTYPE_BOOLEAN:
@@ -259,13 +467,78 @@ uint32_t co_od_set_value (
       break;
 
    default:
-      return CO_SDO_ABORT_GENERAL;
+      abort = CO_SDO_ABORT_GENERAL;
+      break;
    }
 
+   co_od_write_end (lock);
+
+   if (abort)
+      return abort;
+
    co_od_notify (net, obj, entry, subindex);
    return 0;
 }
 
+bool co_od_is_stream (const co_obj_t * obj, const co_entry_t * entry)
+{
+   if (obj->ops == NULL || obj->ops->stream == NULL)
+      return false;
+
+   return entry->datatype == DTYPE_DOMAIN ||
+          CO_BYTELENGTH (entry->bitlength) > sizeof (uint64_t);
+}
+
+uint32_t co_od_get_chunk (
+   co_net_t * net,
+   const co_obj_t * obj,
+   const co_entry_t * entry,
+   uint8_t subindex,
+   size_t offset,
+   void * data,
+   size_t * size)
+{
+   CC_ASSERT (co_od_is_stream (obj, entry));
+   return obj->ops->stream (net, OD_EVENT_READ, obj, entry, subindex, offset, data, size);
+}
+
+uint32_t co_od_set_chunk (
+   co_net_t * net,
+   const co_obj_t * obj,
+   const co_entry_t * entry,
+   uint8_t subindex,
+   size_t offset,
+   const void * data,
+   size_t size)
+{
+   uint32_t result;
+
+   CC_ASSERT (co_od_is_stream (obj, entry));
+
+   LOG_DEBUG (
+      CO_OD_LOG,
+      "set %x:%x chunk %u + %u\n",
+      obj->index,
+      subindex,
+      (unsigned)offset,
+      (unsigned)size);
+
+   result = obj->ops->stream (
+      net,
+      OD_EVENT_WRITE,
+      obj,
+      entry,
+      subindex,
+      offset,
+      (void *)data,
+      &size);
+
+   if (data == NULL)
+      co_od_notify (net, obj, entry, subindex);
+
+   return result;
+}
+
 void co_od_set_defaults (co_net_t * net, uint16_t min, uint16_t max)
 {
    const co_default_t * item = net->defaults;
@@ -321,13 +594,21 @@ void co_od_zero (co_net_t * net, uint16_t min, uint16_t max)
       if (obj->index < min || obj->index > max)
          continue;
 
-      if (obj->access)
+      if (obj->ops && (obj->ops->access || obj->ops->stream))
+      {
+         if (obj->ops->access)
+            obj->ops->access (net, OD_EVENT_RESTORE, obj, NULL, 0, NULL);
+         if (obj->ops->stream)
+            obj->ops->stream (net, OD_EVENT_RESTORE, obj, NULL, 0, 0, NULL, NULL);
+      }
+      else if (obj->access)
       {
          obj->access (net, OD_EVENT_RESTORE, obj, NULL, 0, NULL);
       }
       else
       {
          const co_entry_t * entry = obj->entries;
+         co_seqlock_t * lock      = co_od_write_begin (net, obj);
          uint8_t subindex;
 
          do
@@ -346,6 +627,8 @@ void co_od_zero (co_net_t * net, uint16_t min, uint16_t max)
             subindex = entry->subindex;
             entry++;
          } while (subindex < obj->max_subindex);
+
+         co_od_write_end (lock);
       }
    }
 }
@@ -395,7 +678,7 @@ uint32_t co_od_load (co_net_t * net, co_store_t store)
          goto skip;
 
       entry = co_entry_find (net, obj, subindex);
-      if (entry == NULL || !(entry->flags & OD_WRITE) || (entry->flags & OD_TRANSIENT))
+      if (entry == NULL || !co_od_is_storable (obj, entry))
          goto skip; /* Not storable in this OD */
 
       if (size <= sizeof (value))
@@ -407,12 +690,19 @@ uint32_t co_od_load (co_net_t * net, co_store_t store)
       }
       else if (size == CO_BYTELENGTH (entry->bitlength))
       {
+         co_seqlock_t * lock;
+         int result;
+
          /* Get pointer to storage */
          abort = co_od_get_ptr (net, obj, entry, subindex, &ptr);
          if (abort)
             goto error;
 
-         if (net->read (arg, ptr, size) < 0)
+         lock   = co_od_write_begin (net, obj);
+         result = net->read (arg, ptr, size);
+         co_od_write_end (lock);
+
+         if (result < 0)
             goto error;
       }
       else
@@ -451,19 +741,12 @@ void co_od_reset (co_net_t * net, co_store_t store, uint16_t min, uint16_t max)
    co_od_load (net, store);
 }
 
-uint32_t co_od_store (co_net_t * net, co_store_t store, uint16_t min, uint16_t max)
+static int co_od_store_entries (co_net_t * net, void * arg, uint16_t min, uint16_t max)
 {
    const co_obj_t * obj;
    uint8_t subindex;
-   void * arg;
    size_t entries = 0;
-
-   if (net->open == NULL || net->write == NULL || net->close == NULL)
-      return CO_SDO_ABORT_HW_ERROR;
-
-   arg = net->open (store, CO_MODE_WRITE);
-   if (arg == NULL)
-      return CO_SDO_ABORT_HW_ERROR;
+   bool modified  = false;
 
    /* Compute number of entries */
    for (obj = net->od; obj->index != 0; obj++)
@@ -475,14 +758,14 @@ uint32_t co_od_store (co_net_t * net, co_store_t store, uint16_t min, uint16_t m
       {
          const co_entry_t * entry;
          entry = co_entry_find (net, obj, subindex);
-         if (entry != NULL && (entry->flags & OD_WRITE) && !(entry->flags & OD_TRANSIENT))
+         if (entry != NULL && co_od_is_storable (obj, entry))
             entries++;
       }
    }
 
    /* Store number of entries */
    if (net->write (arg, &entries, sizeof (entries)) < 0)
-      goto error;
+      return -1;
 
    /* Store entries */
    for (obj = net->od; obj->index != 0; obj++)
@@ -495,7 +778,7 @@ uint32_t co_od_store (co_net_t * net, co_store_t store, uint16_t min, uint16_t m
          const co_entry_t * entry;
 
          entry = co_entry_find (net, obj, subindex);
-         if (entry != NULL && (entry->flags & OD_WRITE) && !(entry->flags & OD_TRANSIENT))
+         if (entry != NULL && co_od_is_storable (obj, entry))
          {
             size_t size = CO_BYTELENGTH (entry->bitlength);
             uint64_t value;
@@ -504,44 +787,84 @@ uint32_t co_od_store (co_net_t * net, co_store_t store, uint16_t min, uint16_t m
 
             /* Write index */
             if (net->write (arg, &obj->index, sizeof (obj->index)) < 0)
-               goto error;
+               return -1;
 
             /* Write subindex */
             if (net->write (arg, &subindex, sizeof (subindex)) < 0)
-               goto error;
+               return -1;
 
             /* Write size of entry */
             if (net->write (arg, &size, sizeof (size)) < 0)
-               goto error;
+               return -1;
 
             if (size > sizeof (value))
             {
+               co_seqlock_t * lock = co_od_seqlock (obj);
+               uint32_t sequence   = 0;
+
                /* Get pointer to storage */
                abort = co_od_get_ptr (net, obj, entry, subindex, &ptr);
                if (abort)
-                  goto error;
+                  return -1;
+
+               if (lock != NULL)
+                  sequence = co_seqlock_read_begin (lock);
 
                if (net->write (arg, ptr, size) < 0)
-                  goto error;
+                  return -1;
+
+               /* Check that value was not modified while written */
+               if (lock != NULL && co_seqlock_read_retry (lock, sequence))
+                  modified = true;
             }
             else
             {
                /* Get value */
                abort = co_od_get_value (net, obj, entry, subindex, &value);
                if (abort)
-                  goto error;
+                  return -1;
 
                if (net->write (arg, &value, size) < 0)
-                  goto error;
+                  return -1;
             }
          }
       }
    }
 
-   /* Finalize write */
-   if (net->close (arg) < 0)
+   return modified ? 1 : 0;
+}
+
+uint32_t co_od_store (co_net_t * net, co_store_t store, uint16_t min, uint16_t max)
+{
+   unsigned int retries = CO_SEQLOCK_RETRIES;
+   void * arg;
+   int result;
+
+   if (net->open == NULL || net->write == NULL || net->close == NULL)
       return CO_SDO_ABORT_HW_ERROR;
 
+   /* Store is restarted if an object was modified while stored */
+   do
+   {
+      arg = net->open (store, CO_MODE_WRITE);
+      if (arg == NULL)
+         return CO_SDO_ABORT_HW_ERROR;
+
+      result = co_od_store_entries (net, arg, min, max);
+      if (result < 0)
+         goto error;
+
+      /* Finalize write */
+      if (net->close (arg) < 0)
+         return CO_SDO_ABORT_HW_ERROR;
+   } while (result > 0 && retries-- > 0);
+
+   if (result > 0)
+   {
+      LOG_ERROR (CO_OD_LOG, "OD modified during store\n");
+      return CO_SDO_ABORT_WRITE;
+   }
+
    return 0;
 
 error:
@@ -180,6 +180,24 @@ void co_od_reset (co_net_t * net, co_store_t store, uint16_t min, uint16_t max);
  */
 uint32_t co_od_store (co_net_t * net, co_store_t store, uint16_t min, uint16_t max);
 
+/**
+ * Initialise object dictionary lookup
+ *
+ * A sorted dictionary is searched using binary search, other
+ * dictionaries are searched linearly. This function counts the
+ * objects in the dictionary and checks if they are sorted by
+ * index. The size given by a generated dictionary is checked against
+ * the count, a mismatch is logged and the count is used.
+ *
+ * The position of the last entry of each RECORD and ARRAY object is
+ * kept in net->od_last, if allocated, so that co_entry_find() can use
+ * binary search on entries sorted by subindex.
+ *
+ * @param net           network handle
+ * @param od_size       number of objects in dictionary, or 0
+ */
+void co_od_init (co_net_t * net, size_t od_size);
+
 /**
  * Find object in dictionary
  *
@@ -195,7 +213,9 @@ const co_obj_t * co_obj_find (co_net_t * net, uint16_t index);
 /**
  * Find entry in object
  *
- * This function finds the entry descriptor with the given subindex.
+ * This function finds the entry descriptor with the given
+ * subindex. Entries of objects in the dictionary are found using
+ * binary search once co_od_init() has checked that they are sorted.
  *
  * @param net           network handle
  * @param obj           object descriptor
@@ -271,6 +291,85 @@ uint32_t co_od_set_value (
    uint8_t subindex,
    uint64_t value);
 
+/**
+ * Get sequence counter of object
+ *
+ * @param obj           object descriptor
+ *
+ * @return sequence counter, or NULL if object has none
+ */
+static inline co_seqlock_t * co_od_seqlock (const co_obj_t * obj)
+{
+   return (obj->ops != NULL) ? obj->ops->seqlock : NULL;
+}
+
+/**
+ * Check if subindex is streamed
+ *
+ * An entry is streamed if the object has a chunked access function
+ * and the entry is a DOMAIN or does not fit in 64 bits.
+ *
+ * @param obj           object descriptor
+ * @param entry         entry descriptor
+ *
+ * @return true if entry is accessed by the chunked access function
+ */
+bool co_od_is_stream (const co_obj_t * obj, const co_entry_t * entry);
+
+/**
+ * Read chunk of streamed subindex
+ *
+ * This function reads at most \a size bytes starting at \a offset
+ * by calling the chunked access function of the object. On success,
+ * \a size is set to the number of bytes read. If \a data is NULL,
+ * \a size is set to the total size of the subindex.
+ *
+ * @param net           network handle
+ * @param obj           object descriptor
+ * @param entry         entry descriptor
+ * @param subindex      subindex
+ * @param offset        offset of chunk
+ * @param data          chunk buffer, or NULL
+ * @param size          size of chunk
+ *
+ * @return 0 or sdo abort code
+ */
+uint32_t co_od_get_chunk (
+   co_net_t * net,
+   const co_obj_t * obj,
+   const co_entry_t * entry,
+   uint8_t subindex,
+   size_t offset,
+   void * data,
+   size_t * size);
+
+/**
+ * Write chunk of streamed subindex
+ *
+ * This function writes \a size bytes starting at \a offset by
+ * calling the chunked access function of the object. If \a data is
+ * NULL, the transfer is complete and \a size is the total size
+ * written. The notification callback is triggered on completion.
+ *
+ * @param net           network handle
+ * @param obj           object descriptor
+ * @param entry         entry descriptor
+ * @param subindex      subindex
+ * @param offset        offset of chunk
+ * @param data          chunk to write, or NULL
+ * @param size          size of chunk
+ *
+ * @return 0 or sdo abort code
+ */
+uint32_t co_od_set_chunk (
+   co_net_t * net,
+   const co_obj_t * obj,
+   const co_entry_t * entry,
+   uint8_t subindex,
+   size_t offset,
+   const void * data,
+   size_t size);
+
 /**
  * Trigger notification callback
  *
@@ -24,6 +24,9 @@
 
 #include "co_pdo.h"
 #include "co_od.h"
+#include "co_notify.h"
+#include "co_stats.h"
+#include "co_probe.h"
 #include "co_util.h"
 #include "co_sdo.h"
 #include "co_emcy.h"
@@ -74,27 +77,66 @@ static void bitslice_set (uint64_t * data, int offset, int length, uint64_t valu
    *data = (*data & ~mask) | (value << offset);
 }
 
-void co_pdo_pack (co_net_t * net, co_pdo_t * pdo)
+int co_pdo_pack (co_net_t * net, co_pdo_t * pdo)
 {
+   uint32_t sequence[CO_PDO_MAX_ENTRIES];
+   unsigned int retries = CO_SEQLOCK_RETRIES;
    unsigned int ix;
-   unsigned int offset = 0;
+   uint64_t frame;
+   bool retry;
 
-   for (ix = 0; ix < pdo->number_of_mappings; ix++)
+   CO_PROBE2 (pdo_pack, net->node, pdo->cobid & CO_EXTID_MASK);
+
+   do
    {
-      const co_entry_t * entry = pdo->entries[ix];
-      const co_obj_t * obj     = pdo->objs[ix];
-      size_t bitlength         = pdo->mappings[ix] & 0xFF;
-      uint8_t subindex         = (pdo->mappings[ix] >> 8) & 0xFF;
-      uint64_t value           = 0;
+      unsigned int offset = 0;
 
-      if (entry != NULL)
+      frame = 0;
+
+      for (ix = 0; ix < pdo->number_of_mappings; ix++)
       {
-         co_od_get_value (net, obj, entry, subindex, &value);
+         const co_entry_t * entry = pdo->entries[ix];
+         const co_obj_t * obj     = pdo->objs[ix];
+         size_t bitlength         = pdo->mappings[ix] & 0xFF;
+         uint8_t subindex         = (pdo->mappings[ix] >> 8) & 0xFF;
+         uint64_t value           = 0;
+
+         if (entry != NULL)
+         {
+            co_seqlock_t * lock = co_od_seqlock (obj);
+
+            if (lock != NULL)
+               sequence[ix] = co_seqlock_read_begin (lock);
+
+            co_od_get_value (net, obj, entry, subindex, &value);
+         }
+
+         bitslice_set (&frame, offset, bitlength, value);
+         offset += bitlength;
       }
 
-      bitslice_set (&pdo->frame, offset, bitlength, value);
-      offset += bitlength;
-   }
+      /* Repack if an object was modified while packed, so that
+         entries of the same object are consistent */
+      retry = false;
+      for (ix = 0; ix < pdo->number_of_mappings; ix++)
+      {
+         co_seqlock_t * lock;
+
+         if (pdo->entries[ix] == NULL)
+            continue;
+
+         lock = co_od_seqlock (pdo->objs[ix]);
+         if (lock != NULL && co_seqlock_read_retry (lock, sequence[ix]))
+            retry = true;
+      }
+   } while (retry && retries-- > 0);
+
+   /* Keep last consistent frame when retries are exhausted */
+   if (retry)
+      return -1;
+
+   pdo->frame = frame;
+   return 0;
 }
 
 void co_pdo_unpack (co_net_t * net, co_pdo_t * pdo)
@@ -120,12 +162,15 @@ void co_pdo_unpack (co_net_t * net, co_pdo_t * pdo)
    }
 }
 
-static uint32_t co_pdo_mapping_validate (co_pdo_t * pdo, uint8_t number_of_mappings)
+static uint32_t co_pdo_mapping_validate (
+   co_net_t * net,
+   co_pdo_t * pdo,
+   uint8_t number_of_mappings)
 {
    int ix;
 
    /* Mappings array bounds check */
-   if (number_of_mappings > MAX_PDO_ENTRIES)
+   if (number_of_mappings > net->sizes.pdo_entries)
       return CO_SDO_ABORT_PDO_LENGTH;
 
    /* Check that bitlength is OK */
@@ -230,7 +275,7 @@ static uint32_t co_pdo_map_get (
 {
    if (subindex == 0)
       *value = pdo->number_of_mappings;
-   else if (subindex > MAX_PDO_ENTRIES)
+   else if (subindex > net->sizes.pdo_entries)
       return CO_SDO_ABORT_BAD_SUBINDEX;
    else
       *value = pdo->mappings[subindex - 1];
@@ -262,7 +307,7 @@ static uint32_t co_pdo_map_set (
    {
       uint8_t number_of_mappings = *value & 0xFF;
 
-      uint32_t abort = co_pdo_mapping_validate (pdo, number_of_mappings);
+      uint32_t abort = co_pdo_mapping_validate (net, pdo, number_of_mappings);
       if (abort)
          return abort;
 
@@ -271,7 +316,7 @@ static uint32_t co_pdo_map_set (
 
       return 0;
    }
-   else if (subindex > MAX_PDO_ENTRIES)
+   else if (subindex > net->sizes.pdo_entries)
    {
       return CO_SDO_ABORT_BAD_SUBINDEX;
    }
@@ -335,21 +380,21 @@ void co_pdo_mapping_init (co_net_t * net)
 {
    unsigned int ix;
 
-   for (ix = 0; ix < MAX_RX_PDO; ix++)
+   for (ix = 0; ix < net->sizes.rx_pdos; ix++)
    {
       co_pdo_t * pdo = &net->pdo_rx[ix];
       if ((pdo->cobid & CO_COBID_INVALID) == 0)
       {
-         co_pdo_mapping_validate (pdo, pdo->number_of_mappings);
+         co_pdo_mapping_validate (net, pdo, pdo->number_of_mappings);
       }
    }
 
-   for (ix = 0; ix < MAX_TX_PDO; ix++)
+   for (ix = 0; ix < net->sizes.tx_pdos; ix++)
    {
       co_pdo_t * pdo = &net->pdo_tx[ix];
       if ((pdo->cobid & CO_COBID_INVALID) == 0)
       {
-         co_pdo_mapping_validate (pdo, pdo->number_of_mappings);
+         co_pdo_mapping_validate (net, pdo, pdo->number_of_mappings);
       }
    }
 }
@@ -391,12 +436,12 @@ static co_pdo_t * co_pdo_find (co_net_t * net, uint16_t index)
    if (is_rx)
    {
       pdo  = net->pdo_rx;
-      size = MAX_RX_PDO;
+      size = net->sizes.rx_pdos;
    }
    else
    {
       pdo  = net->pdo_tx;
-      size = MAX_TX_PDO;
+      size = net->sizes.tx_pdos;
    }
 
    for (size_t ix = 0; ix < size; ix++)
@@ -462,8 +507,8 @@ uint32_t co_od1600_fn (
       return co_pdo_map_set (net, pdo, subindex, value, true);
 
    case OD_EVENT_RESTORE:
-      pdo->number_of_mappings = MAX_PDO_ENTRIES;
-      memset (pdo->mappings, 0, sizeof (pdo->mappings));
+      pdo->number_of_mappings = net->sizes.pdo_entries;
+      memset (pdo->mappings, 0, net->sizes.pdo_entries * sizeof (pdo->mappings[0]));
       return 0;
 
    default:
@@ -525,8 +570,8 @@ uint32_t co_od1A00_fn (
       return co_pdo_map_set (net, pdo, subindex, value, false);
 
    case OD_EVENT_RESTORE:
-      pdo->number_of_mappings = MAX_PDO_ENTRIES;
-      memset (pdo->mappings, 0, sizeof (pdo->mappings));
+      pdo->number_of_mappings = net->sizes.pdo_entries;
+      memset (pdo->mappings, 0, net->sizes.pdo_entries * sizeof (pdo->mappings[0]));
       return 0;
 
    default:
@@ -543,17 +588,35 @@ static void co_pdo_transmit (co_net_t * net, co_pdo_t * pdo)
    {
       /* Check that inhibit time has expired */
       if (!co_is_expired (now, pdo->timestamp, 100 * pdo->inhibit_time))
+      {
+         net->stats.pdo_inhibited++;
          return;
+      }
    }
 
+   /* Skip transmission rather than send a torn frame. Timestamp is
+      kept so that an event timer retries on the next period. */
+   if (co_pdo_pack (net, pdo) < 0)
+      return;
+
    /* Transmit PDO */
-   co_pdo_pack (net, pdo);
    dlc = CO_BYTELENGTH (pdo->bitlength);
-   os_channel_send (net->channel, pdo->cobid & CO_EXTID_MASK, &pdo->frame, dlc);
+   co_send (net, pdo->cobid & CO_EXTID_MASK, &pdo->frame, dlc);
+   CO_PROBE3 (pdo_transmit, net->node, pdo->cobid & CO_EXTID_MASK, dlc);
    pdo->timestamp = now;
    pdo->queued    = false;
 }
 
+static void co_pdo_sync_transmit (co_net_t * net, co_pdo_t * pdo)
+{
+   co_pdo_transmit (net, pdo);
+   co_stats_latency (
+      net,
+      &net->stats.sync_latency,
+      net->sync_timestamp,
+      os_tick_current());
+}
+
 int co_pdo_timer (co_net_t * net, os_tick_t now)
 {
    unsigned int ix;
@@ -563,7 +626,7 @@ int co_pdo_timer (co_net_t * net, os_tick_t now)
       return -1;
 
    /* Check for TPDOs with event timer */
-   for (ix = 0; ix < MAX_TX_PDO; ix++)
+   for (ix = 0; ix < net->sizes.tx_pdos; ix++)
    {
       co_pdo_t * pdo = &net->pdo_tx[ix];
 
@@ -581,7 +644,7 @@ int co_pdo_timer (co_net_t * net, os_tick_t now)
    }
 
    /* Check for RPDOs with event timer (deadline monitoring) */
-   for (ix = 0; ix < MAX_RX_PDO; ix++)
+   for (ix = 0; ix < net->sizes.rx_pdos; ix++)
    {
       co_pdo_t * pdo = &net->pdo_rx[ix];
 
@@ -622,7 +685,7 @@ void co_pdo_trigger (co_net_t * net)
       return;
 
    /* Transmit event-driven TPDOs, queue acyclic TPDOs */
-   for (ix = 0; ix < MAX_TX_PDO; ix++)
+   for (ix = 0; ix < net->sizes.tx_pdos; ix++)
    {
       co_pdo_t * pdo = &net->pdo_tx[ix];
 
@@ -665,7 +728,7 @@ void co_pdo_trigger_with_obj (co_net_t * net, uint16_t index, uint8_t subindex)
       return;
 
    /* Transmit event-driven TPDOs, queue acyclic TPDOs */
-   for (ix = 0; ix < MAX_TX_PDO; ix++)
+   for (ix = 0; ix < net->sizes.tx_pdos; ix++)
    {
       co_pdo_t * pdo = &net->pdo_tx[ix];
       if (pdo->cobid & CO_COBID_INVALID)
@@ -699,7 +762,7 @@ int co_pdo_sync (co_net_t * net, uint8_t * msg, size_t dlc)
    net->sync_timestamp = os_tick_current();
 
    /* Transmit TPDOs */
-   for (ix = 0; ix < MAX_TX_PDO; ix++)
+   for (ix = 0; ix < net->sizes.tx_pdos; ix++)
    {
       co_pdo_t * pdo = &net->pdo_tx[ix];
 
@@ -709,7 +772,7 @@ int co_pdo_sync (co_net_t * net, uint8_t * msg, size_t dlc)
       if (pdo->queued)
       {
          /* Queued by event */
-         co_pdo_transmit (net, pdo);
+         co_pdo_sync_transmit (net, pdo);
       }
       else if (IS_CYCLIC (pdo->transmission_type))
       {
@@ -737,7 +800,7 @@ int co_pdo_sync (co_net_t * net, uint8_t * msg, size_t dlc)
             pdo->sync_counter += 1;
             if (pdo->sync_counter == pdo->transmission_type)
             {
-               co_pdo_transmit (net, pdo);
+               co_pdo_sync_transmit (net, pdo);
                pdo->sync_counter = 0;
             }
          }
@@ -750,7 +813,7 @@ int co_pdo_sync (co_net_t * net, uint8_t * msg, size_t dlc)
    }
 
    /* Deliver queued RPDOs */
-   for (ix = 0; ix < MAX_RX_PDO; ix++)
+   for (ix = 0; ix < net->sizes.rx_pdos; ix++)
    {
       co_pdo_t * pdo = &net->pdo_rx[ix];
       if (pdo->queued)
@@ -760,6 +823,9 @@ int co_pdo_sync (co_net_t * net, uint8_t * msg, size_t dlc)
       }
    }
 
+   /* Deliver notifications of RPDO and SDO writes */
+   co_notify_flush (net, CO_NOTIFY_SYNC);
+
    /* Call user callback */
    if (net->cb_sync)
    {
@@ -781,7 +847,7 @@ void co_pdo_rx (co_net_t * net, uint32_t id, void * msg, size_t dlc)
    if (id & CO_RTR_MASK)
    {
       id &= CO_EXTID_MASK;
-      for (ix = 0; ix < MAX_TX_PDO; ix++)
+      for (ix = 0; ix < net->sizes.tx_pdos; ix++)
       {
          co_pdo_t * pdo = &net->pdo_tx[ix];
 
@@ -798,7 +864,7 @@ void co_pdo_rx (co_net_t * net, uint32_t id, void * msg, size_t dlc)
             {
                /* Transmit value sampled at previous SYNC */
                dlc = CO_BYTELENGTH (pdo->bitlength);
-               os_channel_send (net->channel, pdo->cobid, &pdo->frame, dlc);
+               co_send (net, pdo->cobid, &pdo->frame, dlc);
                pdo->timestamp = os_tick_current();
                pdo->queued    = false;
             }
@@ -807,7 +873,7 @@ void co_pdo_rx (co_net_t * net, uint32_t id, void * msg, size_t dlc)
    }
    else
    {
-      for (ix = 0; ix < MAX_RX_PDO; ix++)
+      for (ix = 0; ix < net->sizes.rx_pdos; ix++)
       {
          co_pdo_t * pdo = &net->pdo_rx[ix];
 
@@ -817,6 +883,7 @@ void co_pdo_rx (co_net_t * net, uint32_t id, void * msg, size_t dlc)
             {
                /* PDO received is too short. Sending EMCY when it's too long is
                 * optional, so don't do that (data must still be consumed). */
+               net->stats.pdo_dropped++;
                co_emcy_tx (net, 0x8210, 0, NULL);
             }
             else
@@ -826,7 +893,10 @@ void co_pdo_rx (co_net_t * net, uint32_t id, void * msg, size_t dlc)
                   /* Check that sync window has not expired */
                   now = os_tick_current();
                   if (co_is_expired (now, net->sync_timestamp, net->sync_window))
+                  {
+                     net->stats.pdo_dropped++;
                      continue;
+                  }
                }
 
                /* Buffer frame */
@@ -847,7 +917,10 @@ void co_pdo_rx (co_net_t * net, uint32_t id, void * msg, size_t dlc)
                }
                else
                {
-                  /* Deliver synchronously */
+                  /* Deliver synchronously. A PDO still queued since
+                     the previous SYNC is overwritten. */
+                  if (pdo->queued)
+                     net->stats.pdo_dropped++;
                   pdo->queued = true;
                }
             }
@@ -883,13 +956,13 @@ int co_pdo_init (co_net_t * net)
    int ix;
 
    /* Disable RPDOs */
-   for (ix = 0; ix < MAX_RX_PDO; ix++)
+   for (ix = 0; ix < net->sizes.rx_pdos; ix++)
    {
       net->pdo_rx[ix].cobid = CO_COBID_INVALID;
    }
 
    /* Disable TPDOs */
-   for (ix = 0; ix < MAX_TX_PDO; ix++)
+   for (ix = 0; ix < net->sizes.tx_pdos; ix++)
    {
       net->pdo_tx[ix].cobid = CO_COBID_INVALID;
    }
@@ -900,7 +973,7 @@ int co_pdo_init (co_net_t * net)
       if (obj->index >= 0x1400 && obj->index < 0x1600)
       {
          /* Out of RPDOs? */
-         if (pdo_rx == MAX_RX_PDO)
+         if (pdo_rx == net->sizes.rx_pdos)
             return -1;
 
          net->pdo_rx[pdo_rx++].number = obj->index - 0x1400;
@@ -908,7 +981,7 @@ int co_pdo_init (co_net_t * net)
       else if (obj->index >= 0x1800 && obj->index < 0x1A00)
       {
          /* Out of TPDOs? */
-         if (pdo_tx == MAX_TX_PDO)
+         if (pdo_tx == net->sizes.tx_pdos)
             return -1;
 
          net->pdo_tx[pdo_tx++].number = obj->index - 0x1800;
@@ -35,10 +35,15 @@ extern "C" {
  * This function packs a PDO into a CAN message for transmission. This
  * function is exported from the module to simplify unit-testing.
  *
+ * The message is left unchanged if a mapped object was being written
+ * for CO_SEQLOCK_RETRIES consecutive attempts.
+ *
  * @param net           network handle
  * @param pdo           PDO to pack
+ *
+ * @return 0 on success, -1 if no consistent message could be packed
  */
-void co_pdo_pack (co_net_t * net, co_pdo_t * pdo);
+int co_pdo_pack (co_net_t * net, co_pdo_t * pdo);
 
 /**
  * @internal
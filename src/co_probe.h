@@ -0,0 +1,61 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Static tracing probes
+ *
+ * With CO_PROBES enabled, the probes are USDT probes of the provider
+ * "canopen", for use with e.g. bpftrace or perf. A disabled USDT probe
+ * is a single nop instruction. Otherwise, the probes expand to
+ * nothing. See util/probes for scripts.
+ *
+ * The first argument of all probes is the node ID of the network.
+ */
+
+#ifndef CO_PROBE_H
+#define CO_PROBE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "options.h"
+
+#if CO_PROBES
+
+#include <sys/sdt.h>
+
+#define CO_PROBE1(name, a)             DTRACE_PROBE1 (canopen, name, a)
+#define CO_PROBE2(name, a, b)          DTRACE_PROBE2 (canopen, name, a, b)
+#define CO_PROBE3(name, a, b, c)       DTRACE_PROBE3 (canopen, name, a, b, c)
+#define CO_PROBE4(name, a, b, c, d)    DTRACE_PROBE4 (canopen, name, a, b, c, d)
+#define CO_PROBE5(name, a, b, c, d, e) DTRACE_PROBE5 (canopen, name, a, b, c, d, e)
+
+#else
+
+#define CO_PROBE1(name, a)
+#define CO_PROBE2(name, a, b)
+#define CO_PROBE3(name, a, b, c)
+#define CO_PROBE4(name, a, b, c, d)
+#define CO_PROBE5(name, a, b, c, d, e)
+
+#endif /* CO_PROBES */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_PROBE_H */
@@ -55,7 +55,27 @@ extern "C" {
 /**
  * Send SDO abort message
  *
- * This function sends an SDO abort message.
+ * This function sends an SDO abort message, without changing the
+ * state of the SDO server or client.
+ *
+ * @param net           network handle
+ * @param id            COB ID
+ * @param index         failed index
+ * @param subindex      failed subindex
+ * @param code          abort code
+ */
+void co_sdo_abort_send (
+   co_net_t * net,
+   uint16_t id,
+   uint16_t index,
+   uint8_t subindex,
+   uint32_t code);
+
+/**
+ * Abort SDO server transfer
+ *
+ * This function ends the current SDO server transfer and sends an
+ * SDO abort message.
  *
  * @param net           network handle
  * @param id            COB ID
@@ -19,31 +19,156 @@
 #define co_obj_find        mock_co_obj_find
 #define co_entry_find      mock_co_entry_find
 #define os_tick_from_us    mock_os_tick_from_us
+#define os_tick_current    mock_os_tick_current
 #endif
 
 #include "co_sdo.h"
 #include "co_od.h"
+#include "co_stats.h"
+#include "co_capture.h"
+#include "co_probe.h"
 #include "co_util.h"
 
 #include <inttypes.h>
 
-static void co_sdo_done (co_net_t * net)
+static co_job_t ** co_sdo_client_slot (co_net_t * net, uint8_t node)
 {
-   co_job_t * job = net->job_client;
+   unsigned int ix;
 
-   net->job_client = NULL;
+   for (ix = 0; ix < MAX_SDO_CLIENTS; ix++)
+   {
+      co_job_t * job = net->job_client[ix];
+
+      if (job != NULL && job->sdo.node == node)
+         return &net->job_client[ix];
+   }
+
+   return NULL;
+}
+
+/* Abort transfer towards the server, leaving the SDO server of this
+   node alone */
+static void co_sdo_client_abort (co_net_t * net, co_job_t * job, uint32_t code)
+{
+   co_sdo_abort_send (
+      net,
+      0x600 + job->sdo.node,
+      job->sdo.index,
+      job->sdo.subindex,
+      code);
+}
+
+static bool co_sdo_client_busy (co_net_t * net, uint8_t node)
+{
+   return co_sdo_client_slot (net, node) != NULL;
+}
+
+static void co_sdo_start (co_net_t * net, co_job_t * job)
+{
+   uint8_t msg[8] = {0};
+
+   job->sdo.total = 0;
+   job->timestamp = os_tick_current();
+   CO_PROBE4 (sdo_client_start, net->node, job->sdo.node, job->sdo.index, job->sdo.subindex);
+
+   if (job->type == CO_JOB_SDO_READ)
+   {
+      msg[0] = CO_SDO_CCS_UPLOAD_INIT_REQ;
+   }
+   else
+   {
+      msg[0] = CO_SDO_CCS_DOWNLOAD_INIT_REQ;
+      if (job->sdo.remain <= 4)
+      {
+         int n = 4 - job->sdo.remain;
+         msg[0] |= (n << 2) | CO_SDO_E | CO_SDO_S;
+         memcpy (&msg[4], job->sdo.data, job->sdo.remain);
+         job->sdo.total  = job->sdo.remain;
+         job->sdo.remain = 0;
+      }
+      else
+      {
+         msg[0] |= CO_SDO_S;
+         co_put_uint32 (&msg[4], job->sdo.remain);
+      }
+   }
+
+   co_put_uint16 (&msg[1], job->sdo.index);
+   co_put_uint8 (&msg[3], job->sdo.subindex);
+
+   co_send (net, 0x600 + job->sdo.node, msg, sizeof (msg));
+}
+
+static bool co_sdo_start_next (co_net_t * net, co_job_t ** slot)
+{
+   co_job_t ** pending = &net->job_client_pending;
+
+   /* Start first pending job whose server is not busy */
+   while (*pending != NULL)
+   {
+      co_job_t * job = *pending;
+
+      if (!co_sdo_client_busy (net, job->sdo.node))
+      {
+         *pending  = job->next;
+         job->next = NULL;
+         *slot     = job;
+         co_sdo_start (net, job);
+         return true;
+      }
+
+      pending = &job->next;
+   }
+
+   return false;
+}
+
+static void co_sdo_done (co_net_t * net, co_job_t * job)
+{
+   unsigned int ix;
+
+   CO_PROBE5 (
+      sdo_client_end,
+      net->node,
+      job->sdo.node,
+      job->sdo.index,
+      job->sdo.subindex,
+      job->result);
+
+   if (job->result >= 0)
+   {
+      net->stats.sdo_transfers++;
+      net->stats.sdo_bytes += job->sdo.total;
+   }
+
+   for (ix = 0; ix < MAX_SDO_CLIENTS; ix++)
+   {
+      if (net->job_client[ix] == job)
+         net->job_client[ix] = NULL;
+   }
 
    if (job->callback)
       job->callback (job);
+
+   /* Let pending jobs use free sessions. The callback may already
+      have issued new jobs. */
+   for (ix = 0; ix < MAX_SDO_CLIENTS; ix++)
+   {
+      if (net->job_client[ix] == NULL)
+      {
+         if (!co_sdo_start_next (net, &net->job_client[ix]))
+            break;
+      }
+   }
 }
 
 static int co_sdo_tx_upload_init_rsp (
    co_net_t * net,
    uint8_t node,
    uint8_t type,
-   uint8_t * data)
+   uint8_t * data,
+   co_job_t * job)
 {
-   co_job_t * job = net->job_client;
 
    /* Complete if e = 1 */
    if (type & CO_SDO_E)
@@ -58,7 +183,7 @@ static int co_sdo_tx_upload_init_rsp (
       job->sdo.total += size;
 
       job->result = job->sdo.total; /* actual size */
-      co_sdo_done (net);
+      co_sdo_done (net, job);
       return 1;
    }
    else
@@ -73,7 +198,7 @@ static int co_sdo_tx_upload_init_rsp (
 
       msg[0] = CO_SDO_CCS_UPLOAD_SEG_REQ;
 
-      os_channel_send (net->channel, 0x600 + node, msg, sizeof (msg));
+      co_send (net, 0x600 + node, msg, sizeof (msg));
    }
 
    return 0;
@@ -83,22 +208,17 @@ static int co_sdo_tx_upload_seg_rsp (
    co_net_t * net,
    uint8_t node,
    uint8_t type,
-   uint8_t * data)
+   uint8_t * data,
+   co_job_t * job)
 {
-   co_job_t * job = net->job_client;
    int error;
 
    error = co_sdo_toggle_update (job, type);
    if (error < 0)
    {
-      co_sdo_abort (
-         net,
-         0x600 + net->node,
-         job->sdo.index,
-         job->sdo.subindex,
-         CO_SDO_ABORT_TOGGLE);
+      co_sdo_client_abort (net, job, CO_SDO_ABORT_TOGGLE);
       job->result = CO_STATUS_ERROR;
-      co_sdo_done (net);
+      co_sdo_done (net, job);
       return error;
    }
 
@@ -114,7 +234,7 @@ static int co_sdo_tx_upload_seg_rsp (
    if (type & CO_SDO_C)
    {
       job->result = job->sdo.total;
-      co_sdo_done (net);
+      co_sdo_done (net, job);
       return 1;
    }
    else
@@ -125,7 +245,7 @@ static int co_sdo_tx_upload_seg_rsp (
       if (job->sdo.toggle)
          msg[0] |= CO_SDO_TOGGLE;
 
-      os_channel_send (net->channel, 0x600 + node, msg, sizeof (msg));
+      co_send (net, 0x600 + node, msg, sizeof (msg));
    }
 
    return 0;
@@ -135,15 +255,15 @@ static int co_sdo_tx_download_init_rsp (
    co_net_t * net,
    uint8_t node,
    uint8_t type,
-   uint8_t * data)
+   uint8_t * data,
+   co_job_t * job)
 {
-   co_job_t * job = net->job_client;
 
    if (job->sdo.remain == 0)
    {
       /* Complete */
       job->result = job->sdo.total;
-      co_sdo_done (net);
+      co_sdo_done (net, job);
       return 1;
    }
    else
@@ -163,7 +283,7 @@ static int co_sdo_tx_download_init_rsp (
       job->sdo.remain -= size;
       job->sdo.total += size;
 
-      os_channel_send (net->channel, 0x600 + node, msg, sizeof (msg));
+      co_send (net, 0x600 + node, msg, sizeof (msg));
    }
 
    return 0;
@@ -173,22 +293,17 @@ static int co_sdo_tx_download_seg_rsp (
    co_net_t * net,
    uint8_t node,
    uint8_t type,
-   uint8_t * data)
+   uint8_t * data,
+   co_job_t * job)
 {
-   co_job_t * job = net->job_client;
    int error;
 
    error = co_sdo_toggle_update (job, type);
    if (error < 0)
    {
-      co_sdo_abort (
-         net,
-         0x600 + net->node,
-         job->sdo.index,
-         job->sdo.subindex,
-         CO_SDO_ABORT_TOGGLE);
+      co_sdo_client_abort (net, job, CO_SDO_ABORT_TOGGLE);
       job->result = CO_STATUS_ERROR;
-      co_sdo_done (net);
+      co_sdo_done (net, job);
       return error;
    }
 
@@ -196,7 +311,7 @@ static int co_sdo_tx_download_seg_rsp (
    {
       /* Complete */
       job->result = job->sdo.total;
-      co_sdo_done (net);
+      co_sdo_done (net, job);
       return 1;
    }
    else
@@ -216,7 +331,7 @@ static int co_sdo_tx_download_seg_rsp (
       job->sdo.remain -= size;
       job->sdo.total += size;
 
-      os_channel_send (net->channel, 0x600 + node, msg, sizeof (msg));
+      co_send (net, 0x600 + node, msg, sizeof (msg));
    }
 
    return 0;
@@ -227,22 +342,25 @@ int co_sdo_tx (co_net_t * net, uint8_t node, void * msg, size_t dlc)
    uint8_t * data = (uint8_t *)msg;
    uint8_t type   = data[0];
    uint8_t scs    = CO_SDO_xCS (type);
-   co_job_t * job = net->job_client;
+   co_job_t ** slot;
+   co_job_t * job;
 
-   /* Check for ongoing job */
-   if (job == NULL)
+   /* Check for ongoing job with this node */
+   slot = co_sdo_client_slot (net, node);
+   if (slot == NULL)
       return -1;
 
-   /* Check for correct response */
-   if (job->sdo.node != node)
-      return -1;
+   job = *slot;
+
+   /* Each response restarts the timeout */
+   job->timestamp = os_tick_current();
 
    /* Check DLC - must be complete frame */
    if (dlc != 8)
    {
-      co_sdo_abort (net, 0x600 + net->node, 0, 0, CO_SDO_ABORT_GENERAL);
+      co_sdo_client_abort (net, job, CO_SDO_ABORT_GENERAL);
       job->result = CO_STATUS_ERROR;
-      co_sdo_done (net);
+      co_sdo_done (net, job);
       return -1;
    }
 
@@ -250,91 +368,97 @@ int co_sdo_tx (co_net_t * net, uint8_t node, void * msg, size_t dlc)
    switch (scs)
    {
    case CO_SDO_SCS_UPLOAD_INIT_RSP:
-      return co_sdo_tx_upload_init_rsp (net, node, type, data);
+      return co_sdo_tx_upload_init_rsp (net, node, type, data, job);
 
    case CO_SDO_SCS_UPLOAD_SEG_RSP:
-      return co_sdo_tx_upload_seg_rsp (net, node, type, data);
+      return co_sdo_tx_upload_seg_rsp (net, node, type, data, job);
 
    case CO_SDO_SCS_DOWNLOAD_INIT_RSP:
-      return co_sdo_tx_download_init_rsp (net, node, type, data);
+      return co_sdo_tx_download_init_rsp (net, node, type, data, job);
 
    case CO_SDO_SCS_DOWNLOAD_SEG_RSP:
-      return co_sdo_tx_download_seg_rsp (net, node, type, data);
+      return co_sdo_tx_download_seg_rsp (net, node, type, data, job);
 
    case CO_SDO_xCS_ABORT:
    {
       uint32_t error = co_fetch_uint32 (&data[4]);
       (void)error;
       LOG_WARNING (CO_SDO_LOG, "sdo abort (%08" PRIx32 ")\n", error);
+      net->stats.sdo_aborts++;
+      co_capture_sdo_abort (
+         net,
+         co_fetch_uint16 (&data[1]),
+         co_fetch_uint8 (&data[3]),
+         error,
+         false);
+      CO_PROBE5 (
+         sdo_abort,
+         net->node,
+         co_fetch_uint16 (&data[1]),
+         co_fetch_uint8 (&data[3]),
+         error,
+         0);
       job->result = CO_STATUS_ERROR;
-      co_sdo_done (net);
+      co_sdo_done (net, job);
       return 1;
    }
 
    default:
-      co_sdo_abort (net, 0x600 + net->node, 0, 0, CO_SDO_ABORT_UNKNOWN);
+      co_sdo_client_abort (net, job, CO_SDO_ABORT_UNKNOWN);
       LOG_ERROR (CO_SDO_LOG, "sdo unknown command (%X)\n", scs);
       job->result = CO_STATUS_ERROR;
-      co_sdo_done (net);
+      co_sdo_done (net, job);
       return 1;
    }
 }
 
 void co_sdo_issue (co_net_t * net, co_job_t * job)
 {
-   uint8_t msg[8] = {0};
+   co_job_t ** pending = &net->job_client_pending;
+   unsigned int ix;
 
-   net->job_client = job;
-   job->sdo.total  = 0;
+   job->next = NULL;
 
-   if (job->type == CO_JOB_SDO_READ)
-   {
-      msg[0] = CO_SDO_CCS_UPLOAD_INIT_REQ;
-   }
-   else
+   /* Start job if a session is free and server is not busy */
+   if (!co_sdo_client_busy (net, job->sdo.node))
    {
-      msg[0] = CO_SDO_CCS_DOWNLOAD_INIT_REQ;
-      if (job->sdo.remain <= 4)
-      {
-         int n = 4 - job->sdo.remain;
-         msg[0] |= (n << 2) | CO_SDO_E | CO_SDO_S;
-         memcpy (&msg[4], job->sdo.data, job->sdo.remain);
-         job->sdo.total  = job->sdo.remain;
-         job->sdo.remain = 0;
-      }
-      else
+      for (ix = 0; ix < MAX_SDO_CLIENTS; ix++)
       {
-         msg[0] |= CO_SDO_S;
-         co_put_uint32 (&msg[4], job->sdo.remain);
+         if (net->job_client[ix] == NULL)
+         {
+            net->job_client[ix] = job;
+            co_sdo_start (net, job);
+            return;
+         }
       }
    }
 
-   co_put_uint16 (&msg[1], job->sdo.index);
-   co_put_uint8 (&msg[3], job->sdo.subindex);
-
-   os_channel_send (net->channel, 0x600 + job->sdo.node, msg, sizeof (msg));
+   /* Queue job until a session is available */
+   while (*pending != NULL)
+      pending = &(*pending)->next;
+   *pending = job;
 }
 
 int co_sdo_client_timer (co_net_t * net, os_tick_t now)
 {
-   co_job_t * job = net->job_client;
-
-   if (job == NULL)
-      return 0;
+   unsigned int ix;
 
-   if (job->type == CO_JOB_SDO_READ || job->type == CO_JOB_SDO_WRITE)
+   for (ix = 0; ix < MAX_SDO_CLIENTS; ix++)
    {
-      if (co_is_expired (now, job->timestamp, 1000 * SDO_TIMEOUT))
+      co_job_t * job = net->job_client[ix];
+
+      if (job == NULL)
+         continue;
+
+      if (job->type == CO_JOB_SDO_READ || job->type == CO_JOB_SDO_WRITE)
       {
-         co_sdo_abort (
-            net,
-            0x580 + net->node,
-            job->sdo.index,
-            job->sdo.subindex,
-            CO_SDO_ABORT_TIMEOUT);
-
-         job->result = CO_STATUS_ERROR;
-         co_sdo_done (net);
+         if (co_is_expired (now, job->timestamp, 1000 * SDO_TIMEOUT))
+         {
+            co_sdo_client_abort (net, job, CO_SDO_ABORT_TIMEOUT);
+
+            job->result = CO_STATUS_ERROR;
+            co_sdo_done (net, job);
+         }
       }
    }
 
@@ -24,6 +24,9 @@
 
 #include "co_sdo.h"
 #include "co_od.h"
+#include "co_stats.h"
+#include "co_capture.h"
+#include "co_probe.h"
 #include "co_util.h"
 
 #include <inttypes.h>
@@ -49,7 +52,7 @@
 #define CO_SDO_N_SEG(v) (((v) >> 1) & 0x07)
 #define CO_SDO_C        BIT (0)
 
-void co_sdo_abort (
+void co_sdo_abort_send (
    co_net_t * net,
    uint16_t id,
    uint16_t index,
@@ -59,7 +62,9 @@ void co_sdo_abort (
    uint8_t msg[8] = {0};
    uint8_t * p    = msg;
 
-   net->job_sdo_server.type = CO_JOB_NONE;
+   net->stats.sdo_aborts++;
+   co_capture_sdo_abort (net, index, subindex, code, true);
+   CO_PROBE5 (sdo_abort, net->node, index, subindex, code, 1);
 
    LOG_WARNING (CO_SDO_LOG, "sdo abort 0x%" PRIx32 "\n", code);
 
@@ -68,7 +73,18 @@ void co_sdo_abort (
    p = co_put_uint8 (p, subindex);
    co_put_uint32 (p, code);
 
-   os_channel_send (net->channel, id, msg, sizeof (msg));
+   co_send (net, id, msg, sizeof (msg));
+}
+
+void co_sdo_abort (
+   co_net_t * net,
+   uint16_t id,
+   uint16_t index,
+   uint8_t subindex,
+   uint32_t code)
+{
+   net->job_sdo_server.type = CO_JOB_NONE;
+   co_sdo_abort_send (net, id, index, subindex, code);
 }
 
 int co_sdo_toggle_update (co_job_t * job, uint8_t type)
@@ -84,6 +100,101 @@ int co_sdo_toggle_update (co_job_t * job, uint8_t type)
    return 0;
 }
 
+static uint32_t co_sdo_find_entry (
+   co_net_t * net,
+   co_job_t * job,
+   const co_obj_t ** obj,
+   const co_entry_t ** entry)
+{
+   *obj = co_obj_find (net, job->sdo.index);
+   if (*obj == NULL)
+      return CO_SDO_ABORT_BAD_INDEX;
+
+   *entry = co_entry_find (net, *obj, job->sdo.subindex);
+   if (*entry == NULL)
+      return CO_SDO_ABORT_BAD_SUBINDEX;
+
+   return 0;
+}
+
+static uint32_t co_sdo_upload_chunk (
+   co_net_t * net,
+   co_job_t * job,
+   uint8_t * data,
+   size_t size)
+{
+   const co_obj_t * obj;
+   const co_entry_t * entry;
+   uint32_t abort;
+   size_t n = size;
+
+   if (!job->sdo.stream)
+   {
+      memcpy (data, job->sdo.data, size);
+      job->sdo.data += size;
+
+      /* Object must not be modified during transfer */
+      if (job->sdo.seqlock != NULL &&
+          co_seqlock_read_retry (job->sdo.seqlock, job->sdo.sequence))
+         return CO_SDO_ABORT_GENERAL;
+
+      return 0;
+   }
+
+   abort = co_sdo_find_entry (net, job, &obj, &entry);
+   if (abort)
+      return abort;
+
+   abort = co_od_get_chunk (
+      net,
+      obj,
+      entry,
+      job->sdo.subindex,
+      job->sdo.offset,
+      data,
+      &n);
+   if (abort)
+      return abort;
+
+   /* Object must provide the size that was announced */
+   if (n != size)
+      return CO_SDO_ABORT_GENERAL;
+
+   job->sdo.offset += size;
+   return 0;
+}
+
+static uint32_t co_sdo_download_chunk (
+   co_net_t * net,
+   co_job_t * job,
+   const uint8_t * data,
+   size_t size)
+{
+   const co_obj_t * obj;
+   const co_entry_t * entry;
+   uint32_t abort;
+
+   if (!job->sdo.stream)
+   {
+      /* Write to object, or to download buffer */
+      memcpy (job->sdo.data, data, size);
+      job->sdo.data += size;
+      return 0;
+   }
+
+   abort = co_sdo_find_entry (net, job, &obj, &entry);
+   if (abort)
+      return abort;
+
+   abort =
+      co_od_set_chunk (net, obj, entry, job->sdo.subindex, job->sdo.offset, data, size);
+   if (abort)
+      return abort;
+
+   job->sdo.offset += size;
+   return 0;
+}
+
 static int co_sdo_get_structure (co_net_t * net, const co_obj_t * obj)
 {
    uint8_t msg[8] = {0};
@@ -107,7 +218,7 @@ static int co_sdo_get_structure (co_net_t * net, const co_obj_t * obj)
    p = co_put_uint8 (p, 0xFF);
    co_put_uint32 (p, (datatype << 8) | obj->objtype);
 
-   os_channel_send (net->channel, 0x580 + net->node, msg, sizeof (msg));
+   co_send (net, 0x580 + net->node, msg, sizeof (msg));
    return 0;
 }
 
@@ -125,12 +236,13 @@ static int co_sdo_rx_upload_init_req (
    uint8_t * p    = msg;
    uint8_t scs;
 
-   /* Configure upload job */
+   /* Configure upload job, ending any transfer in progress */
    job->type         = CO_JOB_SDO_UPLOAD;
    job->sdo.index    = co_fetch_uint16 (&data[1]);
    job->sdo.subindex = data[3];
    job->sdo.cached   = false;
    job->timestamp    = os_tick_current();
+   CO_PROBE4 (sdo_server_start, net->node, job->sdo.index, job->sdo.subindex, 1);
 
    /* Find requested object */
    obj = co_obj_find (net, job->sdo.index);
@@ -179,8 +291,44 @@ static int co_sdo_rx_upload_init_req (
 
    job->sdo.remain = CO_BYTELENGTH (entry->bitlength);
    job->sdo.toggle = 0;
+   job->sdo.offset  = 0;
+   job->sdo.seqlock = NULL;
+   job->sdo.stream  = co_od_is_stream (obj, entry);
+
+   if (job->sdo.stream)
+   {
+      /* Streamed objects are read in chunks as segments are
+         requested. Get total size first. */
+      abort = co_od_get_chunk (
+         net,
+         obj,
+         entry,
+         job->sdo.subindex,
+         0,
+         NULL,
+         &job->sdo.remain);
+
+      if (abort == 0 && job->sdo.remain > 0 && job->sdo.remain <= 4)
+      {
+         uint8_t buffer[4] = {0};
+         size_t size       = job->sdo.remain;
+
+         /* Fetch value for expedited upload */
+         abort = co_od_get_chunk (
+            net,
+            obj,
+            entry,
+            job->sdo.subindex,
+            0,
+            buffer,
+            &size);
+         if (abort == 0 && size != job->sdo.remain)
+            abort = CO_SDO_ABORT_GENERAL;
 
-   if (job->sdo.remain <= sizeof (job->sdo.value))
+         job->sdo.value = co_fetch_uint32 (buffer);
+      }
+   }
+   else if (job->sdo.remain <= sizeof (job->sdo.value))
    {
       /* Object values up to 64 bits are fetched atomically */
       abort =
@@ -189,8 +337,13 @@ static int co_sdo_rx_upload_init_req (
    }
    else
    {
-      /* Otherwise a pointer is used to access object */
+      /* Otherwise a pointer is used to access object. Data is
+         copied per segment, so check that the object is not
+         modified during the transfer. */
       abort = co_od_get_ptr (net, obj, entry, job->sdo.subindex, &job->sdo.data);
+      job->sdo.seqlock = co_od_seqlock (obj);
+      if (job->sdo.seqlock != NULL)
+         job->sdo.sequence = co_seqlock_read_begin (job->sdo.seqlock);
    }
 
    if (abort)
@@ -199,7 +352,7 @@ static int co_sdo_rx_upload_init_req (
       return -1;
    }
 
-   if (job->sdo.remain <= 4)
+   if (job->sdo.remain > 0 && job->sdo.remain <= 4)
    {
       size_t n = 4 - job->sdo.remain;
 
@@ -214,6 +367,9 @@ static int co_sdo_rx_upload_init_req (
 
       /* Done */
       job->type = CO_JOB_NONE;
+      net->stats.sdo_transfers++;
+      CO_PROBE3 (sdo_server_end, net->node, job->sdo.index, job->sdo.subindex);
+      net->stats.sdo_bytes += job->sdo.remain;
    }
    else
    {
@@ -226,7 +382,7 @@ static int co_sdo_rx_upload_init_req (
       co_put_uint32 (p, job->sdo.remain);
    }
 
-   os_channel_send (net->channel, 0x580 + net->node, msg, sizeof (msg));
+   co_send (net, 0x580 + net->node, msg, sizeof (msg));
    return 0;
 }
 
@@ -238,8 +394,9 @@ static int co_sdo_rx_upload_seg_req (
 {
    co_job_t * job = &net->job_sdo_server;
    int error;
+   uint32_t abort;
    uint8_t msg[8] = {0};
-   uint8_t * p    = msg;
+   size_t size;
    uint8_t scs;
 
    /* Check toggle protocol */
@@ -255,38 +412,42 @@ static int co_sdo_rx_upload_seg_req (
       return error;
    }
 
-   if (job->sdo.remain <= 7)
+   /* Get data */
+   size  = MIN (job->sdo.remain, 7);
+   abort = co_sdo_upload_chunk (net, job, &msg[1], size);
+   if (abort)
    {
-      size_t n = 7 - job->sdo.remain;
+      co_sdo_abort (net, 0x580 + net->node, job->sdo.index, job->sdo.subindex, abort);
+      return -1;
+   }
 
-      /* Complete segmented upload */
-      scs = CO_SDO_SCS_UPLOAD_SEG_RSP | CO_SDO_C;
-      scs |= data[0] & CO_SDO_TOGGLE;
-      scs |= (n << 1);
+   job->sdo.remain -= size;
+   net->stats.sdo_bytes += size;
 
-      p = co_put_uint8 (p, scs);
-      memcpy (p, job->sdo.data, job->sdo.remain);
+   scs = CO_SDO_SCS_UPLOAD_SEG_RSP;
+   scs |= data[0] & CO_SDO_TOGGLE;
+
+   if (job->sdo.remain == 0)
+   {
+      size_t n = 7 - size;
+
+      /* Complete segmented upload */
+      scs |= CO_SDO_C | (n << 1);
 
       /* Done */
       job->type = CO_JOB_NONE;
+      net->stats.sdo_transfers++;
+      CO_PROBE3 (sdo_server_end, net->node, job->sdo.index, job->sdo.subindex);
    }
    else
    {
-      size_t size = MIN (job->sdo.remain, 7);
-
       /* Continue segmented upload */
-      scs = CO_SDO_SCS_UPLOAD_SEG_RSP;
-      scs |= data[0] & CO_SDO_TOGGLE;
-
-      p = co_put_uint8 (p, scs);
-      memcpy (p, job->sdo.data, size);
-
-      job->sdo.data += size;
-      job->sdo.remain -= size;
       job->timestamp = os_tick_current();
    }
 
-   os_channel_send (net->channel, 0x580 + net->node, msg, sizeof (msg));
+   co_put_uint8 (msg, scs);
+
+   co_send (net, 0x580 + net->node, msg, sizeof (msg));
    return 0;
 }
 
@@ -303,12 +464,13 @@ static int co_sdo_rx_download_init_req (
    uint8_t msg[8] = {0};
    uint8_t * p    = msg;
 
-   /* Configure download job */
+   /* Configure download job, ending any transfer in progress */
    job->type         = CO_JOB_SDO_DOWNLOAD;
    job->sdo.index    = co_fetch_uint16 (&data[1]);
    job->sdo.subindex = data[3];
    job->sdo.cached   = false;
    job->timestamp    = os_tick_current();
+   CO_PROBE4 (sdo_server_start, net->node, job->sdo.index, job->sdo.subindex, 0);
 
    /* Find requested object */
    obj = co_obj_find (net, job->sdo.index);
@@ -350,8 +512,23 @@ static int co_sdo_rx_download_init_req (
 
    job->sdo.remain = CO_BYTELENGTH (entry->bitlength);
    job->sdo.toggle = 0;
+   job->sdo.offset  = 0;
+   job->sdo.seqlock = NULL;
+   job->sdo.stream  = co_od_is_stream (obj, entry);
+   job->sdo.sized    = false;
+   job->sdo.buffered = false;
 
-   if (job->sdo.remain <= sizeof (job->sdo.value))
+   if (job->sdo.stream)
+   {
+      /* Streamed objects are written in chunks as segments
+         arrive. Size is limited only if indicated by client. */
+      job->sdo.sized = (type & (CO_SDO_E | CO_SDO_S)) == CO_SDO_S;
+      if (job->sdo.sized)
+         job->sdo.remain = co_fetch_uint32 (&data[4]);
+      else
+         job->sdo.remain = SIZE_MAX;
+   }
+   else if (job->sdo.remain <= sizeof (job->sdo.value))
    {
       /* Object values up to 64 bits are cached so that we can set
          them atomically when the transfer is complete */
@@ -362,6 +539,17 @@ static int co_sdo_rx_download_init_req (
    {
       /* Otherwise a pointer is used to access object */
       abort = co_od_get_ptr (net, obj, entry, job->sdo.subindex, &job->sdo.data);
+      job->sdo.seqlock = co_od_seqlock (obj);
+      if (abort == 0 && job->sdo.seqlock != NULL)
+      {
+         /* Segments are buffered and the object is written when the
+            last segment arrives, so that readers never see a
+            partially downloaded value */
+         if (job->sdo.remain > net->sizes.download)
+            abort = CO_SDO_ABORT_OUT_OF_MEMORY;
+         job->sdo.data     = net->download;
+         job->sdo.buffered = true;
+      }
       if (abort)
       {
          co_sdo_abort (
@@ -380,23 +568,35 @@ static int co_sdo_rx_download_init_req (
       size_t size = (type & CO_SDO_S) ? 4 - CO_SDO_N (type) : 4;
       uint32_t value;
 
-      /* Validate size */
-      if (size != job->sdo.remain)
+      if (job->sdo.stream)
       {
-         co_sdo_abort (
-            net,
-            0x580 + net->node,
-            job->sdo.index,
-            job->sdo.subindex,
-            CO_SDO_ABORT_LENGTH);
-         return -1;
+         /* Write data as a single chunk and complete transfer */
+         abort =
+            co_od_set_chunk (net, obj, entry, job->sdo.subindex, 0, &data[4], size);
+         if (abort == 0)
+            abort =
+               co_od_set_chunk (net, obj, entry, job->sdo.subindex, size, NULL, size);
       }
+      else
+      {
+         /* Validate size */
+         if (size != job->sdo.remain)
+         {
+            co_sdo_abort (
+               net,
+               0x580 + net->node,
+               job->sdo.index,
+               job->sdo.subindex,
+               CO_SDO_ABORT_LENGTH);
+            return -1;
+         }
 
-      /* Fetch value */
-      value = co_fetch_uint32 (&data[4]);
+         /* Fetch value */
+         value = co_fetch_uint32 (&data[4]);
 
-      /* Atomically set value */
-      abort = co_od_set_value (net, obj, entry, job->sdo.subindex, value);
+         /* Atomically set value */
+         abort = co_od_set_value (net, obj, entry, job->sdo.subindex, value);
+      }
 
       /* Done */
       job->type = CO_JOB_NONE;
@@ -411,6 +611,10 @@ static int co_sdo_rx_download_init_req (
             abort);
          return -1;
       }
+
+      net->stats.sdo_transfers++;
+      CO_PROBE3 (sdo_server_end, net->node, job->sdo.index, job->sdo.subindex);
+      net->stats.sdo_bytes += size;
    }
 
    /* Dictionary has been written to and is now dirty */
@@ -421,7 +625,7 @@ static int co_sdo_rx_download_init_req (
    p = co_put_uint16 (p, job->sdo.index);
    co_put_uint8 (p, job->sdo.subindex);
 
-   os_channel_send (net->channel, 0x580 + net->node, msg, sizeof (msg));
+   co_send (net, 0x580 + net->node, msg, sizeof (msg));
    return 0;
 }
 
@@ -456,18 +660,48 @@ static int co_sdo_rx_download_seg_req (
 
    /* Get data */
    size = 7 - CO_SDO_N_SEG (type);
-   size = MIN (size, job->sdo.remain);
-   memcpy (job->sdo.data, &data[1], size);
 
-   job->sdo.data += size;
+   /* Streamed data must not exceed the size indicated by client */
+   if (job->sdo.sized && size > job->sdo.remain)
+   {
+      co_sdo_abort (
+         net,
+         0x580 + net->node,
+         job->sdo.index,
+         job->sdo.subindex,
+         CO_SDO_ABORT_LENGTH_TOO_HIGH);
+      return -1;
+   }
+
+   size  = MIN (size, job->sdo.remain);
+   abort = co_sdo_download_chunk (net, job, &data[1], size);
+   if (abort)
+   {
+      co_sdo_abort (net, 0x580 + net->node, job->sdo.index, job->sdo.subindex, abort);
+      return -1;
+   }
+
    job->sdo.remain -= size;
    job->timestamp = os_tick_current();
+   net->stats.sdo_bytes += size;
 
    if (data[0] & CO_SDO_C)
    {
       /* Write complete */
       job->type = CO_JOB_NONE;
 
+      /* Streamed data must have the size indicated by client */
+      if (job->sdo.sized && job->sdo.remain != 0)
+      {
+         co_sdo_abort (
+            net,
+            0x580 + net->node,
+            job->sdo.index,
+            job->sdo.subindex,
+            CO_SDO_ABORT_LENGTH);
+         return -1;
+      }
+
       /* Find requested object */
       obj = co_obj_find (net, job->sdo.index);
       if (obj == NULL)
@@ -510,10 +744,57 @@ static int co_sdo_rx_download_seg_req (
             return -1;
          }
       }
+      else if (job->sdo.stream)
+      {
+         /* Complete streamed transfer */
+         abort = co_od_set_chunk (
+            net,
+            obj,
+            entry,
+            job->sdo.subindex,
+            job->sdo.offset,
+            NULL,
+            job->sdo.offset);
+         if (abort)
+         {
+            co_sdo_abort (
+               net,
+               0x580 + net->node,
+               job->sdo.index,
+               job->sdo.subindex,
+               abort);
+            return -1;
+         }
+      }
       else
       {
+         if (job->sdo.buffered)
+         {
+            uint8_t * data;
+
+            /* Commit downloaded value while holding the object */
+            abort = co_od_get_ptr (net, obj, entry, job->sdo.subindex, &data);
+            if (abort)
+            {
+               co_sdo_abort (
+                  net,
+                  0x580 + net->node,
+                  job->sdo.index,
+                  job->sdo.subindex,
+                  abort);
+               return -1;
+            }
+
+            co_seqlock_write_begin (job->sdo.seqlock);
+            memcpy (data, net->download, job->sdo.data - net->download);
+            co_seqlock_write_end (job->sdo.seqlock);
+         }
+
          co_od_notify (net, obj, entry, job->sdo.subindex);
       }
+
+      net->stats.sdo_transfers++;
+      CO_PROBE3 (sdo_server_end, net->node, job->sdo.index, job->sdo.subindex);
    }
 
    /* Segmented response */
@@ -522,7 +803,7 @@ static int co_sdo_rx_download_seg_req (
 
    co_put_uint8 (p, scs);
 
-   os_channel_send (net->channel, 0x580 + net->node, msg, sizeof (msg));
+   co_send (net, 0x580 + net->node, msg, sizeof (msg));
    return 0;
 }
 
@@ -531,6 +812,7 @@ int co_sdo_rx (co_net_t * net, uint8_t node, void * msg, size_t dlc)
    uint8_t * data = (uint8_t *)msg;
    uint8_t type   = data[0];
    uint8_t ccs    = CO_SDO_xCS (type);
+   int result;
 
    /* Check for correct node id */
    if (node != net->node)
@@ -553,30 +835,62 @@ int co_sdo_rx (co_net_t * net, uint8_t node, void * msg, size_t dlc)
    switch (ccs)
    {
    case CO_SDO_CCS_UPLOAD_INIT_REQ:
-      return co_sdo_rx_upload_init_req (net, node, type, data);
+      result = co_sdo_rx_upload_init_req (net, node, type, data);
+      break;
 
    case CO_SDO_CCS_UPLOAD_SEG_REQ:
-      return co_sdo_rx_upload_seg_req (net, node, type, data);
+      result = co_sdo_rx_upload_seg_req (net, node, type, data);
+      break;
 
    case CO_SDO_CCS_DOWNLOAD_INIT_REQ:
-      return co_sdo_rx_download_init_req (net, node, type, data);
+      result = co_sdo_rx_download_init_req (net, node, type, data);
+      break;
 
    case CO_SDO_CCS_DOWNLOAD_SEG_REQ:
-      return co_sdo_rx_download_seg_req (net, node, type, data);
+      result = co_sdo_rx_download_seg_req (net, node, type, data);
+      break;
 
    case CO_SDO_xCS_ABORT:
    {
       uint32_t error = co_fetch_uint32 (&data[4]);
       (void)error;
       LOG_WARNING (CO_SDO_LOG, "sdo abort (%08" PRIx32 ")\n", error);
+      net->stats.sdo_aborts++;
+      co_capture_sdo_abort (
+         net,
+         co_fetch_uint16 (&data[1]),
+         co_fetch_uint8 (&data[3]),
+         error,
+         false);
+      CO_PROBE5 (
+         sdo_abort,
+         net->node,
+         co_fetch_uint16 (&data[1]),
+         co_fetch_uint8 (&data[3]),
+         error,
+         0);
       return 1;
    }
 
    default:
       co_sdo_abort (net, 0x580 + net->node, 0, 0, CO_SDO_ABORT_UNKNOWN);
       LOG_ERROR (CO_SDO_LOG, "sdo unknown command (%X)\n", ccs);
-      return 1;
+      result = 1;
+      break;
    }
+
+   /* Request has been responded to. Aborted requests are counted in
+      sdo_aborts but not sampled, they would skew the latency. */
+   if (result == 0)
+   {
+      co_stats_latency (
+         net,
+         &net->stats.sdo_latency,
+         net->rx_timestamp,
+         os_tick_current());
+   }
+
+   return result;
 }
 
 int co_sdo_server_timer (co_net_t * net, os_tick_t now)
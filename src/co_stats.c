@@ -0,0 +1,150 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifdef UNIT_TEST
+#define os_tick_from_us mock_os_tick_from_us
+#endif
+
+#include "co_stats.h"
+#include "co_obj.h"
+
+#include <string.h>
+
+void co_stats_latency (
+   co_net_t * net,
+   co_histogram_t * hist,
+   os_tick_t start,
+   os_tick_t end)
+{
+   uint64_t delta = (os_tick_t)(end - start);
+   uint64_t limit = 3600000ULL * net->stats_tick_ms;
+   uint32_t us;
+   unsigned int ix;
+
+   /* Clamp to one hour, well beyond the last bucket. Ticks may be 32
+      bits, so convert in 64 bits. */
+   if (delta > limit)
+      delta = limit;
+
+   us = (uint32_t)(delta * 1000 / net->stats_tick_ms);
+   ix = (us == 0) ? 0 : 32 - __builtin_clz (us);
+   if (ix >= CO_STATS_BUCKETS)
+      ix = CO_STATS_BUCKETS - 1;
+
+   hist->bucket[ix]++;
+   if (us > hist->max)
+      hist->max = us;
+}
+
+void co_stats_init (co_net_t * net)
+{
+   memset (&net->stats, 0, sizeof (net->stats));
+   net->stats_tick_ms = os_tick_from_us (1000);
+   if (net->stats_tick_ms == 0)
+      net->stats_tick_ms = 1;
+}
+
+void co_stats_job (co_net_t * net, co_job_t * job)
+{
+   switch (job->type)
+   {
+   case CO_JOB_STATS_GET:
+      *job->stats              = net->stats;
+      job->stats->mbox_overrun = net->mbox_overrun;
+      break;
+   case CO_JOB_STATS_RESET:
+      memset (&net->stats, 0, sizeof (net->stats));
+      net->mbox_overrun = 0;
+      break;
+   default:
+      CC_ASSERT (0);
+   }
+
+   job->result = 0;
+   if (job->callback)
+      job->callback (job);
+}
+
+static uint32_t co_stats_sum (const uint32_t counter[16])
+{
+   uint32_t sum = 0;
+   unsigned int ix;
+
+   for (ix = 0; ix < 16; ix++)
+      sum += counter[ix];
+
+   return sum;
+}
+
+uint32_t co_od5F00_fn (
+   co_net_t * net,
+   od_event_t event,
+   const co_obj_t * obj,
+   const co_entry_t * entry,
+   uint8_t subindex,
+   uint32_t * value)
+{
+   const co_stats_t * stats = &net->stats;
+
+   switch (event)
+   {
+   case OD_EVENT_READ:
+      switch (subindex)
+      {
+      case 1:
+         *value = co_stats_sum (stats->rx);
+         return 0;
+      case 2:
+         *value = co_stats_sum (stats->tx);
+         return 0;
+      case 3:
+         *value = stats->tx_failed;
+         return 0;
+      case 4:
+         *value = stats->pdo_inhibited;
+         return 0;
+      case 5:
+         *value = stats->pdo_dropped;
+         return 0;
+      case 6:
+         *value = stats->sdo_transfers;
+         return 0;
+      case 7:
+         *value = stats->sdo_aborts;
+         return 0;
+      case 8:
+         *value = stats->sdo_bytes;
+         return 0;
+      case 9:
+         *value = stats->hb_expired;
+         return 0;
+      case 10:
+         *value = stats->emcy_tx;
+         return 0;
+      case 11:
+         *value = stats->emcy_rx;
+         return 0;
+      case 12:
+         *value = net->mbox_overrun;
+         return 0;
+      default:
+         return CO_SDO_ABORT_BAD_SUBINDEX;
+      }
+   case OD_EVENT_RESTORE:
+      return 0;
+   default:
+      return CO_SDO_ABORT_GENERAL;
+   }
+}
@@ -0,0 +1,130 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Runtime statistics
+ */
+
+#ifndef CO_STATS_H
+#define CO_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "co_api.h"
+#include "co_main.h"
+#include "co_capture.h"
+
+/**
+ * Send CAN frame, count and capture it
+ *
+ * Use instead of os_channel_send() for all frames sent by the
+ * stack, so that they are included in the statistics and capture.
+ *
+ * @param net           network handle
+ * @param id            CAN ID
+ * @param data          CAN message
+ * @param dlc           size of CAN message
+ *
+ * @return 0 on success, -1 on failure
+ */
+#define co_send(net, id, data, dlc)                                            \
+   co_stats_tx (                                                               \
+      (net),                                                                   \
+      (id),                                                                    \
+      (data),                                                                  \
+      (dlc),                                                                   \
+      os_channel_send ((net)->channel, (id), (data), (dlc)))
+
+/**
+ * Count frame received
+ *
+ * @param net           network handle
+ * @param id            CAN ID
+ */
+static inline void co_stats_rx (co_net_t * net, uint32_t id)
+{
+   net->stats.rx[(id & CO_FUNCTION_MASK) >> 7]++;
+}
+
+/**
+ * Count frame sent, and capture it if it was sent successfully
+ *
+ * @param net           network handle
+ * @param id            CAN ID
+ * @param data          CAN message
+ * @param dlc           size of CAN message
+ * @param status        result of os_channel_send()
+ *
+ * @return status
+ */
+static inline int co_stats_tx (
+   co_net_t * net,
+   uint32_t id,
+   const void * data,
+   size_t dlc,
+   int status)
+{
+   if (status == 0)
+   {
+      net->stats.tx[(id & CO_FUNCTION_MASK) >> 7]++;
+      co_capture_frame (net, id, data, dlc);
+   }
+   else
+   {
+      net->stats.tx_failed++;
+   }
+   return status;
+}
+
+/**
+ * Add latency sample to histogram
+ *
+ * @param net           network handle
+ * @param hist          histogram
+ * @param start         start of measured interval
+ * @param end           end of measured interval
+ */
+void co_stats_latency (
+   co_net_t * net,
+   co_histogram_t * hist,
+   os_tick_t start,
+   os_tick_t end);
+
+/**
+ * Initialise statistics
+ *
+ * @param net           network handle
+ */
+void co_stats_init (co_net_t * net);
+
+/**
+ * Statistics job
+ *
+ * This function is called from the CANopen thread to get or reset
+ * the statistics.
+ *
+ * @param net           network handle
+ * @param job           job to run
+ */
+void co_stats_job (co_net_t * net, co_job_t * job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_STATS_H */
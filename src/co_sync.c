@@ -21,6 +21,7 @@
 #include "co_sync.h"
 #include "co_pdo.h"
 #include "co_sdo.h"
+#include "co_stats.h"
 #include "co_util.h"
 
 uint32_t co_od1005_fn (
@@ -157,11 +158,7 @@ int co_sync_timer (co_net_t * net, os_tick_t now)
          {
             uint8_t msg[1];
             co_put_uint8 (msg, sync->counter);
-            os_channel_send (
-               net->channel,
-               sync->cobid & CO_EXTID_MASK,
-               msg,
-               sizeof (msg));
+            co_send (net, sync->cobid & CO_EXTID_MASK, msg, sizeof (msg));
             co_pdo_sync (net, msg, sizeof (msg));
 
             if (sync->counter++ == sync->overflow)
@@ -169,7 +166,7 @@ int co_sync_timer (co_net_t * net, os_tick_t now)
          }
          else
          {
-            os_channel_send (net->channel, sync->cobid & CO_EXTID_MASK, NULL, 0);
+            co_send (net, sync->cobid & CO_EXTID_MASK, NULL, 0);
             co_pdo_sync (net, NULL, 0);
          }
 
@@ -183,3 +180,13 @@ int co_sync_timer (co_net_t * net, os_tick_t now)
 
    return 0;
 }
+
+void co_sync_job (co_net_t * net, co_job_t * job)
+{
+   co_send (net, CO_FUNCTION_SYNC, NULL, 0);
+   co_pdo_sync (net, NULL, 0);
+
+   job->result = 0;
+   if (job->callback)
+      job->callback (job);
+}
@@ -41,6 +41,18 @@ extern "C" {
  */
 int co_sync_timer (co_net_t * net, os_tick_t now);
 
+/**
+ * SYNC job
+ *
+ * This function is called from the CANopen thread to send a SYNC
+ * message requested by the application, and to send the synchronous
+ * TPDOs.
+ *
+ * @param net           network handle
+ * @param job           job to run
+ */
+void co_sync_job (co_net_t * net, co_job_t * job);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,6 +25,13 @@ extern "C" {
 
 #include "osal.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CO_MEMORY_BARRIER() _mm_mfence()
+#else
+#define CO_MEMORY_BARRIER() __atomic_thread_fence (__ATOMIC_SEQ_CST)
+#endif
+
 static inline int co_is_expired (os_tick_t now, os_tick_t timestamp, uint32_t timeout)
 {
    os_tick_t delta = now - timestamp;
@@ -191,6 +198,40 @@ static inline void co_atomic_set_uint64 (void * data, uint64_t value)
    CC_ATOMIC_SET64 (p, value);
 }
 
+/* Atomically add value, returning the previous value */
+static inline uint32_t co_atomic_add_uint32 (void * data, uint32_t value)
+{
+   uint32_t * p = (uint32_t *)data;
+   CC_ASSERT (((uintptr_t)p & 0x03) == 0);
+#if defined(_MSC_VER)
+   return (uint32_t)_InterlockedExchangeAdd ((volatile long *)p, (long)value);
+#else
+   return __atomic_fetch_add (p, value, __ATOMIC_RELAXED);
+#endif
+}
+
+/* Atomically replace expected value with desired value, returning
+   true if successful */
+static inline bool co_atomic_cas_uint32 (void * data, uint32_t expected, uint32_t desired)
+{
+   uint32_t * p = (uint32_t *)data;
+   CC_ASSERT (((uintptr_t)p & 0x03) == 0);
+#if defined(_MSC_VER)
+   return (uint32_t)_InterlockedCompareExchange (
+             (volatile long *)p,
+             (long)desired,
+             (long)expected) == expected;
+#else
+   return __atomic_compare_exchange_n (
+      p,
+      &expected,
+      desired,
+      false,
+      __ATOMIC_SEQ_CST,
+      __ATOMIC_RELAXED);
+#endif
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -38,6 +38,7 @@ typedef struct os_channel_state
 } os_channel_state_t;
 
 os_channel_t * os_channel_open (const char * name, void * callback, void * arg);
+void os_channel_close (os_channel_t * channel);
 int os_channel_send (
    os_channel_t * channel,
    uint32_t id,
@@ -50,6 +51,7 @@ int os_channel_receive (
    void * data,
    size_t * dlc);
 int os_channel_set_bitrate (os_channel_t * channel, int bitrate);
+int os_channel_set_listen_only (os_channel_t * channel, bool enable);
 int os_channel_set_filter (os_channel_t * channel, uint8_t * filter, size_t size);
 int os_channel_bus_on (os_channel_t * channel);
 int os_channel_bus_off (os_channel_t * channel);
@@ -0,0 +1,57 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifndef COAL_LOOP_H
+#define COAL_LOOP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "coal_can.h"
+
+/* Event loop waiting for received frames on a set of channels, a
+   periodic tick and wakeups from other threads. Ports that do not
+   support event loops return NULL from os_loop_create(). Channels
+   are added from any thread, but only removed by the thread waiting
+   on the loop. */
+
+typedef struct os_loop os_loop_t;
+
+#define OS_LOOP_TICK (1U << 0) /* Periodic tick expired */
+#define OS_LOOP_WAKE (1U << 1) /* Woken by os_loop_wake() */
+
+os_loop_t * os_loop_create (uint32_t period_us);
+void os_loop_destroy (os_loop_t * loop);
+int os_loop_add (os_loop_t * loop, os_channel_t * channel, void * arg);
+void os_loop_remove (os_loop_t * loop, os_channel_t * channel);
+int os_loop_wait (
+   os_loop_t * loop,
+   uint32_t timeout_ms,
+   void ** ready,
+   size_t size,
+   uint32_t * events);
+void os_loop_wake (os_loop_t * loop);
+int os_loop_fd (os_loop_t * loop);
+int os_loop_bind (int cpu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COAL_LOOP_H */
@@ -32,7 +32,26 @@
 #include <sys/epoll.h>
 
 #include <linux/can.h>
+#include <linux/can/netlink.h>
 #include <linux/can/raw.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+/* Netlink link request */
+typedef struct os_nl_req
+{
+   struct nlmsghdr nh;
+   struct ifinfomsg ifi;
+   char attr[256];
+} os_nl_req_t;
+
+/* CAN link settings that can be changed through netlink */
+typedef struct os_can_link
+{
+   bool up;
+   uint32_t bitrate;
+   bool listen_only;
+} os_can_link_t;
 
 static void os_channel_rx (void * arg)
 {
@@ -105,6 +124,7 @@ os_channel_t * os_channel_open (const char * name, void * callback, void * arg)
 
    addr.can_family  = AF_CAN;
    addr.can_ifindex = ifr.ifr_ifindex;
+   channel->ifindex = ifr.ifr_ifindex;
 
    LOG_DEBUG (CO_CAN_LOG, "%s at index %d\n", name, ifr.ifr_ifindex);
 
@@ -118,16 +138,27 @@ os_channel_t * os_channel_open (const char * name, void * callback, void * arg)
    channel->callback = callback;
    channel->arg      = arg;
 
-   os_thread_create ("co_rx", 5, 1024, os_channel_rx, channel);
+   /* Without a callback the channel is polled, e.g. by an event loop */
+   if (callback != NULL)
+      os_thread_create ("co_rx", 5, 1024, os_channel_rx, channel);
+
    return channel;
 }
 
+void os_channel_close (os_channel_t * channel)
+{
+   /* Only polled channels are closed, a receive thread would keep
+      using the socket */
+   close (channel->handle);
+   free (channel);
+}
+
 int os_channel_send (os_channel_t * channel, uint32_t id, const void * data, size_t dlc)
 {
    struct can_frame frame;
    int n;
 
-   co_msg_log ("Tx", id, data, dlc);
+   co_trace (CO_TRACE_TX, id, data, dlc);
 
    frame.can_id = id & CO_ID_MASK;
    frame.can_id |= (id & CO_RTR_MASK) ? CAN_RTR_FLAG : 0;
@@ -161,16 +192,260 @@ int os_channel_receive (
    *dlc = frame.can_dlc;
    memcpy (data, frame.data, frame.can_dlc);
 
-   co_msg_log ("Rx", *id, data, *dlc);
+   co_trace (0, *id, data, *dlc);
 
    return 0;
 }
 
-int os_channel_set_bitrate (os_channel_t * channel, int bitrate)
+static void os_nl_init (os_nl_req_t * req, os_channel_t * channel, uint16_t type)
+{
+   memset (req, 0, sizeof (*req));
+   req->nh.nlmsg_len   = NLMSG_LENGTH (sizeof (struct ifinfomsg));
+   req->nh.nlmsg_type  = type;
+   req->nh.nlmsg_flags = NLM_F_REQUEST;
+   req->ifi.ifi_family = AF_UNSPEC;
+   req->ifi.ifi_index  = channel->ifindex;
+}
+
+/* Append attribute, returns NULL if the request is full */
+static struct rtattr * os_nl_attr_add (
+   os_nl_req_t * req,
+   uint16_t type,
+   const void * data,
+   size_t size)
+{
+   struct rtattr * rta;
+
+   if (NLMSG_ALIGN (req->nh.nlmsg_len) + RTA_SPACE (size) > sizeof (*req))
+   {
+      LOG_ERROR (CO_CAN_LOG, "netlink request too large\n");
+      return NULL;
+   }
+
+   rta           = (struct rtattr *)((char *)req + NLMSG_ALIGN (req->nh.nlmsg_len));
+   rta->rta_type = type;
+   rta->rta_len  = RTA_LENGTH (size);
+   if (size > 0)
+      memcpy (RTA_DATA (rta), data, size);
+
+   req->nh.nlmsg_len = NLMSG_ALIGN (req->nh.nlmsg_len) + RTA_ALIGN (rta->rta_len);
+   return rta;
+}
+
+static void os_nl_attr_end (os_nl_req_t * req, struct rtattr * nest)
+{
+   nest->rta_len = (char *)req + req->nh.nlmsg_len - (char *)nest;
+}
+
+static struct rtattr * os_nl_attr_find (struct rtattr * rta, int size, uint16_t type)
 {
+   for (; RTA_OK (rta, size); rta = RTA_NEXT (rta, size))
+   {
+      if (rta->rta_type == type)
+         return rta;
+   }
+   return NULL;
+}
+
+/* Send request and receive reply, or acknowledge if requested.
+   Returns the negative errno reported by the kernel, or -1. */
+static int os_nl_talk (os_nl_req_t * req, void * reply, size_t size)
+{
+   struct sockaddr_nl addr;
+   struct nlmsghdr * nh = reply;
+   struct nlmsgerr * err;
+   ssize_t n;
+   int fd;
+
+   fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+   if (fd < 0)
+      return -1;
+
+   memset (&addr, 0, sizeof (addr));
+   addr.nl_family = AF_NETLINK;
+
+   n = sendto (fd, req, req->nh.nlmsg_len, 0, (struct sockaddr *)&addr, sizeof (addr));
+   if (n < 0)
+   {
+      close (fd);
+      return -1;
+   }
+
+   n = recv (fd, reply, size, 0);
+   close (fd);
+
+   if (n < 0 || !NLMSG_OK (nh, (size_t)n))
+      return -1;
+
+   if (nh->nlmsg_type == NLMSG_ERROR)
+   {
+      err = NLMSG_DATA (nh);
+      if (err->error != 0)
+      {
+         LOG_DEBUG (CO_CAN_LOG, "netlink error %d\n", err->error);
+         return (err->error < 0) ? err->error : -1;
+      }
+   }
+
+   return 0;
+}
+
+static int os_channel_get_link (os_channel_t * channel, os_can_link_t * link)
+{
+   os_nl_req_t req;
+   char reply[8192];
+   struct nlmsghdr * nh = (struct nlmsghdr *)reply;
+   struct ifinfomsg * ifi;
+   struct rtattr * info;
+   struct rtattr * rta;
+   struct can_bittiming bt;
+   struct can_ctrlmode cm;
+
+   os_nl_init (&req, channel, RTM_GETLINK);
+   if (os_nl_talk (&req, reply, sizeof (reply)) < 0)
+      return -1;
+
+   if (nh->nlmsg_type != RTM_NEWLINK)
+      return -1;
+
+   ifi = NLMSG_DATA (nh);
+   memset (link, 0, sizeof (*link));
+   link->up = ifi->ifi_flags & IFF_UP;
+
+   /* CAN settings are only present for CAN controllers, not vcan */
+   info = os_nl_attr_find (IFLA_RTA (ifi), IFLA_PAYLOAD (nh), IFLA_LINKINFO);
+   if (info != NULL)
+      info = os_nl_attr_find (RTA_DATA (info), RTA_PAYLOAD (info), IFLA_INFO_DATA);
+   if (info == NULL)
+   {
+      LOG_ERROR (CO_CAN_LOG, "interface has no CAN settings, e.g. vcan\n");
+      return -1;
+   }
+
+   rta = os_nl_attr_find (RTA_DATA (info), RTA_PAYLOAD (info), IFLA_CAN_BITTIMING);
+   if (rta != NULL && RTA_PAYLOAD (rta) >= sizeof (bt))
+   {
+      memcpy (&bt, RTA_DATA (rta), sizeof (bt));
+      link->bitrate = bt.bitrate;
+   }
+
+   rta = os_nl_attr_find (RTA_DATA (info), RTA_PAYLOAD (info), IFLA_CAN_CTRLMODE);
+   if (rta != NULL && RTA_PAYLOAD (rta) >= sizeof (cm))
+   {
+      memcpy (&cm, RTA_DATA (rta), sizeof (cm));
+      link->listen_only = cm.flags & CAN_CTRLMODE_LISTENONLY;
+   }
+
    return 0;
 }
 
+static int os_channel_set_up (os_channel_t * channel, bool up)
+{
+   os_nl_req_t req;
+   char ack[1024];
+
+   os_nl_init (&req, channel, RTM_NEWLINK);
+   req.nh.nlmsg_flags |= NLM_F_ACK;
+   req.ifi.ifi_change = IFF_UP;
+   req.ifi.ifi_flags  = up ? IFF_UP : 0;
+
+   return os_nl_talk (&req, ack, sizeof (ack));
+}
+
+/* Apply CAN settings. The interface must be down while they change. */
+static int os_channel_set_link (os_channel_t * channel, const os_can_link_t * link)
+{
+   os_nl_req_t req;
+   char ack[1024];
+   struct rtattr * linkinfo;
+   struct rtattr * data;
+   struct can_bittiming bt;
+   struct can_ctrlmode cm;
+   int status;
+
+   memset (&bt, 0, sizeof (bt));
+   bt.bitrate = link->bitrate;
+
+   cm.mask  = CAN_CTRLMODE_LISTENONLY;
+   cm.flags = link->listen_only ? CAN_CTRLMODE_LISTENONLY : 0;
+
+   os_nl_init (&req, channel, RTM_NEWLINK);
+   req.nh.nlmsg_flags |= NLM_F_ACK;
+   linkinfo = os_nl_attr_add (&req, IFLA_LINKINFO, NULL, 0);
+   if (linkinfo == NULL)
+      return -1;
+   if (os_nl_attr_add (&req, IFLA_INFO_KIND, "can", strlen ("can")) == NULL)
+      return -1;
+   data = os_nl_attr_add (&req, IFLA_INFO_DATA, NULL, 0);
+   if (data == NULL)
+      return -1;
+   if (
+      link->bitrate != 0 &&
+      os_nl_attr_add (&req, IFLA_CAN_BITTIMING, &bt, sizeof (bt)) == NULL)
+      return -1;
+   if (os_nl_attr_add (&req, IFLA_CAN_CTRLMODE, &cm, sizeof (cm)) == NULL)
+      return -1;
+   os_nl_attr_end (&req, data);
+   os_nl_attr_end (&req, linkinfo);
+
+   if (link->up)
+   {
+      status = os_channel_set_up (channel, false);
+      if (status < 0)
+      {
+         if (status == -EPERM)
+            LOG_ERROR (CO_CAN_LOG, "CAN settings require CAP_NET_ADMIN\n");
+         return -1;
+      }
+   }
+
+   status = os_nl_talk (&req, ack, sizeof (ack));
+   if (status < 0)
+      LOG_ERROR (CO_CAN_LOG, "failed to change CAN settings (%d)\n", status);
+
+   if (link->up && os_channel_set_up (channel, true) < 0)
+   {
+      LOG_ERROR (CO_CAN_LOG, "failed to restart interface\n");
+      return -1;
+   }
+
+   return (status < 0) ? -1 : 0;
+}
+
+/* Bitrate and listen-only mode are changed through netlink, which
+   requires CAP_NET_ADMIN since the interface is restarted. They
+   cannot be changed on vcan interfaces, which have no CAN settings. */
+int os_channel_set_bitrate (os_channel_t * channel, int bitrate)
+{
+   os_can_link_t link;
+
+   if (os_channel_get_link (channel, &link) < 0)
+      return -1;
+
+   /* Avoid restarting the interface if bitrate is unchanged */
+   if (link.bitrate == (uint32_t)bitrate)
+      return 0;
+
+   LOG_DEBUG (CO_CAN_LOG, "bitrate %d\n", bitrate);
+   link.bitrate = bitrate;
+   return os_channel_set_link (channel, &link);
+}
+
+int os_channel_set_listen_only (os_channel_t * channel, bool enable)
+{
+   os_can_link_t link;
+
+   if (os_channel_get_link (channel, &link) < 0)
+      return -1;
+
+   if (link.listen_only == enable)
+      return 0;
+
+   LOG_DEBUG (CO_CAN_LOG, "listen-only %d\n", enable);
+   link.listen_only = enable;
+   return os_channel_set_link (channel, &link);
+}
+
 int os_channel_set_filter (os_channel_t * channel, uint8_t * filter, size_t size)
 {
    return 0;
@@ -25,6 +25,7 @@ extern "C" {
 typedef struct
 {
    int handle;
+   int ifindex;
    void (*callback) (void * arg);
    void * arg;
 } os_channel_t;
@@ -0,0 +1,217 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* For pthread_setaffinity_np */
+#endif
+
+#include "coal_loop.h"
+#include "osal.h"
+#include "osal_log.h"
+#include "options.h"
+#include "co_log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+/* Maximum number of events handled per wait */
+#define OS_LOOP_EVENTS 16
+
+struct os_loop
+{
+   int epollfd;
+   int eventfd;
+   int timerfd;
+};
+
+static int os_loop_watch (os_loop_t * loop, int fd, void * ptr)
+{
+   struct epoll_event ev;
+
+   ev.events   = EPOLLIN;
+   ev.data.ptr = ptr;
+   return epoll_ctl (loop->epollfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+os_loop_t * os_loop_create (uint32_t period_us)
+{
+   os_loop_t * loop = malloc (sizeof (*loop));
+
+   if (loop == NULL)
+      return NULL;
+
+   loop->timerfd = -1;
+   loop->eventfd = -1;
+   loop->epollfd = epoll_create1 (EPOLL_CLOEXEC);
+   if (loop->epollfd == -1)
+   {
+      LOG_ERROR (CO_CAN_LOG, "epoll_create1 failed\n");
+      goto error;
+   }
+
+   /* Wakeups are identified by the loop itself */
+   loop->eventfd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+   if (loop->eventfd == -1 || os_loop_watch (loop, loop->eventfd, loop) == -1)
+   {
+      LOG_ERROR (CO_CAN_LOG, "eventfd failed\n");
+      goto error;
+   }
+
+   /* Ticks are identified by the timer descriptor */
+   if (period_us > 0)
+   {
+      struct itimerspec spec;
+
+      spec.it_interval.tv_sec  = period_us / 1000000;
+      spec.it_interval.tv_nsec = (period_us % 1000000) * 1000;
+      spec.it_value            = spec.it_interval;
+
+      loop->timerfd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+      if (
+         loop->timerfd == -1 ||
+         timerfd_settime (loop->timerfd, 0, &spec, NULL) == -1 ||
+         os_loop_watch (loop, loop->timerfd, &loop->timerfd) == -1)
+      {
+         LOG_ERROR (CO_CAN_LOG, "timerfd failed\n");
+         goto error;
+      }
+   }
+
+   return loop;
+
+error:
+   os_loop_destroy (loop);
+   return NULL;
+}
+
+void os_loop_destroy (os_loop_t * loop)
+{
+   if (loop->timerfd != -1)
+      close (loop->timerfd);
+   if (loop->eventfd != -1)
+      close (loop->eventfd);
+   if (loop->epollfd != -1)
+      close (loop->epollfd);
+   free (loop);
+}
+
+int os_loop_add (os_loop_t * loop, os_channel_t * channel, void * arg)
+{
+   /* Level-triggered, the owner reads until the socket is empty */
+   if (os_loop_watch (loop, channel->handle, arg) == -1)
+   {
+      LOG_ERROR (CO_CAN_LOG, "epoll_ctl failed\n");
+      return -1;
+   }
+
+   return 0;
+}
+
+void os_loop_remove (os_loop_t * loop, os_channel_t * channel)
+{
+   if (epoll_ctl (loop->epollfd, EPOLL_CTL_DEL, channel->handle, NULL) == -1)
+   {
+      LOG_ERROR (CO_CAN_LOG, "epoll_ctl failed\n");
+   }
+}
+
+int os_loop_wait (
+   os_loop_t * loop,
+   uint32_t timeout_ms,
+   void ** ready,
+   size_t size,
+   uint32_t * events)
+{
+   struct epoll_event ev[OS_LOOP_EVENTS];
+   uint64_t count;
+   int nfds;
+   int n;
+   int ix = 0;
+
+   *events = 0;
+
+   nfds = epoll_wait (
+      loop->epollfd,
+      ev,
+      NELEMENTS (ev),
+      (timeout_ms == OS_WAIT_FOREVER) ? -1 : (int)timeout_ms);
+   if (nfds == -1)
+   {
+      if (errno == EINTR)
+         return 0;
+
+      LOG_ERROR (CO_CAN_LOG, "epoll_wait failed\n");
+      return -1;
+   }
+
+   for (n = 0; n < nfds; n++)
+   {
+      if (ev[n].data.ptr == loop)
+      {
+         if (read (loop->eventfd, &count, sizeof (count)) == sizeof (count))
+            *events |= OS_LOOP_WAKE;
+      }
+      else if (ev[n].data.ptr == &loop->timerfd)
+      {
+         if (read (loop->timerfd, &count, sizeof (count)) == sizeof (count))
+            *events |= OS_LOOP_TICK;
+      }
+      else if ((size_t)ix < size)
+      {
+         ready[ix++] = ev[n].data.ptr;
+      }
+   }
+
+   return ix;
+}
+
+void os_loop_wake (os_loop_t * loop)
+{
+   uint64_t one = 1;
+
+   if (write (loop->eventfd, &one, sizeof (one)) != sizeof (one))
+   {
+      LOG_ERROR (CO_CAN_LOG, "eventfd write failed\n");
+   }
+}
+
+int os_loop_fd (os_loop_t * loop)
+{
+   /* The epoll descriptor is readable when any watched descriptor is */
+   return loop->epollfd;
+}
+
+int os_loop_bind (int cpu)
+{
+   cpu_set_t set;
+
+   CPU_ZERO (&set);
+   CPU_SET (cpu, &set);
+
+   if (pthread_setaffinity_np (pthread_self(), sizeof (set), &set) != 0)
+   {
+      LOG_ERROR (CO_CAN_LOG, "failed to bind to cpu %d\n", cpu);
+      return -1;
+   }
+
+   return 0;
+}
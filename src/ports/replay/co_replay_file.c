@@ -0,0 +1,277 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_replay_file.h"
+#include "co_main.h"
+#include "co_util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* pcap magic numbers, microsecond and nanosecond resolution, as read
+   from a little-endian and from a big-endian file */
+#define CO_REPLAY_PCAP_MAGIC       0xA1B2C3D4
+#define CO_REPLAY_PCAP_MAGIC_NS    0xA1B23C4D
+#define CO_REPLAY_PCAP_MAGIC_BE    0xD4C3B2A1
+#define CO_REPLAY_PCAP_MAGIC_NS_BE 0x4D3CB2A1
+
+/* pcap link type for SocketCAN frames */
+#define CO_REPLAY_LINKTYPE_CAN_SOCKETCAN 227
+
+/* Size of struct can_frame, and of struct canfd_frame */
+#define CO_REPLAY_CAN_FRAME_SIZE   16
+#define CO_REPLAY_CANFD_FRAME_SIZE 72
+
+/* SocketCAN CAN ID flags */
+#define CO_REPLAY_CAN_EFF_FLAG 0x80000000
+#define CO_REPLAY_CAN_RTR_FLAG 0x40000000
+#define CO_REPLAY_CAN_ERR_FLAG 0x20000000
+
+static uint32_t co_replay_fetch_uint32 (const co_replay_file_t * replay, const uint8_t * p)
+{
+   if (replay->big_endian)
+      return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+   return co_fetch_uint32 (p);
+}
+
+static int co_replay_hex (char c)
+{
+   if (c >= '0' && c <= '9')
+      return c - '0';
+   if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+   if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+   return -1;
+}
+
+int co_replay_file_open (co_replay_file_t * replay, FILE * file)
+{
+   uint8_t header[24];
+   uint32_t magic;
+
+   memset (replay, 0, sizeof (*replay));
+   replay->file = file;
+
+   if (fread (header, 1, sizeof (header), file) == sizeof (header))
+   {
+      magic = co_fetch_uint32 (header);
+      if (magic == CO_REPLAY_PCAP_MAGIC || magic == CO_REPLAY_PCAP_MAGIC_NS)
+      {
+         replay->pcap = true;
+      }
+      else if (magic == CO_REPLAY_PCAP_MAGIC_BE || magic == CO_REPLAY_PCAP_MAGIC_NS_BE)
+      {
+         replay->pcap       = true;
+         replay->big_endian = true;
+      }
+   }
+
+   if (!replay->pcap)
+   {
+      /* candump log */
+      return fseek (file, 0, SEEK_SET);
+   }
+
+   magic           = co_replay_fetch_uint32 (replay, header);
+   replay->divisor = (magic == CO_REPLAY_PCAP_MAGIC_NS) ? 1000 : 1;
+
+   if (co_replay_fetch_uint32 (replay, &header[20]) != CO_REPLAY_LINKTYPE_CAN_SOCKETCAN)
+      return -1;
+
+   return 0;
+}
+
+/* Parse candump log line, e.g. "(1436509052.249713) can0 044#2A366C". */
+static int co_replay_parse (const char * line, co_replay_frame_t * frame)
+{
+   unsigned long long sec;
+   char fraction[16];
+   char iface[32];
+   char text[80];
+   const char * p;
+   char * end;
+   unsigned long id;
+   size_t ix;
+   uint32_t us = 0;
+
+   if (sscanf (line, " (%llu.%15[0-9]) %31s %79s", &sec, fraction, iface, text) != 4)
+      return -1;
+
+   /* Fraction may have any number of digits */
+   for (ix = 0; ix < 6; ix++)
+   {
+      us = us * 10 + ((ix < strlen (fraction)) ? fraction[ix] - '0' : 0);
+   }
+   frame->timestamp = (uint64_t)sec * 1000000 + us;
+
+   p = strchr (text, '#');
+   if (p == NULL || p[1] == '#')
+      return -1; /* Not a frame, or CAN FD frame */
+
+   id = strtoul (text, &end, 16);
+   if (end != p)
+      return -1;
+
+   if (p - text == 3 && id <= 0x7FF)
+      frame->id = (uint32_t)id;
+   else if (p - text == 8 && id <= CO_ID_MASK)
+      frame->id = (uint32_t)id | CO_EXT_MASK;
+   else
+      return -1; /* Error frame or malformed */
+
+   p++;
+   memset (frame->data, 0, sizeof (frame->data));
+   frame->dlc = 0;
+
+   if (*p == 'R')
+   {
+      frame->id |= CO_RTR_MASK;
+      if (p[1] >= '0' && p[1] <= '8')
+         frame->dlc = (uint8_t)(p[1] - '0');
+      return 0;
+   }
+
+   while (*p != '\0')
+   {
+      int hi = co_replay_hex (p[0]);
+      int lo = (hi < 0) ? -1 : co_replay_hex (p[1]);
+
+      if (lo < 0 || frame->dlc == sizeof (frame->data))
+         return -1;
+
+      frame->data[frame->dlc++] = (uint8_t)(hi << 4 | lo);
+      p += 2;
+   }
+
+   return 0;
+}
+
+static int co_replay_read_candump (co_replay_file_t * replay, co_replay_frame_t * frame)
+{
+   char line[CO_REPLAY_LINE_SIZE];
+
+   while (fgets (line, sizeof (line), replay->file) != NULL)
+   {
+      /* Discard rest of overlong line */
+      if (strchr (line, '\n') == NULL && !feof (replay->file))
+      {
+         int c;
+         do
+         {
+            c = fgetc (replay->file);
+         } while (c != '\n' && c != EOF);
+         continue;
+      }
+
+      if (co_replay_parse (line, frame) == 0)
+         return 0;
+   }
+
+   return -1;
+}
+
+static int co_replay_read_pcap (co_replay_file_t * replay, co_replay_frame_t * frame)
+{
+   uint8_t header[16];
+   uint8_t data[CO_REPLAY_CANFD_FRAME_SIZE];
+   uint32_t size;
+   uint32_t id;
+
+   while (fread (header, 1, sizeof (header), replay->file) == sizeof (header))
+   {
+      size = co_replay_fetch_uint32 (replay, &header[8]);
+      if (size > sizeof (data))
+      {
+         if (fseek (replay->file, size, SEEK_CUR) != 0)
+            return -1;
+         continue;
+      }
+
+      if (fread (data, 1, size, replay->file) != size)
+         return -1;
+
+      /* Skip CAN FD frames */
+      if (size != CO_REPLAY_CAN_FRAME_SIZE || data[4] > 8)
+         continue;
+
+      /* CAN ID is in network byte order */
+      id = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+           ((uint32_t)data[2] << 8) | data[3];
+      if (id & CO_REPLAY_CAN_ERR_FLAG)
+         continue;
+
+      frame->id = id & CO_ID_MASK;
+      if (id & CO_REPLAY_CAN_EFF_FLAG)
+         frame->id |= CO_EXT_MASK;
+      if (id & CO_REPLAY_CAN_RTR_FLAG)
+         frame->id |= CO_RTR_MASK;
+
+      frame->timestamp = (uint64_t)co_replay_fetch_uint32 (replay, &header[0]) * 1000000 +
+                         co_replay_fetch_uint32 (replay, &header[4]) / replay->divisor;
+      frame->dlc       = data[4];
+      memset (frame->data, 0, sizeof (frame->data));
+      if (!(frame->id & CO_RTR_MASK))
+         memcpy (frame->data, &data[8], frame->dlc);
+      return 0;
+   }
+
+   return -1;
+}
+
+int co_replay_file_read (co_replay_file_t * replay, co_replay_frame_t * frame)
+{
+   if (replay->pcap)
+      return co_replay_read_pcap (replay, frame);
+   else
+      return co_replay_read_candump (replay, frame);
+}
+
+size_t co_replay_file_format (
+   char * s,
+   const char * iface,
+   const co_replay_frame_t * frame)
+{
+   char * p = s;
+   unsigned int ix;
+
+   p += sprintf (
+      p,
+      "(%010llu.%06llu) %.31s ",
+      (unsigned long long)(frame->timestamp / 1000000),
+      (unsigned long long)(frame->timestamp % 1000000),
+      iface);
+
+   if (frame->id & CO_EXT_MASK)
+      p += sprintf (p, "%08lX#", (unsigned long)(frame->id & CO_ID_MASK));
+   else
+      p += sprintf (p, "%03lX#", (unsigned long)(frame->id & CO_ID_MASK));
+
+   if (frame->id & CO_RTR_MASK)
+   {
+      p += sprintf (p, "R");
+   }
+   else
+   {
+      for (ix = 0; ix < frame->dlc && ix < sizeof (frame->data); ix++)
+      {
+         p += sprintf (p, "%02X", frame->data[ix]);
+      }
+   }
+
+   *p++ = '\n';
+   *p   = '\0';
+   return p - s;
+}
@@ -0,0 +1,99 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Reading and writing of recorded CAN frames
+ */
+
+#ifndef CO_REPLAY_FILE_H
+#define CO_REPLAY_FILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** Max size of candump log line */
+#define CO_REPLAY_LINE_SIZE 128
+
+/** Recorded frame */
+typedef struct co_replay_frame
+{
+   uint64_t timestamp; /**< Time in microseconds */
+   uint32_t id;        /**< CAN ID, with CO_RTR_MASK and CO_EXT_MASK */
+   uint8_t dlc;        /**< Size of CAN message */
+   uint8_t data[8];    /**< CAN message */
+} co_replay_frame_t;
+
+/** Recording being read */
+typedef struct co_replay_file
+{
+   FILE * file;
+   bool pcap;        /**< pcap file, else candump log */
+   bool big_endian;  /**< pcap file is big-endian */
+   uint32_t divisor; /**< pcap timestamp fraction per microsecond */
+} co_replay_file_t;
+
+/**
+ * Open recording
+ *
+ * This function detects the file format and reads the pcap header,
+ * if any. The file must be seekable.
+ *
+ * @param replay        recording
+ * @param file          open file
+ *
+ * @return 0 on success, -1 if the pcap link type is not
+ *         LINKTYPE_CAN_SOCKETCAN
+ */
+int co_replay_file_open (co_replay_file_t * replay, FILE * file);
+
+/**
+ * Read next frame
+ *
+ * Lines or records that are not classic CAN frames, such as comments,
+ * CAN FD frames and error frames, are skipped.
+ *
+ * @param replay        recording
+ * @param frame         frame read
+ *
+ * @return 0 on success, -1 at end of file
+ */
+int co_replay_file_read (co_replay_file_t * replay, co_replay_frame_t * frame);
+
+/**
+ * Format frame as candump log line
+ *
+ * @param s             line, at least CO_REPLAY_LINE_SIZE bytes
+ * @param iface         interface name
+ * @param frame         frame
+ *
+ * @return length of line, including newline
+ */
+size_t co_replay_file_format (
+   char * s,
+   const char * iface,
+   const co_replay_frame_t * frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CO_REPLAY_FILE_H */
@@ -0,0 +1,263 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "coal_can.h"
+#include "osal.h"
+#include "options.h"
+#include "osal_log.h"
+#include "co_log.h"
+#include "co_main.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Configured replays */
+static struct
+{
+   char name[64];
+   co_replay_cfg_t cfg;
+} co_replay_cfgs[CO_REPLAY_FILES];
+
+int co_replay_configure (const char * name, const co_replay_cfg_t * cfg)
+{
+   size_t ix;
+
+   for (ix = 0; ix < NELEMENTS (co_replay_cfgs); ix++)
+   {
+      if (
+         co_replay_cfgs[ix].name[0] == '\0' ||
+         strcmp (co_replay_cfgs[ix].name, name) == 0)
+      {
+         if (strlen (name) >= sizeof (co_replay_cfgs[ix].name))
+            return -1;
+
+         strcpy (co_replay_cfgs[ix].name, name);
+         co_replay_cfgs[ix].cfg = *cfg;
+         return 0;
+      }
+   }
+
+   return -1;
+}
+
+/* Load next frame to replay. Returns false at end of file. */
+static bool co_replay_load (os_channel_t * channel)
+{
+   co_replay_frame_t * frame = &channel->next;
+
+   while (!channel->loaded && !channel->eof)
+   {
+      if (co_replay_file_read (&channel->replay, frame) < 0)
+      {
+         LOG_INFO (CO_CAN_LOG, "replay done, %llu frames\n", (unsigned long long)channel->frames);
+
+         channel->eof = true;
+         fclose (channel->replay.file);
+         if (channel->cfg.done != NULL)
+            channel->cfg.done (channel->cfg.arg, channel->frames);
+         break;
+      }
+
+      /* Captured stack events were never on the bus */
+      if (
+         frame->id == (CO_EXT_MASK | CO_CAPTURE_EVENT_NMT) ||
+         frame->id == (CO_EXT_MASK | CO_CAPTURE_EVENT_SDO_ABORT))
+         continue;
+
+      if (channel->cfg.filter != NULL && !channel->cfg.filter (channel->cfg.arg, frame->id))
+         continue;
+
+      channel->loaded = true;
+   }
+
+   return channel->loaded;
+}
+
+bool co_replay_pending (os_channel_t * channel, uint64_t * wait)
+{
+   os_tick_t now;
+   uint64_t elapsed;
+   uint64_t due;
+
+   *wait = UINT64_MAX;
+
+   if (!channel->enabled || !co_replay_load (channel))
+      return false;
+
+   if (channel->cfg.pacing == CO_REPLAY_FAST)
+      return true;
+
+   now = os_tick_current();
+   if (!channel->started)
+   {
+      channel->started = true;
+      channel->start   = now;
+      channel->origin  = channel->next.timestamp;
+   }
+
+   elapsed = (uint64_t)(now - channel->start) * 1000 / os_tick_from_us (1000);
+   due     = (channel->next.timestamp > channel->origin)
+                ? channel->next.timestamp - channel->origin
+                : 0;
+
+   if (due <= elapsed)
+      return true;
+
+   *wait = due - elapsed;
+   return false;
+}
+
+os_channel_t * os_channel_open (const char * name, void * callback, void * arg)
+{
+   os_channel_t * channel;
+   FILE * file;
+   size_t ix;
+
+   /* Readiness is only reported through the event loop */
+   if (callback != NULL)
+   {
+      LOG_ERROR (CO_CAN_LOG, "replay requires an event loop\n");
+      return NULL;
+   }
+
+   channel = calloc (1, sizeof (*channel));
+   if (channel == NULL)
+      return NULL;
+
+   for (ix = 0; ix < NELEMENTS (co_replay_cfgs); ix++)
+   {
+      if (strcmp (co_replay_cfgs[ix].name, name) == 0)
+         channel->cfg = co_replay_cfgs[ix].cfg;
+   }
+
+   file = fopen (name, "rb");
+   if (file == NULL)
+   {
+      LOG_ERROR (CO_CAN_LOG, "failed to open %s\n", name);
+      free (channel);
+      return NULL;
+   }
+
+   if (co_replay_file_open (&channel->replay, file) < 0)
+   {
+      LOG_ERROR (CO_CAN_LOG, "%s is not a CAN recording\n", name);
+      fclose (file);
+      free (channel);
+      return NULL;
+   }
+
+   LOG_DEBUG (CO_CAN_LOG, "%s opened\n", name);
+   return channel;
+}
+
+void os_channel_close (os_channel_t * channel)
+{
+   /* File is closed when the replay is done */
+   if (!channel->eof)
+      fclose (channel->replay.file);
+   free (channel);
+}
+
+int os_channel_send (os_channel_t * channel, uint32_t id, const void * data, size_t dlc)
+{
+   co_replay_frame_t frame;
+   char line[CO_REPLAY_LINE_SIZE];
+   size_t size;
+
+   co_trace (CO_TRACE_TX, id, data, dlc);
+
+   if (!channel->enabled)
+      return -1;
+
+   if (channel->cfg.write == NULL)
+      return 0;
+
+   if (dlc > sizeof (frame.data))
+      dlc = sizeof (frame.data);
+
+   frame.timestamp = channel->now;
+   frame.id        = id;
+   frame.dlc       = (uint8_t)dlc;
+   memset (frame.data, 0, sizeof (frame.data));
+   if (data != NULL && !(id & CO_RTR_MASK))
+      memcpy (frame.data, data, dlc);
+
+   size = co_replay_file_format (line, "co", &frame);
+   if (channel->cfg.write (channel->cfg.arg, line, size) < 0)
+      return -1;
+
+   return 0;
+}
+
+int os_channel_receive (
+   os_channel_t * channel,
+   uint32_t * id,
+   void * data,
+   size_t * dlc)
+{
+   uint64_t wait;
+
+   if (channel->budget == 0 || !co_replay_pending (channel, &wait))
+      return -1;
+
+   channel->budget--;
+   channel->loaded = false;
+   channel->now    = channel->next.timestamp;
+   channel->frames++;
+
+   *id  = channel->next.id;
+   *dlc = channel->next.dlc;
+   memcpy (data, channel->next.data, sizeof (channel->next.data));
+
+   co_trace (0, *id, data, *dlc);
+
+   return 0;
+}
+
+int os_channel_set_bitrate (os_channel_t * channel, int bitrate)
+{
+   /* Bitrate is a property of the recording */
+   return 0;
+}
+
+int os_channel_set_listen_only (os_channel_t * channel, bool enable)
+{
+   return 0;
+}
+
+int os_channel_set_filter (os_channel_t * channel, uint8_t * filter, size_t size)
+{
+   return 0;
+}
+
+int os_channel_bus_on (os_channel_t * channel)
+{
+   channel->enabled = true;
+   return 0;
+}
+
+int os_channel_bus_off (os_channel_t * channel)
+{
+   channel->enabled = false;
+   return 0;
+}
+
+int os_channel_get_state (os_channel_t * channel, os_channel_state_t * state)
+{
+   state->overrun       = false;
+   state->error_passive = false;
+   state->bus_off       = false;
+   return 0;
+}
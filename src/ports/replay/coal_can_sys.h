@@ -0,0 +1,58 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifndef COAL_CAN_SYS_H
+#define COAL_CAN_SYS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "co_replay.h"
+#include "co_replay_file.h"
+#include "osal.h"
+
+#define OS_CHANNEL
+
+/* Number of frames received per readiness report of the loop. Keeps
+   timers and jobs running when replaying as fast as possible. */
+#define CO_REPLAY_BATCH 32
+
+/* Channels replay a recording, see co_replay.h */
+typedef struct os_channel
+{
+   co_replay_cfg_t cfg;
+   co_replay_file_t replay;
+   co_replay_frame_t next; /* Next frame to receive, if loaded */
+   bool loaded;
+   bool eof;
+   bool enabled;
+   bool started;        /* Real-time pacing has started */
+   os_tick_t start;     /* Time when first frame was due */
+   uint64_t origin;     /* Recorded time of first frame */
+   uint64_t now;        /* Recorded time of last frame received */
+   uint64_t frames;     /* Number of frames received */
+   unsigned int budget; /* Frames left in current batch */
+} os_channel_t;
+
+/* Check if next frame is due. Otherwise, wait is set to the time in
+   microseconds until it is due, or UINT64_MAX at end of file. */
+bool co_replay_pending (os_channel_t * channel, uint64_t * wait);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COAL_CAN_SYS_H */
@@ -0,0 +1,200 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "coal_loop.h"
+#include "osal.h"
+#include "osal_log.h"
+#include "options.h"
+#include "co_log.h"
+
+#include <stdlib.h>
+
+/* Event bits */
+#define OS_LOOP_EVENT_WAKE (1U << 0)
+
+/* Max number of channels per loop */
+#define OS_LOOP_CHANNELS CO_REPLAY_FILES
+
+/* Channels are polled. A channel is ready while its next frame is
+   due, waits are bounded by the time until the next frame is due. */
+
+typedef struct os_loop_channel
+{
+   os_channel_t * channel;
+   void * arg;
+} os_loop_channel_t;
+
+struct os_loop
+{
+   os_event_t * event;
+   os_tick_t period;
+   os_tick_t timestamp; /* Start of current period */
+   size_t count;
+   os_loop_channel_t channels[OS_LOOP_CHANNELS];
+};
+
+os_loop_t * os_loop_create (uint32_t period_us)
+{
+   os_loop_t * loop = calloc (1, sizeof (*loop));
+
+   if (loop == NULL)
+      return NULL;
+
+   loop->event = os_event_create();
+   if (loop->event == NULL)
+   {
+      LOG_ERROR (CO_CAN_LOG, "failed to create loop event\n");
+      free (loop);
+      return NULL;
+   }
+
+   if (period_us > 0)
+   {
+      loop->period   = os_tick_from_us (period_us);
+      loop->timestamp = os_tick_current();
+   }
+
+   return loop;
+}
+
+void os_loop_destroy (os_loop_t * loop)
+{
+   os_event_destroy (loop->event);
+   free (loop);
+}
+
+int os_loop_add (os_loop_t * loop, os_channel_t * channel, void * arg)
+{
+   if (loop->count == NELEMENTS (loop->channels))
+   {
+      LOG_ERROR (CO_CAN_LOG, "too many channels in loop\n");
+      return -1;
+   }
+
+   loop->channels[loop->count].channel = channel;
+   loop->channels[loop->count].arg     = arg;
+   loop->count++;
+   return 0;
+}
+
+void os_loop_remove (os_loop_t * loop, os_channel_t * channel)
+{
+   size_t ix;
+
+   for (ix = 0; ix < loop->count; ix++)
+   {
+      if (loop->channels[ix].channel == channel)
+      {
+         loop->channels[ix] = loop->channels[--loop->count];
+         break;
+      }
+   }
+}
+
+int os_loop_wait (
+   os_loop_t * loop,
+   uint32_t timeout_ms,
+   void ** ready,
+   size_t size,
+   uint32_t * events)
+{
+   os_tick_t ms      = os_tick_from_us (1000);
+   os_tick_t start   = os_tick_current();
+   os_tick_t timeout = timeout_ms * ms;
+   uint32_t value;
+   int ix;
+
+   *events = 0;
+
+   for (;;)
+   {
+      /* Ticks wrap, only differences are compared */
+      os_tick_t now     = os_tick_current();
+      os_tick_t elapsed = now - start;
+      os_tick_t wait    = (elapsed < timeout) ? timeout - elapsed : 0;
+      size_t n;
+
+      if (timeout_ms == OS_WAIT_FOREVER)
+         wait = UINT32_MAX * ms;
+
+      value = 0;
+      os_event_wait (loop->event, OS_LOOP_EVENT_WAKE, &value, 0);
+      os_event_clr (loop->event, value);
+      if (value & OS_LOOP_EVENT_WAKE)
+         *events |= OS_LOOP_WAKE;
+
+      if (loop->period > 0)
+      {
+         elapsed = now - loop->timestamp;
+         if (elapsed >= loop->period)
+         {
+            /* Missed ticks are not made up for */
+            *events |= OS_LOOP_TICK;
+            loop->timestamp += elapsed - elapsed % loop->period;
+            elapsed %= loop->period;
+         }
+
+         wait = MIN (wait, loop->period - elapsed);
+      }
+
+      ix = 0;
+      for (n = 0; n < loop->count; n++)
+      {
+         os_channel_t * channel = loop->channels[n].channel;
+         uint64_t next;
+
+         /* Start a new batch, see os_channel_receive() */
+         channel->budget = CO_REPLAY_BATCH;
+
+         if (co_replay_pending (channel, &next))
+         {
+            if ((size_t)ix < size)
+               ready[ix++] = loop->channels[n].arg;
+         }
+         else if (next != UINT64_MAX)
+         {
+            wait = MIN (wait, os_tick_from_us ((uint32_t)MIN (next, 1000000)));
+         }
+      }
+
+      if (ix > 0 || *events != 0 || wait == 0)
+         return ix;
+
+      if (wait >= ms)
+      {
+         os_event_wait (loop->event, OS_LOOP_EVENT_WAKE, &value, (uint32_t)(wait / ms));
+      }
+      else
+      {
+         os_usleep ((uint32_t)(wait * 1000 / ms));
+      }
+   }
+}
+
+void os_loop_wake (os_loop_t * loop)
+{
+   os_event_set (loop->event, OS_LOOP_EVENT_WAKE);
+}
+
+int os_loop_fd (os_loop_t * loop)
+{
+   /* Not backed by a file descriptor */
+   return -1;
+}
+
+int os_loop_bind (int cpu)
+{
+   return -1;
+}
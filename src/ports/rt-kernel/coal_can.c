@@ -24,6 +24,7 @@
 #include <drivers/can/can.h>
 #include <fcntl.h>
 #include <string.h>
+#include <unistd.h>
 
 static void os_can_callback (void * arg, can_event_t event)
 {
@@ -63,11 +64,17 @@ os_channel_t * os_channel_open (const char * name, void * callback, void * arg)
    return channel;
 }
 
+void os_channel_close (os_channel_t * channel)
+{
+   close (channel->handle);
+   free (channel);
+}
+
 int os_channel_send (os_channel_t * channel, uint32_t id, const void * data, size_t dlc)
 {
    can_frame_t frame = {};
 
-   co_msg_log ("Tx", id, data, dlc);
+   co_trace (CO_TRACE_TX, id, data, dlc);
 
    frame.id = id & CO_ID_MASK;
    frame.id |= (id & CO_RTR_MASK) ? CAN_ID_RTR : 0;
@@ -100,7 +107,7 @@ int os_channel_receive (
    *dlc = MIN(8, frame.dlc);
    memcpy (data, frame.data, frame.dlc);
 
-   co_msg_log ("Rx", *id, data, *dlc);
+   co_trace (0, *id, data, *dlc);
 
    return 0;
 }
@@ -123,6 +130,12 @@ int os_channel_set_bitrate (os_channel_t * channel, int bitrate)
    return 0;
 }
 
+int os_channel_set_listen_only (os_channel_t * channel, bool enable)
+{
+   /* Not supported by driver */
+   return -1;
+}
+
 int os_channel_set_filter (os_channel_t * channel, uint8_t * filter, size_t size)
 {
    return 0;
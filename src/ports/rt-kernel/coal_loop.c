@@ -0,0 +1,61 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "coal_loop.h"
+
+/* Event loops are not supported on this port. The stack falls back
+   to a receive callback and an OS timer per network. */
+
+os_loop_t * os_loop_create (uint32_t period_us)
+{
+   return NULL;
+}
+
+void os_loop_destroy (os_loop_t * loop)
+{
+}
+
+int os_loop_add (os_loop_t * loop, os_channel_t * channel, void * arg)
+{
+   return -1;
+}
+
+void os_loop_remove (os_loop_t * loop, os_channel_t * channel)
+{
+}
+
+int os_loop_wait (
+   os_loop_t * loop,
+   uint32_t timeout_ms,
+   void ** ready,
+   size_t size,
+   uint32_t * events)
+{
+   return -1;
+}
+
+void os_loop_wake (os_loop_t * loop)
+{
+}
+
+int os_loop_fd (os_loop_t * loop)
+{
+   return -1;
+}
+
+int os_loop_bind (int cpu)
+{
+   return -1;
+}
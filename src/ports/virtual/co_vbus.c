@@ -0,0 +1,598 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_vbus.h"
+#include "co_main.h"
+#include "co_util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CO_VBUS_XCHG(p, v) _InterlockedExchange ((volatile long *)(p), (v))
+#else
+#define CO_VBUS_XCHG(p, v) __atomic_exchange_n ((p), (v), __ATOMIC_SEQ_CST)
+#endif
+
+/* Transmit queue length per channel, power of 2 */
+#define CO_VBUS_TXQ 64
+
+/* Length of frame ring, power of 2 */
+#define CO_VBUS_RING 1024
+
+/* Length of error frame, including intermission */
+#define CO_VBUS_ERROR_BITS 17
+
+/* Transmit error counter limits */
+#define CO_VBUS_TEC_PASSIVE 128
+#define CO_VBUS_TEC_BUS_OFF 256
+
+typedef struct co_vbus co_vbus_t;
+
+typedef struct co_vbus_frame
+{
+   uint64_t time;   /* Time queued, or time transmission completes */
+   uint32_t id;     /* Identifier with RTR and EXT flags */
+   uint8_t sender;  /* Index of sending channel */
+   uint8_t dlc;     /* Length of data */
+   uint8_t data[8]; /* Frame data */
+} co_vbus_frame_t;
+
+/* Frame ring slot. The sequence is the ring position plus one when
+   the slot is valid, and zero while it is being written. */
+typedef struct co_vbus_slot
+{
+   uint32_t sequence;
+   co_vbus_frame_t frame;
+} co_vbus_slot_t;
+
+struct co_vbus_node
+{
+   co_vbus_t * bus;
+   uint8_t index;
+
+   void (*callback) (void * arg);
+   void * arg;
+
+   /* Transmit queue, written by the channel owner and read by the
+      thread currently arbitrating the bus */
+   uint32_t tx_head;
+   uint32_t tx_tail;
+   co_vbus_frame_t tx[CO_VBUS_TXQ];
+
+   /* Receive position in frame ring, only used by channel owner */
+   uint32_t rx_position;
+
+   uint32_t tec;
+   uint8_t overrun;
+   uint8_t enabled;
+   uint8_t listen_only;
+};
+
+struct co_vbus
+{
+   char name[16];
+   co_vbus_cfg_t cfg;
+
+   /* Arbitration is done by one thread at a time. Requests made while
+      another thread arbitrates are picked up by that thread. */
+   uint32_t arbitrating;
+   uint32_t requests;
+
+   uint64_t busy_until;
+   uint32_t head;     /* Next ring position to write */
+   uint32_t notified; /* Next ring position to notify channels of */
+   co_vbus_slot_t ring[CO_VBUS_RING];
+
+   uint32_t inject_id;
+   uint32_t inject_mask;
+   uint32_t inject_count;
+
+   co_vbus_stats_t stats;
+
+   uint32_t count;
+   co_vbus_node_t node[CO_VBUS_NODES];
+};
+
+static co_vbus_t * co_vbus_buses[CO_VBUS_BUSES];
+
+/* Protects the table of buses and the allocation of channels, which
+   may happen from several threads. It is taken rarely and needs no
+   initialisation, so a spinning lock is used. */
+static uint32_t co_vbus_locked;
+
+static void co_vbus_lock (void)
+{
+   while (CO_VBUS_XCHG (&co_vbus_locked, 1) != 0)
+      os_usleep (10);
+}
+
+static void co_vbus_unlock (void)
+{
+   CO_VBUS_XCHG (&co_vbus_locked, 0);
+}
+
+static uint64_t co_vbus_clock (const co_vbus_t * bus)
+{
+   uint64_t ticks_per_ms;
+   uint64_t ticks;
+
+   if (bus->cfg.clock != NULL)
+      return bus->cfg.clock (bus->cfg.clock_arg);
+
+   ticks_per_ms = os_tick_from_us (1000);
+   ticks        = os_tick_current();
+
+   if (ticks_per_ms >= 1000000)
+      return ticks / (ticks_per_ms / 1000000);
+   else
+      return ticks * (1000000 / ticks_per_ms);
+}
+
+static co_vbus_t * co_vbus_find (const char * name, bool create)
+{
+   co_vbus_t * bus;
+   unsigned int ix;
+
+   co_vbus_lock();
+
+   for (ix = 0; ix < CO_VBUS_BUSES; ix++)
+   {
+      bus = co_vbus_buses[ix];
+      if (bus != NULL && strncmp (bus->name, name, sizeof (bus->name)) == 0)
+         goto done;
+   }
+
+   bus = NULL;
+   if (!create)
+      goto done;
+
+   for (ix = 0; ix < CO_VBUS_BUSES; ix++)
+   {
+      if (co_vbus_buses[ix] == NULL)
+      {
+         bus = calloc (1, sizeof (*bus));
+         if (bus != NULL)
+         {
+            strncpy (bus->name, name, sizeof (bus->name) - 1);
+            co_vbus_buses[ix] = bus;
+         }
+         break;
+      }
+   }
+
+done:
+   co_vbus_unlock();
+   return bus;
+}
+
+/* Arbitration priority, lower wins. Follows the bit order on the
+   bus: base identifier, RTR or SRR, IDE, extended identifier, RTR. */
+static uint32_t co_vbus_priority (uint32_t id)
+{
+   uint32_t rtr = (id & CO_RTR_MASK) ? 1 : 0;
+
+   if (id & CO_EXT_MASK)
+   {
+      uint32_t base = (id >> 18) & 0x7FF;
+      uint32_t ext  = id & 0x3FFFF;
+
+      return (base << 21) | (3 << 19) | (ext << 1) | rtr;
+   }
+
+   return ((id & 0x7FF) << 21) | (rtr << 20);
+}
+
+/* Frame length in bits, with worst case bit stuffing */
+static uint32_t co_vbus_bits (const co_vbus_frame_t * frame)
+{
+   uint32_t data = (frame->id & CO_RTR_MASK) ? 0 : 8 * frame->dlc;
+
+   if (frame->id & CO_EXT_MASK)
+      return 67 + data + (54 + data - 1) / 4;
+   else
+      return 47 + data + (34 + data - 1) / 4;
+}
+
+static uint64_t co_vbus_duration (const co_vbus_t * bus, uint32_t bits)
+{
+   if (bus->cfg.bitrate <= 0)
+      return 0;
+
+   return (uint64_t)bits * 1000000000 / bus->cfg.bitrate;
+}
+
+static void co_vbus_publish (co_vbus_t * bus, const co_vbus_frame_t * frame)
+{
+   co_vbus_slot_t * slot = &bus->ring[bus->head & (CO_VBUS_RING - 1)];
+
+   co_atomic_set_uint32 (&slot->sequence, 0);
+   CO_MEMORY_BARRIER();
+   slot->frame = *frame;
+   CO_MEMORY_BARRIER();
+   co_atomic_set_uint32 (&slot->sequence, bus->head + 1);
+   co_atomic_set_uint32 (&bus->head, bus->head + 1);
+}
+
+/* Call receive callbacks for frames that have completed */
+static void co_vbus_notify (co_vbus_t * bus, uint64_t now)
+{
+   while (bus->notified != bus->head)
+   {
+      co_vbus_slot_t * slot = &bus->ring[bus->notified & (CO_VBUS_RING - 1)];
+      uint32_t count        = co_atomic_get_uint32 (&bus->count);
+      unsigned int ix;
+
+      if (slot->frame.time > now)
+         break;
+
+      for (ix = 0; ix < count; ix++)
+      {
+         co_vbus_node_t * node         = &bus->node[ix];
+         void (*callback) (void * arg) = node->callback;
+
+         CO_MEMORY_BARRIER();
+         if (ix != slot->frame.sender && callback != NULL)
+            callback (node->arg);
+      }
+
+      bus->notified++;
+   }
+}
+
+/* Transmit queued frames, in order of priority, until the bus is
+   busy past the current time */
+static void co_vbus_arbitrate (co_vbus_t * bus, uint64_t now)
+{
+   for (;;)
+   {
+      co_vbus_node_t * winner = NULL;
+      co_vbus_frame_t * frame = NULL;
+      uint32_t priority       = UINT32_MAX;
+      uint32_t count          = co_atomic_get_uint32 (&bus->count);
+      uint64_t start;
+      unsigned int ix;
+
+      if (bus->busy_until > now)
+         break;
+
+      for (ix = 0; ix < count; ix++)
+      {
+         co_vbus_node_t * node = &bus->node[ix];
+         co_vbus_frame_t * head;
+
+         if (node->tx_tail == co_atomic_get_uint32 (&node->tx_head))
+            continue;
+
+         head = &node->tx[node->tx_tail & (CO_VBUS_TXQ - 1)];
+         if (head->time <= now && co_vbus_priority (head->id) < priority)
+         {
+            winner   = node;
+            frame    = head;
+            priority = co_vbus_priority (head->id);
+         }
+      }
+
+      if (winner == NULL)
+         break;
+
+      start = MAX (bus->busy_until, frame->time);
+
+      if (
+         co_atomic_get_uint32 (&bus->inject_count) > 0 &&
+         (frame->id & bus->inject_mask) == bus->inject_id)
+      {
+         /* Destroyed by error frame, the sender retransmits */
+         bus->busy_until = start + co_vbus_duration (
+                                      bus,
+                                      co_vbus_bits (frame) + CO_VBUS_ERROR_BITS);
+         bus->inject_count--;
+         bus->stats.errors++;
+
+         winner->tec += 8;
+         if (winner->tec >= CO_VBUS_TEC_BUS_OFF)
+         {
+            /* Bus off discards pending frames */
+            co_atomic_set_uint32 (&winner->tx_tail, co_atomic_get_uint32 (&winner->tx_head));
+         }
+         continue;
+      }
+
+      bus->busy_until = start + co_vbus_duration (bus, co_vbus_bits (frame));
+      bus->stats.busy_ns += bus->busy_until - start;
+      bus->stats.frames++;
+
+      if (winner->tec > 0)
+         winner->tec--;
+
+      frame->time = bus->busy_until;
+      co_vbus_publish (bus, frame);
+      co_atomic_set_uint32 (&winner->tx_tail, winner->tx_tail + 1);
+   }
+
+   co_vbus_notify (bus, now);
+}
+
+static void co_vbus_run (co_vbus_t * bus)
+{
+   uint32_t requests;
+
+   do
+   {
+      /* Leave it to the thread already arbitrating */
+      if (CO_VBUS_XCHG (&bus->arbitrating, 1) != 0)
+         return;
+
+      requests = co_atomic_get_uint32 (&bus->requests);
+      co_vbus_arbitrate (bus, co_vbus_clock (bus));
+      co_atomic_set_uint32 (&bus->arbitrating, 0);
+
+   } while (co_atomic_get_uint32 (&bus->requests) != requests);
+}
+
+int co_vbus_configure (const char * name, const co_vbus_cfg_t * cfg)
+{
+   co_vbus_t * bus = co_vbus_find (name, true);
+
+   if (bus == NULL)
+      return -1;
+
+   bus->cfg = *cfg;
+   return 0;
+}
+
+void co_vbus_destroy (const char * name)
+{
+   unsigned int ix;
+
+   co_vbus_lock();
+   for (ix = 0; ix < CO_VBUS_BUSES; ix++)
+   {
+      co_vbus_t * bus = co_vbus_buses[ix];
+
+      if (bus != NULL && strncmp (bus->name, name, sizeof (bus->name)) == 0)
+      {
+         co_vbus_buses[ix] = NULL;
+         free (bus);
+         break;
+      }
+   }
+   co_vbus_unlock();
+}
+
+int co_vbus_error_inject (
+   const char * name,
+   uint32_t id,
+   uint32_t mask,
+   unsigned int count)
+{
+   co_vbus_t * bus = co_vbus_find (name, false);
+
+   if (bus == NULL)
+      return -1;
+
+   bus->inject_id   = id & mask;
+   bus->inject_mask = mask;
+   co_atomic_set_uint32 (&bus->inject_count, count);
+   return 0;
+}
+
+int co_vbus_stats_get (const char * name, co_vbus_stats_t * stats)
+{
+   co_vbus_t * bus = co_vbus_find (name, false);
+
+   if (bus == NULL)
+      return -1;
+
+   *stats = bus->stats;
+   return 0;
+}
+
+uint64_t co_vbus_now (const char * name)
+{
+   co_vbus_t * bus = co_vbus_find (name, false);
+   co_vbus_t dummy;
+
+   if (bus == NULL)
+   {
+      memset (&dummy.cfg, 0, sizeof (dummy.cfg));
+      bus = &dummy;
+   }
+
+   return co_vbus_clock (bus);
+}
+
+co_vbus_node_t * co_vbus_open (
+   const char * name,
+   void (*callback) (void * arg),
+   void * arg)
+{
+   co_vbus_t * bus = co_vbus_find (name, true);
+   co_vbus_node_t * node;
+
+   if (bus == NULL)
+      return NULL;
+
+   co_vbus_lock();
+   if (bus->count == CO_VBUS_NODES)
+   {
+      co_vbus_unlock();
+      return NULL;
+   }
+
+   node              = &bus->node[bus->count];
+   node->bus         = bus;
+   node->index       = bus->count;
+   node->callback    = callback;
+   node->arg         = arg;
+   node->enabled     = true;
+   node->rx_position = co_atomic_get_uint32 (&bus->head);
+
+   /* Arbitrating threads read the count without the lock */
+   co_atomic_set_uint32 (&bus->count, bus->count + 1);
+   co_vbus_unlock();
+
+   return node;
+}
+
+void co_vbus_callback_set (
+   co_vbus_node_t * node,
+   void (*callback) (void * arg),
+   void * arg)
+{
+   /* Receive callbacks are called by any sending thread. The argument
+      is updated while no callback is set, so that a callback is never
+      called with the argument of another. */
+   node->callback = NULL;
+   CO_MEMORY_BARRIER();
+   node->arg = arg;
+   CO_MEMORY_BARRIER();
+   node->callback = callback;
+}
+
+int co_vbus_send (co_vbus_node_t * node, uint32_t id, const void * data, size_t dlc)
+{
+   co_vbus_t * bus = node->bus;
+   uint32_t head   = node->tx_head;
+   co_vbus_frame_t * frame;
+
+   if (!node->enabled || node->listen_only || node->tec >= CO_VBUS_TEC_BUS_OFF)
+      return -1;
+
+   if (head - co_atomic_get_uint32 (&node->tx_tail) == CO_VBUS_TXQ)
+      return -1;
+
+   frame         = &node->tx[head & (CO_VBUS_TXQ - 1)];
+   frame->time   = co_vbus_clock (bus);
+   frame->id     = id;
+   frame->sender = node->index;
+   frame->dlc    = (uint8_t)MIN (dlc, sizeof (frame->data));
+   memcpy (frame->data, data, frame->dlc);
+
+   CO_MEMORY_BARRIER();
+   co_atomic_set_uint32 (&node->tx_head, head + 1);
+
+   /* Count request before arbitrating, see co_vbus_run() */
+   co_atomic_add_uint32 (&bus->requests, 1);
+   co_vbus_run (bus);
+   return 0;
+}
+
+/* Get next frame for channel without consuming it */
+static co_vbus_frame_t * co_vbus_peek (
+   co_vbus_node_t * node,
+   co_vbus_frame_t * frame,
+   uint64_t * next)
+{
+   co_vbus_t * bus = node->bus;
+   uint64_t now    = co_vbus_clock (bus);
+
+   *next = UINT64_MAX;
+
+   for (;;)
+   {
+      uint32_t head = co_atomic_get_uint32 (&bus->head);
+      co_vbus_slot_t * slot;
+      uint32_t sequence;
+
+      if (node->rx_position == head)
+         return NULL;
+
+      if (head - node->rx_position > CO_VBUS_RING)
+      {
+         /* Frames have been overwritten */
+         node->overrun     = true;
+         node->rx_position = head - CO_VBUS_RING;
+         continue;
+      }
+
+      slot     = &bus->ring[node->rx_position & (CO_VBUS_RING - 1)];
+      sequence = co_atomic_get_uint32 (&slot->sequence);
+      CO_MEMORY_BARRIER();
+      *frame = slot->frame;
+      CO_MEMORY_BARRIER();
+
+      if (sequence != node->rx_position + 1 ||
+          co_atomic_get_uint32 (&slot->sequence) != sequence)
+      {
+         /* Overwritten while reading */
+         continue;
+      }
+
+      if (frame->time > now)
+      {
+         /* Still being transmitted */
+         *next = frame->time - now;
+         return NULL;
+      }
+
+      if (frame->sender != node->index && node->enabled)
+         return frame;
+
+      node->rx_position++;
+   }
+}
+
+int co_vbus_receive (co_vbus_node_t * node, uint32_t * id, void * data, size_t * dlc)
+{
+   co_vbus_frame_t frame;
+   uint64_t next;
+
+   co_vbus_run (node->bus);
+
+   if (co_vbus_peek (node, &frame, &next) == NULL)
+      return -1;
+
+   node->rx_position++;
+
+   *id  = frame.id;
+   *dlc = frame.dlc;
+   memcpy (data, frame.data, frame.dlc);
+   return 0;
+}
+
+bool co_vbus_pending (co_vbus_node_t * node, uint64_t * next)
+{
+   co_vbus_frame_t frame;
+
+   co_vbus_run (node->bus);
+   return co_vbus_peek (node, &frame, next) != NULL;
+}
+
+void co_vbus_state_get (
+   co_vbus_node_t * node,
+   bool * overrun,
+   bool * error_passive,
+   bool * bus_off)
+{
+   *overrun       = node->overrun;
+   *error_passive = node->tec >= CO_VBUS_TEC_PASSIVE;
+   *bus_off       = node->tec >= CO_VBUS_TEC_BUS_OFF;
+
+   node->overrun = false;
+}
+
+void co_vbus_enable (co_vbus_node_t * node, bool enable)
+{
+   node->enabled = enable;
+   if (enable)
+      node->tec = 0;
+}
+
+void co_vbus_listen_only (co_vbus_node_t * node, bool enable)
+{
+   node->listen_only = enable;
+}
@@ -0,0 +1,105 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "coal_can.h"
+#include "osal.h"
+#include "options.h"
+#include "osal_log.h"
+#include "co_log.h"
+#include "co_main.h"
+
+/* Channel names select the virtual bus. Nodes opened with the same
+   name share the bus, see co_vbus.h. */
+
+os_channel_t * os_channel_open (const char * name, void * callback, void * arg)
+{
+   os_channel_t * channel = co_vbus_open (name, callback, arg);
+
+   if (channel == NULL)
+   {
+      LOG_ERROR (CO_CAN_LOG, "failed to open virtual bus %s\n", name);
+      return NULL;
+   }
+
+   LOG_DEBUG (CO_CAN_LOG, "%s opened\n", name);
+   return channel;
+}
+
+void os_channel_close (os_channel_t * channel)
+{
+   /* Nodes are never removed from the bus, only disabled */
+   co_vbus_callback_set (channel, NULL, NULL);
+   co_vbus_enable (channel, false);
+}
+
+int os_channel_send (os_channel_t * channel, uint32_t id, const void * data, size_t dlc)
+{
+   co_trace (CO_TRACE_TX, id, data, dlc);
+
+   return co_vbus_send (channel, id, data, dlc);
+}
+
+int os_channel_receive (
+   os_channel_t * channel,
+   uint32_t * id,
+   void * data,
+   size_t * dlc)
+{
+   if (co_vbus_receive (channel, id, data, dlc) < 0)
+      return -1;
+
+   co_trace (0, *id, data, *dlc);
+
+   return 0;
+}
+
+int os_channel_set_bitrate (os_channel_t * channel, int bitrate)
+{
+   /* Bitrate is a property of the bus, see co_vbus_configure() */
+   return 0;
+}
+
+int os_channel_set_listen_only (os_channel_t * channel, bool enable)
+{
+   co_vbus_listen_only (channel, enable);
+   return 0;
+}
+
+int os_channel_set_filter (os_channel_t * channel, uint8_t * filter, size_t size)
+{
+   return 0;
+}
+
+int os_channel_bus_on (os_channel_t * channel)
+{
+   co_vbus_enable (channel, true);
+   return 0;
+}
+
+int os_channel_bus_off (os_channel_t * channel)
+{
+   co_vbus_enable (channel, false);
+   return 0;
+}
+
+int os_channel_get_state (os_channel_t * channel, os_channel_state_t * state)
+{
+   co_vbus_state_get (
+      channel,
+      &state->overrun,
+      &state->error_passive,
+      &state->bus_off);
+   return 0;
+}
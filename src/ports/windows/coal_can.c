@@ -57,12 +57,19 @@ os_channel_t * os_channel_open (const char * name, void * callback, void * arg)
    return channel;
 }
 
+void os_channel_close (os_channel_t * channel)
+{
+   kvSetNotifyCallback (channel->handle, NULL, NULL, canNOTIFY_NONE);
+   canClose (channel->handle);
+   free (channel);
+}
+
 int os_channel_send (os_channel_t * channel, uint32_t id, const void * data, size_t dlc)
 {
    canStatus status;
    uint32_t flags = 0;
 
-   co_msg_log ("Tx", id, data, dlc);
+   co_trace (CO_TRACE_TX, id, data, dlc);
 
    flags |= (id & CO_RTR_MASK) ? canMSG_RTR : 0;
    flags |= (id & CO_EXT_MASK) ? canMSG_EXT : 0;
@@ -90,7 +97,7 @@ int os_channel_receive (
    *id |= (flags & canMSG_RTR) ? CO_RTR_MASK : 0;
    *id |= (flags & canMSG_EXT) ? CO_EXT_MASK : 0;
 
-   co_msg_log ("Rx", *id, data, *dlc);
+   co_trace (0, *id, data, *dlc);
 
    return 0;
 }
@@ -101,6 +108,12 @@ int os_channel_set_bitrate (os_channel_t * channel, int bitrate)
 
    switch (bitrate)
    {
+   case 10 * 1000:
+      bitrate = canBITRATE_10K;
+      break;
+   case 50 * 1000:
+      bitrate = canBITRATE_50K;
+      break;
    case 100 * 1000:
       bitrate = canBITRATE_100K;
       break;
@@ -117,7 +130,7 @@ int os_channel_set_bitrate (os_channel_t * channel, int bitrate)
       bitrate = canBITRATE_1M;
       break;
    default:
-      assert (0);
+      return -1;
    }
 
    status = canSetBusParams (channel->handle, bitrate, 0, 0, 0, 0, 0);
@@ -127,6 +140,19 @@ int os_channel_set_bitrate (os_channel_t * channel, int bitrate)
    return 0;
 }
 
+int os_channel_set_listen_only (os_channel_t * channel, bool enable)
+{
+   canStatus status;
+
+   status = canSetBusOutputControl (
+      channel->handle,
+      enable ? canDRIVER_SILENT : canDRIVER_NORMAL);
+   if (status < canOK)
+      return status;
+
+   return 0;
+}
+
 int os_channel_set_filter (os_channel_t * channel, uint8_t * filter, size_t size)
 {
    return 0;
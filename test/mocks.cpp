@@ -14,10 +14,19 @@
  ********************************************************************/
 
 #include "mocks.h"
+#include "co_emcy.h"
+#include "co_od.h"
 
 #include <gtest/gtest.h>
 #include <string.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 os_tick_t mock_os_tick_current_result = 0;
 os_tick_t mock_os_tick_current (void)
 {
@@ -29,11 +38,232 @@ os_tick_t mock_os_tick_from_us (uint32_t us)
    return us;
 }
 
+void mock_os_usleep (uint32_t us)
+{
+}
+
+bool mock_reactor = false;
+static std::list<std::thread> mock_threads;
+os_thread_t * mock_os_thread_create (
+   const char * name,
+   uint32_t priority,
+   size_t stacksize,
+   void (*entry) (void * arg),
+   void * arg)
+{
+   if (mock_reactor)
+   {
+      mock_threads.emplace_back (entry, arg);
+      return (os_thread_t *)&mock_threads.back();
+   }
+   return NULL;
+}
+
+void mock_os_thread_join (void)
+{
+   for (std::thread & thread : mock_threads)
+      thread.join();
+   mock_threads.clear();
+}
+
+void (*mock_os_sem_wait_hook) (uint32_t time);
+bool mock_os_sem_wait (os_sem_t * sem, uint32_t time)
+{
+   /* Let the hook pass the time instead of waiting */
+   if (mock_os_sem_wait_hook != nullptr && time != OS_WAIT_FOREVER)
+   {
+      mock_os_sem_wait_hook (time);
+      time = 0;
+   }
+   return os_sem_wait (sem, time);
+}
+
+/* Event loop polling virtual bus nodes, woken by the receive
+   callbacks of the nodes. The bus calls the callbacks with its lock
+   held, so the nodes are never polled with the loop mutex held. */
+struct mock_os_loop
+{
+   std::mutex mutex;
+   std::condition_variable cond;
+   std::vector<std::pair<co_vbus_node_t *, void *>> channels;
+   bool signal = false;
+   bool wake   = false;
+   std::chrono::microseconds period;
+   std::chrono::steady_clock::time_point deadline;
+};
+
+static void mock_os_loop_signal (void * arg)
+{
+   mock_os_loop * loop = static_cast<mock_os_loop *> (arg);
+   std::lock_guard<std::mutex> lock (loop->mutex);
+
+   loop->signal = true;
+   loop->cond.notify_one();
+}
+
+os_loop_t * mock_os_loop_create (uint32_t period_us)
+{
+   mock_os_loop * loop;
+
+   if (!mock_reactor)
+      return NULL;
+
+   loop           = new mock_os_loop;
+   loop->period   = std::chrono::microseconds (period_us);
+   loop->deadline = std::chrono::steady_clock::now() + loop->period;
+   return (os_loop_t *)loop;
+}
+
+void mock_os_loop_destroy (os_loop_t * os_loop)
+{
+   mock_os_loop * loop = (mock_os_loop *)os_loop;
+
+   for (auto & channel : loop->channels)
+      co_vbus_callback_set (channel.first, NULL, NULL);
+   delete loop;
+}
+
+int mock_os_loop_add_result = 0;
+int mock_os_loop_add (os_loop_t * os_loop, os_channel_t * channel, void * arg)
+{
+   mock_os_loop * loop   = (mock_os_loop *)os_loop;
+   co_vbus_node_t * node = (co_vbus_node_t *)channel;
+
+   if (mock_os_loop_add_result != 0)
+      return mock_os_loop_add_result;
+
+   {
+      std::lock_guard<std::mutex> lock (loop->mutex);
+      loop->channels.emplace_back (node, arg);
+      loop->signal = true;
+   }
+
+   co_vbus_callback_set (node, mock_os_loop_signal, loop);
+   loop->cond.notify_one();
+   return 0;
+}
+
+void mock_os_loop_remove (os_loop_t * os_loop, os_channel_t * channel)
+{
+   mock_os_loop * loop   = (mock_os_loop *)os_loop;
+   co_vbus_node_t * node = (co_vbus_node_t *)channel;
+   std::lock_guard<std::mutex> lock (loop->mutex);
+
+   co_vbus_callback_set (node, NULL, NULL);
+   for (auto it = loop->channels.begin(); it != loop->channels.end(); ++it)
+   {
+      if (it->first == node)
+      {
+         loop->channels.erase (it);
+         break;
+      }
+   }
+}
+
+int mock_os_loop_wait (
+   os_loop_t * os_loop,
+   uint32_t timeout_ms,
+   void ** ready,
+   size_t size,
+   uint32_t * events)
+{
+   mock_os_loop * loop = (mock_os_loop *)os_loop;
+   auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds (timeout_ms);
+
+   *events = 0;
+
+   for (;;)
+   {
+      std::vector<std::pair<co_vbus_node_t *, void *>> channels;
+      auto now = std::chrono::steady_clock::now();
+      size_t ix = 0;
+
+      {
+         std::lock_guard<std::mutex> lock (loop->mutex);
+         if (loop->wake)
+            *events |= OS_LOOP_WAKE;
+         loop->wake   = false;
+         loop->signal = false;
+         channels     = loop->channels;
+      }
+
+      if (loop->period.count() > 0 && now >= loop->deadline)
+      {
+         *events |= OS_LOOP_TICK;
+         while (now >= loop->deadline)
+            loop->deadline += loop->period;
+      }
+
+      for (auto & channel : channels)
+      {
+         uint64_t next;
+
+         if (co_vbus_pending (channel.first, &next) && ix < size)
+            ready[ix++] = channel.second;
+      }
+
+      if (ix > 0 || *events != 0)
+         return (int)ix;
+
+      if (timeout_ms != OS_WAIT_FOREVER && now >= end)
+         return 0;
+
+      if (loop->period.count() > 0 && loop->deadline < end)
+         end = loop->deadline;
+
+      std::unique_lock<std::mutex> lock (loop->mutex);
+      loop->cond.wait_until (lock, end, [loop] { return loop->signal || loop->wake; });
+   }
+}
+
+void mock_os_loop_wake (os_loop_t * os_loop)
+{
+   mock_os_loop * loop = (mock_os_loop *)os_loop;
+   std::lock_guard<std::mutex> lock (loop->mutex);
+
+   loop->wake = true;
+   loop->cond.notify_one();
+}
+
+int mock_os_loop_fd (os_loop_t * loop)
+{
+   return -1;
+}
+
+int mock_os_loop_bind (int cpu)
+{
+   return -1;
+}
+
+static uint8_t mock_os_channel;
+bool mock_sim                  = false;
+bool mock_os_channel_open_fail = false;
+os_channel_t * mock_os_channel_open (const char * name, void * callback, void * arg)
+{
+   if (mock_os_channel_open_fail)
+      return NULL;
+   if (mock_sim)
+      return (os_channel_t *)co_vbus_open (name, NULL, NULL);
+   return (os_channel_t *)&mock_os_channel;
+}
+
+unsigned int mock_os_channel_close_calls = 0;
+void mock_os_channel_close (os_channel_t * channel)
+{
+   mock_os_channel_close_calls++;
+   if (mock_sim)
+   {
+      co_vbus_callback_set ((co_vbus_node_t *)channel, NULL, NULL);
+      co_vbus_enable ((co_vbus_node_t *)channel, false);
+   }
+}
+
 unsigned int mock_os_channel_send_calls = 0;
 uint32_t mock_os_channel_send_id;
 uint8_t mock_os_channel_send_data[8];
 size_t mock_os_channel_send_dlc;
 int mock_os_channel_send_result;
+void (*mock_os_channel_send_hook) (uint32_t id, const uint8_t * data, size_t dlc);
 int mock_os_channel_send (
    os_channel_t * channel,
    uint32_t id,
@@ -42,10 +272,19 @@ int mock_os_channel_send (
 {
    (void)channel;
    EXPECT_LE (dlc, 8u);
+
+   /* Sent from several threads, not recorded */
+   if (mock_reactor)
+      return co_vbus_send ((co_vbus_node_t *)channel, id, data, dlc);
+
    mock_os_channel_send_calls++;
    mock_os_channel_send_id  = id;
    mock_os_channel_send_dlc = dlc;
    memcpy (mock_os_channel_send_data, data, dlc);
+   if (mock_os_channel_send_hook)
+      mock_os_channel_send_hook (id, data, dlc);
+   if (mock_sim)
+      return co_vbus_send ((co_vbus_node_t *)channel, id, data, dlc);
    return mock_os_channel_send_result;
 }
 
@@ -61,9 +300,10 @@ int mock_os_channel_receive (
    size_t * dlc,
    int tmo)
 {
-   (void)channel;
    (void)tmo;
    mock_os_channel_receive_calls++;
+   if (mock_sim)
+      return co_vbus_receive ((co_vbus_node_t *)channel, id, data, dlc);
    *id  = mock_os_channel_receive_id;
    *dlc = mock_os_channel_receive_dlc;
    memcpy (data, mock_os_channel_receive_data, *dlc);
@@ -74,6 +314,8 @@ unsigned int mock_os_channel_bus_off_calls = 0;
 int mock_os_channel_bus_off (os_channel_t * channel)
 {
    mock_os_channel_bus_off_calls++;
+   if (mock_sim)
+      co_vbus_enable ((co_vbus_node_t *)channel, false);
    return 0;
 }
 
@@ -81,16 +323,29 @@ unsigned int mock_os_channel_bus_on_calls = 0;
 int mock_os_channel_bus_on (os_channel_t * channel)
 {
    mock_os_channel_bus_on_calls++;
+   if (mock_sim)
+      co_vbus_enable ((co_vbus_node_t *)channel, true);
    return 0;
 }
 
 unsigned int mock_os_channel_set_bitrate_calls = 0;
 int mock_os_channel_set_bitrate_bitrate        = 0;
+int mock_os_channel_set_bitrate_result         = 0;
 int mock_os_channel_set_bitrate (os_channel_t * channel, int bitrate)
 {
    mock_os_channel_set_bitrate_calls++;
    mock_os_channel_set_bitrate_bitrate = bitrate;
-   return 0;
+   return mock_os_channel_set_bitrate_result;
+}
+
+unsigned int mock_os_channel_set_listen_only_calls = 0;
+bool mock_os_channel_set_listen_only_enable        = false;
+int mock_os_channel_set_listen_only_result         = 0;
+int mock_os_channel_set_listen_only (os_channel_t * channel, bool enable)
+{
+   mock_os_channel_set_listen_only_calls++;
+   mock_os_channel_set_listen_only_enable = enable;
+   return mock_os_channel_set_listen_only_result;
 }
 
 unsigned int mock_os_channel_set_filter_calls = 0;
@@ -108,33 +363,50 @@ int mock_os_channel_get_state (os_channel_t * channel, os_channel_state * state)
 {
    mock_os_channel_get_state_calls++;
    *state = mock_os_channel_get_state_state;
+   if (mock_sim)
+   {
+      co_vbus_state_get (
+         (co_vbus_node_t *)channel,
+         &state->overrun,
+         &state->error_passive,
+         &state->bus_off);
+   }
    return 0;
 }
 
 const co_obj_t * mock_co_obj_find_result;
 const co_obj_t * mock_co_obj_find (co_net_t * net, uint16_t index)
 {
+   if (mock_sim)
+      return co_obj_find (net, index);
    return mock_co_obj_find_result;
 }
 
 const co_entry_t * mock_co_entry_find_result;
 const co_entry_t * mock_co_entry_find (co_net_t * net, co_obj_t * obj, uint8_t subindex)
 {
+   if (mock_sim)
+      return co_entry_find (net, obj, subindex);
    return mock_co_entry_find_result;
 }
 
 unsigned int mock_co_od_reset_calls = 0;
-void mock_co_od_reset (co_net_t * net)
+void mock_co_od_reset (co_net_t * net, co_store_t store, uint16_t min, uint16_t max)
 {
    mock_co_od_reset_calls++;
+   if (mock_sim)
+      co_od_reset (net, store, min, max);
 }
 
 unsigned int mock_co_emcy_tx_calls = 0;
 uint16_t mock_co_emcy_tx_code      = 0;
-void mock_co_emcy_tx (co_net_t * net, uint16_t code)
+int mock_co_emcy_tx (co_net_t * net, uint16_t code, uint16_t info, uint8_t msef[5])
 {
    mock_co_emcy_tx_calls++;
    mock_co_emcy_tx_code = code;
+   if (mock_sim)
+      return co_emcy_tx (net, code, info, msef);
+   return 0;
 }
 
 unsigned int cb_reset_calls;
@@ -172,6 +444,12 @@ void cb_sync (co_net_t * net)
    cb_sync_calls++;
 }
 
+unsigned int cb_job_calls;
+void cb_job (co_job_t * job)
+{
+   cb_job_calls++;
+}
+
 unsigned int cb_notify_calls;
 uint16_t cb_notify_index;
 uint16_t cb_notify_subindex;
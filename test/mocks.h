@@ -25,17 +25,62 @@ extern "C" {
 #include "osal.h"
 #include "co_api.h"
 #include "co_main.h"
+#include "co_vbus.h"
 
 extern os_tick_t mock_os_tick_current_result;
 os_tick_t mock_os_tick_current (void);
 
 os_tick_t mock_os_tick_from_us (uint32_t us);
 
+void mock_os_usleep (uint32_t us);
+
+os_thread_t * mock_os_thread_create (
+   const char * name,
+   uint32_t priority,
+   size_t stacksize,
+   void (*entry) (void * arg),
+   void * arg);
+
+extern void (*mock_os_sem_wait_hook) (uint32_t time);
+bool mock_os_sem_wait (os_sem_t * sem, uint32_t time);
+
+/* Set to run reactors, see test_reactor.cpp. Threads are then
+   started and event loops poll the nodes of a virtual bus. Started
+   threads must return before mock_os_thread_join() returns. */
+extern bool mock_reactor;
+void mock_os_thread_join (void);
+
+os_loop_t * mock_os_loop_create (uint32_t period_us);
+void mock_os_loop_destroy (os_loop_t * loop);
+extern int mock_os_loop_add_result;
+int mock_os_loop_add (os_loop_t * loop, os_channel_t * channel, void * arg);
+void mock_os_loop_remove (os_loop_t * loop, os_channel_t * channel);
+int mock_os_loop_wait (
+   os_loop_t * loop,
+   uint32_t timeout_ms,
+   void ** ready,
+   size_t size,
+   uint32_t * events);
+void mock_os_loop_wake (os_loop_t * loop);
+int mock_os_loop_fd (os_loop_t * loop);
+int mock_os_loop_bind (int cpu);
+
+/* Set while a simulation runs, see sim.h. Channels are then nodes on
+   a virtual bus and mocks of stack functions call the stack. */
+extern bool mock_sim;
+
+extern bool mock_os_channel_open_fail;
+os_channel_t * mock_os_channel_open (const char * name, void * callback, void * arg);
+
+extern unsigned int mock_os_channel_close_calls;
+void mock_os_channel_close (os_channel_t * channel);
+
 extern unsigned int mock_os_channel_send_calls;
 extern uint32_t mock_os_channel_send_id;
 extern uint8_t mock_os_channel_send_data[8];
 extern size_t mock_os_channel_send_dlc;
 extern int mock_os_channel_send_result;
+extern void (*mock_os_channel_send_hook) (uint32_t id, const uint8_t * data, size_t dlc);
 int mock_os_channel_send (
    os_channel_t * channel,
    uint32_t id,
@@ -62,8 +107,14 @@ int mock_os_channel_bus_on (os_channel_t * channel);
 
 extern unsigned int mock_os_channel_set_bitrate_calls;
 extern int mock_os_channel_set_bitrate_bitrate;
+extern int mock_os_channel_set_bitrate_result;
 int mock_os_channel_set_bitrate (os_channel_t * channel, int bitrate);
 
+extern unsigned int mock_os_channel_set_listen_only_calls;
+extern bool mock_os_channel_set_listen_only_enable;
+extern int mock_os_channel_set_listen_only_result;
+int mock_os_channel_set_listen_only (os_channel_t * channel, bool enable);
+
 extern unsigned int mock_os_channel_set_filter_calls;
 extern int mock_os_channel_set_filter_filter;
 int mock_os_channel_set_filter (os_channel_t * channel, int filter);
@@ -82,11 +133,11 @@ const co_entry_t * mock_co_entry_find (
    uint8_t subindex);
 
 extern unsigned int mock_co_od_reset_calls;
-void mock_co_od_reset (co_net_t * net);
+void mock_co_od_reset (co_net_t * net, co_store_t store, uint16_t min, uint16_t max);
 
 extern unsigned int mock_co_emcy_tx_calls;
 extern uint16_t mock_co_emcy_tx_code;
-void mock_co_emcy_tx (co_net_t * net, uint16_t code);
+int mock_co_emcy_tx (co_net_t * net, uint16_t code, uint16_t info, uint8_t msef[5]);
 
 extern unsigned int cb_reset_calls;
 void cb_reset (co_net_t * net);
@@ -105,6 +156,9 @@ bool cb_emcy (co_net_t * net, uint8_t node, uint16_t code, uint8_t reg, uint8_t
 extern unsigned int cb_sync_calls;
 void cb_sync (co_net_t * net);
 
+extern unsigned int cb_job_calls;
+void cb_job (co_job_t * job);
+
 extern unsigned int cb_notify_calls;
 extern uint16_t cb_notify_index;
 extern uint16_t cb_notify_subindex;
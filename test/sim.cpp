@@ -0,0 +1,176 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "sim.h"
+#include "co_main.h"
+
+#include <gtest/gtest.h>
+
+/* Limit on polling rounds at one point in time, to catch networks
+   that keep exchanging frames without time passing */
+#define SIM_MAX_ROUNDS 1000
+
+Sim * Sim::current = nullptr;
+
+Sim::Sim (const char * bus, int bitrate) : bus (bus)
+{
+   co_vbus_cfg_t cfg = {bitrate, clock, NULL};
+
+   current               = this;
+   mock_sim              = true;
+   mock_os_sem_wait_hook = wait;
+
+   co_vbus_configure (bus, &cfg);
+   probe = co_vbus_open (bus, NULL, NULL);
+}
+
+Sim::~Sim()
+{
+   /* There is no co_exit(). Threadless networks have no threads or
+      timers and live in the arenas of the simulation, so they are
+      released once no longer polled. Channels are disabled first so
+      that nothing is left in flight when the bus is destroyed. */
+   for (co_net_t * net : nets)
+      co_vbus_enable ((co_vbus_node_t *)net->channel, false);
+   nets.clear();
+
+   co_vbus_destroy (bus);
+
+   current               = nullptr;
+   mock_sim              = false;
+   mock_os_sem_wait_hook = nullptr;
+}
+
+uint64_t Sim::clock (void * arg)
+{
+   /* Bus time in ns */
+   return mock_os_tick_current_result * 1000000 / mock_os_tick_from_us (1000);
+}
+
+void Sim::wait (uint32_t time)
+{
+   current->run_for (mock_os_tick_from_us (1000 * time));
+}
+
+co_net_t * Sim::add (co_cfg_t cfg)
+{
+   co_net_t * net;
+
+   cfg.threadless = true;
+   cfg.reactor    = NULL;
+
+   arenas.emplace_back (co_arena_size (&cfg), 0);
+   cfg.arena      = arenas.back().data();
+   cfg.arena_size = arenas.back().size();
+
+   net = co_init (bus, &cfg);
+   if (net != NULL)
+      nets.push_back (net);
+
+   return net;
+}
+
+void Sim::remove (co_net_t * net)
+{
+   for (auto it = nets.begin(); it != nets.end(); ++it)
+   {
+      if (*it == net)
+      {
+         co_vbus_enable ((co_vbus_node_t *)net->channel, false);
+         nets.erase (it);
+         return;
+      }
+   }
+}
+
+std::vector<SimFrame> Sim::filter (uint32_t id) const
+{
+   std::vector<SimFrame> result;
+
+   for (const SimFrame & frame : frames)
+   {
+      if (frame.id == id)
+         result.push_back (frame);
+   }
+
+   return result;
+}
+
+/* Poll all networks until no frames are waiting to be received */
+void Sim::step()
+{
+   SimFrame frame;
+   bool busy = true;
+
+   for (unsigned int round = 0; busy; round++)
+   {
+      ASSERT_LT (round, SIM_MAX_ROUNDS) << "networks do not settle";
+
+      idle = UINT32_MAX;
+      for (co_net_t * net : nets)
+      {
+         os_tick_t deadline = (os_tick_t)co_poll (net, now());
+
+         idle = MIN (idle, (os_tick_t)(deadline - now()));
+      }
+
+      busy = false;
+      for (co_net_t * net : nets)
+      {
+         uint64_t next;
+
+         if (co_vbus_pending ((co_vbus_node_t *)net->channel, &next))
+            busy = true;
+      }
+   }
+
+   frame.time = now();
+   while (co_vbus_receive (probe, &frame.id, frame.data, &frame.dlc) == 0)
+   {
+      frames.push_back (frame);
+   }
+}
+
+/* Times are compared by their distance from the current time, so
+   that the simulation is not affected by the tick counter wrapping */
+void Sim::run_until (os_tick_t end)
+{
+   os_tick_t duration = end - now();
+
+   for (;;)
+   {
+      os_tick_t left;
+      uint64_t delay;
+
+      step();
+
+      /* End was reached if it is now behind the current time */
+      left = end - now();
+      if (left == 0 || left > duration)
+         break;
+
+      /* Skip to the earliest deadline */
+      left = MIN (left, idle);
+
+      /* Or to the end of the frame being transmitted */
+      if (!co_vbus_pending (probe, &delay) && delay != UINT64_MAX)
+      {
+         os_tick_t ticks = (delay * mock_os_tick_from_us (1000) + 999999) / 1000000;
+         left            = MIN (left, ticks);
+      }
+
+      mock_os_tick_current_result = now() + MAX (left, (os_tick_t)1);
+   }
+}
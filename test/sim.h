@@ -0,0 +1,89 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "mocks.h"
+#include "co_vbus.h"
+
+#include <vector>
+
+/* Simulation of complete networks on a virtual clock. Networks are
+   created threadless on a virtual bus and driven by co_poll(). The
+   clock, mock_os_tick_current_result in microseconds, skips ahead to
+   the earliest deadline of any network or the completion of the next
+   frame on the bus, so that long scenarios run in little wall time
+   and with reproducible timing. Blocking client calls, such as
+   co_sdo_read(), advance the simulation while they wait. */
+
+struct SimFrame
+{
+   os_tick_t time;
+   uint32_t id;
+   uint8_t data[8];
+   size_t dlc;
+};
+
+class Sim
+{
+ public:
+   Sim (const char * bus = "sim", int bitrate = 0);
+   ~Sim();
+
+   /* Add network, the configuration is completed with an arena and
+      threadless mode. The network is released with the simulation.
+      Returns NULL if co_init() fails. */
+   co_net_t * add (co_cfg_t cfg);
+
+   /* Stop polling network, as if it lost power. Its channel is
+      disabled so queued frames are not sent. */
+   void remove (co_net_t * net);
+
+   /* Run until the clock reaches the given time */
+   void run_until (os_tick_t end);
+
+   /* Run for the given number of microseconds */
+   void run_for (os_tick_t duration)
+   {
+      run_until (now() + duration);
+   }
+
+   os_tick_t now() const
+   {
+      return mock_os_tick_current_result;
+   }
+
+   /* Frames seen on the bus, with time of reception */
+   std::vector<SimFrame> frames;
+
+   /* Frames seen with the given identifier */
+   std::vector<SimFrame> filter (uint32_t id) const;
+
+ private:
+   static uint64_t clock (void * arg);
+   static void wait (uint32_t time);
+   void step();
+
+   const char * bus;
+   co_vbus_node_t * probe;
+   std::vector<co_net_t *> nets;
+   os_tick_t idle; /* Time from now until the earliest deadline */
+   std::vector<std::vector<uint8_t>> arenas;
+
+   static Sim * current;
+};
+
+#endif /* SIM_H */
@@ -0,0 +1,176 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+#include "co_arena.h"
+#include "co_od.h"
+#include "test_util.h"
+
+// Test fixture
+
+class ArenaTest : public TestBase
+{
+};
+
+// Tests
+
+TEST_F (ArenaTest, Sizes)
+{
+   co_sizes_t sizes;
+
+   ASSERT_EQ (0, co_arena_sizes (test_od, true, &sizes));
+   EXPECT_EQ (2u, sizes.rx_pdos);
+   EXPECT_EQ (2u, sizes.tx_pdos);
+   EXPECT_EQ (MAX_PDO_ENTRIES, sizes.pdo_entries);
+   EXPECT_EQ (MAX_HEARTBEATS, sizes.heartbeats);
+   EXPECT_EQ (MAX_EMCY_COBIDS, sizes.emcy_cobids);
+   EXPECT_EQ (MAX_ERRORS, sizes.errors);
+   EXPECT_TRUE (sizes.process_image);
+   EXPECT_TRUE (sizes.emcy_nodes);
+   EXPECT_EQ (36u, sizes.objects);
+}
+
+TEST_F (ArenaTest, SizesLimits)
+{
+   co_sizes_t sizes;
+   co_obj_t od[2] = {
+      {0x1016, OTYPE_ARRAY, 128, OD1016, co_od1016_fn, NULL},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
+   };
+
+   EXPECT_EQ (-1, co_arena_sizes (od, false, &sizes));
+
+   od[0] = {0x1A00, OTYPE_RECORD, CO_PDO_MAX_ENTRIES + 1, OD1A00, co_od1A00_fn, NULL};
+   EXPECT_EQ (-1, co_arena_sizes (od, false, &sizes));
+
+   // Empty dictionary needs no tables
+   od[0] = {0x1000, OTYPE_VAR, 0, OD1000, NULL, NULL};
+   EXPECT_EQ (0, co_arena_sizes (od, false, &sizes));
+   EXPECT_EQ (0u, sizes.rx_pdos + sizes.tx_pdos);
+   EXPECT_EQ (0u, sizes.heartbeats + sizes.emcy_cobids + sizes.errors);
+}
+
+TEST_F (ArenaTest, SizesDownload)
+{
+   static co_seqlock_t lock;
+   static const co_obj_ops_t ops = {NULL, NULL, &lock};
+   static char str[3][12];
+   static const co_entry_t entries[] = {
+      {0, OD_RO, DTYPE_UNSIGNED8, 8, 2, NULL},
+      {1, OD_RW, DTYPE_VISIBLE_STRING, 8 * 10, 0, str[0]},
+      {2, OD_RO, DTYPE_VISIBLE_STRING, 8 * 12, 0, str[1]},
+   };
+   co_obj_t od[3] = {
+      {0x2000, OTYPE_RECORD, 2, entries, NULL, NULL},
+      {0x2001, OTYPE_VAR, 0, OD1008, NULL, NULL},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
+   };
+   co_sizes_t sizes;
+
+   // Only objects with a sequence counter are buffered
+   EXPECT_EQ (0, co_arena_sizes (od, false, &sizes));
+   EXPECT_EQ (0u, sizes.download);
+
+   // Largest writable subindex
+   od[0].ops = &ops;
+   EXPECT_EQ (0, co_arena_sizes (od, false, &sizes));
+   EXPECT_EQ (10u, sizes.download);
+}
+
+TEST_F (ArenaTest, Alloc)
+{
+   uint8_t memory[64];
+   co_arena_t arena;
+   uint8_t * p;
+
+   co_arena_init (&arena, memory + 1, sizeof (memory) - 1);
+
+   p = (uint8_t *)co_arena_alloc (&arena, 1, 1);
+   EXPECT_EQ (memory + 1, p);
+
+   p = (uint8_t *)co_arena_alloc (&arena, 4, 4);
+   EXPECT_EQ (0u, (uintptr_t)p % 4);
+   EXPECT_LE (memory + 2, p);
+
+   // Exhausted
+   EXPECT_EQ (NULL, co_arena_alloc (&arena, sizeof (memory), 1));
+   p = (uint8_t *)co_arena_alloc (&arena, memory + sizeof (memory) - (uint8_t *)arena.next, 1);
+   EXPECT_NE ((uint8_t *)NULL, p);
+   EXPECT_EQ (NULL, co_arena_alloc (&arena, 1, 1));
+}
+
+TEST_F (ArenaTest, Tables)
+{
+   co_arena_t a;
+   uint8_t * base;
+   unsigned int offset;
+
+   net.sizes.process_image = true;
+
+   // Tables fit regardless of alignment of the arena
+   for (offset = 0; offset < CO_ARENA_ALIGN; offset += 7)
+   {
+      size_t size = co_arena_tables_size (&net.sizes);
+
+      arena.assign (size + offset, 0);
+      base = arena.data() + offset;
+      co_arena_init (&a, base, size);
+      ASSERT_EQ (0, co_arena_tables (&net, &a));
+      EXPECT_EQ (0u, (uintptr_t)net.image % CO_IMAGE_ALIGN);
+      EXPECT_EQ (0u, (uintptr_t)net.pdo_tx % 8);
+
+      // Mapping tables do not overlap
+      EXPECT_EQ (
+         net.pdo_tx[0].mappings + net.sizes.pdo_entries,
+         net.pdo_tx[1].mappings);
+      EXPECT_EQ (
+         net.pdo_tx[1].mappings + net.sizes.pdo_entries,
+         net.pdo_rx[0].mappings);
+   }
+
+   // Too small
+   co_arena_init (&a, arena.data(), 64);
+   EXPECT_EQ (-1, co_arena_tables (&net, &a));
+}
+
+TEST_F (ArenaTest, Size)
+{
+   co_cfg_t cfg = {};
+   co_sizes_t sizes;
+
+   cfg.od = test_od;
+   co_arena_sizes (test_od, false, &sizes);
+   EXPECT_EQ (
+      CO_ARENA_ALIGN - 1 + sizeof (co_net_t) + co_arena_tables_size (&sizes),
+      co_arena_size (&cfg));
+
+   cfg.process_image = true;
+   EXPECT_LT (
+      CO_IMAGE_SIZE * sizeof (co_image_slot_t) +
+         co_arena_tables_size (&sizes),
+      co_arena_size (&cfg));
+}
+
+TEST_F (ArenaTest, NumberOfEntries)
+{
+   uint32_t value;
+
+   // Subindex 0 reports the size of the table
+   value = 0;
+   EXPECT_EQ (0u, co_od1016_fn (&net, OD_EVENT_READ, find_obj (0x1016), NULL, 0, &value));
+   EXPECT_EQ (MAX_HEARTBEATS, value);
+
+   value = 0;
+   EXPECT_EQ (0u, co_od1028_fn (&net, OD_EVENT_READ, find_obj (0x1028), NULL, 0, &value));
+   EXPECT_EQ (MAX_EMCY_COBIDS, value);
+}
@@ -0,0 +1,166 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_bootup.h"
+#include "co_nmt.h"
+#include "co_bitmap.h"
+#include "test_util.h"
+
+// Test fixture
+
+static unsigned int bootup_calls;
+static uint8_t bootup_node;
+
+static void cb_bootup (co_net_t * net, uint8_t node)
+{
+   bootup_calls++;
+   bootup_node = node;
+}
+
+class BootupTest : public TestBase
+{
+ protected:
+   void SetUp() override
+   {
+      TestBase::SetUp();
+      net.cb_bootup = cb_bootup;
+      bootup_calls  = 0;
+      bootup_node   = 0;
+
+      memset (&job, 0, sizeof (job));
+      memset (expected, 0, sizeof (expected));
+      memset (booted, 0xFF, sizeof (booted));
+   }
+
+   void bootup (uint8_t node)
+   {
+      uint8_t msg[] = {0};
+      co_bootup_rx (&net, 0x700 + node, msg, sizeof (msg));
+   }
+
+   void wait (uint32_t timeout)
+   {
+      job.type            = CO_JOB_BOOTUP_WAIT;
+      job.bootup.expected = expected;
+      job.bootup.booted   = booted;
+      job.bootup.timeout  = timeout;
+      job.callback        = cb_job;
+      job.timestamp       = mock_os_tick_current();
+      co_bootup_job (&net, &job);
+   }
+
+   co_job_t job;
+   uint32_t expected[4];
+   uint32_t booted[4];
+};
+
+// Tests
+
+TEST_F (BootupTest, Rx)
+{
+   uint8_t heartbeat[] = {0x05};
+
+   bootup (3);
+   EXPECT_EQ (1u, bootup_calls);
+   EXPECT_EQ (3u, bootup_node);
+   EXPECT_TRUE (co_bitmap_get (net.booted, 3));
+
+   // Heartbeat is not a boot-up
+   co_bootup_rx (&net, 0x704, heartbeat, sizeof (heartbeat));
+   EXPECT_EQ (1u, bootup_calls);
+   EXPECT_FALSE (co_bitmap_get (net.booted, 4));
+
+   // Node guarding request is not a boot-up
+   co_bootup_rx (&net, 0x705 | CO_RTR_MASK, NULL, 0);
+   EXPECT_EQ (1u, bootup_calls);
+   EXPECT_FALSE (co_bitmap_get (net.booted, 5));
+}
+
+TEST_F (BootupTest, Wait)
+{
+   co_bitmap_set (expected, 2);
+   co_bitmap_set (expected, 100);
+
+   wait (1000);
+   EXPECT_EQ (0u, cb_job_calls);
+
+   bootup (2);
+   bootup (3);
+   EXPECT_EQ (0u, cb_job_calls);
+
+   // Completes when last expected node has booted
+   bootup (100);
+   EXPECT_EQ (1u, cb_job_calls);
+   EXPECT_EQ (0, job.result);
+   EXPECT_EQ (BIT (2), booted[0]);
+   EXPECT_EQ (BIT (100 - 96), booted[3]);
+   EXPECT_EQ (0u, booted[1]);
+   EXPECT_EQ (3u, bootup_calls);
+   EXPECT_EQ (NULL, net.job_bootup);
+}
+
+TEST_F (BootupTest, WaitAlreadyBooted)
+{
+   bootup (2);
+
+   co_bitmap_set (expected, 2);
+   wait (1000);
+   EXPECT_EQ (1u, cb_job_calls);
+   EXPECT_EQ (0, job.result);
+}
+
+TEST_F (BootupTest, WaitTimeout)
+{
+   co_bitmap_set (expected, 2);
+   co_bitmap_set (expected, 3);
+
+   mock_os_tick_current_result = 100;
+   wait (10);
+   bootup (3);
+
+   co_bootup_timer (&net, 100 + 9 * 1000);
+   EXPECT_EQ (0u, cb_job_calls);
+
+   co_bootup_timer (&net, 100 + 10 * 1000);
+   EXPECT_EQ (1u, cb_job_calls);
+   EXPECT_EQ (-1, job.result);
+   EXPECT_EQ (BIT (3), booted[0]);
+}
+
+TEST_F (BootupTest, NmtResetClearsBootup)
+{
+   co_job_t nmt;
+
+   bootup (2);
+   bootup (3);
+
+   nmt.type     = CO_JOB_NMT;
+   nmt.nmt.cmd  = CO_NMT_RESET_COMMUNICATION;
+   nmt.nmt.node = 2;
+   nmt.callback = NULL;
+   co_nmt_job (&net, &nmt);
+   EXPECT_EQ (1u, mock_os_channel_send_calls);
+   EXPECT_FALSE (co_bitmap_get (net.booted, 2));
+   EXPECT_TRUE (co_bitmap_get (net.booted, 3));
+
+   nmt.nmt.cmd  = CO_NMT_OPERATIONAL;
+   nmt.nmt.node = 0;
+   co_nmt_job (&net, &nmt);
+   EXPECT_TRUE (co_bitmap_get (net.booted, 3));
+
+   nmt.nmt.cmd = CO_NMT_RESET_NODE;
+   co_nmt_job (&net, &nmt);
+   EXPECT_FALSE (co_bitmap_get (net.booted, 3));
+}
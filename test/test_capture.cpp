@@ -0,0 +1,191 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_capture.h"
+#include "co_sdo.h"
+#include "co_util.h"
+#include "test_util.h"
+
+#include <string>
+
+// co_send() expands to os_channel_send()
+#define os_channel_send mock_os_channel_send
+
+// Test fixture
+
+class CaptureTest : public TestBase
+{
+ protected:
+   void TearDown() override
+   {
+      if (net.capture != NULL)
+         co_capture_destroy (net.capture);
+      net.capture = NULL;
+   }
+
+   void start (co_capture_format_t format)
+   {
+      file.clear();
+      net.capture = co_capture_create (format, vector_write, &file);
+      ASSERT_NE (nullptr, net.capture);
+   }
+
+   std::string text()
+   {
+      return std::string (file.begin(), file.end());
+   }
+
+   std::vector<uint8_t> file;
+};
+
+// Tests
+
+TEST_F (CaptureTest, Pcap)
+{
+   uint8_t data[] = {0x11, 0x22, 0x33};
+   const uint8_t * p;
+
+   start (CO_CAPTURE_PCAP);
+
+   // Global header
+   ASSERT_EQ ((size_t)CO_CAPTURE_PCAP_HEADER_SIZE, file.size());
+   EXPECT_EQ (0xA1B2C3D4u, co_fetch_uint32 (&file[0]));
+   EXPECT_EQ (2u, co_fetch_uint16 (&file[4]));
+   EXPECT_EQ (4u, co_fetch_uint16 (&file[6]));
+   EXPECT_EQ (16u, co_fetch_uint32 (&file[16]));
+   EXPECT_EQ (227u, co_fetch_uint32 (&file[20]));
+
+   mock_os_tick_current_result = 2000001;
+   co_capture_frame (&net, 0x181, data, sizeof (data));
+   co_capture_frame (&net, CO_EXT_MASK | 0x12345678, data, 1);
+   co_capture_frame (&net, CO_RTR_MASK | 0x701, NULL, 1);
+
+   EXPECT_EQ (3, co_capture_flush (net.capture));
+   ASSERT_EQ (
+      (size_t)CO_CAPTURE_PCAP_HEADER_SIZE + 3 * CO_CAPTURE_PCAP_RECORD_SIZE,
+      file.size());
+
+   // Record header
+   p = &file[CO_CAPTURE_PCAP_HEADER_SIZE];
+   EXPECT_EQ (2u, co_fetch_uint32 (&p[0]));
+   EXPECT_EQ (1u, co_fetch_uint32 (&p[4]));
+   EXPECT_EQ (16u, co_fetch_uint32 (&p[8]));
+   EXPECT_EQ (16u, co_fetch_uint32 (&p[12]));
+
+   // CAN frames, CAN ID in network byte order
+   uint8_t std[] = {0x00, 0x00, 0x01, 0x81, 3, 0, 0, 0, 0x11, 0x22, 0x33, 0, 0, 0, 0, 0};
+   EXPECT_EQ (0, memcmp (&p[16], std, sizeof (std)));
+
+   p += CO_CAPTURE_PCAP_RECORD_SIZE;
+   uint8_t ext[] = {0x92, 0x34, 0x56, 0x78, 1, 0, 0, 0, 0x11, 0, 0, 0, 0, 0, 0, 0};
+   EXPECT_EQ (0, memcmp (&p[16], ext, sizeof (ext)));
+
+   p += CO_CAPTURE_PCAP_RECORD_SIZE;
+   uint8_t rtr[] = {0x40, 0x00, 0x07, 0x01, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+   EXPECT_EQ (0, memcmp (&p[16], rtr, sizeof (rtr)));
+}
+
+TEST_F (CaptureTest, Candump)
+{
+   uint8_t data[] = {0x11, 0x22, 0xAB};
+
+   start (CO_CAPTURE_CANDUMP);
+   EXPECT_EQ (0u, file.size());
+
+   mock_os_tick_current_result = 1500000;
+   co_capture_frame (&net, 0x181, data, sizeof (data));
+   co_capture_frame (&net, CO_EXT_MASK | 0x12345678, data, 1);
+   co_capture_frame (&net, CO_RTR_MASK | 0x701, NULL, 1);
+   co_capture_frame (&net, 0x80, NULL, 0);
+
+   EXPECT_EQ (4, co_capture_flush (net.capture));
+   EXPECT_EQ (
+      "(0000000001.500000) co 181#1122AB\n"
+      "(0000000001.500000) co 12345678#11\n"
+      "(0000000001.500000) co 701#R\n"
+      "(0000000001.500000) co 080#\n",
+      text());
+
+   // Nothing more to write
+   EXPECT_EQ (0, co_capture_flush (net.capture));
+}
+
+TEST_F (CaptureTest, Sent)
+{
+   uint8_t data[] = {0x05};
+
+   start (CO_CAPTURE_CANDUMP);
+
+   mock_os_channel_send_result = 0;
+   co_send (&net, 0x701, data, sizeof (data));
+
+   // Frames that could not be sent are not captured
+   mock_os_channel_send_result = -1;
+   co_send (&net, 0x702, data, sizeof (data));
+   mock_os_channel_send_result = 0;
+
+   co_capture_flush (net.capture);
+   EXPECT_EQ ("(0000000000.000000) co 701#05\n", text());
+}
+
+TEST_F (CaptureTest, Events)
+{
+   start (CO_CAPTURE_CANDUMP);
+
+   net.state = STATE_OP;
+   co_capture_nmt (&net, STATE_PREOP);
+   co_sdo_abort (&net, 0x581, 0x1234, 0x56, CO_SDO_ABORT_BAD_INDEX);
+
+   co_capture_flush (net.capture);
+   EXPECT_EQ (
+      "(0000000000.000000) co 1FFFFF00#0405\n"
+      "(0000000000.000000) co 1FFFFF01#0000020634125601\n"
+      "(0000000000.000000) co 581#8034125600000206\n",
+      text());
+}
+
+TEST_F (CaptureTest, Full)
+{
+   uint8_t data[] = {0x01};
+   unsigned int ix;
+
+   start (CO_CAPTURE_PCAP);
+
+   for (ix = 0; ix < CO_CAPTURE_SIZE + 5; ix++)
+      co_capture_frame (&net, 0x181, data, sizeof (data));
+
+   EXPECT_EQ (5u, net.capture->dropped);
+   EXPECT_EQ ((int)CO_CAPTURE_SIZE, co_capture_flush (net.capture));
+
+   // Ring has room again
+   co_capture_frame (&net, 0x181, data, sizeof (data));
+   EXPECT_EQ (5u, net.capture->dropped);
+   EXPECT_EQ (1, co_capture_flush (net.capture));
+}
+
+TEST_F (CaptureTest, WriteError)
+{
+   uint8_t data[] = {0x01};
+
+   EXPECT_EQ (nullptr, co_capture_create (CO_CAPTURE_PCAP, fail_write, NULL));
+
+   net.capture = co_capture_create (CO_CAPTURE_CANDUMP, fail_write, NULL);
+   ASSERT_NE (nullptr, net.capture);
+
+   co_capture_frame (&net, 0x181, data, sizeof (data));
+   EXPECT_EQ (-1, co_capture_flush (net.capture));
+   EXPECT_EQ (-1, co_capture_destroy (net.capture));
+   net.capture = NULL;
+}
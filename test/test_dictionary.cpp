@@ -0,0 +1,193 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_dictionary.hpp"
+#include "test_util.h"
+
+using output  = co::od::var<0x6000, uint64_t, OD_RW | OD_RPDO>;
+using input   = co::od::var<0x6001, uint16_t, OD_RO | OD_TPDO>;
+using flag    = co::od::var<0x6002, bool, OD_RW | OD_TPDO>;
+using gains   = co::od::array<0x6100, float, 3>;
+using version = co::od::constant<0x1000, uint32_t, 0x12345678>;
+
+// Objects are deliberately given out of order
+using dictionary = co::od::dictionary<
+   input,
+   output,
+   co::od::tpdo_mapping<0>,
+   co::od::tpdo_comm<0>,
+   gains,
+   flag,
+   co::od::identity<0x1337, 2, 3, 4>,
+   co::od::error_register,
+   version>;
+
+static_assert (dictionary::size == 9, "");
+static_assert (dictionary::objects()[0].index == 0x1000, "");
+static_assert (dictionary::objects()[1].index == 0x1001, "");
+static_assert (dictionary::objects()[2].index == 0x1018, "");
+static_assert (dictionary::objects()[3].index == 0x1800, "");
+static_assert (dictionary::objects()[4].index == 0x1A00, "");
+static_assert (dictionary::objects()[5].index == 0x6000, "");
+static_assert (dictionary::objects()[8].index == 0x6100, "");
+static_assert (dictionary::objects()[9].index == 0, "");
+
+// Mappings are checked and encoded
+using tpdo_map = co::od::pdo_map<0x1A00, input, flag>;
+using rpdo_map = co::od::pdo_map<0x1600, output>;
+
+static_assert (tpdo_map::count == 2, "");
+static_assert (tpdo_map::entries[0] == 0x60010010, "");
+static_assert (tpdo_map::entries[1] == 0x60020001, "");
+static_assert (co::od::detail::mapping_bitlength<input, flag>() == 17, "");
+static_assert (co::od::detail::mapping_bitlength<output, input>() == 80, "");
+static_assert (co::od::detail::mapping_flags<OD_RPDO, output>(), "");
+static_assert (!co::od::detail::mapping_flags<OD_RPDO, output, input>(), "");
+static_assert (rpdo_map::entries[0] == 0x60000040, "");
+
+// Duplicates are detected
+static_assert (co::od::detail::unique<3> ({{0x1000, 0x2000, 0x1001}}, 3), "");
+static_assert (!co::od::detail::unique<3> ({{0x1000, 0x2000, 0x1000}}, 3), "");
+
+class DictionaryTest : public TestBase
+{
+ protected:
+   virtual void SetUp()
+   {
+      TestBase::SetUp();
+      net.od = dictionary::objects();
+      arena_init();
+      co_od_init (&net, dictionary::size);
+      co_pdo_init (&net);
+   }
+};
+
+TEST_F (DictionaryTest, Sorted)
+{
+   EXPECT_TRUE (net.od_sorted);
+   EXPECT_EQ (9u, net.od_size);
+
+   EXPECT_EQ (&dictionary::objects()[2], co_obj_find (&net, 0x1018));
+   EXPECT_EQ (&dictionary::objects()[7], co_obj_find (&net, 0x6002));
+   EXPECT_EQ (NULL, co_obj_find (&net, 0x6003));
+}
+
+TEST_F (DictionaryTest, Var)
+{
+   const co_obj_t * obj;
+   const co_entry_t * entry;
+   uint64_t value;
+
+   obj   = co_obj_find (&net, 0x6000);
+   entry = co_entry_find (&net, obj, 0);
+   ASSERT_NE (nullptr, entry);
+   EXPECT_EQ (DTYPE_UNSIGNED64, entry->datatype);
+   EXPECT_EQ (64u, entry->bitlength);
+   EXPECT_EQ (OD_RW | OD_RPDO, entry->flags);
+
+   output::set (0x0123456789ABCDEF);
+   EXPECT_EQ (0u, co_od_get_value (&net, obj, entry, 0, &value));
+   EXPECT_EQ (0x0123456789ABCDEFu, value);
+
+   EXPECT_EQ (0u, co_od_set_value (&net, obj, entry, 0, 0xFEDCBA9876543210));
+   EXPECT_EQ (0xFEDCBA9876543210u, output::get());
+
+   obj   = co_obj_find (&net, 0x6002);
+   entry = co_entry_find (&net, obj, 0);
+   EXPECT_EQ (DTYPE_BOOLEAN, entry->datatype);
+   EXPECT_EQ (1u, entry->bitlength);
+
+   flag::set (true);
+   EXPECT_EQ (0u, co_od_get_value (&net, obj, entry, 0, &value));
+   EXPECT_EQ (1u, value);
+}
+
+TEST_F (DictionaryTest, Array)
+{
+   const co_obj_t * obj = co_obj_find (&net, 0x6100);
+   const co_entry_t * entry;
+   uint64_t value;
+   float f;
+
+   EXPECT_EQ (OTYPE_ARRAY, obj->objtype);
+   EXPECT_EQ (3, obj->max_subindex);
+
+   entry = co_entry_find (&net, obj, 0);
+   EXPECT_EQ (0u, co_od_get_value (&net, obj, entry, 0, &value));
+   EXPECT_EQ (3u, value);
+
+   gains::set (2, 1.5f);
+   entry = co_entry_find (&net, obj, 2);
+   EXPECT_EQ (0u, co_od_get_value (&net, obj, entry, 2, &value));
+   uint32_t bits = (uint32_t)value;
+   memcpy (&f, &bits, sizeof (f));
+   EXPECT_EQ (1.5f, f);
+
+   EXPECT_EQ (nullptr, co_entry_find (&net, obj, 4));
+}
+
+TEST_F (DictionaryTest, Constants)
+{
+   const co_obj_t * obj;
+   const co_entry_t * entry;
+   uint64_t value;
+
+   obj   = co_obj_find (&net, 0x1000);
+   entry = co_entry_find (&net, obj, 0);
+   EXPECT_EQ (0u, co_od_get_value (&net, obj, entry, 0, &value));
+   EXPECT_EQ (0x12345678u, value);
+   EXPECT_EQ (0x12345678u, version::get());
+
+   obj   = co_obj_find (&net, 0x1018);
+   entry = co_entry_find (&net, obj, 1);
+   EXPECT_EQ (0u, co_od_get_value (&net, obj, entry, 1, &value));
+   EXPECT_EQ (0x1337u, value);
+   entry = co_entry_find (&net, obj, 4);
+   EXPECT_EQ (0u, co_od_get_value (&net, obj, entry, 4, &value));
+   EXPECT_EQ (4u, value);
+}
+
+TEST_F (DictionaryTest, TPDO)
+{
+   const co_obj_t * obj = co_obj_find (&net, 0x1A00);
+   EXPECT_EQ (MAX_PDO_ENTRIES, obj->max_subindex);
+   EXPECT_EQ (co_od1A00_fn, obj->access);
+
+   // Map input and flag to TPDO
+   EXPECT_EQ (0u, co_od_set_value (&net, obj, co_entry_find (&net, obj, 0), 0, 0));
+
+   mock_co_obj_find_result   = co_obj_find (&net, 0x6001);
+   mock_co_entry_find_result = co_entry_find (&net, mock_co_obj_find_result, 0);
+   EXPECT_EQ (
+      0u,
+      co_od_set_value (&net, obj, co_entry_find (&net, obj, 1), 1, 0x60010010));
+
+   mock_co_obj_find_result   = co_obj_find (&net, 0x6002);
+   mock_co_entry_find_result = co_entry_find (&net, mock_co_obj_find_result, 0);
+   EXPECT_EQ (
+      0u,
+      co_od_set_value (&net, obj, co_entry_find (&net, obj, 2), 2, 0x60020001));
+
+   EXPECT_EQ (0u, co_od_set_value (&net, obj, co_entry_find (&net, obj, 0), 0, 2));
+   EXPECT_EQ (17u, net.pdo_tx[0].bitlength);
+
+   // Output is not mappable to TPDO
+   EXPECT_EQ (0u, co_od_set_value (&net, obj, co_entry_find (&net, obj, 0), 0, 0));
+   mock_co_obj_find_result   = co_obj_find (&net, 0x6000);
+   mock_co_entry_find_result = co_entry_find (&net, mock_co_obj_find_result, 0);
+   EXPECT_EQ (
+      CO_SDO_ABORT_UNMAPPABLE,
+      co_od_set_value (&net, obj, co_entry_find (&net, obj, 1), 1, 0x60000040));
+}
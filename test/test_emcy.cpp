@@ -29,6 +29,14 @@ class EmcyTest : public TestBase
       cb_emcy_result = false;
    }
 
+   // Read error history (1003h), subindex 1 is the latest error
+   uint32_t error (uint8_t subindex)
+   {
+      uint32_t value = 0;
+      EXPECT_EQ (0u, co_od1003_fn (&net, OD_EVENT_READ, NULL, NULL, subindex, &value));
+      return value;
+   }
+
    uint8_t msef[5] = {5, 4, 3, 2, 1};
 };
 
@@ -55,20 +63,20 @@ TEST_F (EmcyTest, AddError)
    co_emcy_tx (&net, 1, 0x1234, msef);
    EXPECT_EQ (1u, cb_emcy_calls);
    EXPECT_EQ (1u, net.number_of_errors);
-   EXPECT_EQ (0x12340001u, net.errors[0]);
+   EXPECT_EQ (0x12340001u, error (1));
 
    co_emcy_tx (&net, 2, 0, msef);
    EXPECT_EQ (2u, cb_emcy_calls);
    EXPECT_EQ (2u, net.number_of_errors);
-   EXPECT_EQ (2u, net.errors[0]);
-   EXPECT_EQ (0x12340001u, net.errors[1]);
+   EXPECT_EQ (2u, error (1));
+   EXPECT_EQ (0x12340001u, error (2));
 
    co_emcy_tx (&net, 3, 0, msef);
    EXPECT_EQ (3u, cb_emcy_calls);
    EXPECT_EQ (3u, net.number_of_errors);
-   EXPECT_EQ (3u, net.errors[0]);
-   EXPECT_EQ (2u, net.errors[1]);
-   EXPECT_EQ (0x12340001u, net.errors[2]);
+   EXPECT_EQ (3u, error (1));
+   EXPECT_EQ (2u, error (2));
+   EXPECT_EQ (0x12340001u, error (3));
 
    // Read back number of errors
    value  = 99;
@@ -96,13 +104,13 @@ TEST_F (EmcyTest, MaxErrors)
       co_emcy_tx (&net, ix, 0, msef);
    }
    EXPECT_EQ (MAX_ERRORS, net.number_of_errors);
-   EXPECT_EQ (0u, net.errors[MAX_ERRORS - 1]);
+   EXPECT_EQ (0u, error (MAX_ERRORS));
 
    // Overflow list
    co_emcy_tx (&net, 4242, 0, msef);
    EXPECT_EQ (MAX_ERRORS, net.number_of_errors);
-   EXPECT_EQ (4242u, net.errors[0]);
-   EXPECT_EQ (1u, net.errors[MAX_ERRORS - 1]);
+   EXPECT_EQ (4242u, error (1));
+   EXPECT_EQ (1u, error (MAX_ERRORS));
 }
 
 TEST_F (EmcyTest, ClearErrors)
@@ -193,6 +201,54 @@ TEST_F (EmcyTest, EmcyConsumer)
    EXPECT_EQ (0u, result);
 }
 
+TEST_F (EmcyTest, EmcyConsumerCobId)
+{
+   const co_obj_t * obj1028 = find_obj (0x1028);
+   uint8_t emcy[8]          = {0x30, 0x81, 0x03, 0x05, 0x04, 0x03, 0x02, 0x01};
+   uint32_t value;
+
+   // Subindex gives node of COB ID outside 81h - FFh
+   value = 0x305;
+   EXPECT_EQ (0u, co_od1028_fn (&net, OD_EVENT_WRITE, obj1028, NULL, 2, &value));
+   value = CO_EXT_MASK | 0x85;
+   EXPECT_EQ (0u, co_od1028_fn (&net, OD_EVENT_WRITE, obj1028, NULL, 3, &value));
+
+   co_emcy_rx (&net, 0x305, emcy, sizeof (emcy));
+   EXPECT_EQ (1u, cb_emcy_calls);
+   EXPECT_EQ (2u, cb_emcy_node);
+
+   co_emcy_rx (&net, CO_EXT_MASK | 0x85, emcy, sizeof (emcy));
+   EXPECT_EQ (2u, cb_emcy_calls);
+   EXPECT_EQ (3u, cb_emcy_node);
+
+   // Default COB IDs of these nodes are not consumed
+   co_emcy_rx (&net, 0x82, emcy, sizeof (emcy));
+   co_emcy_rx (&net, 0x85, emcy, sizeof (emcy));
+   co_emcy_rx (&net, CO_RTR_MASK | 0x305, emcy, sizeof (emcy));
+   EXPECT_EQ (2u, cb_emcy_calls);
+
+   // Should stop consuming when COB ID is invalidated
+   value = CO_COBID_INVALID | 0x305;
+   co_od1028_fn (&net, OD_EVENT_WRITE, obj1028, NULL, 2, &value);
+   co_emcy_rx (&net, 0x305, emcy, sizeof (emcy));
+   EXPECT_EQ (2u, cb_emcy_calls);
+}
+
+TEST_F (EmcyTest, EmcyConsumerBadLength)
+{
+   uint8_t emcy[8] = {0x30, 0x81, 0x03, 0x05, 0x04, 0x03, 0x02, 0x01};
+
+   net.emcy.consume_all = true;
+
+   // Short EMCY is ignored
+   EXPECT_EQ (-1, co_emcy_rx (&net, 0x81, emcy, 4));
+   EXPECT_EQ (0u, cb_emcy_calls);
+   EXPECT_EQ (0u, net.stats.emcy_rx);
+
+   EXPECT_EQ (0, co_emcy_rx (&net, 0x81, emcy, sizeof (emcy)));
+   EXPECT_EQ (1u, cb_emcy_calls);
+}
+
 TEST_F (EmcyTest, NMTErrorBehavior)
 {
    const co_obj_t * obj1029 = find_obj (0x1029);
@@ -434,3 +490,201 @@ TEST_F (EmcyTest, EmcyInhibit)
    co_emcy_tx (&net, 0x8130, 0x1234, msef);
    EXPECT_EQ (2u, mock_os_channel_send_calls);
 }
+
+TEST_F (EmcyTest, EmcyInhibitQueue)
+{
+   uint8_t expected[8] = {0x02, 0x00, 0x00, 0x05, 0x04, 0x03, 0x02, 0x01};
+
+   net.emcy.inhibit = 10; // 10 * 100 us
+
+   // First EMCY is sent, burst is queued
+   mock_os_tick_current_result = 10 * 100;
+   co_emcy_tx (&net, 1, 0, msef);
+   co_emcy_tx (&net, 2, 0, msef);
+   co_emcy_tx (&net, 3, 0, msef);
+   EXPECT_EQ (1u, mock_os_channel_send_calls);
+   EXPECT_EQ (2u, net.emcy.queued);
+
+   // Inhibit time active
+   co_emcy_timer (&net, 15 * 100);
+   EXPECT_EQ (1u, mock_os_channel_send_calls);
+
+   // One queued EMCY is sent per inhibit time, in order
+   co_emcy_timer (&net, 20 * 100);
+   EXPECT_EQ (2u, mock_os_channel_send_calls);
+   EXPECT_TRUE (CanMatch (0x81, expected, 8));
+
+   co_emcy_timer (&net, 30 * 100);
+   EXPECT_EQ (3u, mock_os_channel_send_calls);
+   EXPECT_EQ (0u, net.emcy.queued);
+   EXPECT_EQ (3u, net.stats.emcy_tx);
+}
+
+TEST_F (EmcyTest, EmcyQueueFull)
+{
+   net.emcy.inhibit = 10;
+
+   mock_os_tick_current_result = 10 * 100;
+   for (unsigned int ix = 0; ix < CO_EMCY_QUEUE_SIZE + 3; ix++)
+   {
+      co_emcy_tx (&net, 0x1000, 0, msef);
+   }
+
+   // First EMCY was sent, the rest fill the queue
+   EXPECT_EQ (1u, mock_os_channel_send_calls);
+   EXPECT_EQ (CO_EMCY_QUEUE_SIZE, net.emcy.queued);
+   EXPECT_EQ (2u, net.stats.emcy_dropped);
+
+   // Error history is complete
+   EXPECT_EQ (MAX_ERRORS, net.number_of_errors);
+}
+
+TEST_F (EmcyTest, EmcySendFailed)
+{
+   // EMCY stays queued while it can not be sent
+   mock_os_channel_send_result = -1;
+   co_emcy_tx (&net, 0x8140, 0, NULL);
+   EXPECT_EQ (1u, mock_os_channel_send_calls);
+   EXPECT_EQ (1u, net.emcy.queued);
+   EXPECT_EQ (0u, net.stats.emcy_tx);
+
+   mock_os_channel_send_result = 0;
+   co_emcy_timer (&net, 0);
+   EXPECT_EQ (2u, mock_os_channel_send_calls);
+   EXPECT_EQ (0u, net.emcy.queued);
+   EXPECT_EQ (1u, net.stats.emcy_tx);
+}
+
+TEST_F (EmcyTest, EmcyStream)
+{
+   co_emcy_stream_t stream = {};
+   co_emcy_record_t record;
+
+   net.emcy.stream = &stream;
+   stream.event    = os_event_create();
+   net.emcy.error  = CO_ERR_CURRENT;
+
+   mock_os_tick_current_result = 1234;
+   co_emcy_tx (&net, 0x2310, 0x0042, msef);
+   co_emcy_tx (&net, 0x2311, 0, NULL);
+
+   EXPECT_TRUE (co_emcy_stream_read (&stream, &record));
+   EXPECT_EQ (1234u, record.timestamp);
+   EXPECT_EQ (0u, record.lost);
+   EXPECT_EQ (0x2310u, record.code);
+   EXPECT_EQ (0x0042u, record.info);
+   EXPECT_EQ (CO_ERR_CURRENT | CO_ERR_GENERIC, record.reg);
+   EXPECT_EQ (0, memcmp (msef, record.msef, sizeof (msef)));
+
+   EXPECT_TRUE (co_emcy_stream_read (&stream, &record));
+   EXPECT_EQ (0x2311u, record.code);
+   EXPECT_FALSE (co_emcy_stream_read (&stream, &record));
+
+   // Overflow ring, lost records are counted in next record
+   for (unsigned int ix = 0; ix < CO_EMCY_STREAM_SIZE + 2; ix++)
+   {
+      co_emcy_tx (&net, (uint16_t)ix, 0, NULL);
+   }
+   for (unsigned int ix = 0; ix < CO_EMCY_STREAM_SIZE; ix++)
+   {
+      EXPECT_TRUE (co_emcy_stream_read (&stream, &record));
+   }
+   co_emcy_tx (&net, 0x5000, 0, NULL);
+   EXPECT_TRUE (co_emcy_stream_read (&stream, &record));
+   EXPECT_EQ (0x5000u, record.code);
+   EXPECT_EQ (2u, record.lost);
+
+   os_event_destroy (stream.event);
+   net.emcy.stream = NULL;
+}
+
+TEST_F (EmcyTest, EmcyConsumeAll)
+{
+   uint8_t emcy[8] = {0x30, 0x81, 0x03, 0x05, 0x04, 0x03, 0x02, 0x01};
+   co_emcy_status_t status;
+   co_job_t job = {};
+
+   job.type        = CO_JOB_EMCY_STATUS_GET;
+   job.emcy.status = &status;
+
+   // Should not consume EMCY from node not in 1028h
+   co_emcy_rx (&net, 0xFF, emcy, sizeof (emcy));
+   EXPECT_EQ (0u, cb_emcy_calls);
+   job.emcy.node = 127;
+   co_emcy_job (&net, &job);
+   EXPECT_EQ (CO_STATUS_ERROR, job.result);
+
+   // Should consume EMCY from all nodes
+   net.emcy.consume_all = true;
+   for (uint32_t id = 0x81; id <= 0xFF; id++)
+   {
+      co_emcy_rx (&net, id, emcy, sizeof (emcy));
+   }
+   EXPECT_EQ (127u, cb_emcy_calls);
+   EXPECT_EQ (127u, net.stats.emcy_rx);
+   EXPECT_EQ (127u, cb_emcy_node);
+
+   mock_os_tick_current_result = 1000;
+   emcy[0]                     = 0x10;
+   co_emcy_rx (&net, 0xFF, emcy, sizeof (emcy));
+
+   co_emcy_job (&net, &job);
+   EXPECT_EQ (0, job.result);
+   EXPECT_EQ (1000u, status.timestamp);
+   EXPECT_EQ (2u, status.count);
+   EXPECT_EQ (0u, status.suppressed);
+   EXPECT_EQ (0x8110u, status.code);
+   EXPECT_EQ (0x03u, status.reg);
+   EXPECT_EQ (0x01u, status.msef[4]);
+
+   // Node 0 is not a valid producer
+   job.emcy.node = 0;
+   co_emcy_job (&net, &job);
+   EXPECT_EQ (CO_STATUS_ERROR, job.result);
+}
+
+TEST_F (EmcyTest, EmcyConsumerRateLimit)
+{
+   const co_obj_t * obj1028 = find_obj (0x1028);
+   uint8_t emcy[8]          = {0x30, 0x81, 0x03, 0, 0, 0, 0, 0};
+   uint8_t reset[8]         = {0};
+   uint32_t value;
+   co_emcy_status_t status;
+   co_job_t job = {};
+
+   value = 0x85;
+   co_od1028_fn (&net, OD_EVENT_WRITE, obj1028, NULL, 1, &value);
+   net.emcy.rate = 10000;
+
+   // First EMCY is passed, following EMCYs are only counted
+   co_emcy_rx (&net, 0x85, emcy, sizeof (emcy));
+   mock_os_tick_current_result = 5000;
+   co_emcy_rx (&net, 0x85, emcy, sizeof (emcy));
+   co_emcy_rx (&net, 0x85, emcy, sizeof (emcy));
+   EXPECT_EQ (1u, cb_emcy_calls);
+
+   // Error reset is always passed
+   co_emcy_rx (&net, 0x85, reset, sizeof (reset));
+   EXPECT_EQ (2u, cb_emcy_calls);
+   EXPECT_EQ (0u, cb_emcy_code);
+
+   // EMCY is passed when rate limit period has expired
+   mock_os_tick_current_result = 15000;
+   co_emcy_rx (&net, 0x85, emcy, sizeof (emcy));
+   EXPECT_EQ (3u, cb_emcy_calls);
+
+   job.type        = CO_JOB_EMCY_STATUS_GET;
+   job.emcy.node   = 5;
+   job.emcy.status = &status;
+   co_emcy_job (&net, &job);
+   EXPECT_EQ (0, job.result);
+   EXPECT_EQ (5u, status.count);
+   EXPECT_EQ (2u, status.suppressed);
+   EXPECT_EQ (0x8130u, status.code);
+
+   // Should stop consuming when COB ID is invalidated
+   value = CO_COBID_INVALID | 0x85;
+   co_od1028_fn (&net, OD_EVENT_WRITE, obj1028, NULL, 1, &value);
+   co_emcy_rx (&net, 0x85, emcy, sizeof (emcy));
+   EXPECT_EQ (5u, net.stats.emcy_rx);
+}
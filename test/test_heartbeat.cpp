@@ -101,8 +101,9 @@ TEST_F (HeartbeatTest, HeartbeatConsumer)
 {
    uint8_t heartbeat = 5;
 
-   net.heartbeat[0].node = 1;
-   net.heartbeat[0].time = 1000;
+   uint32_t value = (1 << 16) | 1000;
+
+   co_od1016_fn (&net, OD_EVENT_WRITE, NULL, NULL, 1, &value);
 
    // Receive heartbeat within timer window
    mock_os_tick_current_result = 500 * 1000;
@@ -141,8 +142,9 @@ TEST_F (HeartbeatTest, ShouldMaintainNodeMap)
 {
    uint8_t heartbeat = 0x01;
 
-   net.heartbeat[0].node = 1;
-   net.heartbeat[0].time = 1000;
+   uint32_t value = (1 << 16) | 1000;
+
+   co_od1016_fn (&net, OD_EVENT_WRITE, NULL, NULL, 1, &value);
 
    // Receive heartbeat within timer window, should set active node ID
    mock_os_tick_current_result = 500 * 1000;
@@ -153,3 +155,75 @@ TEST_F (HeartbeatTest, ShouldMaintainNodeMap)
    co_heartbeat_timer (&net, 1500 * 1000);
    EXPECT_FALSE (co_bitmap_get (net.nodes, 1));
 }
+
+TEST_F (HeartbeatTest, HeartbeatConsumerDeadlineOrder)
+{
+   uint8_t heartbeat = 5;
+   uint32_t value;
+
+   value = (1 << 16) | 3000;
+   co_od1016_fn (&net, OD_EVENT_WRITE, NULL, NULL, 1, &value);
+   value = (2 << 16) | 1000;
+   co_od1016_fn (&net, OD_EVENT_WRITE, NULL, NULL, 2, &value);
+   value = (3 << 16) | 2000;
+   co_od1016_fn (&net, OD_EVENT_WRITE, NULL, NULL, 3, &value);
+
+   // Node 4 is not consumed
+   mock_os_tick_current_result = 0;
+   co_heartbeat_rx (&net, 1, &heartbeat, 1);
+   co_heartbeat_rx (&net, 2, &heartbeat, 1);
+   co_heartbeat_rx (&net, 3, &heartbeat, 1);
+   co_heartbeat_rx (&net, 4, &heartbeat, 1);
+   EXPECT_EQ (3u, cb_heartbeat_state_calls);
+   EXPECT_TRUE (co_bitmap_get (net.nodes, 4));
+
+   // Node 2 expires first
+   co_heartbeat_timer (&net, 1000 * 1000);
+   EXPECT_EQ (4u, cb_heartbeat_state_calls);
+   EXPECT_EQ (2u, cb_heartbeat_state_node);
+   EXPECT_EQ (1u, mock_co_emcy_tx_calls);
+
+   // Heartbeat from node 3 extends its deadline
+   mock_os_tick_current_result = 1500 * 1000;
+   co_heartbeat_rx (&net, 3, &heartbeat, 1);
+
+   // Node 1 expires next
+   co_heartbeat_timer (&net, 3000 * 1000);
+   EXPECT_EQ (5u, cb_heartbeat_state_calls);
+   EXPECT_EQ (1u, cb_heartbeat_state_node);
+   EXPECT_EQ (2u, mock_co_emcy_tx_calls);
+   EXPECT_EQ (5, net.heartbeat[2].state);
+
+   // Then node 3
+   co_heartbeat_timer (&net, 3500 * 1000);
+   EXPECT_EQ (6u, cb_heartbeat_state_calls);
+   EXPECT_EQ (3u, cb_heartbeat_state_node);
+   EXPECT_EQ (3u, mock_co_emcy_tx_calls);
+   EXPECT_EQ (0u, net.hb_heap_size);
+}
+
+TEST_F (HeartbeatTest, HeartbeatConsumerReconfigure)
+{
+   uint8_t heartbeat = 5;
+   uint32_t value    = (1 << 16) | 1000;
+
+   co_od1016_fn (&net, OD_EVENT_WRITE, NULL, NULL, 1, &value);
+   mock_os_tick_current_result = 0;
+   co_heartbeat_rx (&net, 1, &heartbeat, 1);
+   EXPECT_EQ (1u, net.hb_heap_size);
+
+   // Moving the slot to another node stops monitoring of node 1
+   value = (2 << 16) | 1000;
+   co_od1016_fn (&net, OD_EVENT_WRITE, NULL, NULL, 1, &value);
+   EXPECT_EQ (0u, net.hb_heap_size);
+   EXPECT_FALSE (co_bitmap_get (net.hb_consumed, 1));
+   EXPECT_TRUE (co_bitmap_get (net.hb_consumed, 2));
+
+   co_heartbeat_timer (&net, 2000 * 1000);
+   EXPECT_EQ (0u, mock_co_emcy_tx_calls);
+
+   // Node 2 may not be consumed twice
+   EXPECT_EQ (
+      CO_SDO_ABORT_PARAM_INCOMPATIBLE,
+      co_od1016_fn (&net, OD_EVENT_WRITE, NULL, NULL, 2, &value));
+}
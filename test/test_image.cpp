@@ -0,0 +1,166 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_image.h"
+#include "test_util.h"
+
+#include <atomic>
+#include <thread>
+
+// Test fixture
+
+class ImageTest : public TestBase
+{
+ protected:
+   virtual void SetUp()
+   {
+      TestBase::SetUp();
+      net.image = NULL;
+   }
+
+   // Allocate tables again, including the process image
+   int image_init()
+   {
+      co_arena_t a;
+
+      net.sizes.process_image = true;
+      arena.assign (co_arena_tables_size (&net.sizes), 0);
+      co_arena_init (&a, arena.data(), arena.size());
+      return co_arena_tables (&net, &a);
+   }
+};
+
+// Tests
+
+TEST_F (ImageTest, NoImage)
+{
+   uint8_t data[] = {1, 2, 3, 4};
+   co_image_entry_t entry;
+
+   co_image_rx (&net, 0x185, data, sizeof (data));
+   EXPECT_EQ (-1, co_image_read (&net, 5, 1, &entry));
+}
+
+TEST_F (ImageTest, Init)
+{
+   co_image_entry_t entry;
+   unsigned int node;
+   uint8_t pdo;
+
+   ASSERT_EQ (0, image_init());
+   EXPECT_EQ (0u, (uintptr_t)net.image % CO_IMAGE_ALIGN);
+
+   for (node = 1; node <= 127; node++)
+   {
+      for (pdo = 1; pdo <= CO_IMAGE_PDOS; pdo++)
+      {
+         EXPECT_EQ (0, co_image_read (&net, node, pdo, &entry));
+         EXPECT_EQ (0u, entry.count);
+      }
+   }
+
+   // Bad arguments
+   EXPECT_EQ (-1, co_image_read (&net, 0, 1, &entry));
+   EXPECT_EQ (-1, co_image_read (&net, 128, 1, &entry));
+   EXPECT_EQ (-1, co_image_read (&net, 1, 0, &entry));
+   EXPECT_EQ (-1, co_image_read (&net, 1, 5, &entry));
+}
+
+TEST_F (ImageTest, Receive)
+{
+   uint8_t data[][8] = {
+      {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08},
+      {0x11, 0x12},
+   };
+   co_image_entry_t entry;
+
+   ASSERT_EQ (0, image_init());
+
+   mock_os_tick_current_result = 1000;
+   co_image_rx (&net, 0x185, data[0], 8);
+   EXPECT_EQ (0, co_image_read (&net, 5, 1, &entry));
+   EXPECT_EQ (1u, entry.count);
+   EXPECT_EQ (1000u, entry.timestamp);
+   EXPECT_EQ (8u, entry.dlc);
+   EXPECT_EQ (0, memcmp (data[0], entry.data, 8));
+
+   mock_os_tick_current_result = 2000;
+   co_image_rx (&net, 0x185, data[1], 2);
+   EXPECT_EQ (0, co_image_read (&net, 5, 1, &entry));
+   EXPECT_EQ (2u, entry.count);
+   EXPECT_EQ (2000u, entry.timestamp);
+   EXPECT_EQ (2u, entry.dlc);
+   EXPECT_EQ (0, memcmp (data[1], entry.data, 2));
+
+   // TPDO4 of node 127
+   co_image_rx (&net, 0x4FF, data[0], 8);
+   EXPECT_EQ (0, co_image_read (&net, 127, 4, &entry));
+   EXPECT_EQ (1u, entry.count);
+
+   // Other PDOs of node are unchanged
+   EXPECT_EQ (0, co_image_read (&net, 5, 2, &entry));
+   EXPECT_EQ (0u, entry.count);
+
+   // RPDOs, RTR and other functions are ignored
+   co_image_rx (&net, 0x205, data[0], 8);
+   co_image_rx (&net, 0x585, data[0], 8);
+   co_image_rx (&net, 0x180, data[0], 8);
+   co_image_rx (&net, 0x285 | CO_RTR_MASK, data[0], 0);
+   EXPECT_EQ (0, co_image_read (&net, 5, 2, &entry));
+   EXPECT_EQ (0u, entry.count);
+}
+
+TEST_F (ImageTest, ConcurrentRead)
+{
+   std::atomic<bool> done (false);
+   unsigned int inconsistent = 0;
+   uint32_t n;
+
+   ASSERT_EQ (0, image_init());
+
+   // Reader expects all bytes of payload to be equal
+   std::thread reader ([&] {
+      co_image_entry_t entry;
+      unsigned int ix;
+
+      while (!done)
+      {
+         if (co_image_read (&net, 1, 1, &entry) != 0 || entry.count == 0)
+            continue;
+
+         for (ix = 1; ix < 8; ix++)
+         {
+            if (entry.data[ix] != entry.data[0])
+               inconsistent++;
+         }
+
+         if (entry.data[0] != (uint8_t)entry.count)
+            inconsistent++;
+      }
+   });
+
+   for (n = 1; n <= 100000; n++)
+   {
+      uint8_t data[8];
+
+      memset (data, (uint8_t)n, sizeof (data));
+      co_image_rx (&net, 0x181, data, sizeof (data));
+   }
+
+   done = true;
+   reader.join();
+
+   EXPECT_EQ (0u, inconsistent);
+}
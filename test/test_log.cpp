@@ -0,0 +1,154 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_log.h"
+#include "co_main.h"
+#include "co_util.h"
+#include "test_util.h"
+
+#include <thread>
+
+// Test fixture
+
+class LogTest : public TestBase
+{
+ protected:
+   void SetUp() override
+   {
+      TestBase::SetUp();
+      co_trace_clear();
+   }
+
+   // Dump trace into dump
+   int trace_dump()
+   {
+      dump.clear();
+      return co_trace_dump (vector_write, &dump);
+   }
+
+   const uint8_t * record (size_t ix)
+   {
+      return &dump[CO_TRACE_HEADER_SIZE + ix * CO_TRACE_RECORD_SIZE];
+   }
+
+   std::vector<uint8_t> dump;
+};
+
+// Tests
+
+TEST_F (LogTest, Empty)
+{
+   EXPECT_EQ (0, trace_dump());
+   ASSERT_EQ ((size_t)CO_TRACE_HEADER_SIZE, dump.size());
+
+   EXPECT_EQ ((uint32_t)CO_TRACE_MAGIC, co_fetch_uint32 (&dump[0]));
+   EXPECT_EQ (CO_TRACE_VERSION, co_fetch_uint16 (&dump[4]));
+   EXPECT_EQ (CO_TRACE_RECORD_SIZE, co_fetch_uint16 (&dump[6]));
+   EXPECT_EQ (1000000u, co_fetch_uint32 (&dump[8]));
+
+   EXPECT_EQ (-1, co_trace_dump (fail_write, NULL));
+}
+
+#if CO_CAN_LOG == LOG_STATE_ON
+
+TEST_F (LogTest, Records)
+{
+   const uint8_t data[] = {0x11, 0x22, 0x33};
+
+   mock_os_tick_current_result = 100;
+   co_trace (CO_TRACE_TX, 0x181, data, sizeof (data));
+   mock_os_tick_current_result = 200;
+   co_trace (0, 0x80, NULL, 0);
+   mock_os_tick_current_result = 300;
+   co_trace (0, 0x281 | CO_RTR_MASK, NULL, 4);
+
+   ASSERT_EQ (3, trace_dump());
+   ASSERT_EQ ((size_t)CO_TRACE_HEADER_SIZE + 3 * CO_TRACE_RECORD_SIZE, dump.size());
+
+   EXPECT_EQ (100u, co_fetch_uint64 (&record (0)[0]));
+   EXPECT_EQ (0x181u, co_fetch_uint32 (&record (0)[8]));
+   EXPECT_EQ (CO_TRACE_TX, record (0)[12]);
+   EXPECT_EQ (3, record (0)[13]);
+   EXPECT_EQ (0, memcmp (&record (0)[16], data, sizeof (data)));
+
+   EXPECT_EQ (200u, co_fetch_uint64 (&record (1)[0]));
+   EXPECT_EQ (0x80u, co_fetch_uint32 (&record (1)[8]));
+   EXPECT_EQ (0, record (1)[12]);
+   EXPECT_EQ (0, record (1)[13]);
+
+   EXPECT_EQ (0x281u | CO_RTR_MASK, co_fetch_uint32 (&record (2)[8]));
+   EXPECT_EQ (4, record (2)[13]);
+}
+
+TEST_F (LogTest, Overwrite)
+{
+   uint32_t ix;
+
+   for (ix = 0; ix < CO_TRACE_SIZE + 10; ix++)
+   {
+      mock_os_tick_current_result = ix;
+      co_trace (CO_TRACE_TX, 0x181, &ix, sizeof (ix));
+   }
+
+   // Oldest frames are overwritten
+   ASSERT_EQ (CO_TRACE_SIZE, trace_dump());
+   for (ix = 0; ix < CO_TRACE_SIZE; ix++)
+   {
+      EXPECT_EQ (ix + 10, co_fetch_uint64 (&record (ix)[0]));
+      EXPECT_EQ (ix + 10, co_fetch_uint32 (&record (ix)[16]));
+   }
+}
+
+TEST_F (LogTest, Concurrent)
+{
+   std::vector<std::thread> threads;
+   unsigned int n;
+
+   for (n = 0; n < 4; n++)
+   {
+      threads.emplace_back ([n] {
+         for (uint32_t ix = 0; ix < 10000; ix++)
+            co_trace (CO_TRACE_TX, 0x181 + n, &ix, sizeof (ix));
+      });
+   }
+
+   // Dumps while tracing hold only complete frames
+   for (n = 0; n < 20; n++)
+   {
+      int count = trace_dump();
+
+      ASSERT_GE (count, 0);
+      ASSERT_LE (count, CO_TRACE_SIZE);
+      for (int ix = 0; ix < count; ix++)
+      {
+         uint32_t id = co_fetch_uint32 (&record (ix)[8]);
+         EXPECT_GE (id, 0x181u);
+         EXPECT_LE (id, 0x184u);
+         EXPECT_EQ (4, record (ix)[13]);
+      }
+   }
+
+   for (auto & thread : threads)
+      thread.join();
+
+   // Frames colliding with a writer still holding their slot may
+   // have been dropped, the ring fills up again without contention
+   EXPECT_LE (trace_dump(), CO_TRACE_SIZE);
+   for (uint32_t ix = 0; ix < CO_TRACE_SIZE; ix++)
+      co_trace (0, 0x80, NULL, 0);
+   EXPECT_EQ (CO_TRACE_SIZE, trace_dump());
+}
+
+#endif /* CO_CAN_LOG == LOG_STATE_ON */
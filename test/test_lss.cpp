@@ -14,6 +14,7 @@
  ********************************************************************/
 
 #include "co_lss.h"
+#include "co_nmt.h"
 #include "test_util.h"
 
 // Test fixture
@@ -239,6 +240,146 @@ TEST_F (LssTest, ActivateBitrate)
    EXPECT_EQ (125 * 1000, mock_os_channel_set_bitrate_bitrate);
 }
 
+TEST_F (LssTest, ActivateAutoBitrate)
+{
+   uint8_t command[][8] = {
+      {0x13, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00}, // Configure
+      {0x15, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // Activate
+   };
+   uint8_t expected[][8] = {
+      {0x13, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+   };
+
+   net.lss.state = LSS_STATE_CONFIG;
+
+   co_lss_rx (&net, 0x7E5, command[0], 8);
+   EXPECT_TRUE (CanMatch (0x7E4, expected[0], 8));
+   EXPECT_EQ (CO_BITRATE_AUTO, net.lss.bitrate);
+
+   co_lss_rx (&net, 0x7E5, command[1], 8);
+   EXPECT_TRUE (net.lss.autobaud);
+   EXPECT_TRUE (mock_os_channel_set_listen_only_enable);
+   EXPECT_EQ (1000 * 1000, mock_os_channel_set_bitrate_bitrate);
+
+   // Detect bitrate while operational
+   EXPECT_FALSE (co_lss_autobaud_rx (&net));
+   EXPECT_FALSE (net.lss.autobaud);
+   EXPECT_FALSE (mock_os_channel_set_listen_only_enable);
+   EXPECT_EQ (1000 * 1000, net.bitrate);
+   EXPECT_EQ (STATE_PREOP, net.state);
+}
+
+TEST_F (LssTest, AutoBitrate)
+{
+   int bitrates[] = {
+      800 * 1000,
+      500 * 1000,
+      250 * 1000,
+      125 * 1000,
+      50 * 1000,
+      20 * 1000,
+      10 * 1000,
+      1000 * 1000,
+      800 * 1000,
+      500 * 1000,
+      250 * 1000,
+   };
+   uint8_t bootup[] = {0};
+   unsigned int ix;
+
+   // Reset communication with unknown bitrate
+   net.bitrate = CO_BITRATE_AUTO;
+   co_nmt_event (&net, EVENT_RESETCOMM);
+   EXPECT_EQ (STATE_INIT, net.state);
+   EXPECT_TRUE (mock_os_channel_set_listen_only_enable);
+   EXPECT_EQ (1000 * 1000, mock_os_channel_set_bitrate_bitrate);
+
+   // Keep bitrate until timeout
+   mock_os_tick_current_result += LSS_AUTOBAUD_TIMEOUT * 1000 - 1;
+   co_lss_autobaud_timer (&net, mock_os_tick_current_result);
+   EXPECT_EQ (1000 * 1000, mock_os_channel_set_bitrate_bitrate);
+
+   // Cycle through standard bitrates
+   for (ix = 0; ix < NELEMENTS (bitrates); ix++)
+   {
+      mock_os_tick_current_result += LSS_AUTOBAUD_TIMEOUT * 1000;
+      co_lss_autobaud_timer (&net, mock_os_tick_current_result);
+      EXPECT_EQ (bitrates[ix], mock_os_channel_set_bitrate_bitrate);
+   }
+
+   // Frame with errors is discarded
+   mock_os_channel_get_state_state.error_passive = true;
+   EXPECT_TRUE (co_lss_autobaud_rx (&net));
+   EXPECT_EQ (STATE_INIT, net.state);
+
+   // Error-free frame completes reset communication
+   mock_os_channel_get_state_state.error_passive = false;
+   EXPECT_FALSE (co_lss_autobaud_rx (&net));
+   EXPECT_EQ (250 * 1000, net.bitrate);
+   EXPECT_FALSE (mock_os_channel_set_listen_only_enable);
+   EXPECT_EQ (STATE_PREOP, net.state);
+   EXPECT_TRUE (CanMatch (0x701, bootup, 1));
+
+   // Detection is finished
+   mock_os_tick_current_result += LSS_AUTOBAUD_TIMEOUT * 1000;
+   co_lss_autobaud_timer (&net, mock_os_tick_current_result);
+   EXPECT_EQ (250 * 1000, mock_os_channel_set_bitrate_bitrate);
+   EXPECT_FALSE (co_lss_autobaud_rx (&net));
+}
+
+TEST_F (LssTest, AutoBitrateNoListenOnly)
+{
+   mock_os_channel_set_listen_only_result = -1;
+
+   // Reset communication completes at the current bitrate
+   net.bitrate = CO_BITRATE_AUTO;
+   co_nmt_event (&net, EVENT_RESETCOMM);
+   EXPECT_EQ (STATE_PREOP, net.state);
+   EXPECT_FALSE (net.lss.autobaud);
+   EXPECT_EQ (0u, mock_os_channel_set_bitrate_calls);
+}
+
+TEST_F (LssTest, AutoBitrateStartFailure)
+{
+   mock_os_channel_set_bitrate_result = -1;
+
+   // Reset communication completes at the current bitrate
+   net.bitrate = CO_BITRATE_AUTO;
+   co_nmt_event (&net, EVENT_RESETCOMM);
+   EXPECT_EQ (STATE_PREOP, net.state);
+   EXPECT_FALSE (net.lss.autobaud);
+   EXPECT_FALSE (mock_os_channel_set_listen_only_enable);
+}
+
+TEST_F (LssTest, AutoBitrateSetFailure)
+{
+   net.bitrate = CO_BITRATE_AUTO;
+   co_nmt_event (&net, EVENT_RESETCOMM);
+   EXPECT_TRUE (net.lss.autobaud);
+
+   // Detection is aborted if the next bitrate can not be set
+   mock_os_channel_set_bitrate_result = -1;
+   mock_os_tick_current_result += LSS_AUTOBAUD_TIMEOUT * 1000;
+   co_lss_autobaud_timer (&net, mock_os_tick_current_result);
+   EXPECT_FALSE (net.lss.autobaud);
+   EXPECT_FALSE (mock_os_channel_set_listen_only_enable);
+   EXPECT_EQ (STATE_PREOP, net.state);
+   EXPECT_FALSE (co_lss_autobaud_rx (&net));
+}
+
+TEST_F (LssTest, AutoBitrateListenOnlyExitFailure)
+{
+   net.bitrate = CO_BITRATE_AUTO;
+   co_nmt_event (&net, EVENT_RESETCOMM);
+   EXPECT_TRUE (net.lss.autobaud);
+
+   // Node does not become active while in listen-only mode
+   mock_os_channel_set_listen_only_result = -1;
+   EXPECT_FALSE (co_lss_autobaud_rx (&net));
+   EXPECT_FALSE (net.lss.autobaud);
+   EXPECT_EQ (STATE_INIT, net.state);
+}
+
 TEST_F (LssTest, Persistence)
 {
    uint8_t command[][8] = {
@@ -260,3 +401,46 @@ TEST_F (LssTest, Persistence)
    EXPECT_EQ (0x42u, co_lss_get_persistent_node_id (&net));
    EXPECT_EQ (125 * 1000, co_lss_get_persistent_bitrate (&net));
 }
+
+TEST_F (LssTest, Fastscan)
+{
+   uint8_t command[][8] = {
+      {0x51, 0x00, 0x00, 0x00, 0x00, 0x80, 0x00, 0x00}, // Reset
+      {0x51, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00}, // Bit 31 of vendor
+      {0x51, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01}, // Wrong vendor
+      {0x51, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01}, // Vendor
+      {0x51, 0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02}, // Product
+      {0x51, 0x03, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03}, // Revision
+      {0x51, 0x04, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00}, // Serial
+   };
+   uint8_t expected[8] = {0x4F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+   // Configured slaves do not take part
+   co_lss_rx (&net, 0x7E5, command[0], 8);
+   EXPECT_EQ (0u, mock_os_channel_send_calls);
+
+   net.state = STATE_INIT;
+
+   co_lss_rx (&net, 0x7E5, command[0], 8);
+   EXPECT_EQ (1u, mock_os_channel_send_calls);
+   EXPECT_TRUE (CanMatch (0x7E4, expected, 8));
+
+   co_lss_rx (&net, 0x7E5, command[1], 8);
+   EXPECT_EQ (2u, mock_os_channel_send_calls);
+   EXPECT_EQ (0u, net.lss.fastscan_pos);
+
+   co_lss_rx (&net, 0x7E5, command[2], 8);
+   EXPECT_EQ (2u, mock_os_channel_send_calls);
+
+   // Product is ignored until vendor has matched
+   co_lss_rx (&net, 0x7E5, command[4], 8);
+   EXPECT_EQ (2u, mock_os_channel_send_calls);
+
+   for (unsigned int ix = 3; ix < NELEMENTS (command); ix++)
+   {
+      co_lss_rx (&net, 0x7E5, command[ix], 8);
+      EXPECT_EQ (ix, mock_os_channel_send_calls);
+   }
+
+   EXPECT_EQ (LSS_STATE_CONFIG, net.lss.state);
+}
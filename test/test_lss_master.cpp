@@ -0,0 +1,270 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_lss.h"
+#include "test_util.h"
+
+#include <memory>
+#include <vector>
+
+// Simulated bus with virtual LSS slaves
+
+#define NUMBER_OF_SLAVES 100
+
+struct Frame
+{
+   uint32_t id;
+   uint8_t data[8];
+};
+
+struct VirtualSlave
+{
+   co_net_t net;
+   uint32_t identity[4];
+   co_entry_t OD1018[5];
+   co_obj_t od[2];
+};
+
+static std::vector<Frame> pending;
+static unsigned int fastscan_frames;
+
+static void bus_send (uint32_t id, const uint8_t * data, size_t dlc)
+{
+   Frame frame = {};
+
+   frame.id = id;
+   memcpy (frame.data, data, dlc);
+   pending.push_back (frame);
+
+   if (id == 0x7E5 && data[0] == CS_FASTSCAN)
+      fastscan_frames++;
+}
+
+class LssMasterTest : public TestBase
+{
+ protected:
+   void SetUp() override
+   {
+      TestBase::SetUp();
+      co_lss_init (&net);
+
+      pending.clear();
+      fastscan_frames           = 0;
+      now                       = 0;
+      mock_os_channel_send_hook = bus_send;
+
+      for (unsigned int ix = 0; ix < NUMBER_OF_SLAVES; ix++)
+      {
+         slaves.emplace_back (new VirtualSlave());
+         init_slave (*slaves.back(), ix);
+      }
+   }
+
+   void init_slave (VirtualSlave & slave, unsigned int ix)
+   {
+      // All slaves are of the same type, with unique serial numbers
+      slave.identity[0] = 0x0000ABCD;
+      slave.identity[1] = 0x00001234;
+      slave.identity[2] = 0x00010002;
+      slave.identity[3] = 0x9E3779B9u * (ix + 1);
+
+      slave.OD1018[0] = {0, OD_RO, DTYPE_UNSIGNED8, 8, 4, NULL};
+      for (unsigned int sub = 1; sub <= 4; sub++)
+      {
+         slave.OD1018[sub] =
+            {(uint8_t)sub, OD_RO, DTYPE_UNSIGNED32, 32, 0, &slave.identity[sub - 1]};
+      }
+
+      slave.od[0] = {0x1018, OTYPE_RECORD, 4, slave.OD1018, NULL, NULL};
+      slave.od[1] = {0, OTYPE_NULL, 0, NULL, NULL, NULL};
+
+      slave.net.od    = slave.od;
+      slave.net.state = STATE_INIT;
+      co_lss_init (&slave.net);
+      slave.net.lss.node = 0xFF;
+   }
+
+   void deliver (const Frame & frame)
+   {
+      if (frame.id == 0x7E5)
+      {
+         for (auto & slave : slaves)
+            co_lss_rx (&slave->net, frame.id, (uint8_t *)frame.data, 8);
+      }
+      else if (frame.id == 0x7E4)
+      {
+         co_lss_rx (&net, frame.id, (uint8_t *)frame.data, 8);
+      }
+   }
+
+   void flush()
+   {
+      while (!pending.empty())
+      {
+         std::vector<Frame> batch;
+
+         // Identical frames sent at the same time appear as one frame
+         for (const Frame & frame : pending)
+         {
+            bool duplicate = false;
+
+            for (const Frame & other : batch)
+            {
+               if (other.id == frame.id && memcmp (other.data, frame.data, 8) == 0)
+                  duplicate = true;
+            }
+
+            if (!duplicate)
+               batch.push_back (frame);
+         }
+         pending.clear();
+
+         for (const Frame & frame : batch)
+            deliver (frame);
+      }
+   }
+
+   int run (co_job_t * job)
+   {
+      unsigned int calls = cb_job_calls;
+
+      job->callback = cb_job;
+      co_lss_master_job (&net, job);
+
+      for (int n = 0; n < 1000 && cb_job_calls == calls; n++)
+      {
+         flush();
+         if (cb_job_calls != calls)
+            break;
+
+         now += LSS_TIMEOUT * 1000;
+         mock_os_tick_current_result = now;
+         co_lss_master_timer (&net, now);
+      }
+
+      EXPECT_EQ (calls + 1, cb_job_calls);
+      flush();
+      return job->result;
+   }
+
+   int fastscan (co_lss_address_t * address)
+   {
+      co_job_t job = {};
+
+      job.type        = CO_JOB_LSS_FASTSCAN;
+      job.lss.address = address;
+      return run (&job);
+   }
+
+   int request (uint8_t cs, uint8_t arg1, uint8_t arg2, bool response)
+   {
+      co_job_t job = {};
+
+      job.type         = CO_JOB_LSS_REQUEST;
+      job.lss.msg[0]   = cs;
+      job.lss.msg[1]   = arg1;
+      job.lss.msg[2]   = arg2;
+      job.lss.response = response;
+      if (run (&job) < 0)
+         return -1;
+
+      return response ? job.lss.msg[1] : 0;
+   }
+
+   VirtualSlave * find_slave (const co_lss_address_t & address)
+   {
+      for (auto & slave : slaves)
+      {
+         if (
+            slave->identity[0] == address.vendor &&
+            slave->identity[1] == address.product &&
+            slave->identity[2] == address.revision &&
+            slave->identity[3] == address.serial)
+            return slave.get();
+      }
+      return nullptr;
+   }
+
+   os_tick_t now;
+   std::vector<std::unique_ptr<VirtualSlave>> slaves;
+};
+
+// Tests
+
+TEST_F (LssMasterTest, NoSlaves)
+{
+   co_lss_address_t address;
+
+   slaves.clear();
+   EXPECT_EQ (-1, fastscan (&address));
+   EXPECT_EQ (1u, fastscan_frames);
+}
+
+TEST_F (LssMasterTest, Request)
+{
+   co_lss_address_t address;
+
+   ASSERT_EQ (0, fastscan (&address));
+   EXPECT_EQ (LSS_STATE_CONFIG, find_slave (address)->net.lss.state);
+
+   // Bad node ID is rejected by slave
+   EXPECT_EQ (1, request (CS_CONFIGURE_NODE_ID, 0x80, 0, true));
+   EXPECT_EQ (0, request (CS_CONFIGURE_NODE_ID, 0x10, 0, true));
+   EXPECT_EQ (0, request (CS_CONFIGURE_BIT_TIMING, 0, LSS_BITRATE_250K, true));
+
+   // Slave has no storage
+   EXPECT_EQ (1, request (CS_STORE_CONFIGURATION, 0, 0, true));
+
+   EXPECT_EQ (0, request (CS_SWITCH_GLOBAL, LSS_STATE_WAITING, 0, false));
+   EXPECT_EQ (0x10, find_slave (address)->net.node);
+   EXPECT_EQ (250 * 1000, find_slave (address)->net.lss.bitrate);
+
+   // No slave in configuration state
+   EXPECT_EQ (-1, request (CS_CONFIGURE_NODE_ID, 0x11, 0, true));
+}
+
+TEST_F (LssMasterTest, AssignNodeIds)
+{
+   co_lss_address_t address;
+   uint32_t previous = 0;
+   unsigned int n;
+
+   // Give each non-configured slave the next node ID
+   for (n = 0; n < NUMBER_OF_SLAVES; n++)
+   {
+      VirtualSlave * slave;
+
+      ASSERT_EQ (0, fastscan (&address));
+
+      slave = find_slave (address);
+      ASSERT_NE (nullptr, slave);
+      EXPECT_EQ (LSS_STATE_CONFIG, slave->net.lss.state);
+
+      // Slaves are found in order of LSS address
+      EXPECT_LT (previous, address.serial);
+      previous = address.serial;
+
+      EXPECT_EQ (0, request (CS_CONFIGURE_NODE_ID, 2 + n, 0, true));
+      EXPECT_EQ (0, request (CS_SWITCH_GLOBAL, LSS_STATE_WAITING, 0, false));
+      EXPECT_EQ (2 + n, slave->net.node);
+      EXPECT_EQ (STATE_PREOP, slave->net.state);
+   }
+
+   // All slaves are configured
+   EXPECT_EQ (-1, fastscan (&address));
+
+   // One request per bit and one per value, no probing of candidates
+   EXPECT_EQ (NUMBER_OF_SLAVES * (1 + 4 * 33) + 1, fastscan_frames);
+}
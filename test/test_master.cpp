@@ -0,0 +1,272 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_master.h"
+#include "co_sdo.h"
+#include "test_util.h"
+
+// Test fixture
+
+static unsigned int progress_calls;
+static uint8_t progress_node;
+static co_master_state_t progress_state;
+static unsigned int progress_done;
+static unsigned int progress_total;
+
+static void cb_master_progress (
+   co_net_t * net,
+   uint8_t node,
+   co_master_state_t state,
+   unsigned int done,
+   unsigned int total)
+{
+   progress_calls++;
+   progress_node  = node;
+   progress_state = state;
+   progress_done  = done;
+   progress_total = total;
+}
+
+// Concise DCF: 1017h:00 = 1000
+static uint8_t dcf_node;
+static const uint8_t dcf[] = {
+   0x01, 0x00, 0x00, 0x00,                   // Number of entries
+   0x17, 0x10, 0x00, 0x02, 0x00, 0x00, 0x00, // 1017h:00, size 2
+   0xE8, 0x03,
+};
+
+static uint32_t od1F22_fn (
+   co_net_t * net,
+   od_event_t event,
+   const co_obj_t * obj,
+   const co_entry_t * entry,
+   uint8_t subindex,
+   size_t offset,
+   void * data,
+   size_t * size)
+{
+   size_t total = (subindex == dcf_node) ? sizeof (dcf) : 0;
+
+   if (event != OD_EVENT_READ)
+      return CO_SDO_ABORT_GENERAL;
+
+   if (data == NULL)
+   {
+      *size = total;
+      return 0;
+   }
+
+   if (offset > total)
+      return CO_SDO_ABORT_GENERAL;
+
+   *size = MIN (*size, total - offset);
+   memcpy (data, &dcf[offset], *size);
+   return 0;
+}
+
+static const co_obj_ops_t od1F22_ops = {NULL, od1F22_fn, NULL};
+
+class MasterTest : public TestBase
+{
+ protected:
+   void SetUp() override
+   {
+      TestBase::SetUp();
+      net.od                 = master_od;
+      net.cb_master_progress = cb_master_progress;
+      arena_init();
+
+      memset (&job, 0, sizeof (job));
+      job.type     = CO_JOB_MASTER_BOOT;
+      job.callback = cb_job;
+      dcf_node     = 0;
+
+      progress_calls = 0;
+      progress_node  = 0;
+      progress_done  = 0;
+      progress_total = 0;
+
+      memset (arr1F81, 0, sizeof (arr1F81));
+      memset (arr1F84, 0, sizeof (arr1F84));
+      memset (arr1F85, 0, sizeof (arr1F85));
+
+      mock_os_channel_send_calls = 0;
+   }
+
+   void respond (uint8_t node, const uint8_t * msg)
+   {
+      co_sdo_tx (&net, node, (void *)msg, 8);
+   }
+
+   co_job_t job;
+
+   uint32_t arr1F81[127];
+   const co_entry_t OD1F81[2] = {
+      {0x00, OD_RO, DTYPE_UNSIGNED8, 8, 127, NULL},
+      {0x01, OD_RW | OD_ARRAY, DTYPE_UNSIGNED32, 32, 0, arr1F81},
+   };
+
+   uint32_t arr1F84[127];
+   const co_entry_t OD1F84[2] = {
+      {0x00, OD_RO, DTYPE_UNSIGNED8, 8, 127, NULL},
+      {0x01, OD_RW | OD_ARRAY, DTYPE_UNSIGNED32, 32, 0, arr1F84},
+   };
+
+   uint32_t arr1F85[127];
+   const co_entry_t OD1F85[2] = {
+      {0x00, OD_RO, DTYPE_UNSIGNED8, 8, 127, NULL},
+      {0x01, OD_RW | OD_ARRAY, DTYPE_UNSIGNED32, 32, 0, arr1F85},
+   };
+
+   const co_entry_t OD1F22[2] = {
+      {0x00, OD_RO, DTYPE_UNSIGNED8, 8, 127, NULL},
+      {0x01, OD_RW | OD_ARRAY, DTYPE_DOMAIN, 0, 0, NULL},
+   };
+
+   const co_obj_t master_od[6] = {
+      // clang-format off
+      {0x1000, OTYPE_VAR,   0,   OD1000, NULL, NULL},
+      {0x1F22, OTYPE_ARRAY, 127, OD1F22, NULL, &od1F22_ops},
+      {0x1F81, OTYPE_ARRAY, 127, OD1F81, NULL, NULL},
+      {0x1F84, OTYPE_ARRAY, 127, OD1F84, NULL, NULL},
+      {0x1F85, OTYPE_ARRAY, 127, OD1F85, NULL, NULL},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
+      // clang-format on
+   };
+};
+
+// Tests
+
+TEST_F (MasterTest, NoSlaves)
+{
+   co_master_job (&net, &job);
+   EXPECT_EQ (1u, cb_job_calls);
+   EXPECT_EQ (0, job.result);
+   EXPECT_EQ (0u, mock_os_channel_send_calls);
+}
+
+TEST_F (MasterTest, NotMaster)
+{
+   // No NMT slave assignment, no boot-up state is allocated
+   net.od = test_od;
+   arena_init();
+   EXPECT_EQ (nullptr, net.master);
+
+   co_master_job (&net, &job);
+   EXPECT_EQ (1u, cb_job_calls);
+   EXPECT_EQ (-1, job.result);
+   EXPECT_EQ (CO_MASTER_NODE_UNUSED, co_master_state_get (&net, 2));
+}
+
+TEST_F (MasterTest, Boot)
+{
+   static const uint8_t device_type[8] = {0x43, 0x00, 0x10, 0x00, 0x92, 0x01, 0x00, 0x00};
+   static const uint8_t vendor[8]      = {0x43, 0x18, 0x10, 0x01, 0x34, 0x12, 0x00, 0x00};
+   static const uint8_t written[8]     = {0x60, 0x17, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00};
+   uint8_t read1018[8]                 = {0x40, 0x18, 0x10, 0x01, 0x00, 0x00, 0x00, 0x00};
+   uint8_t write1017[8]                = {0x2B, 0x17, 0x10, 0x00, 0xE8, 0x03, 0x00, 0x00};
+   uint8_t start[2]                    = {0x01, 0x02};
+
+   // Node 2 has expected identity and is started
+   arr1F81[2 - 1] = CO_NMT_SLAVE | CO_NMT_SLAVE_BOOT | CO_NMT_SLAVE_MANDATORY;
+   arr1F84[2 - 1] = 0x192;
+   arr1F85[2 - 1] = 0x1234;
+
+   // Node 3 is configured but not started
+   arr1F81[3 - 1] = CO_NMT_SLAVE | CO_NMT_SLAVE_MANDATORY;
+   dcf_node       = 3;
+
+   // Both nodes are booted in parallel
+   co_master_job (&net, &job);
+   EXPECT_EQ (2u, mock_os_channel_send_calls);
+   EXPECT_EQ (CO_MASTER_NODE_IDENTIFY, net.master->state[2]);
+   EXPECT_EQ (CO_MASTER_NODE_IDENTIFY, net.master->state[3]);
+   EXPECT_EQ (CO_MASTER_NODE_UNUSED, net.master->state[4]);
+   EXPECT_EQ (2u, progress_total);
+
+   respond (2, device_type);
+   EXPECT_TRUE (CanMatch (0x602, read1018, 8));
+
+   respond (3, device_type);
+   EXPECT_EQ (CO_MASTER_NODE_CONFIGURE, net.master->state[3]);
+   EXPECT_TRUE (CanMatch (0x603, write1017, 8));
+
+   respond (2, vendor);
+   EXPECT_EQ (CO_MASTER_NODE_OPERATIONAL, net.master->state[2]);
+   EXPECT_TRUE (CanMatch (0x000, start, 2));
+   EXPECT_EQ (1u, progress_done);
+   EXPECT_EQ (0u, cb_job_calls);
+
+   respond (3, written);
+   EXPECT_EQ (CO_MASTER_NODE_CONFIGURED, net.master->state[3]);
+   EXPECT_EQ (3u, progress_node);
+   EXPECT_EQ (2u, progress_done);
+   EXPECT_EQ (1u, cb_job_calls);
+   EXPECT_EQ (0, job.result);
+
+   EXPECT_EQ (NULL, net.job_client[0]);
+   EXPECT_EQ (NULL, net.job_client_pending);
+}
+
+TEST_F (MasterTest, Errors)
+{
+   static const uint8_t device_type[8] = {0x43, 0x00, 0x10, 0x00, 0x91, 0x01, 0x00, 0x00};
+   static const uint8_t abort[8]       = {0x80, 0x00, 0x10, 0x00, 0x00, 0x00, 0x04, 0x05};
+
+   // Node 2 has wrong identity, node 3 is missing
+   arr1F81[2 - 1] = CO_NMT_SLAVE | CO_NMT_SLAVE_MANDATORY;
+   arr1F84[2 - 1] = 0x192;
+   arr1F81[3 - 1] = CO_NMT_SLAVE;
+
+   co_master_job (&net, &job);
+
+   respond (3, abort);
+   EXPECT_EQ (CO_MASTER_NODE_MISSING, net.master->state[3]);
+   EXPECT_EQ (0u, cb_job_calls);
+
+   respond (2, device_type);
+   EXPECT_EQ (CO_MASTER_NODE_WRONG_IDENTITY, net.master->state[2]);
+   EXPECT_EQ (1u, cb_job_calls);
+
+   // Node 2 is mandatory
+   EXPECT_EQ (-1, job.result);
+}
+
+TEST_F (MasterTest, MoreSlavesThanSessions)
+{
+   static const uint8_t device_type[8] = {0x43, 0x00, 0x10, 0x00, 0x92, 0x01, 0x00, 0x00};
+   const unsigned int n = MAX_SDO_CLIENTS + 2;
+   unsigned int ix;
+
+   for (ix = 0; ix < n; ix++)
+   {
+      arr1F81[ix + 1] = CO_NMT_SLAVE;
+   }
+
+   co_master_job (&net, &job);
+   EXPECT_EQ ((unsigned)MAX_SDO_CLIENTS, mock_os_channel_send_calls);
+   EXPECT_EQ (CO_MASTER_NODE_WAITING, net.master->state[n + 1]);
+
+   // Each completed node frees a session for the next node
+   for (ix = 0; ix < n; ix++)
+   {
+      respond (ix + 2, device_type);
+      EXPECT_EQ (CO_MASTER_NODE_CONFIGURED, net.master->state[ix + 2]);
+   }
+
+   EXPECT_EQ (n, progress_done);
+   EXPECT_EQ (1u, cb_job_calls);
+   EXPECT_EQ (0, job.result);
+}
@@ -16,6 +16,10 @@
 #include "co_nmt.h"
 #include "test_util.h"
 
+#include <thread>
+
+extern "C" void co_main (void * arg);
+
 // Test fixture
 
 class NmtTest : public TestBase
@@ -29,6 +33,20 @@ class NmtTest : public TestBase
 
 // Tests
 
+static co_client_t * nmt_client;
+static int nmt_sdo_result;
+static void cb_nmt_command (co_net_t * net, co_state_t state)
+{
+   uint32_t value;
+
+   if (state != STATE_OP)
+      return;
+
+   // Handled directly, the stack thread does not wait for itself
+   co_nmt (nmt_client, CO_NMT_STOPPED, net->node);
+   nmt_sdo_result = co_sdo_read (nmt_client, 2, 0x1000, 0, &value, sizeof (value));
+}
+
 TEST_F (NmtTest, Fsm)
 {
    uint8_t command[][8] = {
@@ -118,6 +136,19 @@ TEST_F (NmtTest, BadNMT)
    EXPECT_EQ (0u, cb_nmt_calls);
 }
 
+TEST_F (NmtTest, BitrateFailure)
+{
+   uint8_t command[] = {CO_NMT_RESET_COMMUNICATION, 0x01};
+
+   // Bitrate of e.g. vcan can not be set, communication is reset anyway
+   net.bitrate                        = 250 * 1000;
+   mock_os_channel_set_bitrate_result = -1;
+   co_nmt_rx (&net, 0, command, 2);
+   EXPECT_EQ (STATE_PREOP, net.state);
+   EXPECT_EQ (1u, mock_os_channel_set_bitrate_calls);
+   EXPECT_EQ (1u, mock_os_channel_bus_on_calls);
+}
+
 TEST_F (NmtTest, LssFsm)
 {
    net.lss.node = 0xFF;
@@ -126,3 +157,27 @@ TEST_F (NmtTest, LssFsm)
    co_nmt_event (&net, EVENT_RESETCOMM);
    EXPECT_EQ (STATE_INIT_COMM, net.state);
 }
+
+TEST_F (NmtTest, CommandFromCallback)
+{
+   co_client_t * client = co_client_init (&net);
+   co_job_t exit        = {};
+
+   nmt_client     = co_client_init (&net);
+   nmt_sdo_result = 0;
+   net.cb_nmt     = cb_nmt_command;
+   net.mbox       = os_mbox_create (10);
+   ASSERT_NE (nullptr, net.mbox);
+
+   std::thread stack (co_main, &net);
+
+   // Callback stops node and fails SDO request instead of deadlocking
+   co_nmt (client, CO_NMT_OPERATIONAL, net.node);
+   EXPECT_EQ (STATE_STOP, net.state);
+   EXPECT_EQ (CO_STATUS_ERROR, nmt_sdo_result);
+
+   exit.type = CO_JOB_EXIT;
+   os_mbox_post (net.mbox, &exit, OS_WAIT_FOREVER);
+   stack.join();
+   os_mbox_destroy (net.mbox);
+}
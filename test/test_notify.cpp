@@ -0,0 +1,177 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_notify.h"
+#include "co_od.h"
+#include "test_util.h"
+
+// Test fixture
+
+static unsigned int batch_calls;
+static co_notify_t batch[MAX_NOTIFY];
+static size_t batch_count;
+static bool batch_overrun;
+
+static void cb_notify_batch (
+   co_net_t * net,
+   const co_notify_t * notify,
+   size_t count,
+   bool overrun)
+{
+   batch_calls++;
+   memcpy (batch, notify, count * sizeof (*notify));
+   batch_count   = count;
+   batch_overrun = overrun;
+}
+
+static unsigned int ready_calls;
+
+static void cb_notify_ready (co_net_t * net)
+{
+   ready_calls++;
+}
+
+class NotifyTest : public TestBase
+{
+ protected:
+   void SetUp() override
+   {
+      TestBase::SetUp();
+      net.cb_notify_batch = cb_notify_batch;
+      net.cb_notify_ready = cb_notify_ready;
+      batch_calls         = 0;
+      batch_count         = 0;
+      batch_overrun       = false;
+      ready_calls         = 0;
+   }
+
+   void write (uint16_t index)
+   {
+      const co_obj_t * obj     = find_obj (index);
+      const co_entry_t * entry = find_entry (obj, 0);
+
+      co_od_notify (&net, obj, entry, 0);
+   }
+};
+
+// Tests
+
+TEST_F (NotifyTest, Immediate)
+{
+   co_notify_init (&net, CO_NOTIFY_IMMEDIATE);
+
+   write (0x6000);
+   EXPECT_EQ (1u, cb_notify_calls);
+
+   co_notify_flush (&net, CO_NOTIFY_IMMEDIATE);
+   EXPECT_EQ (0u, batch_calls);
+}
+
+TEST_F (NotifyTest, Frame)
+{
+   co_notify_init (&net, CO_NOTIFY_FRAME);
+
+   write (0x6000);
+   write (0x1009);
+   write (0x6000);
+   EXPECT_EQ (0u, cb_notify_calls);
+
+   // Should not deliver at SYNC
+   co_notify_flush (&net, CO_NOTIFY_SYNC);
+   EXPECT_EQ (0u, batch_calls);
+
+   // Should deliver each subindex once
+   co_notify_flush (&net, CO_NOTIFY_FRAME);
+   EXPECT_EQ (1u, batch_calls);
+   EXPECT_EQ (2u, batch_count);
+   EXPECT_EQ (0x6000, batch[0].index);
+   EXPECT_EQ (0, batch[0].subindex);
+   EXPECT_EQ (0x1009, batch[1].index);
+   EXPECT_EQ (0, batch[1].subindex);
+   EXPECT_FALSE (batch_overrun);
+
+   // Should not deliver empty batch
+   co_notify_flush (&net, CO_NOTIFY_FRAME);
+   EXPECT_EQ (1u, batch_calls);
+}
+
+TEST_F (NotifyTest, FrameFull)
+{
+   co_notify_init (&net, CO_NOTIFY_FRAME);
+
+   for (unsigned int ix = 0; ix <= MAX_NOTIFY; ix++)
+      co_notify_post (&net, 0x2000, ix);
+
+   // Full batch should be delivered early
+   EXPECT_EQ (1u, batch_calls);
+   EXPECT_EQ ((size_t)MAX_NOTIFY, batch_count);
+   EXPECT_FALSE (batch_overrun);
+
+   co_notify_flush (&net, CO_NOTIFY_FRAME);
+   EXPECT_EQ (2u, batch_calls);
+   EXPECT_EQ (1u, batch_count);
+   EXPECT_EQ (MAX_NOTIFY, batch[0].subindex);
+}
+
+TEST_F (NotifyTest, SyncOverrun)
+{
+   co_notify_init (&net, CO_NOTIFY_SYNC);
+
+   for (unsigned int ix = 0; ix <= MAX_NOTIFY; ix++)
+      co_notify_post (&net, 0x2000, ix);
+
+   EXPECT_EQ (0u, batch_calls);
+
+   co_notify_flush (&net, CO_NOTIFY_FRAME);
+   EXPECT_EQ (0u, batch_calls);
+
+   co_notify_flush (&net, CO_NOTIFY_SYNC);
+   EXPECT_EQ (1u, batch_calls);
+   EXPECT_EQ ((size_t)MAX_NOTIFY, batch_count);
+   EXPECT_TRUE (batch_overrun);
+}
+
+TEST_F (NotifyTest, Poll)
+{
+   co_notify_t notify[2];
+   bool overrun;
+
+   co_notify_init (&net, CO_NOTIFY_POLL);
+
+   write (0x6000);
+   write (0x1009);
+   write (0x6001);
+   EXPECT_EQ (0u, cb_notify_calls);
+   EXPECT_EQ (0u, batch_calls);
+
+   // Application should be woken once
+   EXPECT_EQ (1u, ready_calls);
+
+   EXPECT_EQ (2u, co_notify_fetch (&net, notify, NELEMENTS (notify), &overrun));
+   EXPECT_EQ (0x6000, notify[0].index);
+   EXPECT_EQ (0x1009, notify[1].index);
+   EXPECT_FALSE (overrun);
+
+   EXPECT_EQ (1u, co_notify_fetch (&net, notify, NELEMENTS (notify), &overrun));
+   EXPECT_EQ (0x6001, notify[0].index);
+
+   EXPECT_EQ (0u, co_notify_fetch (&net, notify, NELEMENTS (notify), &overrun));
+
+   // Application should be woken again when queue is no longer empty
+   write (0x6000);
+   EXPECT_EQ (2u, ready_calls);
+
+   os_mutex_destroy (net.notify.mutex);
+}
@@ -16,6 +16,8 @@
 #include "co_od.h"
 #include "test_util.h"
 
+#include <thread>
+
 // Test fixture
 
 int obj_sum (co_net_t * net, const co_entry_t * entry, uintptr_t arg, int sum)
@@ -47,6 +49,24 @@ extern "C" uint32_t cb2001 (
    return 0;
 }
 
+uint64_t cb2002_value;
+extern "C" uint32_t cb2002 (
+   co_net_t * net,
+   od_event_t event,
+   const co_obj_t * obj,
+   const co_entry_t * entry,
+   uint8_t subindex,
+   uint64_t * value)
+{
+   if (event == OD_EVENT_READ)
+      *value = cb2002_value;
+   else if (event == OD_EVENT_WRITE)
+      cb2002_value = *value;
+   else if (event == OD_EVENT_RESTORE)
+      cb2002_value = 0;
+   return 0;
+}
+
 static const co_default_t od_defaults[] = {
    {0x1800, 1, 0x181},
    {0x2000, 1, 11},
@@ -88,6 +108,76 @@ TEST_F (OdTest, ObjFind)
    EXPECT_EQ (NULL, co_obj_find (&net, 0));
 }
 
+TEST_F (OdTest, ObjFindUnsorted)
+{
+   // Test dictionary is not sorted, linear search is used
+   co_od_init (&net, 0);
+   EXPECT_FALSE (net.od_sorted);
+   EXPECT_EQ (36u, net.od_size);
+
+   EXPECT_EQ (&test_od[16], co_obj_find (&net, 0x1018));
+   EXPECT_EQ (&test_od[17], co_obj_find (&net, 0x1017));
+   EXPECT_EQ (NULL, co_obj_find (&net, 0x1234));
+}
+
+TEST_F (OdTest, ObjFindSorted)
+{
+   const co_obj_t od[] = {
+      // clang-format off
+      {0x1000, OTYPE_VAR,    0,               OD1000, NULL, NULL},
+      {0x1001, OTYPE_VAR,    0,               OD1001, co_od1001_fn, NULL},
+      {0x1017, OTYPE_VAR,    0,               OD1017, co_od1017_fn, NULL},
+      {0x1018, OTYPE_RECORD, 4,               OD1018, NULL, NULL},
+      {0x2000, OTYPE_ARRAY,  8,               OD2000, NULL, NULL},
+      {0x7000, OTYPE_VAR,    0,               OD7000, NULL, NULL},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
+      // clang-format on
+   };
+
+   net.od = od;
+   co_od_init (&net, 0);
+   EXPECT_TRUE (net.od_sorted);
+   EXPECT_EQ (6u, net.od_size);
+
+   EXPECT_EQ (&od[0], co_obj_find (&net, 0x1000));
+   EXPECT_EQ (&od[2], co_obj_find (&net, 0x1017));
+   EXPECT_EQ (&od[3], co_obj_find (&net, 0x1018));
+   EXPECT_EQ (&od[5], co_obj_find (&net, 0x7000));
+   EXPECT_EQ (NULL, co_obj_find (&net, 0x0FFF));
+   EXPECT_EQ (NULL, co_obj_find (&net, 0x1010));
+   EXPECT_EQ (NULL, co_obj_find (&net, 0x7001));
+   EXPECT_EQ (NULL, co_obj_find (&net, 0));
+
+   // Size known at compile time matches
+   co_od_init (&net, NELEMENTS (od) - 1);
+   EXPECT_TRUE (net.od_sorted);
+   EXPECT_EQ (6u, net.od_size);
+   EXPECT_EQ (&od[4], co_obj_find (&net, 0x2000));
+
+   // Wrong size is not trusted
+   co_od_init (&net, NELEMENTS (od) + 10);
+   EXPECT_EQ (6u, net.od_size);
+   EXPECT_EQ (NULL, co_obj_find (&net, 0x7001));
+}
+
+TEST_F (OdTest, ObjFindSizeUnsorted)
+{
+   const co_obj_t od[] = {
+      // clang-format off
+      {0x1000, OTYPE_VAR,    0,               OD1000, NULL, NULL},
+      {0x1017, OTYPE_VAR,    0,               OD1017, co_od1017_fn, NULL},
+      {0x1001, OTYPE_VAR,    0,               OD1001, co_od1001_fn, NULL},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
+      // clang-format on
+   };
+
+   // Ordering is checked even if the size is given
+   net.od = od;
+   co_od_init (&net, NELEMENTS (od) - 1);
+   EXPECT_FALSE (net.od_sorted);
+   EXPECT_EQ (&od[2], co_obj_find (&net, 0x1001));
+}
+
 TEST_F (OdTest, EntryFindRecord)
 {
    const co_obj_t * obj = find_obj (0x1018);
@@ -110,6 +200,45 @@ TEST_F (OdTest, EntryFindSparseRecord)
    EXPECT_EQ (NULL, co_entry_find (&net, obj, 6));
 }
 
+TEST_F (OdTest, EntryFindSorted)
+{
+   const co_obj_t * obj = find_obj (0x1400);
+   const co_entry_t entries[] = {
+      {0, OD_RW, DTYPE_UNSIGNED8, 8, 0, NULL},
+      {2, OD_RW, DTYPE_UNSIGNED8, 8, 0, NULL},
+      {1, OD_RW, DTYPE_UNSIGNED8, 8, 0, NULL},
+      {3, OD_RW, DTYPE_UNSIGNED8, 8, 0, NULL},
+   };
+   const co_obj_t od[] = {
+      {0x2000, OTYPE_RECORD, 3, entries, NULL, NULL},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
+   };
+
+   // Position of last entry is kept for objects with sorted entries
+   co_od_init (&net, 0);
+   EXPECT_EQ (4u, net.od_last[obj - test_od]);
+   EXPECT_EQ (0u, net.od_last[find_obj (0x1003) - test_od]);
+   EXPECT_EQ (0u, net.od_last[0]);
+
+   EXPECT_EQ (&obj->entries[0], co_entry_find (&net, obj, 0));
+   EXPECT_EQ (&obj->entries[1], co_entry_find (&net, obj, 1));
+   EXPECT_EQ (&obj->entries[3], co_entry_find (&net, obj, 3));
+   EXPECT_EQ (NULL, co_entry_find (&net, obj, 4));
+   EXPECT_EQ (&obj->entries[4], co_entry_find (&net, obj, 5));
+   EXPECT_EQ (NULL, co_entry_find (&net, obj, 6));
+
+   obj = find_obj (0x1018);
+   EXPECT_EQ (&obj->entries[4], co_entry_find (&net, obj, 4));
+   EXPECT_EQ (NULL, co_entry_find (&net, obj, 5));
+
+   // Unsorted entries are searched linearly
+   net.od = od;
+   co_od_init (&net, 0);
+   EXPECT_EQ (0u, net.od_last[0]);
+   EXPECT_EQ (&entries[1], co_entry_find (&net, &od[0], 2));
+   EXPECT_EQ (&entries[3], co_entry_find (&net, &od[0], 3));
+}
+
 TEST_F (OdTest, EntryFindArray)
 {
    const co_obj_t * obj = find_obj (0x1003);
@@ -199,6 +328,92 @@ TEST_F (OdTest, ZeroOD)
    EXPECT_EQ (0u, arr2000[7]);
 }
 
+TEST_F (OdTest, AccessFunction64)
+{
+   static const co_obj_ops_t ops2002 = {cb2002, NULL, NULL};
+   static const co_entry_t OD2002[] = {
+      {0, OD_RW, DTYPE_UNSIGNED64, 64, 0, NULL},
+   };
+   const co_obj_t od[] = {
+      {0x2002, OTYPE_VAR, 0, OD2002, NULL, &ops2002},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
+   };
+   uint64_t value;
+
+   net.od = od;
+
+   co_od_set_value (&net, &od[0], &OD2002[0], 0, 0x1122334455667788);
+   EXPECT_EQ (0x1122334455667788u, cb2002_value);
+
+   co_od_get_value (&net, &od[0], &OD2002[0], 0, &value);
+   EXPECT_EQ (0x1122334455667788u, value);
+
+   co_od_zero (&net, 0x2000, 0x2FFF);
+   EXPECT_EQ (0u, cb2002_value);
+}
+
+TEST_F (OdTest, Seqlock)
+{
+   static co_seqlock_t lock;
+   static const co_obj_ops_t ops2003 = {NULL, NULL, &lock};
+   static uint32_t value2003;
+   static const co_entry_t OD2003[] = {
+      {0, OD_RW, DTYPE_UNSIGNED32, 32, 0, &value2003},
+   };
+   const co_obj_t obj = {0x2003, OTYPE_VAR, 0, OD2003, NULL, &ops2003};
+   uint32_t sequence;
+
+   sequence = co_seqlock_read_begin (&lock);
+   EXPECT_FALSE (co_seqlock_read_retry (&lock, sequence));
+
+   // Read must be retried if value is written during read
+   co_od_set_value (&net, &obj, &OD2003[0], 0, 0x1234);
+   EXPECT_TRUE (co_seqlock_read_retry (&lock, sequence));
+   EXPECT_EQ (0x1234u, value2003);
+
+   // Read must be retried if write is in progress
+   co_seqlock_write_begin (&lock);
+   sequence = co_seqlock_read_begin (&lock);
+   EXPECT_TRUE (co_seqlock_read_retry (&lock, sequence));
+
+   // Only one write may be in progress
+   EXPECT_FALSE (co_seqlock_write_try_begin (&lock));
+   co_seqlock_write_end (&lock);
+   EXPECT_TRUE (co_seqlock_write_try_begin (&lock));
+   co_seqlock_write_end (&lock);
+
+   sequence = co_seqlock_read_begin (&lock);
+   EXPECT_FALSE (co_seqlock_read_retry (&lock, sequence));
+}
+
+TEST_F (OdTest, SeqlockConcurrentWriters)
+{
+   const unsigned int writes = 10000;
+   co_seqlock_t lock         = {0};
+   uint32_t a                = 0;
+   uint32_t b                = 0;
+
+   // Writers keep a == b, no increment of the sequence may be lost
+   auto writer = [&]() {
+      for (unsigned int i = 0; i < writes; i++)
+      {
+         co_seqlock_write_begin (&lock);
+         a++;
+         b++;
+         co_seqlock_write_end (&lock);
+      }
+   };
+
+   std::thread t1 (writer);
+   std::thread t2 (writer);
+   t1.join();
+   t2.join();
+
+   EXPECT_EQ (4 * writes, lock.sequence);
+   EXPECT_EQ (2 * writes, a);
+   EXPECT_EQ (a, b);
+}
+
 TEST_F (OdTest, DefaultValues)
 {
    const co_obj_t * obj = find_obj (0x2000);
@@ -255,9 +470,9 @@ TEST_F (OdTest, StoreThenLoadNewOD)
       {0, OD_RW, DTYPE_VISIBLE_STRING, 8 * sizeof (str2001), 0, str2001},
    };
    const co_obj_t OD1[] = {
-      {0x2000, OTYPE_RECORD, 2, OD2000_1, NULL},
-      {0x2001, OTYPE_VAR, 0, OD2001_1, NULL},
-      {0, OTYPE_NULL, 0, NULL, NULL},
+      {0x2000, OTYPE_RECORD, 2, OD2000_1, NULL, NULL},
+      {0x2001, OTYPE_VAR, 0, OD2001_1, NULL, NULL},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
    };
    const co_entry_t OD2000_2[12] = {
       {0x00, OD_RO, DTYPE_UNSIGNED8, 8, 0x02, NULL},
@@ -269,9 +484,9 @@ TEST_F (OdTest, StoreThenLoadNewOD)
       {0, OD_RW, DTYPE_VISIBLE_STRING, 8 * (sizeof (str2001) - 1), 0, str2001},
    };
    const co_obj_t OD2[] = {
-      {0x2000, OTYPE_RECORD, 2, OD2000_2, NULL},
-      {0x2001, OTYPE_VAR, 0, OD2001_2, NULL},
-      {0, OTYPE_NULL, 0, NULL, NULL},
+      {0x2000, OTYPE_RECORD, 2, OD2000_2, NULL, NULL},
+      {0x2001, OTYPE_VAR, 0, OD2001_2, NULL, NULL},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
    };
 
    net.od = OD1;
@@ -44,6 +44,20 @@ class PdoTest : public TestBase
 
       value7000 = 0;
    }
+
+   // Clear PDO, with mapping tables owned by the fixture
+   void pdo_init (co_pdo_t * pdo)
+   {
+      memset (pdo, 0, sizeof (*pdo));
+      memset (mappings, 0, sizeof (mappings));
+      pdo->mappings = mappings;
+      pdo->objs     = objs;
+      pdo->entries  = entries;
+   }
+
+   uint32_t mappings[MAX_PDO_ENTRIES];
+   const co_obj_t * objs[MAX_PDO_ENTRIES];
+   const co_entry_t * entries[MAX_PDO_ENTRIES];
 };
 
 // Tests
@@ -73,7 +87,7 @@ TEST_F (PdoTest, Pack)
    uint8_t * frame          = (uint8_t *)&pdo.frame;
    const co_obj_t * obj6003 = find_obj (0x6003);
 
-   memset (&pdo, 0, sizeof (pdo));
+   pdo_init (&pdo);
 
    pdo.number_of_mappings = 2;
    pdo.mappings[0]        = 0x60030110;
@@ -94,7 +108,7 @@ TEST_F (PdoTest, PackLarge)
    uint8_t * frame          = (uint8_t *)&pdo.frame;
    const co_obj_t * obj6003 = find_obj (0x6003);
 
-   memset (&pdo, 0, sizeof (pdo));
+   pdo_init (&pdo);
 
    pdo.number_of_mappings = 2;
    pdo.mappings[0]        = 0x60030320;
@@ -114,7 +128,7 @@ TEST_F (PdoTest, PackSmall)
    uint8_t * frame          = (uint8_t *)&pdo.frame;
    const co_obj_t * obj6003 = find_obj (0x6003);
 
-   memset (&pdo, 0, sizeof (pdo));
+   pdo_init (&pdo);
 
    pdo.number_of_mappings = 2;
    pdo.mappings[0]        = 0x60030501;
@@ -134,7 +148,7 @@ TEST_F (PdoTest, PackWithPadding)
    uint8_t * frame          = (uint8_t *)&pdo.frame;
    const co_obj_t * obj6003 = find_obj (0x6003);
 
-   memset (&pdo, 0, sizeof (pdo));
+   pdo_init (&pdo);
 
    pdo.number_of_mappings = 3;
    pdo.mappings[0]        = 0x60030601;
@@ -158,7 +172,7 @@ TEST_F (PdoTest, PackArray)
    uint8_t * frame          = (uint8_t *)&pdo.frame;
    const co_obj_t * obj2000 = find_obj (0x2000);
 
-   memset (&pdo, 0, sizeof (pdo));
+   pdo_init (&pdo);
 
    pdo.number_of_mappings = 2;
    pdo.mappings[0]        = 0x20000308;
@@ -173,13 +187,47 @@ TEST_F (PdoTest, PackArray)
    EXPECT_EQ (7u, frame[1]);
 }
 
+TEST_F (PdoTest, PackSeqlock)
+{
+   static co_seqlock_t lock;
+   static const co_obj_ops_t ops2102 = {NULL, NULL, &lock};
+   static uint32_t value2102         = 0x12345678;
+   static const co_entry_t OD2102[]  = {
+      {0, OD_RW | OD_TPDO, DTYPE_UNSIGNED32, 32, 0, &value2102},
+   };
+   static const co_obj_t obj2102 = {0x2102, OTYPE_VAR, 0, OD2102, NULL, &ops2102};
+
+   net.state                 = STATE_OP;
+   net.pdo_tx[0].event_timer = 100;
+   net.pdo_tx[0].mappings[0] = 0x21020020;
+   net.pdo_tx[0].objs[0]     = &obj2102;
+   net.pdo_tx[0].entries[0]  = &OD2102[0];
+   net.pdo_tx[0].frame       = 0xAA;
+
+   // Last consistent frame is kept while object is being written
+   co_seqlock_write_begin (&lock);
+   EXPECT_EQ (-1, co_pdo_pack (&net, &net.pdo_tx[0]));
+   EXPECT_EQ (0xAAu, net.pdo_tx[0].frame);
+
+   // Transmission is skipped
+   mock_os_tick_current_result = 150 * 1000;
+   co_pdo_timer (&net, mock_os_tick_current_result);
+   EXPECT_EQ (0u, mock_os_channel_send_calls);
+
+   // Transmission is retried when write has ended
+   co_seqlock_write_end (&lock);
+   co_pdo_timer (&net, mock_os_tick_current_result);
+   EXPECT_EQ (1u, mock_os_channel_send_calls);
+   EXPECT_EQ (0x12345678u, net.pdo_tx[0].frame);
+}
+
 TEST_F (PdoTest, Unpack)
 {
    co_pdo_t pdo;
    uint8_t * frame          = (uint8_t *)&pdo.frame;
    const co_obj_t * obj6003 = find_obj (0x6003);
 
-   memset (&pdo, 0, sizeof (pdo));
+   pdo_init (&pdo);
 
    pdo.number_of_mappings = 2;
    pdo.mappings[0]        = 0x60030710;
@@ -205,7 +253,7 @@ TEST_F (PdoTest, UnpackLarge)
    uint8_t * frame          = (uint8_t *)&pdo.frame;
    const co_obj_t * obj6003 = find_obj (0x6003);
 
-   memset (&pdo, 0, sizeof (pdo));
+   pdo_init (&pdo);
 
    pdo.number_of_mappings = 2;
    pdo.mappings[0]        = 0x60030920;
@@ -233,7 +281,7 @@ TEST_F (PdoTest, UnpackWithPadding)
    uint8_t * frame          = (uint8_t *)&pdo.frame;
    const co_obj_t * obj6003 = find_obj (0x6003);
 
-   memset (&pdo, 0, sizeof (pdo));
+   pdo_init (&pdo);
 
    pdo.number_of_mappings = 3;
    pdo.mappings[0]        = 0x60030808;
@@ -263,7 +311,7 @@ TEST_F (PdoTest, UnpackArray)
    uint8_t * frame          = (uint8_t *)&pdo.frame;
    const co_obj_t * obj2000 = find_obj (0x2000);
 
-   memset (&pdo, 0, sizeof (pdo));
+   pdo_init (&pdo);
 
    pdo.number_of_mappings = 2;
    pdo.mappings[0]        = 0x20000308;
@@ -0,0 +1,239 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_obj.h"
+#include "test_util.h"
+
+#include <list>
+#include <set>
+#include <thread>
+
+// Test fixture
+
+class ReactorTest : public TestBase
+{
+ protected:
+   void SetUp() override
+   {
+      co_vbus_cfg_t cfg = {0, NULL, NULL};
+
+      TestBase::SetUp();
+      od = comm_od();
+
+      mock_sim     = true;
+      mock_reactor = true;
+      co_vbus_configure ("reactor", &cfg);
+
+      reactor = co_reactor_create (-1);
+      ASSERT_NE (nullptr, reactor);
+   }
+
+   void TearDown() override
+   {
+      // Reactor thread stops when the last network has exited
+      for (co_net_t * net : nets)
+      {
+         if (exited.count (net) == 0)
+            exit (net);
+      }
+
+      if (reactor != nullptr)
+         co_reactor_destroy (reactor);
+      mock_os_thread_join();
+
+      for (co_net_t * net : nets)
+      {
+         co_vbus_enable ((co_vbus_node_t *)net->channel, false);
+         os_mbox_destroy (net->mbox);
+      }
+      nets.clear();
+
+      co_vbus_destroy ("reactor");
+      mock_sim     = false;
+      mock_reactor = false;
+   }
+
+   // There is no co_exit(), networks exit with an exit job
+   void exit (co_net_t * net)
+   {
+      jobs.emplace_back();
+      jobs.back().type = CO_JOB_EXIT;
+      os_mbox_post (net->mbox, &jobs.back(), OS_WAIT_FOREVER);
+      mock_os_loop_wake (net->loop);
+      exited.insert (net);
+   }
+
+   co_net_t * add (uint8_t node, co_reactor_t * reactor)
+   {
+      co_cfg_t cfg = {};
+      co_net_t * net;
+
+      cfg.node    = node;
+      cfg.od      = od.data();
+      cfg.reactor = reactor;
+
+      arenas.emplace_back (co_arena_size (&cfg), 0);
+      cfg.arena      = arenas.back().data();
+      cfg.arena_size = arenas.back().size();
+
+      net = co_init ("reactor", &cfg);
+      if (net != NULL)
+         nets.push_back (net);
+
+      return net;
+   }
+
+   co_net_t * add (uint8_t node)
+   {
+      return add (node, reactor);
+   }
+
+   std::vector<co_obj_t> od;
+   std::list<std::vector<uint8_t>> arenas;
+   std::vector<co_net_t *> nets;
+   std::set<co_net_t *> exited;
+   std::list<co_job_t> jobs;
+   co_reactor_t * reactor;
+};
+
+// Tests
+
+TEST_F (ReactorTest, TwoNetworks)
+{
+   co_client_t * client1;
+   co_client_t * client2;
+   uint32_t value;
+
+   ASSERT_NE (nullptr, add (1));
+   ASSERT_NE (nullptr, add (2));
+
+   client1 = co_client_init (nets[0]);
+   client2 = co_client_init (nets[1]);
+
+   // Requests are sent by one network and served by the other, both
+   // serviced by the reactor thread
+   value = 0;
+   EXPECT_EQ (4, co_sdo_read (client1, 2, 0x1000, 0, &value, sizeof (value)));
+   EXPECT_EQ (0x00420192u, value);
+
+   value = 0;
+   EXPECT_EQ (4, co_sdo_read (client2, 1, 0x1000, 0, &value, sizeof (value)));
+   EXPECT_EQ (0x00420192u, value);
+}
+
+TEST_F (ReactorTest, AttachWhileReceiving)
+{
+   co_client_t * client;
+   unsigned int failed = 0;
+   uint32_t value;
+
+   ASSERT_NE (nullptr, add (1));
+   ASSERT_NE (nullptr, add (2));
+
+   client = co_client_init (nets[0]);
+
+   // Received frames are handled outside the reactor mutex while
+   // further networks are attached
+   std::thread traffic ([&] {
+      for (int i = 0; i < 200; i++)
+      {
+         uint32_t data = 0;
+
+         if (co_sdo_read (client, 2, 0x1000, 0, &data, sizeof (data)) != 4)
+            failed++;
+      }
+   });
+
+   for (uint8_t node = 3; node < 10; node++)
+   {
+      EXPECT_NE (nullptr, add (node));
+   }
+
+   traffic.join();
+   EXPECT_EQ (0u, failed);
+
+   // Attached networks are serviced
+   for (uint8_t node = 3; node < 10; node++)
+   {
+      value = 0;
+      EXPECT_EQ (4, co_sdo_read (client, node, 0x1000, 0, &value, sizeof (value)));
+      EXPECT_EQ (0x00420192u, value);
+   }
+}
+
+TEST_F (ReactorTest, ExitDetachesNetwork)
+{
+   co_client_t * client;
+   uint32_t value;
+   uint64_t next;
+
+   ASSERT_NE (nullptr, add (1));
+   ASSERT_NE (nullptr, add (2));
+   ASSERT_NE (nullptr, add (3));
+
+   client = co_client_init (nets[0]);
+
+   // Exit job is handled before the request is served
+   exit (nets[2]);
+   EXPECT_EQ (4, co_sdo_read (client, 2, 0x1000, 0, &value, sizeof (value)));
+
+   // Other networks are still serviced, frames to the exited network
+   // are no longer received
+   EXPECT_EQ (4, co_sdo_read (client, 2, 0x1000, 0, &value, sizeof (value)));
+   EXPECT_TRUE (co_vbus_pending ((co_vbus_node_t *)nets[2]->channel, &next));
+}
+
+TEST_F (ReactorTest, AttachAfterLastExit)
+{
+   ASSERT_NE (nullptr, add (1));
+
+   // Thread stops once the last network has exited
+   exit (nets[0]);
+   mock_os_thread_join();
+
+   EXPECT_EQ (nullptr, add (2));
+   EXPECT_EQ (1u, mock_os_channel_close_calls);
+}
+
+TEST_F (ReactorTest, PrivateReactorReleasedOnError)
+{
+   mock_os_channel_open_fail = true;
+   EXPECT_EQ (nullptr, add (1, NULL));
+
+   // Private reactor thread has stopped, join it with the thread of
+   // the shared reactor
+   co_reactor_destroy (reactor);
+   reactor = nullptr;
+   mock_os_thread_join();
+}
+
+TEST_F (ReactorTest, ThreadlessLoopFailure)
+{
+   co_cfg_t cfg = {};
+   std::vector<uint8_t> arena;
+
+   cfg.node       = 1;
+   cfg.od         = od.data();
+   cfg.threadless = true;
+
+   arena.resize (co_arena_size (&cfg));
+   cfg.arena      = arena.data();
+   cfg.arena_size = arena.size();
+
+   // Channel is closed if it cannot be added to the loop
+   mock_os_loop_add_result = -1;
+   EXPECT_EQ (nullptr, co_init ("reactor", &cfg));
+   EXPECT_EQ (1u, mock_os_channel_close_calls);
+}
@@ -0,0 +1,176 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "ports/replay/co_replay_file.h"
+#include "co_main.h"
+#include "co_util.h"
+#include "test_util.h"
+
+#include <string>
+
+// Test fixture
+
+class ReplayTest : public TestBase
+{
+ protected:
+   void SetUp() override
+   {
+      TestBase::SetUp();
+      file = tmpfile();
+      ASSERT_NE (nullptr, file);
+   }
+
+   void TearDown() override
+   {
+      fclose (file);
+   }
+
+   // Write recording and open it
+   int open (const void * data, size_t size)
+   {
+      fwrite (data, 1, size, file);
+      rewind (file);
+      return co_replay_file_open (&replay, file);
+   }
+
+   int open (const std::string & text)
+   {
+      return open (text.data(), text.size());
+   }
+
+   FILE * file;
+   co_replay_file_t replay;
+   co_replay_frame_t frame;
+};
+
+// Tests
+
+TEST_F (ReplayTest, Candump)
+{
+   ASSERT_EQ (
+      0,
+      open (
+         "(1436509052.249713) can0 181#1122AB\n"
+         "# comment\n"
+         "(1436509052.5) can0 12345678#11\n"
+         "(1436509053.000001) vcan0 701#R\n"
+         "(1436509053.000002) can0 702#R2\n"
+         "(1436509053.000003) can0 20000080#0000000000000000\n"
+         "(1436509053.000004) can0 123##1112233\n"
+         "(1436509053.000005) can0 080#\n"));
+   EXPECT_FALSE (replay.pcap);
+
+   ASSERT_EQ (0, co_replay_file_read (&replay, &frame));
+   EXPECT_EQ (1436509052249713u, frame.timestamp);
+   EXPECT_EQ (0x181u, frame.id);
+   EXPECT_EQ (3u, frame.dlc);
+   EXPECT_EQ (0xABu, frame.data[2]);
+
+   ASSERT_EQ (0, co_replay_file_read (&replay, &frame));
+   EXPECT_EQ (1436509052500000u, frame.timestamp);
+   EXPECT_EQ (CO_EXT_MASK | 0x12345678u, frame.id);
+   EXPECT_EQ (1u, frame.dlc);
+
+   ASSERT_EQ (0, co_replay_file_read (&replay, &frame));
+   EXPECT_EQ (CO_RTR_MASK | 0x701u, frame.id);
+   EXPECT_EQ (0u, frame.dlc);
+
+   ASSERT_EQ (0, co_replay_file_read (&replay, &frame));
+   EXPECT_EQ (CO_RTR_MASK | 0x702u, frame.id);
+   EXPECT_EQ (2u, frame.dlc);
+
+   // Error frame and CAN FD frame are skipped
+   ASSERT_EQ (0, co_replay_file_read (&replay, &frame));
+   EXPECT_EQ (0x80u, frame.id);
+   EXPECT_EQ (0u, frame.dlc);
+
+   EXPECT_EQ (-1, co_replay_file_read (&replay, &frame));
+}
+
+TEST_F (ReplayTest, Pcap)
+{
+   // Big-endian file, nanosecond resolution
+   uint8_t pcap[] = {
+      0xA1, 0xB2, 0x3C, 0x4D, 0x00, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0xE3,
+
+      // Extended frame
+      0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x03, 0xE8, 0x00, 0x00, 0x00, 0x10,
+      0x00, 0x00, 0x00, 0x10,
+      0x92, 0x34, 0x56, 0x78, 0x02, 0x00, 0x00, 0x00,
+      0x11, 0x22, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+
+      // Error frame
+      0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x03, 0xE8, 0x00, 0x00, 0x00, 0x10,
+      0x00, 0x00, 0x00, 0x10,
+      0x20, 0x00, 0x00, 0x04, 0x08, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+
+      // RTR frame
+      0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10,
+      0x00, 0x00, 0x00, 0x10,
+      0x40, 0x00, 0x07, 0x01, 0x01, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+   };
+
+   ASSERT_EQ (0, open (pcap, sizeof (pcap)));
+   EXPECT_TRUE (replay.pcap);
+
+   ASSERT_EQ (0, co_replay_file_read (&replay, &frame));
+   EXPECT_EQ (2000001u, frame.timestamp);
+   EXPECT_EQ (CO_EXT_MASK | 0x12345678u, frame.id);
+   EXPECT_EQ (2u, frame.dlc);
+   EXPECT_EQ (0x22u, frame.data[1]);
+
+   ASSERT_EQ (0, co_replay_file_read (&replay, &frame));
+   EXPECT_EQ (3000000u, frame.timestamp);
+   EXPECT_EQ (CO_RTR_MASK | 0x701u, frame.id);
+   EXPECT_EQ (1u, frame.dlc);
+
+   EXPECT_EQ (-1, co_replay_file_read (&replay, &frame));
+}
+
+TEST_F (ReplayTest, PcapLinkType)
+{
+   uint8_t pcap[] = {
+      0xD4, 0xC3, 0xB2, 0xA1, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+   };
+
+   // Ethernet
+   EXPECT_EQ (-1, open (pcap, sizeof (pcap)));
+}
+
+TEST_F (ReplayTest, Format)
+{
+   char line[CO_REPLAY_LINE_SIZE];
+   co_replay_frame_t std = {1500000, 0x181, 3, {0x11, 0x22, 0xAB}};
+   co_replay_frame_t ext = {0, CO_EXT_MASK | 0x12345678, 1, {0x11}};
+   co_replay_frame_t rtr = {0, CO_RTR_MASK | 0x701, 1, {0}};
+
+   EXPECT_EQ (34u, co_replay_file_format (line, "co", &std));
+   EXPECT_STREQ ("(0000000001.500000) co 181#1122AB\n", line);
+
+   co_replay_file_format (line, "co", &ext);
+   EXPECT_STREQ ("(0000000000.000000) co 12345678#11\n", line);
+
+   co_replay_file_format (line, "co", &rtr);
+   EXPECT_STREQ ("(0000000000.000000) co 701#R\n", line);
+
+   // Formatted line is read back
+   open (std::string (line));
+   ASSERT_EQ (0, co_replay_file_read (&replay, &frame));
+   EXPECT_EQ (CO_RTR_MASK | 0x701u, frame.id);
+}
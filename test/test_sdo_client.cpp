@@ -176,3 +176,122 @@ TEST_F (SdoClientTest, SegmentedDownload)
 
    EXPECT_EQ (strlen (s), job.sdo.total);
 }
+
+TEST_F (SdoClientTest, ParallelSessions)
+{
+   co_job_t job[MAX_SDO_CLIENTS + 2]{};
+   uint32_t value[MAX_SDO_CLIENTS + 2];
+   size_t ix;
+
+   uint8_t response[8] = {0x43, 0x00, 0x10, 0x00, 0x92, 0x01, 0x42, 0x00};
+
+   // One job per node, plus one more for node 1
+   for (ix = 0; ix < NELEMENTS (job); ix++)
+   {
+      job[ix].type         = CO_JOB_SDO_READ;
+      job[ix].sdo.node     = (ix == NELEMENTS (job) - 1) ? 1 : ix + 1;
+      job[ix].sdo.index    = 0x1000;
+      job[ix].sdo.subindex = 0;
+      job[ix].sdo.data     = (uint8_t *)&value[ix];
+      job[ix].sdo.remain   = sizeof (value[ix]);
+      job[ix].result       = 0;
+      job[ix].callback     = NULL;
+   }
+
+   mock_os_channel_send_calls = 0;
+
+   for (ix = 0; ix < NELEMENTS (job); ix++)
+   {
+      co_sdo_issue (&net, &job[ix]);
+   }
+   EXPECT_EQ ((unsigned)MAX_SDO_CLIENTS, mock_os_channel_send_calls);
+
+   // Completing node 2 starts the queued job for another node
+   co_sdo_tx (&net, 2, response, 8);
+   EXPECT_EQ (4, job[1].result);
+   EXPECT_EQ ((unsigned)MAX_SDO_CLIENTS + 1, mock_os_channel_send_calls);
+   EXPECT_EQ (0x600u + MAX_SDO_CLIENTS + 1, mock_os_channel_send_id);
+
+   // Second job for node 1 waits for the first
+   co_sdo_tx (&net, 3, response, 8);
+   EXPECT_EQ ((unsigned)MAX_SDO_CLIENTS + 1, mock_os_channel_send_calls);
+
+   co_sdo_tx (&net, 1, response, 8);
+   EXPECT_EQ (4, job[0].result);
+   EXPECT_EQ (0, job[NELEMENTS (job) - 1].result);
+   EXPECT_EQ ((unsigned)MAX_SDO_CLIENTS + 2, mock_os_channel_send_calls);
+   EXPECT_EQ (0x601u, mock_os_channel_send_id);
+
+   co_sdo_tx (&net, 1, response, 8);
+   EXPECT_EQ (4, job[NELEMENTS (job) - 1].result);
+   EXPECT_EQ (0x00420192u, value[NELEMENTS (job) - 1]);
+}
+
+TEST_F (SdoClientTest, Abort)
+{
+   co_job_t job{};
+   uint8_t value[16];
+
+   uint8_t response[][8] = {
+      {0x41, 0x0a, 0x10, 0x00, 0x1c, 0x00, 0x00, 0x00},
+      {0x10, 0x57, 0x68, 0x69, 0x73, 0x74, 0x6c, 0x65},
+   };
+   uint8_t abort[8] = {0x80, 0x0a, 0x10, 0x00, 0x00, 0x00, 0x03, 0x05};
+
+   job.type         = CO_JOB_SDO_READ;
+   job.sdo.node     = 5;
+   job.sdo.index    = 0x100a;
+   job.sdo.subindex = 0;
+   job.sdo.data     = value;
+   job.sdo.remain   = sizeof (value);
+   job.callback     = NULL;
+
+   // Transfer of local SDO server in progress
+   net.job_sdo_server.type = CO_JOB_SDO_WRITE;
+
+   co_sdo_issue (&net, &job);
+   co_sdo_tx (&net, 5, response[0], 8);
+
+   // Toggle error is sent to the server, local server is not affected
+   co_sdo_tx (&net, 5, response[1], 8);
+   EXPECT_TRUE (CanMatch (0x605, abort, 8));
+   EXPECT_EQ (CO_STATUS_ERROR, job.result);
+   EXPECT_EQ (CO_JOB_SDO_WRITE, net.job_sdo_server.type);
+}
+
+TEST_F (SdoClientTest, TimeoutPerSegment)
+{
+   co_job_t job{};
+   uint8_t value[16];
+
+   uint8_t response[][8] = {
+      {0x41, 0x0a, 0x10, 0x00, 0x1c, 0x00, 0x00, 0x00},
+      {0x00, 0x57, 0x68, 0x69, 0x73, 0x74, 0x6c, 0x65},
+   };
+   uint8_t abort[8] = {0x80, 0x0a, 0x10, 0x00, 0x00, 0x00, 0x04, 0x05};
+
+   job.type         = CO_JOB_SDO_READ;
+   job.sdo.node     = 5;
+   job.sdo.index    = 0x100a;
+   job.sdo.subindex = 0;
+   job.sdo.data     = value;
+   job.sdo.remain   = sizeof (value);
+   job.callback     = NULL;
+   job.result       = 0;
+
+   co_sdo_issue (&net, &job);
+
+   // Responses arriving within the timeout keep the transfer alive
+   mock_os_tick_current_result = 1000 * SDO_TIMEOUT - 1;
+   co_sdo_tx (&net, 5, response[0], 8);
+   mock_os_tick_current_result = 2 * (1000 * SDO_TIMEOUT - 1);
+   co_sdo_client_timer (&net, mock_os_tick_current_result);
+   co_sdo_tx (&net, 5, response[1], 8);
+   EXPECT_EQ (0, job.result);
+
+   // Timeout is sent to the server
+   mock_os_tick_current_result += 1000 * SDO_TIMEOUT;
+   co_sdo_client_timer (&net, mock_os_tick_current_result);
+   EXPECT_TRUE (CanMatch (0x605, abort, 8));
+   EXPECT_EQ (CO_STATUS_ERROR, job.result);
+}
@@ -34,6 +34,53 @@ class SdoServerTest : public TestBase
 {
 };
 
+static uint8_t domain[20];
+static size_t domain_size;
+static size_t domain_written;
+
+static uint32_t stream_domain (
+   co_net_t * net,
+   od_event_t event,
+   const co_obj_t * obj,
+   const co_entry_t * entry,
+   uint8_t subindex,
+   size_t offset,
+   void * data,
+   size_t * size)
+{
+   if (event == OD_EVENT_READ)
+   {
+      if (data == NULL)
+      {
+         *size = domain_size;
+         return 0;
+      }
+
+      *size = MIN (*size, domain_size - offset);
+      memcpy (data, &domain[offset], *size);
+   }
+   else if (event == OD_EVENT_WRITE)
+   {
+      if (data == NULL)
+      {
+         domain_written = *size;
+         return 0;
+      }
+
+      if (offset + *size > sizeof (domain))
+         return CO_SDO_ABORT_LENGTH_TOO_HIGH;
+
+      memcpy (&domain[offset], data, *size);
+   }
+   return 0;
+}
+
+static const co_obj_ops_t ops_domain = {NULL, stream_domain, NULL};
+static const co_entry_t OD2100[] = {
+   {0, OD_RW | OD_NOTIFY, DTYPE_DOMAIN, 0, 0, NULL},
+};
+static const co_obj_t obj2100 = {0x2100, OTYPE_VAR, 0, OD2100, NULL, &ops_domain};
+
 // Tests
 
 TEST_F (SdoServerTest, ExpeditedUpload)
@@ -197,7 +244,7 @@ TEST_F (SdoServerTest, SegmentedTimeout)
 
 TEST_F (SdoServerTest, BadSubIndex)
 {
-   static const co_obj_t obj = {0, OTYPE_NULL, 0, NULL, NULL};
+   static const co_obj_t obj = {0, OTYPE_NULL, 0, NULL, NULL, NULL};
    uint8_t expected[][8] = {
       {0x80, 0x00, 0x10, 0x01, 0x11, 0x00, 0x09, 0x06},
    };
@@ -236,3 +283,249 @@ TEST_F (SdoServerTest, SubIndexFF)
    co_sdo_rx (&net, 1, command[1], 8);
    EXPECT_TRUE (CanMatch (0x581, expected[1], 8));
 }
+
+TEST_F (SdoServerTest, SegmentedUploadStream)
+{
+   uint8_t expected[][8] = {
+      {0x41, 0x00, 0x21, 0x00, 0x0a, 0x00, 0x00, 0x00},
+      {0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06},
+      {0x19, 0x07, 0x08, 0x09, 0x00, 0x00, 0x00, 0x00},
+   };
+   uint8_t command[][8] = {
+      {0x40, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+   };
+
+   for (size_t i = 0; i < sizeof (domain); i++)
+      domain[i] = i;
+   domain_size = 10;
+
+   mock_co_obj_find_result   = &obj2100;
+   mock_co_entry_find_result = &OD2100[0];
+
+   for (size_t i = 0; i < NELEMENTS (command); i++)
+   {
+      co_sdo_rx (&net, 1, command[i], 8);
+      EXPECT_TRUE (CanMatch (0x581, expected[i], 8));
+   }
+}
+
+TEST_F (SdoServerTest, ExpeditedUploadStream)
+{
+   uint8_t expected[][8] = {
+      {0x4B, 0x00, 0x21, 0x00, 0x11, 0x22, 0x00, 0x00},
+   };
+   uint8_t command[][8] = {
+      {0x40, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00},
+   };
+
+   domain[0]   = 0x11;
+   domain[1]   = 0x22;
+   domain_size = 2;
+
+   mock_co_obj_find_result   = &obj2100;
+   mock_co_entry_find_result = &OD2100[0];
+
+   co_sdo_rx (&net, 1, command[0], 8);
+   EXPECT_TRUE (CanMatch (0x581, expected[0], 8));
+}
+
+TEST_F (SdoServerTest, SegmentedDownloadStream)
+{
+   uint8_t expected[][8] = {
+      {0x60, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+   };
+   uint8_t command[][8] = {
+      {0x21, 0x00, 0x21, 0x00, 0x0e, 0x00, 0x00, 0x00},
+      {0x00, 0x6e, 0x65, 0x77, 0x20, 0x64, 0x6f, 0x6d},
+      {0x11, 0x61, 0x69, 0x6e, 0x20, 0x64, 0x61, 0x74},
+   };
+
+   memset (domain, 0, sizeof (domain));
+   domain_written = 0;
+
+   mock_co_obj_find_result   = &obj2100;
+   mock_co_entry_find_result = &OD2100[0];
+
+   for (size_t i = 0; i < NELEMENTS (command); i++)
+   {
+      co_sdo_rx (&net, 1, command[i], 8);
+      EXPECT_TRUE (CanMatch (0x581, expected[i], 8));
+   }
+
+   EXPECT_EQ (14u, domain_written);
+   EXPECT_EQ (0, memcmp ("new domain dat", domain, 14));
+   EXPECT_EQ (1u, cb_notify_calls);
+}
+
+TEST_F (SdoServerTest, SegmentedDownloadStreamTooLong)
+{
+   uint8_t expected[][8] = {
+      {0x60, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x80, 0x00, 0x21, 0x00, 0x12, 0x00, 0x07, 0x06},
+   };
+   uint8_t command[][8] = {
+      {0x20, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+   };
+
+   mock_co_obj_find_result   = &obj2100;
+   mock_co_entry_find_result = &OD2100[0];
+
+   for (size_t i = 0; i < NELEMENTS (command); i++)
+   {
+      co_sdo_rx (&net, 1, command[i], 8);
+      EXPECT_TRUE (CanMatch (0x581, expected[i], 8));
+   }
+}
+
+TEST_F (SdoServerTest, SegmentedDownloadStreamShort)
+{
+   uint8_t expected[][8] = {
+      {0x60, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x80, 0x00, 0x21, 0x00, 0x10, 0x00, 0x07, 0x06},
+   };
+   uint8_t command[][8] = {
+      {0x21, 0x00, 0x21, 0x00, 0x0e, 0x00, 0x00, 0x00},
+      {0x01, 0x6e, 0x65, 0x77, 0x20, 0x64, 0x6f, 0x6d},
+   };
+
+   domain_written = 0;
+
+   mock_co_obj_find_result   = &obj2100;
+   mock_co_entry_find_result = &OD2100[0];
+
+   // Last segment arrives before announced size was written
+   for (size_t i = 0; i < NELEMENTS (command); i++)
+   {
+      co_sdo_rx (&net, 1, command[i], 8);
+      EXPECT_TRUE (CanMatch (0x581, expected[i], 8));
+   }
+
+   EXPECT_EQ (0u, domain_written);
+   EXPECT_EQ (0u, cb_notify_calls);
+}
+
+TEST_F (SdoServerTest, SegmentedDownloadStreamLong)
+{
+   uint8_t expected[][8] = {
+      {0x60, 0x00, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x80, 0x00, 0x21, 0x00, 0x12, 0x00, 0x07, 0x06},
+   };
+   uint8_t command[][8] = {
+      {0x21, 0x00, 0x21, 0x00, 0x05, 0x00, 0x00, 0x00},
+      {0x01, 0x6e, 0x65, 0x77, 0x20, 0x64, 0x6f, 0x6d},
+   };
+
+   domain_written = 0;
+
+   mock_co_obj_find_result   = &obj2100;
+   mock_co_entry_find_result = &OD2100[0];
+
+   // Segment exceeds announced size
+   for (size_t i = 0; i < NELEMENTS (command); i++)
+   {
+      co_sdo_rx (&net, 1, command[i], 8);
+      EXPECT_TRUE (CanMatch (0x581, expected[i], 8));
+   }
+
+   EXPECT_EQ (0u, domain_written);
+}
+
+TEST_F (SdoServerTest, SegmentedDownloadSeqlock)
+{
+   static co_seqlock_t lock;
+   static const co_obj_ops_t ops2102 = {NULL, NULL, &lock};
+   static char str2102[10];
+   static const co_entry_t OD2102[] = {
+      {0, OD_RW, DTYPE_VISIBLE_STRING, 8 * sizeof (str2102), 0, str2102},
+   };
+   static const co_obj_t obj2102 = {0x2102, OTYPE_VAR, 0, OD2102, NULL, &ops2102};
+   uint8_t expected[][8] = {
+      {0x60, 0x02, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+   };
+   uint8_t command[][8] = {
+      {0x21, 0x02, 0x21, 0x00, 0x0a, 0x00, 0x00, 0x00},
+      {0x00, 0x73, 0x65, 0x71, 0x75, 0x65, 0x6e, 0x63},
+      {0x19, 0x65, 0x20, 0x6c, 0x00, 0x00, 0x00, 0x00},
+   };
+   uint8_t abort[] = {0x80, 0x02, 0x21, 0x00, 0x05, 0x00, 0x04, 0x05};
+   uint8_t download[sizeof (str2102)];
+   uint32_t sequence;
+
+   mock_co_obj_find_result   = &obj2102;
+   mock_co_entry_find_result = &OD2102[0];
+
+   // Download buffer must hold the object
+   net.download       = download;
+   net.sizes.download = sizeof (download) - 1;
+   co_sdo_rx (&net, 1, command[0], 8);
+   EXPECT_TRUE (CanMatch (0x581, abort, 8));
+   net.sizes.download = sizeof (download);
+
+   // Segments are buffered, object is written once on last segment
+   sequence = co_seqlock_read_begin (&lock);
+   for (size_t i = 0; i < NELEMENTS (command); i++)
+   {
+      co_sdo_rx (&net, 1, command[i], 8);
+      EXPECT_TRUE (CanMatch (0x581, expected[i], 8));
+      EXPECT_FALSE (co_seqlock_read_retry (&lock, co_seqlock_read_begin (&lock)));
+      EXPECT_EQ (i < 2 ? sequence : sequence + 2, co_seqlock_read_begin (&lock));
+   }
+   EXPECT_EQ (0, memcmp ("sequence l", str2102, 10));
+
+   // Object is not written when transfer times out
+   memset (str2102, 0, sizeof (str2102));
+   co_sdo_rx (&net, 1, command[0], 8);
+   co_sdo_rx (&net, 1, command[1], 8);
+   co_sdo_server_timer (&net, 1000 * SDO_TIMEOUT);
+   EXPECT_EQ (sequence + 2, co_seqlock_read_begin (&lock));
+   EXPECT_EQ (0, str2102[0]);
+}
+
+TEST_F (SdoServerTest, SegmentedUploadSeqlock)
+{
+   static co_seqlock_t lock;
+   static const co_obj_ops_t ops2101 = {NULL, NULL, &lock};
+   static char str2101[16] = "sequence locked";
+   static const co_entry_t OD2101[] = {
+      {0, OD_RW, DTYPE_VISIBLE_STRING, 8 * sizeof (str2101), 0, str2101},
+   };
+   static const co_obj_t obj2101 = {0x2101, OTYPE_VAR, 0, OD2101, NULL, &ops2101};
+   uint8_t expected[][8] = {
+      {0x41, 0x01, 0x21, 0x00, 0x10, 0x00, 0x00, 0x00},
+      {0x00, 0x73, 0x65, 0x71, 0x75, 0x65, 0x6e, 0x63},
+      {0x80, 0x01, 0x21, 0x00, 0x00, 0x00, 0x00, 0x08},
+   };
+   uint8_t command[][8] = {
+      {0x40, 0x01, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x60, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+      {0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+   };
+
+   mock_co_obj_find_result   = &obj2101;
+   mock_co_entry_find_result = &OD2101[0];
+
+   co_sdo_rx (&net, 1, command[0], 8);
+   EXPECT_TRUE (CanMatch (0x581, expected[0], 8));
+
+   co_sdo_rx (&net, 1, command[1], 8);
+   EXPECT_TRUE (CanMatch (0x581, expected[1], 8));
+
+   // Modify object during transfer, upload should be aborted
+   co_seqlock_write_begin (&lock);
+   str2101[8] = 'L';
+   co_seqlock_write_end (&lock);
+
+   co_sdo_rx (&net, 1, command[2], 8);
+   EXPECT_TRUE (CanMatch (0x581, expected[2], 8));
+}
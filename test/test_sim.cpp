@@ -0,0 +1,386 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+#include "sim.h"
+#include "co_obj.h"
+#include "test_util.h"
+
+// Test fixture
+
+class SimTest : public TestBase
+{
+ protected:
+   void SetUp() override
+   {
+      TestBase::SetUp();
+      od = comm_od();
+   }
+
+   co_cfg_t config (uint8_t node)
+   {
+      co_cfg_t cfg           = {};
+      cfg.node               = node;
+      cfg.od                 = od.data();
+      cfg.cb_heartbeat_state = cb_heartbeat_state;
+      cfg.cb_sync            = cb_sync;
+      return cfg;
+   }
+
+   std::vector<co_obj_t> od;
+};
+
+// Tests
+
+static co_client_t * sync_client;
+static int sync_sdo_result;
+static void cb_sync_read (co_net_t * net)
+{
+   uint32_t value;
+
+   // Must not poll recursively from within co_poll()
+   sync_sdo_result = co_sdo_read (sync_client, 2, 0x1000, 0, &value, sizeof (value));
+   co_nmt (sync_client, CO_NMT_STOPPED, 2);
+}
+
+TEST_F (SimTest, Bootup)
+{
+   Sim sim ("sim", 125000);
+
+   ASSERT_NE (nullptr, sim.add (config (3)));
+   ASSERT_NE (nullptr, sim.add (config (2)));
+   ASSERT_NE (nullptr, sim.add (config (1)));
+
+   sim.run_for (10000);
+
+   // Frames of 65 bits at 125 kbit/s. Node 3 sends first, then the
+   // other nodes in order of priority.
+   ASSERT_EQ (3u, sim.frames.size());
+   EXPECT_EQ (0x703u, sim.frames[0].id);
+   EXPECT_EQ (520u, sim.frames[0].time);
+   EXPECT_EQ (0x701u, sim.frames[1].id);
+   EXPECT_EQ (1040u, sim.frames[1].time);
+   EXPECT_EQ (0x702u, sim.frames[2].id);
+   EXPECT_EQ (1560u, sim.frames[2].time);
+}
+
+TEST_F (SimTest, SyncPeriod)
+{
+   Sim sim;
+   co_net_t * net = sim.add (config (1));
+   uint32_t value;
+
+   ASSERT_NE (nullptr, net);
+
+   value = 0x40000080;
+   co_od1005_fn (net, OD_EVENT_WRITE, NULL, NULL, 0, &value);
+   value = 10000;
+   co_od1006_fn (net, OD_EVENT_WRITE, NULL, NULL, 0, &value);
+
+   // One minute of SYNC
+   sim.run_for (60 * 1000 * 1000);
+
+   auto sync = sim.filter (0x80);
+   ASSERT_GE (sync.size(), 6000u);
+   EXPECT_LE (sync.size(), 6001u);
+   for (size_t ix = 1; ix < sync.size(); ix++)
+   {
+      ASSERT_EQ (10000u, sync[ix].time - sync[ix - 1].time) << "at " << ix;
+   }
+   EXPECT_EQ (sync.size(), cb_sync_calls);
+}
+
+TEST_F (SimTest, HeartbeatExpiry)
+{
+   Sim sim;
+   co_net_t * net1 = sim.add (config (1));
+   co_net_t * net2 = sim.add (config (2));
+   co_client_t * client;
+   uint16_t time = 100;
+   uint32_t value;
+
+   ASSERT_NE (nullptr, net1);
+   ASSERT_NE (nullptr, net2);
+
+   // Configure producer remotely, the simulation runs while the
+   // client waits for the response
+   client = co_client_init (net1);
+   ASSERT_NE (nullptr, client);
+   EXPECT_EQ (2, co_sdo_write (client, 2, 0x1017, 0, &time, sizeof (time)));
+
+   value = (2 << 16) | 150;
+   co_od1016_fn (net1, OD_EVENT_WRITE, NULL, NULL, 1, &value);
+
+   // Ten minutes of heartbeats
+   sim.run_for (10 * 60 * 1000 * 1000);
+
+   auto heartbeats = sim.filter (0x702);
+   ASSERT_GE (heartbeats.size(), 6000u);
+   EXPECT_LE (heartbeats.size(), 6001u);
+   for (size_t ix = 1; ix < heartbeats.size(); ix++)
+   {
+      ASSERT_EQ (100000u, heartbeats[ix].time - heartbeats[ix - 1].time)
+         << "at " << ix;
+   }
+   EXPECT_TRUE (sim.filter (0x81).empty());
+
+   // Producer fails, consumer reports heartbeat event within a tick
+   os_tick_t last = heartbeats.back().time;
+   sim.remove (net2);
+   sim.run_for (1000 * 1000);
+
+   auto emcy = sim.filter (0x81);
+   ASSERT_FALSE (emcy.empty());
+   EXPECT_EQ (0x30, emcy[0].data[0]);
+   EXPECT_EQ (0x81, emcy[0].data[1]);
+   EXPECT_GE (emcy[0].time - last, 150000u);
+   EXPECT_LE (emcy[0].time - last, 151000u);
+}
+
+TEST_F (SimTest, Statistics)
+{
+   Sim sim;
+   co_net_t * net1 = sim.add (config (1));
+   co_net_t * net2 = sim.add (config (2));
+   co_client_t * client1;
+   co_client_t * client2;
+   co_stats_t stats;
+   uint32_t value;
+
+   ASSERT_NE (nullptr, net1);
+   ASSERT_NE (nullptr, net2);
+
+   value = 0x40000080;
+   co_od1005_fn (net1, OD_EVENT_WRITE, NULL, NULL, 0, &value);
+   value = 10000;
+   co_od1006_fn (net1, OD_EVENT_WRITE, NULL, NULL, 0, &value);
+
+   sim.run_for (1000 * 1000);
+
+   auto sync = sim.filter (0x80);
+   ASSERT_FALSE (sync.empty());
+
+   client1 = co_client_init (net1);
+   client2 = co_client_init (net2);
+   ASSERT_NE (nullptr, client1);
+   ASSERT_NE (nullptr, client2);
+
+   // Node 1 sends boot-up and SYNCs, receives boot-up of node 2
+   EXPECT_EQ (0, co_stats_get (client1, &stats));
+   EXPECT_EQ (1u, stats.tx[14]);
+   EXPECT_EQ (sync.size(), stats.tx[1]);
+   EXPECT_EQ (1u, stats.rx[14]);
+   EXPECT_EQ (0u, stats.rx[1]);
+   EXPECT_EQ (0u, stats.tx_failed);
+
+   // Node 2 receives SYNCs, each dispatched once
+   EXPECT_EQ (0, co_stats_get (client2, &stats));
+   EXPECT_EQ (sync.size(), stats.rx[1]);
+
+   // One latency sample per batch, SYNCs arrive one at a time
+   uint32_t samples = 0;
+   for (uint32_t count : stats.rx_batch_latency.bucket)
+      samples += count;
+   EXPECT_EQ (sync.size(), samples);
+
+   EXPECT_EQ (0, co_stats_reset (client2));
+   EXPECT_EQ (0, co_stats_get (client2, &stats));
+   EXPECT_EQ (0u, stats.rx[1]);
+   EXPECT_EQ (0u, stats.tx[14]);
+}
+
+TEST_F (SimTest, EmcyBurst)
+{
+   Sim sim;
+   co_net_t * net1 = sim.add (config (1));
+   co_client_t * client;
+   co_emcy_stream_t * stream;
+   co_emcy_record_t record;
+   uint32_t value;
+
+   ASSERT_NE (nullptr, net1);
+
+   // Inhibit time 10 ms
+   value = 100;
+   co_od1015_fn (net1, OD_EVENT_WRITE, NULL, NULL, 0, &value);
+
+   client = co_client_init (net1);
+   ASSERT_NE (nullptr, client);
+   stream = co_emcy_subscribe (client);
+   ASSERT_NE (nullptr, stream);
+   EXPECT_EQ (nullptr, co_emcy_subscribe (client));
+
+   // Burst of EMCYs is sent one per inhibit time
+   for (uint16_t code = 0x1000; code < 0x1003; code++)
+      EXPECT_EQ (0, co_emcy_issue (client, code, 0, NULL));
+   sim.run_for (100 * 1000);
+
+   auto emcy = sim.filter (0x81);
+   ASSERT_EQ (3u, emcy.size());
+   for (size_t ix = 0; ix < emcy.size(); ix++)
+   {
+      EXPECT_EQ (ix, emcy[ix].data[0]);
+      if (ix > 0)
+      {
+         EXPECT_GE (emcy[ix].time - emcy[ix - 1].time, 10000u);
+         EXPECT_LE (emcy[ix].time - emcy[ix - 1].time, 11000u);
+      }
+   }
+
+   // Subscriber sees all EMCYs
+   for (uint16_t code = 0x1000; code < 0x1003; code++)
+   {
+      ASSERT_EQ (0, co_emcy_poll (stream, &record, 0));
+      EXPECT_EQ (code, record.code);
+   }
+   EXPECT_EQ (-1, co_emcy_poll (stream, &record, 0));
+
+   EXPECT_EQ (0, co_emcy_unsubscribe (client, stream));
+}
+
+TEST_F (SimTest, EmcyConsumer)
+{
+   Sim sim;
+   co_cfg_t cfg = config (1);
+   co_client_t * client1;
+   co_client_t * client2;
+   co_emcy_status_t status;
+
+   cfg.cb_emcy       = cb_emcy;
+   cfg.emcy_consumer = true;
+   cfg.emcy_rate_ms  = 50;
+
+   co_net_t * net1 = sim.add (cfg);
+   co_net_t * net2 = sim.add (config (2));
+   ASSERT_NE (nullptr, net1);
+   ASSERT_NE (nullptr, net2);
+
+   client1 = co_client_init (net1);
+   client2 = co_client_init (net2);
+   ASSERT_NE (nullptr, client1);
+   ASSERT_NE (nullptr, client2);
+
+   // Nothing received from node 2 yet
+   ASSERT_EQ (0, co_emcy_status_get (client1, 2, &status));
+   EXPECT_EQ (0u, status.count);
+
+   for (uint16_t code = 0x1000; code < 0x1003; code++)
+      EXPECT_EQ (0, co_emcy_issue (client2, code, 0, NULL));
+   sim.run_for (10 * 1000);
+
+   ASSERT_EQ (0, co_emcy_status_get (client1, 2, &status));
+   EXPECT_EQ (3u, status.count);
+   EXPECT_EQ (2u, status.suppressed);
+   EXPECT_EQ (0x1002u, status.code);
+   EXPECT_EQ (1u, cb_emcy_calls);
+   EXPECT_EQ (0x1000u, cb_emcy_code);
+
+   EXPECT_EQ (CO_STATUS_ERROR, co_emcy_status_get (client1, 128, &status));
+}
+
+TEST_F (SimTest, ClientCallFromCallback)
+{
+   Sim sim;
+   co_cfg_t cfg = config (1);
+   uint32_t value;
+
+   cfg.cb_sync     = cb_sync_read;
+   co_net_t * net1 = sim.add (cfg);
+   co_net_t * net2 = sim.add (config (2));
+   ASSERT_NE (nullptr, net1);
+   ASSERT_NE (nullptr, net2);
+
+   sync_client     = co_client_init (net1);
+   sync_sdo_result = 0;
+   ASSERT_NE (nullptr, sync_client);
+
+   value = 0x40000080;
+   co_od1005_fn (net1, OD_EVENT_WRITE, NULL, NULL, 0, &value);
+   value = 10000;
+   co_od1006_fn (net1, OD_EVENT_WRITE, NULL, NULL, 0, &value);
+
+   sim.run_for (15000);
+
+   // SDO request fails at once, NMT command is sent from the callback
+   EXPECT_EQ (CO_STATUS_ERROR, sync_sdo_result);
+   EXPECT_TRUE (sim.filter (0x602).empty());
+   auto nmt = sim.filter (0x000);
+   ASSERT_FALSE (nmt.empty());
+   EXPECT_EQ (CO_NMT_STOPPED, nmt[0].data[0]);
+   EXPECT_EQ (2, nmt[0].data[1]);
+   EXPECT_EQ (STATE_STOP, net2->state);
+}
+
+TEST_F (SimTest, LssAssign)
+{
+   Sim sim;
+   co_client_t * client;
+   co_lss_address_t address[4];
+   std::vector<std::vector<co_entry_t>> identities;
+   std::vector<std::vector<co_obj_t>> ods;
+   uint32_t serials[] = {0x300, 0x100, 0x200};
+   int error;
+
+   co_net_t * master = sim.add (config (1));
+   ASSERT_NE (nullptr, master);
+
+   // Non-configured LSS slaves, differing in serial number only
+   for (uint32_t serial : serials)
+   {
+      identities.push_back ({
+         {0, OD_RO, DTYPE_UNSIGNED8, 8, 4, NULL},
+         {1, OD_RO, DTYPE_UNSIGNED32, 32, 0x1234, NULL},
+         {2, OD_RO, DTYPE_UNSIGNED32, 32, 0x5678, NULL},
+         {3, OD_RO, DTYPE_UNSIGNED32, 32, 1, NULL},
+         {4, OD_RO, DTYPE_UNSIGNED32, 32, serial, NULL},
+      });
+      ods.push_back (od);
+      for (co_obj_t & obj : ods.back())
+      {
+         if (obj.index == 0x1018)
+            obj.entries = identities.back().data();
+      }
+   }
+   for (std::vector<co_obj_t> & slave_od : ods)
+   {
+      co_cfg_t cfg = config (0xFF);
+
+      cfg.od = slave_od.data();
+      ASSERT_NE (nullptr, sim.add (cfg));
+   }
+   sim.run_for (10000);
+   EXPECT_TRUE (sim.filter (0x70A).empty());
+
+   client = co_client_init (master);
+   ASSERT_NE (nullptr, client);
+
+   // Assignment stops at a slave that is given an invalid bitrate, the
+   // slave keeps its new node ID
+   EXPECT_EQ (1u, co_lss_assign (client, 10, 12345, address, NELEMENTS (address), &error));
+   EXPECT_EQ (-1, error);
+
+   EXPECT_EQ (2u, co_lss_assign (client, 11, 0, &address[1], NELEMENTS (address) - 1, &error));
+   EXPECT_EQ (0, error);
+   sim.run_for (10000);
+
+   // Slaves are found in order of LSS address and boot with new node ID
+   for (unsigned int ix = 0; ix < 3; ix++)
+   {
+      EXPECT_EQ (0x100u * (ix + 1), address[ix].serial);
+      EXPECT_EQ (1u, sim.filter (0x700 + 10 + ix).size());
+   }
+
+   // No slaves left to configure
+   EXPECT_EQ (0u, co_lss_assign (client, 13, 0, address, NELEMENTS (address), &error));
+   EXPECT_EQ (0, error);
+}
@@ -0,0 +1,126 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "co_stats.h"
+#include "co_sdo.h"
+#include "test_util.h"
+
+// co_send() expands to os_channel_send()
+#define os_channel_send mock_os_channel_send
+
+// Test fixture
+
+class StatsTest : public TestBase
+{
+};
+
+// Tests
+
+TEST_F (StatsTest, Latency)
+{
+   co_histogram_t hist = {};
+
+   co_stats_latency (&net, &hist, 1000, 1000);
+   co_stats_latency (&net, &hist, 1000, 1001);
+   co_stats_latency (&net, &hist, 1000, 1005);
+   co_stats_latency (&net, &hist, 1000, 1008);
+   co_stats_latency (&net, &hist, 1000, 2000);
+   co_stats_latency (&net, &hist, 1000, 1000 + 10 * 1000 * 1000);
+
+   EXPECT_EQ (1u, hist.bucket[0]);
+   EXPECT_EQ (1u, hist.bucket[1]);
+   EXPECT_EQ (1u, hist.bucket[3]);
+   EXPECT_EQ (1u, hist.bucket[4]);
+   EXPECT_EQ (1u, hist.bucket[10]);
+   EXPECT_EQ (1u, hist.bucket[CO_STATS_BUCKETS - 1]);
+   EXPECT_EQ (10u * 1000 * 1000, hist.max);
+
+   // Clamped to one hour
+   co_stats_latency (&net, &hist, 1000, 1000 + 10 * 3600000000ULL);
+   EXPECT_EQ (2u, hist.bucket[CO_STATS_BUCKETS - 1]);
+   EXPECT_EQ (3600000000u, hist.max);
+}
+
+TEST_F (StatsTest, Send)
+{
+   uint8_t msg[8] = {0};
+
+   mock_os_channel_send_result = 0;
+   EXPECT_EQ (0, co_send (&net, 0x181, msg, sizeof (msg)));
+   EXPECT_EQ (0, co_send (&net, 0x701, msg, 1));
+
+   mock_os_channel_send_result = -1;
+   EXPECT_EQ (-1, co_send (&net, 0x182, msg, sizeof (msg)));
+   mock_os_channel_send_result = 0;
+
+   EXPECT_EQ (1u, net.stats.tx[3]);
+   EXPECT_EQ (1u, net.stats.tx[14]);
+   EXPECT_EQ (1u, net.stats.tx_failed);
+}
+
+TEST_F (StatsTest, SdoServer)
+{
+   uint8_t upload[] = {0x40, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00};
+   uint8_t unknown[] = {0xE0, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+   mock_co_obj_find_result   = find_obj (0x1000);
+   mock_co_entry_find_result = find_entry (mock_co_obj_find_result, 0);
+
+   net.rx_timestamp            = 100;
+   mock_os_tick_current_result = 105;
+   co_sdo_rx (&net, 1, upload, sizeof (upload));
+
+   EXPECT_EQ (1u, net.stats.sdo_transfers);
+   EXPECT_EQ (4u, net.stats.sdo_bytes);
+   EXPECT_EQ (0u, net.stats.sdo_aborts);
+   EXPECT_EQ (1u, net.stats.sdo_latency.bucket[3]);
+   EXPECT_EQ (5u, net.stats.sdo_latency.max);
+
+   // Aborted request is not sampled
+   co_sdo_rx (&net, 1, unknown, sizeof (unknown));
+   EXPECT_EQ (1u, net.stats.sdo_transfers);
+   EXPECT_EQ (1u, net.stats.sdo_aborts);
+   EXPECT_EQ (1u, net.stats.sdo_latency.bucket[3]);
+}
+
+TEST_F (StatsTest, Object)
+{
+   uint32_t value;
+
+   net.stats.rx[1]         = 2;
+   net.stats.rx[3]         = 3;
+   net.stats.tx[14]        = 4;
+   net.stats.sdo_transfers = 5;
+   net.stats.emcy_rx       = 6;
+   net.mbox_overrun        = 7;
+
+   EXPECT_EQ (0u, co_od5F00_fn (&net, OD_EVENT_READ, NULL, NULL, 1, &value));
+   EXPECT_EQ (5u, value);
+   EXPECT_EQ (0u, co_od5F00_fn (&net, OD_EVENT_READ, NULL, NULL, 2, &value));
+   EXPECT_EQ (4u, value);
+   EXPECT_EQ (0u, co_od5F00_fn (&net, OD_EVENT_READ, NULL, NULL, 6, &value));
+   EXPECT_EQ (5u, value);
+   EXPECT_EQ (0u, co_od5F00_fn (&net, OD_EVENT_READ, NULL, NULL, 11, &value));
+   EXPECT_EQ (6u, value);
+   EXPECT_EQ (0u, co_od5F00_fn (&net, OD_EVENT_READ, NULL, NULL, 12, &value));
+   EXPECT_EQ (7u, value);
+
+   EXPECT_EQ (
+      CO_SDO_ABORT_BAD_SUBINDEX,
+      co_od5F00_fn (&net, OD_EVENT_READ, NULL, NULL, 13, &value));
+   EXPECT_EQ (
+      CO_SDO_ABORT_GENERAL,
+      co_od5F00_fn (&net, OD_EVENT_WRITE, NULL, NULL, 1, &value));
+}
@@ -163,3 +163,15 @@ TEST_F (SyncTest, SyncCounter)
    EXPECT_EQ (4u, mock_os_channel_send_calls);
    EXPECT_TRUE (CanMatch (0x80, &expected[3], 1));
 }
+
+TEST_F (SyncTest, SyncRequest)
+{
+   co_client_t * client = co_client_init (&net);
+
+   // SYNC requested by application is sent and counted by the stack
+   net.threadless = true;
+   co_sync (client);
+   EXPECT_EQ (1u, mock_os_channel_send_calls);
+   EXPECT_TRUE (CanMatch (0x80, NULL, 0));
+   EXPECT_EQ (1u, net.stats.tx[1]);
+}
@@ -23,6 +23,10 @@
 #include "options.h"
 #include "co_od.h"
 #include "co_pdo.h"
+#include "co_arena.h"
+#include "co_stats.h"
+
+#include <vector>
 
 extern "C" uint32_t cb2001 (
    co_net_t * net,
@@ -53,29 +57,40 @@ class TestBase : public ::testing::Test
       net.write              = store_write;
       net.close              = store_close;
 
+      arena_init();
       co_pdo_init (&net);
       co_nmt_init (&net);
       co_od_reset (&net, CO_STORE_COMM, 0x1000, 0x1FFF);
+      co_stats_init (&net);
 
       cb_emcy_calls            = 0;
       cb_reset_calls           = 0;
       cb_nmt_calls             = 0;
       cb_sync_calls            = 0;
+      cb_job_calls             = 0;
       cb_notify_calls          = 0;
       cb_heartbeat_state_calls = 0;
 
-      mock_os_tick_current_result = 0;
-      mock_os_channel_send_calls         = 0;
-      mock_os_channel_send_id            = 0;
-      mock_os_channel_receive_calls      = 0;
-      mock_os_channel_bus_off_calls      = 0;
-      mock_os_channel_bus_on_calls       = 0;
-      mock_os_channel_set_bitrate_calls  = 0;
-      mock_os_channel_set_filter_calls   = 0;
-      mock_os_channel_get_state_calls    = 0;
-      mock_co_od_reset_calls             = 0;
-      mock_co_emcy_tx_calls              = 0;
-      store_open_calls                   = 0;
+      mock_os_tick_current_result            = 0;
+      mock_os_channel_send_calls             = 0;
+      mock_os_channel_send_hook              = nullptr;
+      mock_os_channel_send_id                = 0;
+      mock_os_channel_receive_calls          = 0;
+      mock_os_channel_bus_off_calls          = 0;
+      mock_os_channel_bus_on_calls           = 0;
+      mock_os_channel_close_calls            = 0;
+      mock_os_channel_open_fail              = false;
+      mock_os_loop_add_result                = 0;
+      mock_os_channel_set_bitrate_calls      = 0;
+      mock_os_channel_set_bitrate_result     = 0;
+      mock_os_channel_set_listen_only_calls  = 0;
+      mock_os_channel_set_listen_only_result = 0;
+      mock_os_channel_set_filter_calls       = 0;
+      mock_os_channel_get_state_calls        = 0;
+      mock_os_channel_get_state_state        = {};
+      mock_co_od_reset_calls                 = 0;
+      mock_co_emcy_tx_calls                  = 0;
+      store_open_calls                       = 0;
 
       strcpy (name1008, "new slave");
       OD1008[0].bitlength = 8 * strlen (name1008);
@@ -84,7 +99,51 @@ class TestBase : public ::testing::Test
       OD100A[0].bitlength = 8 * strlen (name100A);
    }
 
+   /* Allocate tables sized from net.od */
+   void arena_init()
+   {
+      co_arena_t a;
+
+      ASSERT_EQ (0, co_arena_sizes (net.od, false, &net.sizes));
+      arena.assign (co_arena_tables_size (&net.sizes), 0);
+      co_arena_init (&a, arena.data(), arena.size());
+      ASSERT_EQ (0, co_arena_tables (&net, &a));
+   }
+
+   /* Write function appending to std::vector<uint8_t> at arg */
+   static int vector_write (void * arg, const void * data, size_t size)
+   {
+      auto * v       = static_cast<std::vector<uint8_t> *> (arg);
+      const auto * p = static_cast<const uint8_t *> (data);
+
+      v->insert (v->end(), p, p + size);
+      return 0;
+   }
+
+   /* Write function that always fails */
+   static int fail_write (void * arg, const void * data, size_t size)
+   {
+      return -1;
+   }
+
+   /* Communication objects of test_od, for networks started with
+      co_init(). Application objects of test_od are not backed by
+      storage. */
+   std::vector<co_obj_t> comm_od() const
+   {
+      std::vector<co_obj_t> od;
+
+      for (const co_obj_t & obj : test_od)
+      {
+         if (obj.index < 0x2000)
+            od.push_back (obj);
+      }
+
+      return od;
+   }
+
    co_net_t net;
+   std::vector<uint8_t> arena;
 
    const co_entry_t OD1000[1] = {
       {0, OD_RO, DTYPE_UNSIGNED32, 32, 0x00420192, NULL},
@@ -167,43 +226,43 @@ class TestBase : public ::testing::Test
 
    const co_obj_t test_od[37] = {
       // clang-format off
-      {0x1000, OTYPE_VAR,    0,               OD1000, NULL},
-      {0x1001, OTYPE_VAR,    0,               OD1001, co_od1001_fn},
-      {0x1003, OTYPE_ARRAY,  MAX_ERRORS,      OD1003, co_od1003_fn},
-      {0x1005, OTYPE_VAR,    0,               OD1005, co_od1005_fn},
-      {0x1006, OTYPE_VAR,    0,               OD1006, co_od1006_fn},
-      {0x1007, OTYPE_VAR,    0,               OD1007, co_od1007_fn},
-      {0x1008, OTYPE_VAR,    0,               OD1008, NULL},
-      {0x1009, OTYPE_VAR,    0,               OD1009, NULL},
-      {0x100A, OTYPE_VAR,    0,               OD100A, NULL},
-      {0x100C, OTYPE_VAR,    0,               OD100C, co_od100C_fn},
-      {0x100D, OTYPE_VAR,    0,               OD100D, co_od100D_fn},
-      {0x1010, OTYPE_ARRAY,  4,               OD1010, co_od1010_fn},
-      {0x1011, OTYPE_ARRAY,  4,               OD1011, co_od1011_fn},
-      {0x1014, OTYPE_VAR,    0,               OD1014, co_od1014_fn},
-      {0x1015, OTYPE_VAR,    0,               OD1015, co_od1015_fn},
-      {0x1016, OTYPE_ARRAY,  MAX_HEARTBEATS,  OD1016, co_od1016_fn},
-      {0x1018, OTYPE_RECORD, 4,               OD1018, NULL},
-      {0x1017, OTYPE_VAR,    0,               OD1017, co_od1017_fn},
-      {0x1019, OTYPE_VAR,    0,               OD1019, co_od1019_fn},
-      {0x1020, OTYPE_ARRAY,  2,               OD1020, co_od1020_fn},
-      {0x1028, OTYPE_ARRAY,  MAX_EMCY_COBIDS, OD1028, co_od1028_fn},
-      {0x1029, OTYPE_ARRAY,  1,               OD1029, co_od1029_fn},
-      {0x1400, OTYPE_RECORD, 5,               OD1400, co_od1400_fn},
-      {0x1533, OTYPE_RECORD, 5,               OD1400, co_od1400_fn},
-      {0x1600, OTYPE_RECORD, MAX_PDO_ENTRIES, OD1600, co_od1600_fn},
-      {0x1733, OTYPE_RECORD, MAX_PDO_ENTRIES, OD1600, co_od1600_fn},
-      {0x1800, OTYPE_RECORD, 6,               OD1800, co_od1800_fn},
-      {0x1899, OTYPE_RECORD, 6,               OD1800, co_od1800_fn},
-      {0x1A00, OTYPE_RECORD, MAX_PDO_ENTRIES, OD1A00, co_od1A00_fn},
-      {0x1A99, OTYPE_RECORD, MAX_PDO_ENTRIES, OD1A00, co_od1A00_fn},
-      {0x2000, OTYPE_ARRAY,  8,               OD2000, NULL},
-      {0x2001, OTYPE_RECORD, 2,               OD2001, cb2001},
-      {0x6000, OTYPE_VAR,    0,               OD6000, NULL},
-      {0x6001, OTYPE_VAR,    0,               OD6001, NULL},
-      {0x6003, OTYPE_RECORD, 12,              OD6003, NULL},
-      {0x7000, OTYPE_VAR,    0,               OD7000, NULL},
-      {0, OTYPE_NULL, 0, NULL, NULL},
+      {0x1000, OTYPE_VAR,    0,               OD1000, NULL, NULL},
+      {0x1001, OTYPE_VAR,    0,               OD1001, co_od1001_fn, NULL},
+      {0x1003, OTYPE_ARRAY,  MAX_ERRORS,      OD1003, co_od1003_fn, NULL},
+      {0x1005, OTYPE_VAR,    0,               OD1005, co_od1005_fn, NULL},
+      {0x1006, OTYPE_VAR,    0,               OD1006, co_od1006_fn, NULL},
+      {0x1007, OTYPE_VAR,    0,               OD1007, co_od1007_fn, NULL},
+      {0x1008, OTYPE_VAR,    0,               OD1008, NULL, NULL},
+      {0x1009, OTYPE_VAR,    0,               OD1009, NULL, NULL},
+      {0x100A, OTYPE_VAR,    0,               OD100A, NULL, NULL},
+      {0x100C, OTYPE_VAR,    0,               OD100C, co_od100C_fn, NULL},
+      {0x100D, OTYPE_VAR,    0,               OD100D, co_od100D_fn, NULL},
+      {0x1010, OTYPE_ARRAY,  4,               OD1010, co_od1010_fn, NULL},
+      {0x1011, OTYPE_ARRAY,  4,               OD1011, co_od1011_fn, NULL},
+      {0x1014, OTYPE_VAR,    0,               OD1014, co_od1014_fn, NULL},
+      {0x1015, OTYPE_VAR,    0,               OD1015, co_od1015_fn, NULL},
+      {0x1016, OTYPE_ARRAY,  MAX_HEARTBEATS,  OD1016, co_od1016_fn, NULL},
+      {0x1018, OTYPE_RECORD, 4,               OD1018, NULL, NULL},
+      {0x1017, OTYPE_VAR,    0,               OD1017, co_od1017_fn, NULL},
+      {0x1019, OTYPE_VAR,    0,               OD1019, co_od1019_fn, NULL},
+      {0x1020, OTYPE_ARRAY,  2,               OD1020, co_od1020_fn, NULL},
+      {0x1028, OTYPE_ARRAY,  MAX_EMCY_COBIDS, OD1028, co_od1028_fn, NULL},
+      {0x1029, OTYPE_ARRAY,  1,               OD1029, co_od1029_fn, NULL},
+      {0x1400, OTYPE_RECORD, 5,               OD1400, co_od1400_fn, NULL},
+      {0x1533, OTYPE_RECORD, 5,               OD1400, co_od1400_fn, NULL},
+      {0x1600, OTYPE_RECORD, MAX_PDO_ENTRIES, OD1600, co_od1600_fn, NULL},
+      {0x1733, OTYPE_RECORD, MAX_PDO_ENTRIES, OD1600, co_od1600_fn, NULL},
+      {0x1800, OTYPE_RECORD, 6,               OD1800, co_od1800_fn, NULL},
+      {0x1899, OTYPE_RECORD, 6,               OD1800, co_od1800_fn, NULL},
+      {0x1A00, OTYPE_RECORD, MAX_PDO_ENTRIES, OD1A00, co_od1A00_fn, NULL},
+      {0x1A99, OTYPE_RECORD, MAX_PDO_ENTRIES, OD1A00, co_od1A00_fn, NULL},
+      {0x2000, OTYPE_ARRAY,  8,               OD2000, NULL, NULL},
+      {0x2001, OTYPE_RECORD, 2,               OD2001, cb2001, NULL},
+      {0x6000, OTYPE_VAR,    0,               OD6000, NULL, NULL},
+      {0x6001, OTYPE_VAR,    0,               OD6001, NULL, NULL},
+      {0x6003, OTYPE_RECORD, 12,              OD6003, NULL, NULL},
+      {0x7000, OTYPE_VAR,    0,               OD7000, NULL, NULL},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
       // clang-format on
    };
 
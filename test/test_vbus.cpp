@@ -0,0 +1,341 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+#include "co_vbus.h"
+#include "co_main.h"
+#include "test_util.h"
+
+#include <set>
+#include <thread>
+
+// Test fixture
+
+static uint64_t vbus_time;
+
+static uint64_t vbus_clock (void * arg)
+{
+   return vbus_time;
+}
+
+static unsigned int vbus_calls;
+
+static void vbus_callback (void * arg)
+{
+   vbus_calls++;
+}
+
+class VbusTest : public TestBase
+{
+ protected:
+   void SetUp() override
+   {
+      co_vbus_cfg_t cfg = {0, vbus_clock, NULL};
+
+      TestBase::SetUp();
+      vbus_time  = 0;
+      vbus_calls = 0;
+      co_vbus_configure ("test", &cfg);
+   }
+
+   void TearDown() override
+   {
+      co_vbus_destroy ("test");
+      TestBase::TearDown();
+   }
+
+   void SetBitrate (int bitrate)
+   {
+      co_vbus_cfg_t cfg = {bitrate, vbus_clock, NULL};
+      co_vbus_configure ("test", &cfg);
+   }
+};
+
+// Tests
+
+TEST_F (VbusTest, SendReceive)
+{
+   co_vbus_node_t * a = co_vbus_open ("test", NULL, NULL);
+   co_vbus_node_t * b = co_vbus_open ("test", NULL, NULL);
+   uint8_t data[8]    = {1, 2, 3, 4, 5, 6, 7, 8};
+   uint8_t rx[8];
+   uint32_t id;
+   size_t dlc;
+
+   ASSERT_NE (nullptr, a);
+   ASSERT_NE (nullptr, b);
+
+   EXPECT_EQ (0, co_vbus_send (a, 0x181, data, 8));
+
+   // Own frames are not received
+   EXPECT_EQ (-1, co_vbus_receive (a, &id, rx, &dlc));
+
+   EXPECT_EQ (0, co_vbus_receive (b, &id, rx, &dlc));
+   EXPECT_EQ (0x181u, id);
+   EXPECT_EQ (8u, dlc);
+   EXPECT_EQ (0, memcmp (data, rx, 8));
+   EXPECT_EQ (-1, co_vbus_receive (b, &id, rx, &dlc));
+}
+
+TEST_F (VbusTest, Callback)
+{
+   co_vbus_node_t * a = co_vbus_open ("test", vbus_callback, NULL);
+   co_vbus_node_t * b = co_vbus_open ("test", vbus_callback, NULL);
+   co_vbus_node_t * c = co_vbus_open ("test", NULL, NULL);
+   uint8_t data[1]    = {0};
+
+   co_vbus_send (a, 0x100, data, 1);
+   EXPECT_EQ (1u, vbus_calls);
+
+   co_vbus_callback_set (b, NULL, NULL);
+   co_vbus_send (c, 0x100, data, 1);
+   EXPECT_EQ (2u, vbus_calls);
+}
+
+TEST_F (VbusTest, Pacing)
+{
+   co_vbus_node_t * a = co_vbus_open ("test", NULL, NULL);
+   co_vbus_node_t * b = co_vbus_open ("test", NULL, NULL);
+   uint8_t data[8]    = {0};
+   co_vbus_stats_t stats;
+   uint64_t next;
+   uint32_t id;
+   size_t dlc;
+
+   SetBitrate (125000);
+
+   // 135 bits with worst case stuffing, 8 us per bit
+   co_vbus_send (a, 0x181, data, 8);
+   EXPECT_FALSE (co_vbus_pending (b, &next));
+   EXPECT_EQ (1080000u, next);
+
+   vbus_time = 1079999;
+   EXPECT_EQ (-1, co_vbus_receive (b, &id, data, &dlc));
+
+   vbus_time = 1080000;
+   EXPECT_TRUE (co_vbus_pending (b, &next));
+   EXPECT_EQ (0, co_vbus_receive (b, &id, data, &dlc));
+
+   co_vbus_stats_get ("test", &stats);
+   EXPECT_EQ (1u, stats.frames);
+   EXPECT_EQ (1080000u, stats.busy_ns);
+}
+
+TEST_F (VbusTest, Arbitration)
+{
+   co_vbus_node_t * a = co_vbus_open ("test", NULL, NULL);
+   co_vbus_node_t * b = co_vbus_open ("test", NULL, NULL);
+   co_vbus_node_t * c = co_vbus_open ("test", NULL, NULL);
+   co_vbus_node_t * d;
+   uint8_t data[8] = {0};
+   uint32_t id;
+   size_t dlc;
+
+   SetBitrate (125000);
+
+   // Bus is busy with first frame while the others are queued
+   co_vbus_send (a, 0x700, data, 1);
+   co_vbus_send (a, 0x080, data, 1);
+   co_vbus_send (b, 0x08000000 | CO_EXT_MASK, data, 1);
+   co_vbus_send (b, 0x100, data, 1);
+   co_vbus_send (c, 0x100 | CO_RTR_MASK, data, 0);
+
+   vbus_time = 1000000000;
+
+   EXPECT_EQ (0, co_vbus_receive (c, &id, data, &dlc));
+   EXPECT_EQ (0x700u, id);
+   EXPECT_EQ (0, co_vbus_receive (c, &id, data, &dlc));
+   EXPECT_EQ (0x080u, id);
+
+   // Frames are sent in order from each channel, so the extended
+   // frame blocks the standard frame queued behind it
+   EXPECT_EQ (0, co_vbus_receive (a, &id, data, &dlc));
+   EXPECT_EQ (0x100u | CO_RTR_MASK, id);
+   EXPECT_EQ (0, co_vbus_receive (a, &id, data, &dlc));
+   EXPECT_EQ (0x08000000u | CO_EXT_MASK, id);
+   EXPECT_EQ (0, co_vbus_receive (a, &id, data, &dlc));
+   EXPECT_EQ (0x100u, id);
+
+   // Data frame wins over remote frame with same identifier, and
+   // standard frame over extended frame with same base identifier
+   d = co_vbus_open ("test", NULL, NULL);
+   co_vbus_send (a, 0x700, data, 1);
+   co_vbus_send (a, 0x200 | CO_RTR_MASK, data, 0);
+   co_vbus_send (b, (0x200 << 18) | CO_EXT_MASK, data, 1);
+   co_vbus_send (c, 0x200, data, 1);
+
+   vbus_time = 2000000000;
+
+   EXPECT_EQ (0, co_vbus_receive (d, &id, data, &dlc));
+   EXPECT_EQ (0x700u, id);
+   EXPECT_EQ (0, co_vbus_receive (d, &id, data, &dlc));
+   EXPECT_EQ (0x200u, id);
+   EXPECT_EQ (0, co_vbus_receive (d, &id, data, &dlc));
+   EXPECT_EQ (0x200u | CO_RTR_MASK, id);
+   EXPECT_EQ (0, co_vbus_receive (d, &id, data, &dlc));
+   EXPECT_EQ ((0x200u << 18) | CO_EXT_MASK, id);
+}
+
+TEST_F (VbusTest, Overrun)
+{
+   co_vbus_node_t * a = co_vbus_open ("test", NULL, NULL);
+   co_vbus_node_t * b = co_vbus_open ("test", NULL, NULL);
+   bool overrun, error_passive, bus_off;
+   uint8_t data[8] = {0};
+   uint32_t id;
+   size_t dlc;
+
+   for (unsigned int ix = 0; ix < 1030; ix++)
+   {
+      ASSERT_EQ (0, co_vbus_send (a, ix & 0x7FF, data, 0));
+   }
+
+   EXPECT_EQ (0, co_vbus_receive (b, &id, data, &dlc));
+   EXPECT_EQ (6u, id);
+
+   co_vbus_state_get (b, &overrun, &error_passive, &bus_off);
+   EXPECT_TRUE (overrun);
+   co_vbus_state_get (b, &overrun, &error_passive, &bus_off);
+   EXPECT_FALSE (overrun);
+}
+
+TEST_F (VbusTest, ErrorInjection)
+{
+   co_vbus_node_t * a = co_vbus_open ("test", NULL, NULL);
+   co_vbus_node_t * b = co_vbus_open ("test", NULL, NULL);
+   bool overrun, error_passive, bus_off;
+   uint8_t data[8] = {0};
+   co_vbus_stats_t stats;
+   uint32_t id;
+   size_t dlc;
+
+   // Frame is retransmitted until it succeeds
+   co_vbus_error_inject ("test", 0x181, 0x7FF, 20);
+   co_vbus_send (a, 0x181, data, 8);
+   EXPECT_EQ (0, co_vbus_receive (b, &id, data, &dlc));
+
+   co_vbus_stats_get ("test", &stats);
+   EXPECT_EQ (20u, stats.errors);
+   EXPECT_EQ (1u, stats.frames);
+
+   co_vbus_state_get (a, &overrun, &error_passive, &bus_off);
+   EXPECT_TRUE (error_passive);
+   EXPECT_FALSE (bus_off);
+
+   // Other identifiers are not affected
+   co_vbus_error_inject ("test", 0x181, 0x7FF, 100);
+   co_vbus_send (a, 0x182, data, 8);
+   EXPECT_EQ (0, co_vbus_receive (b, &id, data, &dlc));
+
+   // Bus off discards the frame
+   co_vbus_send (a, 0x181, data, 8);
+   co_vbus_state_get (a, &overrun, &error_passive, &bus_off);
+   EXPECT_TRUE (bus_off);
+   EXPECT_EQ (-1, co_vbus_send (a, 0x182, data, 8));
+   EXPECT_EQ (-1, co_vbus_receive (b, &id, data, &dlc));
+
+   // Recovery
+   co_vbus_enable (a, false);
+   co_vbus_enable (a, true);
+   co_vbus_state_get (a, &overrun, &error_passive, &bus_off);
+   EXPECT_FALSE (bus_off);
+   EXPECT_EQ (0, co_vbus_send (a, 0x182, data, 8));
+   EXPECT_EQ (0, co_vbus_receive (b, &id, data, &dlc));
+}
+
+TEST_F (VbusTest, ListenOnly)
+{
+   co_vbus_node_t * a = co_vbus_open ("test", NULL, NULL);
+   uint8_t data[8]    = {0};
+
+   co_vbus_listen_only (a, true);
+   EXPECT_EQ (-1, co_vbus_send (a, 0x181, data, 8));
+   co_vbus_listen_only (a, false);
+   EXPECT_EQ (0, co_vbus_send (a, 0x181, data, 8));
+}
+
+TEST_F (VbusTest, ConcurrentSenders)
+{
+   co_vbus_node_t * rx = co_vbus_open ("test", NULL, NULL);
+   std::vector<std::thread> senders;
+   unsigned int received[4] = {0};
+   uint8_t data[8];
+   uint32_t id;
+   size_t dlc;
+
+   // Frames sent while another thread arbitrates must not be stranded
+   for (uint32_t sender = 0; sender < 4; sender++)
+   {
+      co_vbus_node_t * node = co_vbus_open ("test", NULL, NULL);
+
+      senders.emplace_back ([node, sender]() {
+         uint8_t count = 0;
+
+         for (unsigned int ix = 0; ix < 200; ix++, count++)
+         {
+            while (co_vbus_send (node, 0x100 + sender, &count, 1) != 0)
+               std::this_thread::yield();
+         }
+      });
+   }
+
+   for (std::thread & sender : senders)
+      sender.join();
+
+   while (co_vbus_receive (rx, &id, data, &dlc) == 0)
+   {
+      uint32_t sender = id - 0x100;
+
+      ASSERT_LT (sender, 4u);
+      EXPECT_EQ ((uint8_t)received[sender], data[0]);
+      received[sender]++;
+   }
+
+   for (unsigned int count : received)
+      EXPECT_EQ (200u, count);
+}
+
+TEST_F (VbusTest, ConcurrentOpen)
+{
+   std::vector<co_vbus_node_t *> nodes[4];
+   std::vector<std::thread> openers;
+   std::set<co_vbus_node_t *> unique;
+
+   // Buses are created and channels allocated by several threads
+   for (unsigned int opener = 0; opener < 4; opener++)
+   {
+      openers.emplace_back ([&nodes, opener]() {
+         for (unsigned int ix = 0; ix < CO_VBUS_NODES / 4; ix++)
+         {
+            nodes[opener].push_back (co_vbus_open ("open", NULL, NULL));
+         }
+      });
+   }
+
+   for (std::thread & opener : openers)
+      opener.join();
+
+   for (const auto & opened : nodes)
+   {
+      for (co_vbus_node_t * node : opened)
+      {
+         EXPECT_NE (nullptr, node);
+         unique.insert (node);
+      }
+   }
+
+   EXPECT_EQ ((size_t)CO_VBUS_NODES, unique.size());
+   EXPECT_EQ (nullptr, co_vbus_open ("open", NULL, NULL));
+
+   co_vbus_destroy ("open");
+}
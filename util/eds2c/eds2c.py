@@ -0,0 +1,678 @@
+#!/usr/bin/env python3
+#********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2017 rt-labs AB, Sweden.
+#
+# This software is dual-licensed under GPLv3 and a commercial
+# license. See the file LICENSE.md distributed with this software for
+# full license information.
+#*******************************************************************/
+
+"""Generate a c-open object dictionary from an EDS or DCF file.
+
+The generated source file contains the entry descriptors, the object
+descriptors sorted by index, storage for all entries that need it and
+the default values as a co_default_t table. The generated header
+declares the storage so that the application can access it directly.
+
+Objects implemented by the stack (e.g. 1001h, 1017h, 1400h-1BFFh) are
+mapped to the descriptors and access functions in co_obj.h. Their
+size is checked against the stack limits.
+
+The file is validated while generating. Duplicated or inconsistent
+objects, unknown datatypes and bad PDO mappings are reported as
+errors and no output is written.
+"""
+
+import argparse
+import configparser
+import os
+import re
+import sys
+
+# Datatypes supported by the dictionary, see co_dtype_t. The tuple
+# holds the enum name, the bitlength and the C type used for storage.
+DATATYPES = {
+    0x0001: ("DTYPE_BOOLEAN", 1, "bool"),
+    0x0002: ("DTYPE_INTEGER8", 8, "int8_t"),
+    0x0003: ("DTYPE_INTEGER16", 16, "int16_t"),
+    0x0004: ("DTYPE_INTEGER32", 32, "int32_t"),
+    0x0005: ("DTYPE_UNSIGNED8", 8, "uint8_t"),
+    0x0006: ("DTYPE_UNSIGNED16", 16, "uint16_t"),
+    0x0007: ("DTYPE_UNSIGNED32", 32, "uint32_t"),
+    0x0008: ("DTYPE_REAL32", 32, "float"),
+    0x0009: ("DTYPE_VISIBLE_STRING", None, "char"),
+    0x000A: ("DTYPE_OCTET_STRING", None, "uint8_t"),
+    0x000B: ("DTYPE_UNICODE_STRING", None, "uint8_t"),
+    0x0011: ("DTYPE_REAL64", 64, "double"),
+    0x0015: ("DTYPE_INTEGER64", 64, "int64_t"),
+    0x001B: ("DTYPE_UNSIGNED64", 64, "uint64_t"),
+}
+
+STRINGS = (0x0009, 0x000A, 0x000B)
+
+# Objects implemented by the stack. The tuple holds the entry
+# descriptor, the access function and the max subindex. The stack
+# sizes its tables from the dictionary, so a max subindex given as
+# ("EDS", limit) is taken from the EDS file, up to the limit.
+STACK_OBJECTS = {
+    0x1001: ("OD1001", "co_od1001_fn", "0"),
+    0x1003: ("OD1003", "co_od1003_fn", ("EDS", 254)),
+    0x1005: ("OD1005", "co_od1005_fn", "0"),
+    0x1006: ("OD1006", "co_od1006_fn", "0"),
+    0x1007: ("OD1007", "co_od1007_fn", "0"),
+    0x100C: ("OD100C", "co_od100C_fn", "0"),
+    0x100D: ("OD100D", "co_od100D_fn", "0"),
+    0x1010: ("OD1010", "co_od1010_fn", "4"),
+    0x1011: ("OD1011", "co_od1011_fn", "4"),
+    0x1014: ("OD1014", "co_od1014_fn", "0"),
+    0x1015: ("OD1015", "co_od1015_fn", "0"),
+    0x1016: ("OD1016", "co_od1016_fn", ("EDS", 127)),
+    0x1017: ("OD1017", "co_od1017_fn", "0"),
+    0x1019: ("OD1019", "co_od1019_fn", "0"),
+    0x1020: ("OD1020", "co_od1020_fn", "2"),
+    0x1028: ("OD1028", "co_od1028_fn", ("EDS", 254)),
+    0x1029: ("OD1029", "co_od1029_fn", "1"),
+}
+
+# PDO parameter objects implemented by the stack, as ranges
+STACK_RANGES = (
+    (0x1400, 0x15FF, "OD1400", "co_od1400_fn", "5"),
+    (0x1600, 0x17FF, "OD1600", "co_od1600_fn", ("EDS", 64)),
+    (0x1800, 0x19FF, "OD1800", "co_od1800_fn", "6"),
+    (0x1A00, 0x1BFF, "OD1A00", "co_od1A00_fn", ("EDS", 64)),
+)
+
+OTYPES = {
+    0x7: "OTYPE_VAR",
+    0x8: "OTYPE_ARRAY",
+    0x9: "OTYPE_RECORD",
+}
+
+
+class EdsError(Exception):
+    pass
+
+
+class Entry:
+    def __init__(self, index, subindex, section):
+        self.index = index
+        self.subindex = subindex
+        self.name = section.get("parametername", "")
+        self.datatype = parse_int(section.get("datatype"), index, subindex)
+        self.access = section.get("accesstype", "ro").strip().lower()
+        self.mappable = parse_int(section.get("pdomapping", "0"), index, subindex)
+        self.default = section.get("parametervalue", section.get("defaultvalue"))
+        self.storage = None
+
+    def where(self):
+        return "{:04X}sub{:X}".format(self.index, self.subindex)
+
+    def flags(self):
+        flags = []
+        if self.access in ("ro", "const"):
+            flags.append("OD_RO")
+        elif self.access == "wo":
+            flags.append("OD_WO")
+        elif self.access in ("rw", "rwr", "rww"):
+            flags.append("OD_RW")
+        else:
+            raise EdsError(
+                "{}: bad AccessType {}".format(self.where(), self.access)
+            )
+        if self.mappable:
+            if self.access in ("ro", "const", "rw", "rwr"):
+                flags.append("OD_TPDO")
+            if self.access in ("wo", "rw", "rww"):
+                # Process data is not persisted
+                flags.append("OD_RPDO")
+                flags.append("OD_TRANSIENT")
+                flags.insert(0, "OD_NOTIFY")
+        elif self.access == "wo" and self.is_string():
+            # Commands are not persisted
+            flags.append("OD_TRANSIENT")
+        return flags
+
+    def is_string(self):
+        return self.datatype in STRINGS
+
+    def is_constant(self):
+        """Constant scalars up to 32 bits are kept in the descriptor"""
+        return (
+            self.access in ("ro", "const")
+            and not self.mappable
+            and not self.is_string()
+            and DATATYPES[self.datatype][1] <= 32
+        )
+
+
+class Object:
+    def __init__(self, index, section):
+        self.index = index
+        self.name = section.get("parametername", "")
+        self.objtype = parse_int(section.get("objecttype", "7"), index)
+        self.subnumber = parse_int(section.get("subnumber", "0"), index)
+        self.entries = []
+        self.stack = stack_object(index)
+
+    def where(self):
+        return "{:04X}".format(self.index)
+
+    def max_subindex(self):
+        if self.objtype == 0x7:
+            return 0
+        return max(e.subindex for e in self.entries)
+
+
+def to_int(s):
+    """Convert integer as formatted in EDS files (see CiA 306)"""
+    s = s.strip()
+    if s.lower().startswith("0x"):
+        return int(s, 16)
+    if len(s) > 1 and s.startswith("0"):
+        return int(s, 8)
+    return int(s, 10)
+
+
+def parse_int(s, index, subindex=None):
+    where = "{:04X}".format(index)
+    if subindex is not None:
+        where += "sub{:X}".format(subindex)
+    if s is None:
+        raise EdsError("{}: missing value".format(where))
+    s = s.strip()
+    try:
+        if s.upper().startswith("$NODEID"):
+            # Node-ID relative values must be resolved by the caller
+            raise EdsError("{}: unexpected $NODEID".format(where))
+        return to_int(s)
+    except ValueError:
+        raise EdsError("{}: bad value {}".format(where, s))
+
+
+def parse_default(entry):
+    """Return default value of entry as a C expression, or None"""
+    s = entry.default
+    if s is None or s.strip() == "":
+        return None
+    s = s.strip()
+    m = re.match(r"^\$NODEID\s*\+\s*(\S+)$", s, re.IGNORECASE)
+    if m:
+        return ("{} + NODE_ID".format(m.group(1)), True)
+    if entry.is_string():
+        return (s, False)
+    try:
+        value = to_int(s)
+    except ValueError:
+        raise EdsError("{}: bad DefaultValue {}".format(entry.where(), s))
+    return (value, False)
+
+
+def stack_object(index):
+    if index in STACK_OBJECTS:
+        return STACK_OBJECTS[index]
+    for low, high, entries, fn, max_subindex in STACK_RANGES:
+        if low <= index <= high:
+            return (entries, fn, max_subindex)
+    return None
+
+
+def read_eds(filename):
+    parser = configparser.ConfigParser(
+        strict=True,
+        interpolation=None,
+        comment_prefixes=(";", "#"),
+        inline_comment_prefixes=(";",),
+    )
+    try:
+        with open(filename, encoding="latin-1") as f:
+            parser.read_file(f)
+    except (configparser.Error, OSError) as e:
+        raise EdsError(str(e))
+
+    # Sections are case-insensitive in EDS files
+    sections = {name.upper(): parser[name] for name in parser.sections()}
+
+    node_id = None
+    if "DEVICECOMISSIONING" in sections:
+        node_id = sections["DEVICECOMISSIONING"].get("nodeid")
+
+    indexes = []
+    for name in sections:
+        if re.match(r"^[0-9A-F]{4}$", name):
+            indexes.append(int(name, 16))
+
+    objects = []
+    for index in sorted(indexes):
+        section = sections["{:04X}".format(index)]
+        obj = Object(index, section)
+        if "compactsubobj" in section:
+            raise EdsError("{}: CompactSubObj is not supported".format(obj.where()))
+        if obj.objtype == 0x7:
+            obj.entries.append(Entry(index, 0, section))
+        elif obj.objtype in (0x8, 0x9):
+            for subindex in range(256):
+                name = "{:04X}SUB{:X}".format(index, subindex)
+                if name in sections:
+                    obj.entries.append(Entry(index, subindex, sections[name]))
+        else:
+            raise EdsError(
+                "{}: unsupported ObjectType {:#x}".format(obj.where(), obj.objtype)
+            )
+        objects.append(obj)
+
+    return objects, node_id
+
+
+def validate(objects):
+    for obj in objects:
+        for entry in obj.entries:
+            if entry.datatype not in DATATYPES:
+                raise EdsError(
+                    "{}: unsupported DataType {:#06x}".format(
+                        entry.where(), entry.datatype
+                    )
+                )
+            if entry.mappable and entry.is_string():
+                raise EdsError("{}: strings are not PDO mappable".format(entry.where()))
+
+        if obj.objtype == 0x7:
+            continue
+
+        if len(obj.entries) == 0 or obj.entries[0].subindex != 0:
+            raise EdsError("{}: subindex 0 is missing".format(obj.where()))
+
+        if obj.subnumber != len(obj.entries):
+            raise EdsError(
+                "{}: SubNumber is {} but {} subindexes are described".format(
+                    obj.where(), obj.subnumber, len(obj.entries)
+                )
+            )
+
+        sub0 = obj.entries[0]
+        if sub0.datatype != 0x0005:
+            raise EdsError("{}: subindex 0 must be UNSIGNED8".format(sub0.where()))
+
+        if obj.stack is None:
+            value = parse_default(sub0)
+            if value is None or value[1] or value[0] != obj.max_subindex():
+                raise EdsError(
+                    "{}: DefaultValue must be max subindex {}".format(
+                        sub0.where(), obj.max_subindex()
+                    )
+                )
+
+        if obj.objtype == 0x8:
+            first = obj.entries[1] if len(obj.entries) > 1 else None
+            for entry in obj.entries[1:]:
+                if entry.datatype != first.datatype:
+                    raise EdsError(
+                        "{}: ARRAY members must have the same DataType".format(
+                            entry.where()
+                        )
+                    )
+
+
+def c_string(s):
+    return '"' + s.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+class Generator:
+    def __init__(self, objects, name, prefix, node_id, string_length):
+        self.objects = objects
+        self.name = name
+        self.prefix = prefix
+        self.macro = prefix.upper()
+        self.node_id = node_id
+        self.string_length = string_length
+        self.storage = []
+        self.defaults = []
+        self.asserts = []
+
+    def symbol(self, entry, obj):
+        if obj.objtype == 0x7:
+            return "{}_{:04X}".format(self.prefix, entry.index)
+        return "{}_{:04X}_{:02X}".format(self.prefix, entry.index, entry.subindex)
+
+    def default_expr(self, value):
+        expr, relative = value
+        if relative:
+            return expr.replace("NODE_ID", self.macro + "_NODE_ID")
+        if expr < 0:
+            return str(expr)
+        return "0x{:X}".format(expr)
+
+    def plan(self):
+        for obj in self.objects:
+            if obj.stack is not None:
+                self.plan_stack(obj)
+            else:
+                self.plan_app(obj)
+
+    def plan_stack(self, obj):
+        max_subindex = obj.stack[2]
+        if obj.objtype != 0x7:
+            eds_max = obj.max_subindex()
+            if isinstance(max_subindex, tuple):
+                if eds_max > max_subindex[1]:
+                    raise EdsError(
+                        "{}: max subindex is {} but the stack supports {}".format(
+                            obj.where(), eds_max, max_subindex[1]
+                        )
+                    )
+            elif max_subindex.isdigit():
+                if int(max_subindex) != eds_max:
+                    raise EdsError(
+                        "{}: max subindex is {} but the stack implements {}".format(
+                            obj.where(), eds_max, max_subindex
+                        )
+                    )
+            else:
+                expr = "{} == {}".format(max_subindex, eds_max)
+                if expr not in self.asserts:
+                    self.asserts.append(expr)
+
+        # Only the PDO parameters have application specific
+        # defaults. Other stack objects are restored by the stack.
+        if obj.index < 0x1400:
+            return
+        for entry in obj.entries:
+            value = parse_default(entry)
+            if value is None or value == (0, False):
+                continue
+            if entry.access in ("ro", "const"):
+                continue
+            self.defaults.append((entry, value))
+
+    def plan_app(self, obj):
+        entries = obj.entries
+        if obj.objtype == 0x8 and len(entries) > 1:
+            # Members of ARRAY objects are stored as a C array
+            first = entries[1]
+            first.storage = (
+                DATATYPES[first.datatype][2],
+                "{}_{:04X}".format(self.prefix, obj.index),
+                "[{}]".format(len(entries) - 1),
+            )
+            self.storage.append((obj, first, None))
+            for entry in entries[1:]:
+                value = parse_default(entry)
+                if value is not None and value != (0, False):
+                    self.defaults.append((entry, value))
+            return
+
+        for entry in entries:
+            if entry.subindex == 0 and obj.objtype != 0x7:
+                continue
+            if entry.is_constant():
+                continue
+            ctype = DATATYPES[entry.datatype][2]
+            value = parse_default(entry)
+            init = None
+            if entry.is_string():
+                text = value[0] if value is not None else ""
+                size = len(text.encode("latin-1")) + 1
+                if value is None:
+                    size = self.string_length
+                entry.storage = (ctype, self.symbol(entry, obj), "[{}]".format(size))
+                init = c_string(text) if text else None
+            else:
+                entry.storage = (ctype, self.symbol(entry, obj), "")
+                if value is not None and value != (0, False):
+                    self.defaults.append((entry, value))
+            self.storage.append((obj, entry, init))
+
+    def entry_line(self, obj, entry, compact=False):
+        dtype, bitlength, _ = DATATYPES[entry.datatype]
+        flags = entry.flags()
+        if compact:
+            flags.append("OD_ARRAY")
+        flags = " | ".join(flags)
+
+        value = "0"
+        data = "NULL"
+        if entry.storage is not None:
+            ctype, symbol, dim = entry.storage
+            data = symbol if dim else "&" + symbol
+            if bitlength is None or compact:
+                bitlength = "8 * sizeof ({}{})".format(
+                    symbol, "[0]" if compact else ""
+                )
+                if compact and DATATYPES[entry.datatype][1] is not None:
+                    bitlength = str(DATATYPES[entry.datatype][1])
+        elif entry.subindex == 0 and obj.objtype != 0x7:
+            value = str(obj.max_subindex())
+        else:
+            default = parse_default(entry)
+            if default is not None:
+                if default[1]:
+                    raise EdsError(
+                        "{}: $NODEID requires a writable entry".format(entry.where())
+                    )
+                value = self.default_expr(default)
+
+        if entry.subindex == 0 and obj.objtype != 0x7:
+            flags = "OD_RO"
+
+        return "   {{0x{:02X}, {}, {}, {}, {}, {}}},".format(
+            entry.subindex, flags, dtype, bitlength, value, data
+        )
+
+    def write_header(self, f, basename):
+        guard = basename.upper().replace(".", "_").replace("-", "_")
+        f.write(BANNER)
+        f.write(
+            "\n/* This file was generated by eds2c.py. Do not edit. */\n\n"
+            "#ifndef {0}\n"
+            "#define {0}\n\n"
+            "#ifdef __cplusplus\n"
+            'extern "C" {{\n'
+            "#endif\n\n"
+            "#include <stdbool.h>\n"
+            "#include <stdint.h>\n\n"
+            '#include "co_api.h"\n\n'
+            "/** Node ID used for $NODEID relative default values */\n"
+            "#ifndef {1}_NODE_ID\n"
+            "#define {1}_NODE_ID {2}\n"
+            "#endif\n\n"
+            "/** Number of objects in dictionary */\n"
+            "#define {1}_OD_SIZE {3}\n\n".format(
+                guard, self.macro, self.node_id, len(self.objects)
+            )
+        )
+
+        for obj, entry, _ in self.storage:
+            ctype, symbol, dim = entry.storage
+            name = entry.name if obj.objtype == 0x7 else obj.name
+            if obj.objtype == 0x9:
+                name += " - " + entry.name
+            f.write("/** {} ({:04X}h) */\n".format(name, obj.index))
+            f.write("extern {} {}{};\n\n".format(ctype, symbol, dim))
+
+        f.write(
+            "/** Object dictionary, sorted by index */\n"
+            "extern const co_obj_t {0}_od[];\n\n"
+            "/** Default values to be set when the NMT state INIT is entered */\n"
+            "extern const co_default_t {0}_defaults[];\n\n"
+            "#ifdef __cplusplus\n"
+            "}}\n"
+            "#endif\n\n"
+            "#endif /* {1} */\n".format(self.prefix, guard)
+        )
+
+    def write_source(self, f, header):
+        f.write(BANNER)
+        f.write(
+            "\n/* This file was generated by eds2c.py. Do not edit. */\n\n"
+            '#include "{}"\n'
+            '#include "co_obj.h"\n\n'
+            '#include "osal.h"\n\n'.format(header)
+        )
+
+        # Static assertions on layout. Integer types have exact widths,
+        # but the size of floating point types depends on the compiler.
+        asserts = list(self.asserts)
+        for obj, entry, _ in self.storage:
+            _, bitlength, ctype = DATATYPES[entry.datatype]
+            if ctype in ("float", "double"):
+                expr = "8 * sizeof ({}) == {}".format(ctype, bitlength)
+                if expr not in asserts:
+                    asserts.append(expr)
+        for expr in asserts:
+            f.write("CC_STATIC_ASSERT ({});\n".format(expr))
+        if asserts:
+            f.write("\n")
+
+        # Storage
+        for obj, entry, init in self.storage:
+            ctype, symbol, dim = entry.storage
+            if init is not None:
+                f.write("{} {}{} = {};\n".format(ctype, symbol, dim, init))
+            else:
+                f.write("{} {}{};\n".format(ctype, symbol, dim))
+        f.write("\n")
+
+        # Entry descriptors
+        for obj in self.objects:
+            if obj.stack is not None:
+                continue
+            f.write(
+                "/* Entry descriptor for {} ({:04X}h) */\n"
+                "static const co_entry_t OD{:04X}[] = {{\n".format(
+                    obj.name, obj.index, obj.index
+                )
+            )
+            if obj.objtype == 0x8 and len(obj.entries) > 1:
+                f.write(self.entry_line(obj, obj.entries[0]) + "\n")
+                f.write(self.entry_line(obj, obj.entries[1], True) + "\n")
+            else:
+                for entry in obj.entries:
+                    f.write(self.entry_line(obj, entry) + "\n")
+            f.write("};\n\n")
+
+        # Object descriptors
+        f.write(
+            "/* Object dictionary, sorted by index */\n"
+            "const co_obj_t {}_od[] = {{\n"
+            "   // clang-format off\n".format(self.prefix)
+        )
+        for obj in self.objects:
+            if obj.stack is not None:
+                entries, fn, max_subindex = obj.stack
+                if isinstance(max_subindex, tuple):
+                    max_subindex = str(obj.max_subindex())
+            else:
+                entries = "OD{:04X}".format(obj.index)
+                fn = "NULL"
+                max_subindex = str(obj.max_subindex())
+            f.write(
+                "   {{0x{:04X}, {:<13} {:<16} {}, {}, NULL}},\n".format(
+                    obj.index,
+                    OTYPES[obj.objtype] + ",",
+                    max_subindex + ",",
+                    entries,
+                    fn,
+                )
+            )
+        f.write("   {0},\n   // clang-format on\n};\n\n")
+        f.write(
+            "CC_STATIC_ASSERT (NELEMENTS ({}_od) == {}_OD_SIZE + 1);\n\n".format(
+                self.prefix, self.macro
+            )
+        )
+
+        # Default values
+        f.write(
+            "/* Default values to be set when the NMT state INIT is entered */\n"
+            "const co_default_t {}_defaults[] = {{\n".format(self.prefix)
+        )
+        for entry, value in self.defaults:
+            if entry.is_string():
+                continue
+            f.write(
+                "   {{0x{:04X}, {}, {}}},\n".format(
+                    entry.index, entry.subindex, self.default_expr(value)
+                )
+            )
+        f.write("   {0},\n};\n")
+
+
+BANNER = """/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \\ / __|
+ * | |   | |_  _ | || (_| || |_) |\\__ \\
+ * |_|    \\__|(_)|_| \\__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2017 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Generate a c-open object dictionary from an EDS or DCF file"
+    )
+    parser.add_argument("input", help="EDS or DCF file")
+    parser.add_argument(
+        "-o", "--output", required=True, help="output basename (without extension)"
+    )
+    parser.add_argument(
+        "-p", "--prefix", help="symbol prefix (default: output basename)"
+    )
+    parser.add_argument(
+        "-n",
+        "--node-id",
+        type=lambda s: int(s, 0),
+        help="node ID for $NODEID values (default: DCF NodeID or 1)",
+    )
+    parser.add_argument(
+        "--string-length",
+        type=int,
+        default=32,
+        help="size of strings without DefaultValue (default: 32)",
+    )
+    args = parser.parse_args()
+
+    basename = os.path.basename(args.output)
+    prefix = args.prefix or re.sub(r"\W", "_", basename)
+
+    try:
+        objects, node_id = read_eds(args.input)
+        validate(objects)
+        if args.node_id is not None:
+            node_id = args.node_id
+        elif node_id is not None:
+            node_id = to_int(node_id)
+        else:
+            node_id = 1
+        if not 1 <= node_id <= 127:
+            raise EdsError("bad node ID {}".format(node_id))
+
+        gen = Generator(objects, basename, prefix, node_id, args.string_length)
+        gen.plan()
+
+        with open(args.output + ".h", "w") as f:
+            gen.write_header(f, basename + ".h")
+        with open(args.output + ".c", "w") as f:
+            gen.write_source(f, basename + ".h")
+    except EdsError as e:
+        sys.stderr.write("{}: error: {}\n".format(args.input, e))
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -21,15 +21,31 @@ int main (int argc, char * argv[])
 {
    uint8_t node;
    uint32_t bitrate;
+   uint32_t expected[4] = {0};
+   int ix;
 
-   if (argc != 4)
+   if (argc < 4)
    {
-      printf ("usage: %s <canif> <node> <bitrate>\n", argv[0]);
+      printf ("usage: %s <canif> <node> <bitrate> [expected nodes...]\n", argv[0]);
       return -1;
    }
 
    node    = atoi (argv[2]);
    bitrate = atoi (argv[3]);
 
-   return slaveinfo (argv[1], node, bitrate);
+   /* Optional list of nodes to wait for */
+   for (ix = 4; ix < argc; ix++)
+   {
+      int id = atoi (argv[ix]);
+
+      if (id < 1 || id > 127)
+      {
+         printf ("bad node %s\n", argv[ix]);
+         return -1;
+      }
+
+      expected[id / 32] |= 1u << (id % 32);
+   }
+
+   return slaveinfo (argv[1], node, bitrate, (argc > 4) ? expected : NULL);
 }
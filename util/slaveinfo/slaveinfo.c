@@ -22,13 +22,19 @@
 
 #include "osal.h"
 
-int slaveinfo (const char * canif, uint8_t node, int bitrate)
+int slaveinfo (
+   const char * canif,
+   uint8_t node,
+   int bitrate,
+   const uint32_t * expected)
 {
    co_net_t * net;
    co_cfg_t cfg = {0};
    co_client_t * client;
+   uint32_t all[4];
+   uint32_t timeout = 2000;
    static const co_obj_t od_none[] = {
-      {0, OTYPE_NULL, 0, NULL, NULL},
+      {0, OTYPE_NULL, 0, NULL, NULL, NULL},
    };
 
    cfg.node    = node;
@@ -49,8 +55,21 @@ int slaveinfo (const char * canif, uint8_t node, int bitrate)
       return -1;
    }
 
+   if (expected == NULL)
+   {
+      /* Nodes are unknown, allow time for all nodes to boot */
+      memset (all, 0xFF, sizeof (all));
+      all[0] &= ~BIT (0);
+      all[node / 32] &= ~BIT (node % 32);
+      expected = all;
+      timeout  = 500;
+   }
+
    co_nmt (client, CO_NMT_RESET_COMMUNICATION, 0);
-   os_usleep (500 * 1000); /* TODO: how to sync with slave responses? */
+   if (co_bootup_wait (client, expected, NULL, timeout) < 0 && expected != all)
+   {
+      printf ("Not all expected nodes booted\n");
+   }
 
    node = co_node_next (client, 0);
    if (node == 0)
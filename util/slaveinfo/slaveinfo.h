@@ -22,7 +22,11 @@ extern "C" {
 
 #include <stdint.h>
 
-int slaveinfo (const char * canif, uint8_t node, int bitrate);
+int slaveinfo (
+   const char * canif,
+   uint8_t node,
+   int bitrate,
+   const uint32_t * expected);
 
 #ifdef __cplusplus
 }
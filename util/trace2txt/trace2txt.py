@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+#********************************************************************
+#        _       _         _
+#  _ __ | |_  _ | |  __ _ | |__   ___
+# | '__|| __|(_)| | / _` || '_ \ / __|
+# | |   | |_  _ | || (_| || |_) |\__ \
+# |_|    \__|(_)|_| \__,_||_.__/ |___/
+#
+# www.rt-labs.com
+# Copyright 2017 rt-labs AB, Sweden.
+#
+# This software is dual-licensed under GPLv3 and a commercial
+# license. See the file LICENSE.md distributed with this software for
+# full license information.
+#*******************************************************************/
+
+"""Decode a c-open CAN trace dump.
+
+The dump is written by co_trace_dump(), see co_api.h. Frames are
+printed one per line, oldest first, either in the format of the CAN
+debug log or as a candump log file that can be replayed with the
+can-utils.
+"""
+
+import argparse
+import struct
+import sys
+
+TRACE_MAGIC = 0x52544F43
+TRACE_VERSION = 1
+
+HEADER = struct.Struct("<IHHII")
+RECORD = struct.Struct("<QIBBH8s")
+
+CO_RTR_MASK = 1 << 30
+CO_EXT_MASK = 1 << 29
+CO_ID_MASK = 0x1FFFFFFF
+CO_TRACE_TX = 0x01
+
+
+class TraceError(Exception):
+    pass
+
+
+def read_trace(data):
+    """Return ticks per second and a list of frames in data.
+
+    Each frame is a tuple of timestamp (ticks), CAN ID including RTR
+    and extended flags, transmit flag and payload.
+    """
+    if len(data) < HEADER.size:
+        raise TraceError("truncated header")
+
+    magic, version, record_size, rate, _ = HEADER.unpack_from(data)
+    if magic != TRACE_MAGIC:
+        raise TraceError("not a trace dump")
+    if version != TRACE_VERSION:
+        raise TraceError("unsupported version {}".format(version))
+    if record_size < RECORD.size or rate == 0:
+        raise TraceError("bad header")
+
+    frames = []
+    for offset in range(HEADER.size, len(data) - record_size + 1, record_size):
+        timestamp, id, flags, dlc, _, payload = RECORD.unpack_from(data, offset)
+        dlc = min(dlc, 8)
+        frames.append((timestamp, id, bool(flags & CO_TRACE_TX), dlc, payload[:dlc]))
+
+    if (len(data) - HEADER.size) % record_size:
+        sys.stderr.write("warning: ignoring truncated record\n")
+
+    return rate, frames
+
+
+def format_log(time, id, tx, dlc, payload):
+    if id & CO_RTR_MASK:
+        data = " RTR {}".format(dlc)
+    else:
+        data = "".join(" {:02x}".format(b) for b in payload)
+    return "{:12.6f} {} {:04x}:{}".format(
+        time, "Tx" if tx else "Rx", id & CO_ID_MASK, data
+    )
+
+
+def format_candump(time, id, tx, dlc, payload, interface):
+    if id & CO_EXT_MASK:
+        cobid = "{:08X}".format(id & CO_ID_MASK)
+    else:
+        cobid = "{:03X}".format(id & CO_ID_MASK)
+    if id & CO_RTR_MASK:
+        data = "R"
+    else:
+        data = payload.hex().upper()
+    return "({:.6f}) {} {}#{}".format(time, interface, cobid, data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a c-open CAN trace dump")
+    parser.add_argument("input", help="trace dump file")
+    parser.add_argument(
+        "-c",
+        "--candump",
+        action="store_true",
+        help="write candump log format (default: CAN debug log format)",
+    )
+    parser.add_argument(
+        "-i",
+        "--interface",
+        default="can0",
+        help="interface name in candump log (default: can0)",
+    )
+    parser.add_argument(
+        "-r",
+        "--relative",
+        action="store_true",
+        help="print time relative to first frame",
+    )
+    args = parser.parse_args()
+
+    try:
+        with open(args.input, "rb") as f:
+            rate, frames = read_trace(f.read())
+    except (OSError, TraceError) as e:
+        sys.stderr.write("{}: error: {}\n".format(args.input, e))
+        return 1
+
+    start = frames[0][0] if frames and args.relative else 0
+    for timestamp, id, tx, dlc, payload in frames:
+        time = (timestamp - start) / rate
+        if args.candump:
+            line = format_candump(time, id, tx, dlc, payload, args.interface)
+        else:
+            line = format_log(time, id, tx, dlc, payload)
+        print(line)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())